@@ -25,7 +25,7 @@ public class AiBridge : ModuleRules
 		PublicDependencyModuleNames.AddRange(
 			new string[]
 			{
-				"Core", "WebSockets", "HTTP", "Json", "JsonUtilities"
+				"Core", "WebSockets", "HTTP", "Json", "JsonUtilities", "DeveloperSettings"
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);
@@ -38,6 +38,9 @@ public class AiBridge : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
+				"UMG",
+				"Sockets",
+				"SSL",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
@@ -49,5 +52,20 @@ public class AiBridge : ModuleRules
 				// ... add any modules that your module loads dynamically here ...
 			}
 			);
+
+		// ws:// and wss:// run on the AiBridge I/O thread over platform sockets, wss:// with the engine's OpenSSL
+		AddEngineThirdPartyPrivateStaticDependencies(Target, "OpenSSL");
+
+		// opus_* TTS formats are decoded with the engine's libOpus on the platforms that ship it
+		bool bWithOpus = Target.Platform == UnrealTargetPlatform.Win64
+			|| Target.Platform == UnrealTargetPlatform.Mac
+			|| Target.Platform == UnrealTargetPlatform.Linux
+			|| Target.Platform == UnrealTargetPlatform.Android
+			|| Target.Platform == UnrealTargetPlatform.IOS;
+		if (bWithOpus)
+		{
+			AddEngineThirdPartyPrivateStaticDependencies(Target, "libOpus");
+		}
+		PrivateDefinitions.Add("WITH_AIBRIDGE_OPUS=" + (bWithOpus ? "1" : "0"));
 	}
 }
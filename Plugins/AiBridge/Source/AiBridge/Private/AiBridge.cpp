@@ -1,6 +1,7 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "AiBridge.h"
+#include "Logging/AiBridgeLog.h"
 
 #define LOCTEXT_NAMESPACE "FAiBridgeModule"
 
@@ -13,6 +14,7 @@ void FAiBridgeModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	AiBridgeLog::Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
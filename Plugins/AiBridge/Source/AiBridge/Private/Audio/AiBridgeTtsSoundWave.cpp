@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Audio/AiBridgeTtsSoundWave.h"
+
+UAiBridgeTtsSoundWave::UAiBridgeTtsSoundWave(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	SampleByteSize = sizeof(float);
+	bLooping = false;
+
+	// Between replies the sound is silent but must keep pulling, or the next reply would not be heard
+	VirtualizationMode = EVirtualizationMode::PlayWhenSilent;
+}
+
+void UAiBridgeTtsSoundWave::SetStage(const TSharedPtr<FAudioDecodeStage, ESPMode::ThreadSafe>& InStage)
+{
+	Stage = InStage;
+	if (Stage.IsValid())
+	{
+		SetSampleRate(Stage->GetOutputSampleRate());
+		NumChannels = Stage->GetOutputChannels();
+	}
+}
+
+int32 UAiBridgeTtsSoundWave::OnGeneratePCMAudio(TArray<uint8>& OutAudio, int32 NumSamples)
+{
+	OutAudio.Reset();
+	OutAudio.AddZeroed(NumSamples * sizeof(float));
+
+	// What the stage has not decoded yet plays as silence rather than stopping the sound
+	if (Stage.IsValid())
+	{
+		Stage->Read(reinterpret_cast<float*>(OutAudio.GetData()), NumSamples / Stage->GetOutputChannels());
+	}
+	return NumSamples;
+}
@@ -0,0 +1,270 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Audio/AudioDecodeStage.h"
+#include "Logging/AiBridgeLog.h"
+#include "AudioDevice.h"
+#include "Engine/Engine.h"
+#include "Misc/ScopeExit.h"
+
+namespace AudioDecodeStage
+{
+	/** Mixer rate when there is no audio device, e.g. -nosound or a dedicated server */
+	constexpr int32 FallbackSampleRate = 48000;
+
+	int32 GetMixerSampleRate()
+	{
+		FAudioDevice* AudioDevice = GEngine != nullptr ? GEngine->GetMainAudioDeviceRaw() : nullptr;
+		return AudioDevice != nullptr ? (int32)AudioDevice->GetSampleRate() : FallbackSampleRate;
+	}
+}
+
+FAudioDecodeStage::FAudioDecodeStage(int32 OutputSampleRate, int32 InOutputChannels, int32 InBlockFrames, int32 NumBlocks, TSharedPtr<FAiBridgeMemoryStream, ESPMode::ThreadSafe> InMemory)
+	: Pipe(TEXT("AiBridgeAudioDecodePipe"))
+	, OutputRate(OutputSampleRate > 0 ? OutputSampleRate : AudioDecodeStage::GetMixerSampleRate())
+	, OutputChannels(FMath::Max(InOutputChannels, 1))
+	, BlockFrames(FMath::Max(InBlockFrames, 64))
+	, Memory(MoveTemp(InMemory))
+{
+	LLM_SCOPE_BYTAG(AiBridge_Audio);
+
+	// Allocated up front so steady-state streaming never touches the allocator
+	for (int32 Index = 0; Index < NumBlocks; ++Index)
+	{
+		TUniquePtr<FAudioPcmBlock>& Block = Blocks.Add_GetRef(MakeUnique<FAudioPcmBlock>());
+		Block->Samples.SetNumUninitialized(BlockFrames * OutputChannels);
+		Free.Enqueue(Block.Get());
+
+		if (Memory)
+		{
+			Memory->Add(EAiBridgeMemoryCategory::Audio, GetBlockBytes());
+		}
+	}
+}
+
+FAudioDecodeStage::~FAudioDecodeStage()
+{
+	Flush();
+
+	if (Memory)
+	{
+		Memory->Remove(EAiBridgeMemoryCategory::Audio, Blocks.Num() * GetBlockBytes());
+	}
+}
+
+bool FAudioDecodeStage::BeginStream(const FString& OutputFormat)
+{
+	TUniquePtr<IAudioChunkDecoder> NewDecoder = AiBridgeAudio::CreateDecoder(OutputFormat);
+	const bool bSupported = NewDecoder.IsValid();
+	const uint32 NewStream = ++Stream;
+
+	Pipe.Launch(TEXT("AiBridgeAudioDecodeBegin"), [this, NewStream, NewDecoder = MoveTemp(NewDecoder)]() mutable
+	{
+		PipeStream = NewStream;
+		Decoder = MoveTemp(NewDecoder);
+
+		// A half-filled block of the previous stream is reused rather than queued
+		if (Writing != nullptr)
+		{
+			Writing->NumFrames = 0;
+			Writing->Stream = NewStream;
+		}
+
+		if (Decoder)
+		{
+			Resampler.Configure(Decoder->GetSampleRate(), OutputRate, Decoder->GetNumChannels(), OutputChannels);
+		}
+	});
+
+	// An unsupported format still ends the previous stream, its chunks are ignored
+	return bSupported;
+}
+
+void FAudioDecodeStage::PushEncoded(TArray<uint8>&& Chunk)
+{
+	// Chunks wait here while the decoder is busy, a stalled decoder must not queue them without bound
+	const int64 ChunkBytes = Chunk.GetAllocatedSize();
+	if (Memory && !Memory->TryAdd(EAiBridgeMemoryCategory::Audio, ChunkBytes))
+	{
+		Memory->NoteEvicted(EAiBridgeMemoryCategory::Audio, ChunkBytes);
+		++DroppedChunks;
+		AIBRIDGE_LOG_SAMPLED(50, Warning, "audio.chunk.dropped", FAiBridgeLogField::Int(TEXT("bytes"), Chunk.Num()), FAiBridgeLogField::Int(TEXT("budget"), Memory->GetBudget(EAiBridgeMemoryCategory::Audio)));
+		return;
+	}
+
+	Pipe.Launch(TEXT("AiBridgeAudioDecode"), [this, Chunk = MoveTemp(Chunk), ChunkBytes]()
+	{
+		LLM_SCOPE_BYTAG(AiBridge_Audio);
+
+		ON_SCOPE_EXIT
+		{
+			if (Memory)
+			{
+				Memory->Remove(EAiBridgeMemoryCategory::Audio, ChunkBytes);
+			}
+		};
+
+		if (!Decoder)
+		{
+			return;
+		}
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		Decoded.Reset();
+		if (!Decoder->Decode(Chunk, Decoded))
+		{
+			UE_LOG(LogAiBridge, Warning, TEXT("[AudioDecoder] Dropped a corrupt %d byte chunk"), Chunk.Num());
+		}
+
+		const int32 NumFrames = Decoded.Num() / Decoder->GetNumChannels();
+		Converted.Reset();
+		const int32 NumOut = Resampler.Process(Decoded.GetData(), NumFrames, Converted);
+		WriteFrames(Converted.GetData(), NumOut);
+
+		if (Tap && NumOut > 0)
+		{
+			Tap(TArrayView<const float>(Converted.GetData(), NumOut * OutputChannels));
+		}
+
+		// The tail of a chunk goes out with it, playback must not wait for the next chunk to fill the block
+		SubmitWriting();
+
+		++ChunksDecoded;
+		InputFrames += NumFrames;
+		OutputFrames += NumOut;
+		ProcessCycles += FPlatformTime::Cycles64() - StartCycles;
+	});
+}
+
+void FAudioDecodeStage::SetPcmTap(FAudioPcmTap&& InTap)
+{
+	// Swapped in order with the chunks, so a tap sees whole chunks and is never replaced while it runs
+	Pipe.Launch(TEXT("AiBridgeAudioDecodeTap"), [this, InTap = MoveTemp(InTap)]() mutable
+	{
+		Tap = MoveTemp(InTap);
+	});
+}
+
+int32 FAudioDecodeStage::Read(float* Out, int32 NumFrames)
+{
+	const uint32 CurrentStream = Stream;
+	int32 Copied = 0;
+
+	while (Copied < NumFrames)
+	{
+		if (Reading == nullptr)
+		{
+			if (!Filled.Dequeue(Reading))
+			{
+				break;
+			}
+			ReadFrame = 0;
+		}
+
+		if (Reading->Stream != CurrentStream)
+		{
+			BufferedFrames -= Reading->NumFrames - ReadFrame;
+			Free.Enqueue(Reading);
+			Reading = nullptr;
+			continue;
+		}
+
+		const int32 Count = FMath::Min(NumFrames - Copied, Reading->NumFrames - ReadFrame);
+		FMemory::Memcpy(Out + Copied * OutputChannels, Reading->Samples.GetData() + ReadFrame * OutputChannels, Count * OutputChannels * sizeof(float));
+		Copied += Count;
+		ReadFrame += Count;
+		BufferedFrames -= Count;
+
+		if (ReadFrame >= Reading->NumFrames)
+		{
+			Free.Enqueue(Reading);
+			Reading = nullptr;
+		}
+	}
+
+	return Copied;
+}
+
+void FAudioDecodeStage::Flush()
+{
+	Pipe.WaitUntilEmpty();
+}
+
+FAudioDecodeStats FAudioDecodeStage::GetStats() const
+{
+	FAudioDecodeStats Stats;
+	Stats.ChunksDecoded = ChunksDecoded;
+	Stats.InputFrames = InputFrames;
+	Stats.OutputFrames = OutputFrames;
+	Stats.ProcessSeconds = FPlatformTime::ToSeconds64(ProcessCycles);
+	Stats.ExtraBlocks = ExtraBlocks;
+	Stats.BufferedFrames = BufferedFrames;
+	Stats.DroppedChunks = DroppedChunks;
+	Stats.DroppedFrames = DroppedFrames;
+	return Stats;
+}
+
+FAudioPcmBlock* FAudioDecodeStage::AcquireBlock()
+{
+	FAudioPcmBlock* Block = nullptr;
+	if (!Free.Dequeue(Block))
+	{
+		// The reader is behind; grow rather than drop speech, up to the budget
+		if (Memory && !Memory->TryAdd(EAiBridgeMemoryCategory::Audio, GetBlockBytes()))
+		{
+			return nullptr;
+		}
+
+		TUniquePtr<FAudioPcmBlock>& NewBlock = Blocks.Add_GetRef(MakeUnique<FAudioPcmBlock>());
+		NewBlock->Samples.SetNumUninitialized(BlockFrames * OutputChannels);
+		Block = NewBlock.Get();
+		++ExtraBlocks;
+	}
+
+	Block->NumFrames = 0;
+	Block->Stream = PipeStream;
+	return Block;
+}
+
+void FAudioDecodeStage::WriteFrames(const float* Samples, int32 NumFrames)
+{
+	while (NumFrames > 0)
+	{
+		if (Writing == nullptr)
+		{
+			Writing = AcquireBlock();
+			if (Writing == nullptr)
+			{
+				// Nobody has played the queued audio back within the budget, the rest of this chunk is dropped
+				Memory->NoteEvicted(EAiBridgeMemoryCategory::Audio, NumFrames * OutputChannels * sizeof(float));
+				DroppedFrames += NumFrames;
+				AIBRIDGE_LOG_SAMPLED(50, Warning, "audio.frames.dropped", FAiBridgeLogField::Int(TEXT("frames"), NumFrames), FAiBridgeLogField::Int(TEXT("buffered"), BufferedFrames.load()));
+				return;
+			}
+		}
+
+		const int32 Count = FMath::Min(NumFrames, BlockFrames - Writing->NumFrames);
+		FMemory::Memcpy(Writing->Samples.GetData() + Writing->NumFrames * OutputChannels, Samples, Count * OutputChannels * sizeof(float));
+		Writing->NumFrames += Count;
+		Samples += Count * OutputChannels;
+		NumFrames -= Count;
+
+		if (Writing->NumFrames == BlockFrames)
+		{
+			SubmitWriting();
+		}
+	}
+}
+
+void FAudioDecodeStage::SubmitWriting()
+{
+	if (Writing == nullptr || Writing->NumFrames == 0)
+	{
+		return;
+	}
+
+	BufferedFrames += Writing->NumFrames;
+	Filled.Enqueue(Writing);
+	Writing = nullptr;
+}
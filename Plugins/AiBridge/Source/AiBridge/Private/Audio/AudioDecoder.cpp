@@ -0,0 +1,452 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Audio/AudioDecoder.h"
+#include "Logging/AiBridgeLog.h"
+#include "Misc/ScopeLock.h"
+
+#if WITH_AIBRIDGE_OPUS
+THIRD_PARTY_INCLUDES_START
+#include "opus.h"
+THIRD_PARTY_INCLUDES_END
+#endif
+
+namespace AudioDecoder
+{
+	/** Little-endian 16-bit mono PCM, the pcm_* formats */
+	class FPcm16Decoder : public IAudioChunkDecoder
+	{
+	public:
+		explicit FPcm16Decoder(int32 InSampleRate) : SampleRate(InSampleRate) {}
+
+		virtual int32 GetSampleRate() const override { return SampleRate; }
+		virtual int32 GetNumChannels() const override { return 1; }
+		virtual void Reset() override { bHasCarry = false; }
+
+		virtual bool Decode(TArrayView<const uint8> Chunk, TArray<float>& OutSamples) override
+		{
+			const uint8* Bytes = Chunk.GetData();
+			int32 NumBytes = Chunk.Num();
+
+			// A chunk boundary may split a sample
+			if (bHasCarry && NumBytes > 0)
+			{
+				OutSamples.Add((int16)(Carry | (Bytes[0] << 8)) / 32768.0f);
+				++Bytes;
+				--NumBytes;
+				bHasCarry = false;
+			}
+
+			const int32 NumSamples = NumBytes / 2;
+			const int32 Offset = OutSamples.Num();
+			OutSamples.AddUninitialized(NumSamples);
+			float* Out = OutSamples.GetData() + Offset;
+			for (int32 Index = 0; Index < NumSamples; ++Index)
+			{
+				int16 Sample;
+				FMemory::Memcpy(&Sample, Bytes + Index * 2, sizeof(Sample));
+				Out[Index] = Sample / 32768.0f;
+			}
+
+			if (NumBytes % 2 != 0)
+			{
+				Carry = Bytes[NumBytes - 1];
+				bHasCarry = true;
+			}
+			return true;
+		}
+
+	private:
+		int32 SampleRate;
+		uint8 Carry = 0;
+		bool bHasCarry = false;
+	};
+
+	/** G.711 mu-law mono, the ulaw_* formats telephony integrations ask for */
+	class FMuLawDecoder : public IAudioChunkDecoder
+	{
+	public:
+		explicit FMuLawDecoder(int32 InSampleRate) : SampleRate(InSampleRate)
+		{
+			for (int32 Code = 0; Code < 256; ++Code)
+			{
+				const uint8 Value = ~(uint8)Code;
+				const int32 Exponent = (Value >> 4) & 0x07;
+				const int32 Magnitude = ((((Value & 0x0F) << 3) + 0x84) << Exponent) - 0x84;
+				Table[Code] = ((Value & 0x80) ? -Magnitude : Magnitude) / 32768.0f;
+			}
+		}
+
+		virtual int32 GetSampleRate() const override { return SampleRate; }
+		virtual int32 GetNumChannels() const override { return 1; }
+		virtual void Reset() override {}
+
+		virtual bool Decode(TArrayView<const uint8> Chunk, TArray<float>& OutSamples) override
+		{
+			const int32 Offset = OutSamples.Num();
+			OutSamples.AddUninitialized(Chunk.Num());
+			float* Out = OutSamples.GetData() + Offset;
+			for (int32 Index = 0; Index < Chunk.Num(); ++Index)
+			{
+				Out[Index] = Table[Chunk[Index]];
+			}
+			return true;
+		}
+
+	private:
+		int32 SampleRate;
+		float Table[256];
+	};
+
+#if WITH_AIBRIDGE_OPUS
+	/**
+	 * Ogg Opus, the opus_* formats, decoded with the engine's libOpus. Pages are put back together however
+	 * the network splits them and packets spanning pages are joined. TTS voices are mono, a stereo stream
+	 * is downmixed by libOpus itself; multistream mappings are not supported.
+	 */
+	class FOggOpusDecoder : public IAudioChunkDecoder
+	{
+	public:
+		/** Opus always runs at 48 kHz inside, whatever the source rate in its header */
+		static constexpr int32 SampleRate = 48000;
+
+		FOggOpusDecoder()
+		{
+			int32 Error = OPUS_OK;
+			Decoder = opus_decoder_create(SampleRate, 1, &Error);
+			if (Error != OPUS_OK)
+			{
+				Decoder = nullptr;
+			}
+		}
+
+		virtual ~FOggOpusDecoder() override
+		{
+			if (Decoder != nullptr)
+			{
+				opus_decoder_destroy(Decoder);
+			}
+		}
+
+		bool IsValid() const { return Decoder != nullptr; }
+
+		virtual int32 GetSampleRate() const override { return SampleRate; }
+		virtual int32 GetNumChannels() const override { return 1; }
+
+		virtual void Reset() override
+		{
+			Pages.Reset();
+			Packet.Reset();
+			bPartialPacket = false;
+			SkipFrames = 0;
+			Gain = 1.0f;
+			opus_decoder_ctl(Decoder, OPUS_RESET_STATE);
+		}
+
+		virtual bool Decode(TArrayView<const uint8> Chunk, TArray<float>& OutSamples) override
+		{
+			Pages.Append(Chunk.GetData(), Chunk.Num());
+
+			bool bOk = true;
+			int32 Offset = 0;
+			while (Pages.Num() - Offset >= PageHeaderBytes)
+			{
+				const uint8* Page = Pages.GetData() + Offset;
+				if (FMemory::Memcmp(Page, "OggS", 4) != 0)
+				{
+					// Lost sync, resume at the next capture pattern and keep a tail that may start one
+					bOk = false;
+					const int32 Next = FindCapture(Offset + 1);
+					if (Next == INDEX_NONE)
+					{
+						Offset = Pages.Num() - 3;
+						break;
+					}
+					Offset = Next;
+					continue;
+				}
+
+				const int32 NumSegments = Page[26];
+				if (Pages.Num() - Offset < PageHeaderBytes + NumSegments)
+				{
+					break;
+				}
+
+				const uint8* Lacing = Page + PageHeaderBytes;
+				int32 BodyBytes = 0;
+				for (int32 Segment = 0; Segment < NumSegments; ++Segment)
+				{
+					BodyBytes += Lacing[Segment];
+				}
+				if (Pages.Num() - Offset < PageHeaderBytes + NumSegments + BodyBytes)
+				{
+					break;
+				}
+
+				// A packet continued from a page we never saw cannot be decoded, its tail is skipped
+				const bool bContinued = (Page[5] & 0x01) != 0;
+				bool bSkipping = bContinued && !bPartialPacket;
+				if (!bContinued)
+				{
+					Packet.Reset();
+				}
+
+				const uint8* Body = Lacing + NumSegments;
+				for (int32 Segment = 0; Segment < NumSegments; ++Segment)
+				{
+					const int32 SegmentBytes = Lacing[Segment];
+					if (!bSkipping)
+					{
+						if (Packet.Num() + SegmentBytes > MaxPacketBytes)
+						{
+							bOk = false;
+							bSkipping = true;
+							Packet.Reset();
+						}
+						else
+						{
+							Packet.Append(Body, SegmentBytes);
+						}
+					}
+					Body += SegmentBytes;
+
+					// A lacing value below 255 ends a packet
+					if (SegmentBytes < 255)
+					{
+						if (!bSkipping)
+						{
+							bOk &= DecodePacket(OutSamples);
+						}
+						Packet.Reset();
+						bSkipping = false;
+					}
+				}
+				bPartialPacket = !bSkipping && Packet.Num() > 0;
+
+				Offset += PageHeaderBytes + NumSegments + BodyBytes;
+			}
+
+			Pages.RemoveAt(0, Offset, EAllowShrinking::No);
+			return bOk;
+		}
+
+	private:
+		static constexpr int32 PageHeaderBytes = 27;
+		/** 120 ms, the longest packet Opus codes */
+		static constexpr int32 MaxPacketFrames = SampleRate * 120 / 1000;
+		static constexpr int32 MaxPacketBytes = 64 * 1024;
+
+		OpusDecoder* Decoder = nullptr;
+
+		/** Bytes of a page the network has not delivered completely yet */
+		TArray<uint8> Pages;
+		TArray<uint8> Packet;
+		bool bPartialPacket = false;
+
+		/** Encoder lookahead still to drop at the start of the stream, and the header's output gain */
+		int32 SkipFrames = 0;
+		float Gain = 1.0f;
+
+		int32 FindCapture(int32 From) const
+		{
+			for (int32 Index = From; Index + 4 <= Pages.Num(); ++Index)
+			{
+				if (FMemory::Memcmp(Pages.GetData() + Index, "OggS", 4) == 0)
+				{
+					return Index;
+				}
+			}
+			return INDEX_NONE;
+		}
+
+		bool DecodePacket(TArray<float>& OutSamples)
+		{
+			if (Packet.Num() >= 8 && FMemory::Memcmp(Packet.GetData(), "OpusHead", 8) == 0)
+			{
+				// Version, channels, pre-skip, input rate, output gain, mapping family; each stream starts with one
+				if (Packet.Num() < 19 || Packet[18] != 0)
+				{
+					return false;
+				}
+				SkipFrames = Packet[10] | (Packet[11] << 8);
+				Gain = FMath::Pow(10.0f, (int16)(Packet[16] | (Packet[17] << 8)) / (20.0f * 256.0f));
+				opus_decoder_ctl(Decoder, OPUS_RESET_STATE);
+				return true;
+			}
+
+			if (Packet.Num() == 0 || (Packet.Num() >= 8 && FMemory::Memcmp(Packet.GetData(), "OpusTags", 8) == 0))
+			{
+				return true;
+			}
+
+			const int32 Offset = OutSamples.Num();
+			OutSamples.AddUninitialized(MaxPacketFrames);
+			float* Out = OutSamples.GetData() + Offset;
+			const int32 NumFrames = opus_decode_float(Decoder, Packet.GetData(), Packet.Num(), Out, MaxPacketFrames, 0);
+			if (NumFrames < 0)
+			{
+				OutSamples.SetNum(Offset, EAllowShrinking::No);
+				return false;
+			}
+
+			const int32 Skip = FMath::Min(SkipFrames, NumFrames);
+			SkipFrames -= Skip;
+			const int32 NumKept = NumFrames - Skip;
+			for (int32 Index = 0; Index < NumKept; ++Index)
+			{
+				Out[Index] = Out[Index + Skip] * Gain;
+			}
+			OutSamples.SetNum(Offset + NumKept, EAllowShrinking::No);
+			return true;
+		}
+	};
+#endif
+
+	uint8 EncodeMuLaw(int16 Sample)
+	{
+		constexpr int32 Bias = 0x84;
+		constexpr int32 Clip = 32635;
+
+		const uint8 Sign = Sample < 0 ? 0x80 : 0x00;
+		const int32 Magnitude = FMath::Min(FMath::Abs((int32)Sample), Clip) + Bias;
+
+		// Exponent is the position of the highest set bit above the 8 the segment starts at
+		const int32 Exponent = FMath::Max(FMath::FloorLog2((uint32)Magnitude) - 7, 0);
+		const int32 Mantissa = (Magnitude >> (Exponent + 3)) & 0x0F;
+		return ~(uint8)(Sign | (Exponent << 4) | Mantissa);
+	}
+
+	FCriticalSection FactoriesLock;
+
+	TMap<FString, FAudioDecoderFactory>& GetFactories()
+	{
+		static TMap<FString, FAudioDecoderFactory> Factories = []()
+		{
+			TMap<FString, FAudioDecoderFactory> BuiltIn;
+			BuiltIn.Add(TEXT("pcm"), [](int32 SampleRate) -> TUniquePtr<IAudioChunkDecoder> { return MakeUnique<FPcm16Decoder>(SampleRate); });
+			BuiltIn.Add(TEXT("ulaw"), [](int32 SampleRate) -> TUniquePtr<IAudioChunkDecoder> { return MakeUnique<FMuLawDecoder>(SampleRate); });
+#if WITH_AIBRIDGE_OPUS
+			BuiltIn.Add(TEXT("opus"), [](int32 SampleRate) -> TUniquePtr<IAudioChunkDecoder>
+			{
+				TUniquePtr<FOggOpusDecoder> Decoder = MakeUnique<FOggOpusDecoder>();
+				if (!Decoder->IsValid())
+				{
+					return nullptr;
+				}
+				return Decoder;
+			});
+#endif
+			return BuiltIn;
+		}();
+		return Factories;
+	}
+}
+
+void FMuLawEncoder::Encode(TArrayView<const uint8> Pcm16, TArray<uint8>& Out)
+{
+	const uint8* Bytes = Pcm16.GetData();
+	int32 NumBytes = Pcm16.Num();
+
+	if (bHasCarry && NumBytes > 0)
+	{
+		Out.Add(AudioDecoder::EncodeMuLaw((int16)(Carry | (Bytes[0] << 8))));
+		++Bytes;
+		--NumBytes;
+		bHasCarry = false;
+	}
+
+	const int32 NumSamples = NumBytes / 2;
+	const int32 Offset = Out.Num();
+	Out.AddUninitialized(NumSamples);
+	uint8* Encoded = Out.GetData() + Offset;
+	for (int32 Index = 0; Index < NumSamples; ++Index)
+	{
+		int16 Sample;
+		FMemory::Memcpy(&Sample, Bytes + Index * 2, sizeof(Sample));
+		Encoded[Index] = AudioDecoder::EncodeMuLaw(Sample);
+	}
+
+	if (NumBytes % 2 != 0)
+	{
+		Carry = Bytes[NumBytes - 1];
+		bHasCarry = true;
+	}
+}
+
+bool AiBridgeAudio::ParseOutputFormat(const FString& OutputFormat, FString& OutCodec, int32& OutSampleRate)
+{
+	TArray<FString> Parts;
+	OutputFormat.ParseIntoArray(Parts, TEXT("_"));
+	if (Parts.Num() < 2 || !Parts[1].IsNumeric())
+	{
+		return false;
+	}
+
+	OutCodec = Parts[0].ToLower();
+	OutSampleRate = FCString::Atoi(*Parts[1]);
+	return OutSampleRate > 0;
+}
+
+int32 AiBridgeAudio::GetBytesPerSecond(const FString& OutputFormat)
+{
+	FString Codec;
+	int32 SampleRate = 0;
+	if (!ParseOutputFormat(OutputFormat, Codec, SampleRate))
+	{
+		return 0;
+	}
+
+	if (Codec == TEXT("pcm"))
+	{
+		return SampleRate * sizeof(int16);
+	}
+	if (Codec == TEXT("ulaw") || Codec == TEXT("alaw"))
+	{
+		return SampleRate;
+	}
+
+	// mp3_44100_128, opus_48000_64: kilobits per second last
+	TArray<FString> Parts;
+	OutputFormat.ParseIntoArray(Parts, TEXT("_"));
+	return Parts.Num() >= 3 && Parts[2].IsNumeric() ? FCString::Atoi(*Parts[2]) * 1000 / 8 : 0;
+}
+
+void AiBridgeAudio::RegisterDecoder(const FString& Codec, FAudioDecoderFactory Factory)
+{
+	FScopeLock ScopeLock(&AudioDecoder::FactoriesLock);
+	AudioDecoder::GetFactories().Add(Codec.ToLower(), MoveTemp(Factory));
+}
+
+TUniquePtr<IAudioChunkDecoder> AiBridgeAudio::CreateDecoder(const FString& OutputFormat)
+{
+	FString Codec;
+	int32 SampleRate = 0;
+	if (!ParseOutputFormat(OutputFormat, Codec, SampleRate))
+	{
+		UE_LOG(LogAiBridge, Warning, TEXT("[AudioDecoder] Unrecognized output format '%s'"), *OutputFormat);
+		return nullptr;
+	}
+
+	FScopeLock ScopeLock(&AudioDecoder::FactoriesLock);
+	const FAudioDecoderFactory* Factory = AudioDecoder::GetFactories().Find(Codec);
+	if (Factory == nullptr)
+	{
+		UE_LOG(LogAiBridge, Warning, TEXT("[AudioDecoder] No decoder registered for '%s'"), *Codec);
+		return nullptr;
+	}
+
+	return (*Factory)(SampleRate);
+}
+
+bool AiBridgeAudio::HasDecoder(const FString& OutputFormat)
+{
+	FString Codec;
+	int32 SampleRate = 0;
+	if (!ParseOutputFormat(OutputFormat, Codec, SampleRate))
+	{
+		return false;
+	}
+
+	FScopeLock ScopeLock(&AudioDecoder::FactoriesLock);
+	return AudioDecoder::GetFactories().Contains(Codec);
+}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Audio/AudioFeatures.h"
+#include "Math/VectorRegister.h"
+
+FAudioFrameFeatures AiBridgeAudio::AnalyzeFrame(const float* Samples, int32 NumSamples, float PreviousSample)
+{
+	FAudioFrameFeatures Features;
+	if (NumSamples <= 0)
+	{
+		return Features;
+	}
+
+	// First sample against the tail of the previous frame
+	float Energy = Samples[0] * Samples[0];
+	float DiffEnergy = FMath::Square(Samples[0] - PreviousSample);
+	int32 Crossings = (Samples[0] * PreviousSample < 0.0f) ? 1 : 0;
+
+	// Four samples per iteration, each lane compared with its predecessor via an unaligned load
+	VectorRegister4Float VecEnergy = VectorZeroFloat();
+	VectorRegister4Float VecDiff = VectorZeroFloat();
+	const VectorRegister4Float Zero = VectorZeroFloat();
+
+	int32 Index = 1;
+	for (; Index + 4 <= NumSamples; Index += 4)
+	{
+		const VectorRegister4Float Current = VectorLoad(Samples + Index);
+		const VectorRegister4Float Previous = VectorLoad(Samples + Index - 1);
+		const VectorRegister4Float Delta = VectorSubtract(Current, Previous);
+
+		VecEnergy = VectorMultiplyAdd(Current, Current, VecEnergy);
+		VecDiff = VectorMultiplyAdd(Delta, Delta, VecDiff);
+		Crossings += FMath::CountBits((uint64)VectorMaskBits(VectorCompareLT(VectorMultiply(Current, Previous), Zero)));
+	}
+
+	alignas(16) float Lanes[4];
+	VectorStoreAligned(VecEnergy, Lanes);
+	Energy += Lanes[0] + Lanes[1] + Lanes[2] + Lanes[3];
+	VectorStoreAligned(VecDiff, Lanes);
+	DiffEnergy += Lanes[0] + Lanes[1] + Lanes[2] + Lanes[3];
+
+	for (; Index < NumSamples; ++Index)
+	{
+		const float Delta = Samples[Index] - Samples[Index - 1];
+		Energy += Samples[Index] * Samples[Index];
+		DiffEnergy += Delta * Delta;
+		Crossings += (Samples[Index] * Samples[Index - 1] < 0.0f) ? 1 : 0;
+	}
+
+	Features.Rms = FMath::Sqrt(Energy / NumSamples);
+	Features.Brightness = Energy > UE_SMALL_NUMBER ? FMath::Clamp(DiffEnergy / (4.0f * Energy), 0.0f, 1.0f) : 0.0f;
+	Features.ZeroCrossingRate = (float)Crossings / NumSamples;
+	return Features;
+}
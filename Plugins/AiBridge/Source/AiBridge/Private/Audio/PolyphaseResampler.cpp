@@ -0,0 +1,241 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Audio/PolyphaseResampler.h"
+#include "Math/VectorRegister.h"
+
+namespace PolyphaseResampler
+{
+	/** Ratios needing more phases are approximated, 2048 keeps the bank under a megabyte at 64 taps */
+	constexpr uint32 MaxPhases = 2048;
+
+	/** Fraction of the lower Nyquist frequency that passes, the rest is the transition band */
+	constexpr double Rolloff = 0.92;
+
+	/** Kaiser window shape, about 80 dB of stopband attenuation */
+	constexpr double KaiserBeta = 8.0;
+
+	uint32 GreatestCommonDivisor(uint32 A, uint32 B)
+	{
+		while (B != 0)
+		{
+			const uint32 Remainder = A % B;
+			A = B;
+			B = Remainder;
+		}
+		return A;
+	}
+
+	/** Zeroth order modified Bessel function of the first kind, by its power series */
+	double BesselI0(double X)
+	{
+		double Sum = 1.0;
+		double Term = 1.0;
+		for (int32 K = 1; K < 32; ++K)
+		{
+			Term *= FMath::Square(X / (2.0 * K));
+			Sum += Term;
+			if (Term < Sum * 1e-12)
+			{
+				break;
+			}
+		}
+		return Sum;
+	}
+
+	/** Four taps per iteration, Taps is always a multiple of four */
+	float Dot(const float* Coefficients, const float* Samples, int32 Taps)
+	{
+		VectorRegister4Float Sum = VectorZeroFloat();
+		for (int32 Tap = 0; Tap < Taps; Tap += 4)
+		{
+			Sum = VectorMultiplyAdd(VectorLoad(Coefficients + Tap), VectorLoad(Samples + Tap), Sum);
+		}
+
+		alignas(16) float Lanes[4];
+		VectorStoreAligned(Sum, Lanes);
+		return Lanes[0] + Lanes[1] + Lanes[2] + Lanes[3];
+	}
+}
+
+void FPolyphaseResampler::Configure(int32 InInputRate, int32 InOutputRate, int32 InInputChannels, int32 InOutputChannels, int32 InTapsPerPhase)
+{
+	InputRate = FMath::Max(InInputRate, 1);
+	OutputRate = FMath::Max(InOutputRate, 1);
+	InputChannels = FMath::Max(InInputChannels, 1);
+	OutputChannels = FMath::Max(InOutputChannels, 1);
+	Taps = IsPassthrough() ? 0 : Align(FMath::Max(InTapsPerPhase, 4), 4);
+
+	const uint32 Divisor = PolyphaseResampler::GreatestCommonDivisor(InputRate, OutputRate);
+	Up = OutputRate / Divisor;
+	Down = InputRate / Divisor;
+	if (Up > PolyphaseResampler::MaxPhases)
+	{
+		// Odd rate pairs such as 44100 to 47999; the pitch error stays below a twentieth of a percent
+		Down = FMath::Max(1u, (uint32)FMath::RoundToInt64((double)Down * PolyphaseResampler::MaxPhases / Up));
+		Up = PolyphaseResampler::MaxPhases;
+	}
+
+	Bank.Reset();
+	if (!IsPassthrough())
+	{
+		// Prototype low-pass at the upsampled rate, cut at the lower of the two Nyquist frequencies
+		const int32 Length = Up * Taps;
+		const double Center = (Length - 1) * 0.5;
+		const double Cutoff = 0.5 * PolyphaseResampler::Rolloff * FMath::Min(1.0, (double)Up / Down) / Up;
+		const double WindowNorm = 1.0 / PolyphaseResampler::BesselI0(PolyphaseResampler::KaiserBeta);
+
+		Bank.SetNumUninitialized(Length);
+		for (uint32 PhaseIndex = 0; PhaseIndex < Up; ++PhaseIndex)
+		{
+			float* Coefficients = Bank.GetData() + PhaseIndex * Taps;
+			double Sum = 0.0;
+			for (int32 Tap = 0; Tap < Taps; ++Tap)
+			{
+				const double T = PhaseIndex + Tap * (double)Up - Center;
+				const double Sinc = FMath::IsNearlyZero(T) ? 2.0 * Cutoff : FMath::Sin(UE_DOUBLE_TWO_PI * Cutoff * T) / (UE_DOUBLE_PI * T);
+				const double Ratio = T / (Center + 0.5);
+				const double Window = PolyphaseResampler::BesselI0(PolyphaseResampler::KaiserBeta * FMath::Sqrt(FMath::Max(0.0, 1.0 - Ratio * Ratio))) * WindowNorm;
+
+				// Reversed, so tap 0 multiplies the oldest sample of the window
+				Coefficients[Taps - 1 - Tap] = (float)(Sinc * Window);
+				Sum += Sinc * Window;
+			}
+
+			// Unity gain at DC in every phase, otherwise the phases beat against each other as a whine
+			const float Scale = Sum > UE_DOUBLE_SMALL_NUMBER ? (float)(1.0 / Sum) : 0.0f;
+			for (int32 Tap = 0; Tap < Taps; ++Tap)
+			{
+				Coefficients[Tap] *= Scale;
+			}
+		}
+	}
+
+	Reset();
+}
+
+void FPolyphaseResampler::Reset()
+{
+	Channels.SetNum(OutputChannels);
+	for (TArray<float>& Channel : Channels)
+	{
+		Channel.Reset();
+		Channel.AddZeroed(FMath::Max(Taps - 1, 0));
+	}
+
+	Index = FMath::Max(Taps - 1, 0);
+	Phase = 0;
+}
+
+int32 FPolyphaseResampler::GetMaxOutputFrames(int32 NumFrames) const
+{
+	if (IsPassthrough())
+	{
+		return NumFrames;
+	}
+
+	const int64 Pending = FMath::Max<int64>(0, (int64)Channels[0].Num() - Index) + NumFrames;
+	return (int32)(Pending * Up / Down + 1);
+}
+
+int32 FPolyphaseResampler::Process(const float* Interleaved, int32 NumFrames, TArray<float>& Out)
+{
+	if (Channels.Num() != OutputChannels || NumFrames <= 0)
+	{
+		return 0;
+	}
+
+	const int32 MaxFrames = GetMaxOutputFrames(NumFrames);
+	Deinterleave(Interleaved, NumFrames);
+
+	const int32 Start = Out.Num();
+	Out.AddUninitialized(MaxFrames * OutputChannels);
+	float* Write = Out.GetData() + Start;
+
+	int32 NumOut = 0;
+	if (IsPassthrough())
+	{
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			for (int32 Channel = 0; Channel < OutputChannels; ++Channel)
+			{
+				*Write++ = Channels[Channel][Frame];
+			}
+		}
+		NumOut = NumFrames;
+
+		for (TArray<float>& Channel : Channels)
+		{
+			Channel.Reset();
+		}
+	}
+	else
+	{
+		const int32 Available = Channels[0].Num();
+		while (Index < Available && NumOut < MaxFrames)
+		{
+			const float* Coefficients = Bank.GetData() + Phase * Taps;
+			const int32 First = Index - Taps + 1;
+			for (int32 Channel = 0; Channel < OutputChannels; ++Channel)
+			{
+				*Write++ = PolyphaseResampler::Dot(Coefficients, Channels[Channel].GetData() + First, Taps);
+			}
+			++NumOut;
+
+			Phase += Down;
+			Index += Phase / Up;
+			Phase %= Up;
+		}
+
+		// Keep only the history the next output still reaches back into
+		const int32 Consumed = FMath::Min(Index - (Taps - 1), Available);
+		if (Consumed > 0)
+		{
+			for (TArray<float>& Channel : Channels)
+			{
+				Channel.RemoveAt(0, Consumed, EAllowShrinking::No);
+			}
+			Index -= Consumed;
+		}
+	}
+
+	Out.SetNum(Start + NumOut * OutputChannels, EAllowShrinking::No);
+	return NumOut;
+}
+
+void FPolyphaseResampler::Deinterleave(const float* Interleaved, int32 NumFrames)
+{
+	const int32 Offset = Channels[0].Num();
+	for (TArray<float>& Channel : Channels)
+	{
+		Channel.AddUninitialized(NumFrames);
+	}
+
+	// Plain strided loops, simple enough for the compiler to vectorize
+	if (OutputChannels == 1 && InputChannels > 1)
+	{
+		float* Mono = Channels[0].GetData() + Offset;
+		const float Scale = 1.0f / InputChannels;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			float Sum = 0.0f;
+			for (int32 Channel = 0; Channel < InputChannels; ++Channel)
+			{
+				Sum += Interleaved[Frame * InputChannels + Channel];
+			}
+			Mono[Frame] = Sum * Scale;
+		}
+		return;
+	}
+
+	for (int32 Channel = 0; Channel < OutputChannels; ++Channel)
+	{
+		// Mono fans out to every channel, extra output channels repeat the last input channel
+		const int32 Source = FMath::Min(Channel, InputChannels - 1);
+		float* Dest = Channels[Channel].GetData() + Offset;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			Dest[Frame] = Interleaved[Frame * InputChannels + Source];
+		}
+	}
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Audio/TtsFormatSelector.h"
+
+void FTtsFormatSelector::Configure(const TArray<FAiBridgeTtsFormat>& InFormats, float InUpgradeHeadroom)
+{
+	Formats = InFormats;
+
+	// Update walks the ladder top down and takes the first rung the link sustains, a rung out of order would shadow the ones below it
+	Formats.StableSort([](const FAiBridgeTtsFormat& A, const FAiBridgeTtsFormat& B) { return A.MinKbps > B.MinKbps; });
+	UpgradeHeadroom = FMath::Max(1.0f, InUpgradeHeadroom);
+	Current = INDEX_NONE;
+}
+
+bool FTtsFormatSelector::Update(float MeasuredKbps, TFunctionRef<bool(const FAiBridgeTtsFormat&)> IsUsable)
+{
+	int32 Selected = INDEX_NONE;
+	int32 FirstUsable = INDEX_NONE;
+	int32 LastUsable = INDEX_NONE;
+	for (int32 Index = 0; Index < Formats.Num(); ++Index)
+	{
+		const FAiBridgeTtsFormat& Format = Formats[Index];
+		if (!IsUsable(Format))
+		{
+			continue;
+		}
+		if (FirstUsable == INDEX_NONE)
+		{
+			FirstUsable = Index;
+		}
+		LastUsable = Index;
+
+		if (Selected != INDEX_NONE)
+		{
+			continue;
+		}
+
+		// Nothing measured yet, the current format stays if it still can
+		if (MeasuredKbps <= 0.0f)
+		{
+			if (Index == Current)
+			{
+				Selected = Index;
+			}
+			continue;
+		}
+
+		const float Required = Index < Current ? Format.MinKbps * UpgradeHeadroom : Format.MinKbps;
+		if (MeasuredKbps >= Required)
+		{
+			Selected = Index;
+		}
+	}
+
+	// Unmeasured links start at the top, links too slow for every rung get the last one rather than no audio
+	if (Selected == INDEX_NONE)
+	{
+		Selected = MeasuredKbps <= 0.0f ? FirstUsable : LastUsable;
+	}
+
+	const bool bChanged = Selected != Current;
+	Current = Selected;
+	return bChanged;
+}
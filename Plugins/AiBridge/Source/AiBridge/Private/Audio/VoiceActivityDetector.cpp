@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Audio/VoiceActivityDetector.h"
+#include "Audio/AudioFeatures.h"
+
+FVoiceActivityDetector::FVoiceActivityDetector(const FAiBridgeVadSettings& InSettings)
+	: Settings(InSettings)
+{
+}
+
+void FVoiceActivityDetector::SetSettings(const FAiBridgeVadSettings& InSettings)
+{
+	Settings = InSettings;
+	if (SampleRate > 0)
+	{
+		Configure(SampleRate);
+	}
+}
+
+FAiBridgeVadStats FVoiceActivityDetector::GetStats() const
+{
+	FAiBridgeVadStats Stats;
+	Stats.FramesProcessed = FramesProcessed.load(std::memory_order_relaxed);
+	Stats.FramesUploaded = FramesUploaded.load(std::memory_order_relaxed);
+	Stats.BytesSuppressed = BytesSuppressed.load(std::memory_order_relaxed);
+	Stats.Utterances = Utterances.load(std::memory_order_relaxed);
+	Stats.AverageFrameCostMicroseconds = AverageFrameCostUs.load(std::memory_order_relaxed);
+	Stats.PeakFrameCostMicroseconds = PeakFrameCostUs.load(std::memory_order_relaxed);
+	Stats.NoiseFloorDb = PublishedNoiseFloorDb.load(std::memory_order_relaxed);
+	return Stats;
+}
+
+void FVoiceActivityDetector::Configure(int32 InSampleRate)
+{
+	SampleRate = InSampleRate;
+	FrameSamples = FMath::Max(1, SampleRate * Settings.FrameMs / 1000);
+
+	FrameBuffer.Reset(FrameSamples);
+	PcmFrame.SetNumUninitialized(FrameSamples);
+
+	const int32 PreRollFrames = FMath::DivideAndRoundUp(Settings.PreRollMs, FMath::Max(1, Settings.FrameMs));
+	PreRoll.SetNumZeroed(PreRollFrames * FrameSamples);
+	PreRollWrite = 0;
+	PreRollFilled = 0;
+
+	SpeechRunMs = 0;
+	SilenceRunMs = 0;
+}
+
+void FVoiceActivityDetector::ProcessCaptureBuffer(const float* Interleaved, int32 NumFrames, int32 NumChannels, int32 InSampleRate)
+{
+	if (InSampleRate <= 0 || NumChannels <= 0)
+	{
+		return;
+	}
+
+	if (InSampleRate != SampleRate)
+	{
+		Configure(InSampleRate);
+	}
+
+	const float ChannelScale = 1.0f / NumChannels;
+	int32 Frame = 0;
+	while (Frame < NumFrames)
+	{
+		const int32 Count = FMath::Min(NumFrames - Frame, FrameSamples - FrameBuffer.Num());
+		const int32 Offset = FrameBuffer.Num();
+		FrameBuffer.AddUninitialized(Count);
+		float* Out = FrameBuffer.GetData() + Offset;
+
+		if (NumChannels == 1)
+		{
+			FMemory::Memcpy(Out, Interleaved + Frame, Count * sizeof(float));
+		}
+		else
+		{
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				const float* In = Interleaved + (Frame + Index) * NumChannels;
+				float Sum = 0.0f;
+				for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+				{
+					Sum += In[Channel];
+				}
+				Out[Index] = Sum * ChannelScale;
+			}
+		}
+		Frame += Count;
+
+		if (FrameBuffer.Num() == FrameSamples)
+		{
+			ProcessFrame();
+			FrameBuffer.Reset(FrameSamples);
+		}
+	}
+}
+
+void FVoiceActivityDetector::ProcessFrame()
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	const float* Samples = FrameBuffer.GetData();
+	const FAudioFrameFeatures Features = AiBridgeAudio::AnalyzeFrame(Samples, FrameSamples, PreviousSample);
+	PreviousSample = Samples[FrameSamples - 1];
+
+	const float LevelDb = 20.0f * FMath::LogX(10.0f, FMath::Max(Features.Rms, 1e-6f));
+	const float Threshold = Settings.SpeechThresholdDb * (Features.ZeroCrossingRate > Settings.NoiseZeroCrossingRate ? 2.0f : 1.0f);
+	const bool bFrameIsSpeech = LevelDb > Settings.MinSpeechDb && LevelDb > NoiseFloorDb + Threshold;
+
+	// Minimum tracking: drop to quiet frames immediately, rise slowly through non-speech
+	if (LevelDb < NoiseFloorDb)
+	{
+		NoiseFloorDb = LevelDb;
+	}
+	else if (!bFrameIsSpeech)
+	{
+		NoiseFloorDb += Settings.NoiseFloorAdaptRate * (LevelDb - NoiseFloorDb);
+	}
+	PublishedNoiseFloorDb.store(NoiseFloorDb, std::memory_order_relaxed);
+
+	for (int32 Index = 0; Index < FrameSamples; ++Index)
+	{
+		PcmFrame[Index] = (int16)FMath::Clamp(FMath::RoundToInt32(Samples[Index] * 32767.0f), -32768, 32767);
+	}
+
+	if (bFrameIsSpeech)
+	{
+		SpeechRunMs += Settings.FrameMs;
+		SilenceRunMs = 0;
+	}
+	else
+	{
+		SpeechRunMs = 0;
+		SilenceRunMs += Settings.FrameMs;
+	}
+
+	if (!bSpeaking.load(std::memory_order_relaxed))
+	{
+		if (bFrameIsSpeech && SpeechRunMs >= Settings.OnsetMs)
+		{
+			bSpeaking.store(true, std::memory_order_relaxed);
+			if (!bInUtterance)
+			{
+				bInUtterance = true;
+				Utterances.fetch_add(1, std::memory_order_relaxed);
+				if (OnSpeechStart) OnSpeechStart();
+			}
+			FlushPreRoll();
+			Upload(PcmFrame);
+		}
+		else
+		{
+			PushPreRoll();
+		}
+	}
+	else
+	{
+		Upload(PcmFrame);
+		if (SilenceRunMs >= Settings.HangoverMs)
+		{
+			bSpeaking.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	if (bInUtterance && SilenceRunMs >= Settings.EndOfUtteranceMs)
+	{
+		bInUtterance = false;
+		bSpeaking.store(false, std::memory_order_relaxed);
+		if (OnEndOfUtterance) OnEndOfUtterance();
+	}
+
+	FramesProcessed.fetch_add(1, std::memory_order_relaxed);
+
+	const float CostUs = (float)(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0);
+	const float Average = AverageFrameCostUs.load(std::memory_order_relaxed);
+	AverageFrameCostUs.store(Average + 0.05f * (CostUs - Average), std::memory_order_relaxed);
+	if (CostUs > PeakFrameCostUs.load(std::memory_order_relaxed))
+	{
+		PeakFrameCostUs.store(CostUs, std::memory_order_relaxed);
+	}
+}
+
+void FVoiceActivityDetector::PushPreRoll()
+{
+	const int32 Capacity = PreRoll.Num() / FrameSamples;
+	if (Capacity == 0)
+	{
+		BytesSuppressed.fetch_add(FrameSamples * sizeof(int16), std::memory_order_relaxed);
+		return;
+	}
+
+	// Overwriting the oldest pre-roll frame is the point where its audio is definitely not uploaded
+	if (PreRollFilled == Capacity)
+	{
+		BytesSuppressed.fetch_add(FrameSamples * sizeof(int16), std::memory_order_relaxed);
+	}
+	else
+	{
+		PreRollFilled++;
+	}
+
+	FMemory::Memcpy(PreRoll.GetData() + PreRollWrite * FrameSamples, PcmFrame.GetData(), FrameSamples * sizeof(int16));
+	PreRollWrite = (PreRollWrite + 1) % Capacity;
+}
+
+void FVoiceActivityDetector::FlushPreRoll()
+{
+	const int32 Capacity = PreRoll.Num() / FrameSamples;
+	for (int32 Index = 0; Index < PreRollFilled; ++Index)
+	{
+		const int32 Slot = (PreRollWrite - PreRollFilled + Index + Capacity) % Capacity;
+		Upload(TArrayView<const int16>(PreRoll.GetData() + Slot * FrameSamples, FrameSamples));
+	}
+	PreRollFilled = 0;
+}
+
+void FVoiceActivityDetector::Upload(TArrayView<const int16> Pcm)
+{
+	FramesUploaded.fetch_add(1, std::memory_order_relaxed);
+	if (OnVoicedAudio) OnVoicedAudio(Pcm, SampleRate);
+}
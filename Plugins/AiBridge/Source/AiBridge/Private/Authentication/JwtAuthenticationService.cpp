@@ -1,10 +1,21 @@
 #include "Authentication/JwtAuthenticationService.h"
+#include "Logging/AiBridgeLog.h"
 #include "Json.h"
 #include "JsonUtilities.h"
 
 void UJwtAuthenticationService::Initialize(const FString& InBaseUrl)
 {
-    BaseUrl = InBaseUrl.IsEmpty() ? TEXT("https://conversation-api.com") : InBaseUrl;
+    const FString NewBaseUrl = InBaseUrl.IsEmpty() ? TEXT("https://conversation-api.com") : InBaseUrl;
+    if (NewBaseUrl == BaseUrl)
+    {
+        return;
+    }
+
+    // Tokens are issued per deployment, one from the endpoint we failed over from would be refused
+    FScopeLock Lock(&CacheLock);
+    BaseUrl = NewBaseUrl;
+    CachedToken.Reset();
+    TokenExpiry = FDateTime();
 }
 
 bool UJwtAuthenticationService::IsTokenValid() const
@@ -66,7 +77,7 @@ void UJwtAuthenticationService::HandleResponse(
 {
     if (!bWasSuccessful || !Response.IsValid())
     {
-        UE_LOG(LogTemp, Error, TEXT("Auth request failed"));
+        UE_LOG(LogAiBridge, Error, TEXT("Auth request failed"));
         Callback(TEXT(""));
         return;
     }
@@ -78,14 +89,15 @@ void UJwtAuthenticationService::HandleResponse(
 
     if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid())
     {
-        UE_LOG(LogTemp, Error, TEXT("Failed to parse auth response"));
+        UE_LOG(LogAiBridge, Error, TEXT("Failed to parse auth response"));
         Callback(TEXT(""));
         return;
     }
 
     FString Token = JsonObject->GetStringField(TEXT("token"));
 
-    if (!Token.IsEmpty())
+    // A reply from an endpoint we have since moved away from is still handed out, but not cached for the new one
+    if (!Token.IsEmpty() && Request.IsValid() && Request->GetURL().StartsWith(BaseUrl))
     {
         FScopeLock Lock(&CacheLock);
 
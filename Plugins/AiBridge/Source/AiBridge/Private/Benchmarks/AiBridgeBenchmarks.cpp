@@ -0,0 +1,1030 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Console benchmarks for the AiBridge client-side hot paths. Each one runs synchronously on the calling
+// thread with synthetic input and logs its cost normalized to the unit the feature is budgeted in.
+
+#include "CoreMinimal.h"
+#include "Logging/AiBridgeLog.h"
+#include "HAL/IConsoleManager.h"
+#include "Algo/AllOf.h"
+#include "Async/Async.h"
+#include "Audio/AudioDecodeStage.h"
+#include "Audio/TtsFormatSelector.h"
+#include "Capture/AiBridgeCapture.h"
+#include "HAL/PlatformFileManager.h"
+#include "Knowledge/KnowledgeIndex.h"
+#include "LipSync/VisemeAnalyzer.h"
+#include "Memory/AiBridgeMemory.h"
+#include "Misc/Paths.h"
+#include "Prompt/PromptTemplate.h"
+#include "Settings/AiBridgeSettings.h"
+#include "Hash/xxhash.h"
+#include "Tokenizer/BpeTokenizer.h"
+#include "Transcript/AiBridgeTranscript.h"
+#include "Transport/TransportWebSocketBase.h"
+#include "WebSocket/AiBridgeIoThread.h"
+#include "WebSocket/AiBridgeOutbox.h"
+#include "WebSocket/AiBridgeRateLimiter.h"
+#include "WebSocket/AiBridgeThroughputMeter.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace AiBridgeBenchmarks
+{
+	/** Speech-like test signal: two formants modulated at a syllable rate with noisy fricative bursts */
+	TArray<int16> MakeSyntheticSpeech(int32 SampleRate, float Seconds)
+	{
+		FRandomStream Random(1234);
+		const int32 NumSamples = FMath::CeilToInt32(SampleRate * Seconds);
+
+		TArray<int16> Pcm;
+		Pcm.SetNumUninitialized(NumSamples);
+		for (int32 Index = 0; Index < NumSamples; ++Index)
+		{
+			const float Time = (float)Index / SampleRate;
+			const float Syllable = FMath::Max(0.0f, FMath::Sin(UE_TWO_PI * 4.0f * Time));
+			const bool bFricative = FMath::Frac(Time * 1.3f) > 0.85f;
+
+			float Sample = bFricative
+				? Random.FRandRange(-0.3f, 0.3f)
+				: 0.5f * FMath::Sin(UE_TWO_PI * 700.0f * Time) + 0.25f * FMath::Sin(UE_TWO_PI * 1800.0f * Time);
+			Sample *= Syllable;
+
+			Pcm[Index] = (int16)FMath::Clamp(FMath::RoundToInt32(Sample * 32767.0f), -32768, 32767);
+		}
+		return Pcm;
+	}
+
+	int32 ParseIntArg(const TArray<FString>& Args, int32 Index, int32 Default)
+	{
+		return Args.IsValidIndex(Index) ? FMath::Max(1, FCString::Atoi(*Args[Index])) : Default;
+	}
+
+	void BenchLipSync(const TArray<FString>& Args)
+	{
+		const int32 Seconds = ParseIntArg(Args, 0, 60);
+		const int32 SampleRate = ParseIntArg(Args, 1, 22050);
+		const TArray<int16> Pcm = MakeSyntheticSpeech(SampleRate, Seconds);
+
+		// Feature extraction alone, single threaded
+		TArray<float> Floats;
+		Floats.SetNumUninitialized(Pcm.Num());
+		for (int32 Index = 0; Index < Pcm.Num(); ++Index)
+		{
+			Floats[Index] = Pcm[Index] / 32768.0f;
+		}
+
+		const int32 HopSize = SampleRate / 100;
+		const double HopStart = FPlatformTime::Seconds();
+		float Checksum = 0.0f;
+		for (int32 Offset = 0; Offset + HopSize <= Floats.Num(); Offset += HopSize)
+		{
+			Checksum += AiBridgeAudio::AnalyzeFrame(Floats.GetData() + Offset, HopSize, Offset > 0 ? Floats[Offset - 1] : 0.0f).Rms;
+		}
+		const double HopSeconds = FPlatformTime::Seconds() - HopStart;
+
+		// Full pipeline: 100 ms network-sized chunks pushed through the worker pipe
+		FVisemeAnalyzer Analyzer;
+		Analyzer.BeginUtterance(SampleRate);
+		const int32 ChunkSamples = SampleRate / 10;
+
+		const double PipeStart = FPlatformTime::Seconds();
+		for (int32 Offset = 0; Offset < Pcm.Num(); Offset += ChunkSamples)
+		{
+			const int32 Count = FMath::Min(ChunkSamples, Pcm.Num() - Offset);
+			TArray<uint8> Chunk;
+			Chunk.Append(reinterpret_cast<const uint8*>(Pcm.GetData() + Offset), Count * sizeof(int16));
+			Analyzer.PushPcm16(MoveTemp(Chunk));
+		}
+		Analyzer.Flush();
+		const double PipeSeconds = FPlatformTime::Seconds() - PipeStart;
+
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.LipSync] %d s @ %d Hz: features %.1f us/s audio, pipeline %.1f us/s audio (%.0fx realtime), %u keys (checksum %.3f)"),
+			Seconds, SampleRate,
+			HopSeconds * 1e6 / Seconds,
+			PipeSeconds * 1e6 / Seconds,
+			PipeSeconds > 0.0 ? Seconds / PipeSeconds : 0.0,
+			Analyzer.GetTrack().GetNumKeys(),
+			Checksum);
+	}
+
+	/** Socket stand-in that records the stream and sequence number of every binary frame written to it */
+	class FRecordingWebSocket : public FTransportWebSocketBase
+	{
+	public:
+		virtual void Connect() override {}
+		virtual void Close(int32 Code, const FString& Reason) override {}
+		virtual bool IsConnected() override { return true; }
+		virtual void Send(const FString& Data) override {}
+
+		virtual void Send(const void* Data, SIZE_T Size, bool bIsBinary) override
+		{
+			uint32 Header[2];
+			FMemory::Memcpy(Header, Data, sizeof(Header));
+			Written.Emplace(Header[0], Header[1]);
+			NumWritten.fetch_add(1, std::memory_order_release);
+		}
+
+		/** Written by the flushing thread only */
+		TArray<TPair<uint32, uint32>> Written;
+		std::atomic<int32> NumWritten{0};
+	};
+
+	/**
+	 * Hammers one outbox from many producer threads with 20 ms audio-sized frames, each thread its own
+	 * stream, while the calling thread flushes it as the connection's I/O thread does, and checks every
+	 * frame was written exactly once with each stream in order.
+	 */
+	void BenchSendStress(const TArray<FString>& Args)
+	{
+		const int32 NumProducers = ParseIntArg(Args, 0, 16);
+		const int32 FramesPerProducer = ParseIntArg(Args, 1, 20000);
+		const int32 PayloadBytes = 640;
+		const int32 NumFrames = NumProducers * FramesPerProducer;
+
+		TSharedRef<FRecordingWebSocket> Recorder = MakeShared<FRecordingWebSocket>();
+		Recorder->Written.Reserve(NumFrames);
+
+		TSharedRef<FAiBridgeOutbox, ESPMode::ThreadSafe> Outbox = MakeShared<FAiBridgeOutbox, ESPMode::ThreadSafe>();
+		Outbox->SetLinkUp(true);
+
+		const double Start = FPlatformTime::Seconds();
+
+		// Each producer returns when it queued its last frame
+		TArray<TFuture<double>> Producers;
+		for (int32 Stream = 0; Stream < NumProducers; ++Stream)
+		{
+			Producers.Add(Async(EAsyncExecution::Thread, [Outbox, Stream, FramesPerProducer, PayloadBytes]()
+			{
+				for (int32 Seq = 0; Seq < FramesPerProducer; ++Seq)
+				{
+					TArray<uint8> Payload;
+					Payload.SetNumZeroed(PayloadBytes);
+					const uint32 Header[2] = { (uint32)Stream, (uint32)Seq };
+					FMemory::Memcpy(Payload.GetData(), Header, sizeof(Header));
+					Outbox->SendBinary(MoveTemp(Payload));
+				}
+				return FPlatformTime::Seconds();
+			}));
+		}
+
+		// Flushed while the producers run, woken by them or at the latest on the I/O thread's service interval
+		const double Deadline = FPlatformTime::Seconds() + 30.0;
+		while (Recorder->NumWritten.load(std::memory_order_acquire) < NumFrames && FPlatformTime::Seconds() < Deadline)
+		{
+			Outbox->WaitForWork(FAiBridgeIoThread::ServiceIntervalSeconds);
+			Outbox->Flush(&Recorder.Get());
+		}
+		const double TotalSeconds = FPlatformTime::Seconds() - Start;
+
+		double ProduceEnd = Start;
+		for (TFuture<double>& Producer : Producers)
+		{
+			ProduceEnd = FMath::Max(ProduceEnd, Producer.Get());
+		}
+		const double ProduceSeconds = ProduceEnd - Start;
+
+		const int32 NumWritten = Recorder->NumWritten.load(std::memory_order_acquire);
+		TArray<int32> NextSeq;
+		NextSeq.SetNumZeroed(NumProducers);
+		int32 NumOutOfOrder = 0;
+		for (int32 Index = 0; Index < NumWritten; ++Index)
+		{
+			const TPair<uint32, uint32>& Frame = Recorder->Written[Index];
+			if (Frame.Value != (uint32)NextSeq[Frame.Key])
+			{
+				++NumOutOfOrder;
+			}
+			NextSeq[Frame.Key] = Frame.Value + 1;
+		}
+
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.SendStress] %d producers x %d frames: %d/%d written, %d out of order, %.0f frames/s queued, %.1f MB/s written -> %s"),
+			NumProducers, FramesPerProducer,
+			NumWritten, NumFrames,
+			NumOutOfOrder,
+			NumFrames / FMath::Max(ProduceSeconds, 1e-6),
+			(double)NumWritten * PayloadBytes / (1024.0 * 1024.0) / FMath::Max(TotalSeconds, 1e-6),
+			NumWritten == NumFrames && NumOutOfOrder == 0 ? TEXT("PASS") : TEXT("FAIL"));
+	}
+
+	/**
+	 * Writes a synthetic session of alternating inbound JSON and outbound audio frames to a capture,
+	 * then reads it back memory-mapped and streamed, converting text the way a replay does, and
+	 * checks every frame came back intact.
+	 */
+	void BenchCapture(const TArray<FString>& Args)
+	{
+		const int32 NumFrames = ParseIntArg(Args, 0, 200000);
+		const int32 PayloadBytes = ParseIntArg(Args, 1, 512);
+		const FString Path = AiBridgeCapture::ResolvePath(TEXT("Bench"));
+
+		TArray<uint8> Audio;
+		Audio.SetNumZeroed(PayloadBytes);
+		const FString Text = FString::Printf(TEXT(R"({"type":"npc_response","seq":0,"text":"%s"})"), *FString::ChrN(FMath::Max(0, PayloadBytes - 48), TEXT('x')));
+
+		uint64 Written = 0;
+		const double WriteStart = FPlatformTime::Seconds();
+		{
+			TSharedPtr<FAiBridgeCaptureWriter, ESPMode::ThreadSafe> Writer = FAiBridgeCaptureWriter::Create(Path);
+			if (!Writer)
+			{
+				return;
+			}
+
+			for (int32 Index = 0; Index < NumFrames; ++Index)
+			{
+				if (Index % 2 == 0)
+				{
+					Writer->WriteText(false, Text);
+				}
+				else
+				{
+					FMemory::Memcpy(Audio.GetData(), &Index, sizeof(Index));
+					Writer->WriteBinary(true, Audio.GetData(), Audio.Num());
+				}
+			}
+			Written = Writer->GetNumBytes();
+			Writer->Close();
+		}
+		const double WriteSeconds = FPlatformTime::Seconds() - WriteStart;
+
+		bool bPassed = true;
+		double ReadSeconds[2] = { 0.0, 0.0 };
+		bool bWasMapped = false;
+		for (int32 Mode = 0; Mode < 2; ++Mode)
+		{
+			// Mode 0 maps the file when it is large enough, mode 1 streams it
+			const double ReadStart = FPlatformTime::Seconds();
+			TUniquePtr<FAiBridgeCaptureReader> Reader = FAiBridgeCaptureReader::Open(Path, Mode == 0);
+			if (!Reader)
+			{
+				return;
+			}
+			bWasMapped |= Reader->IsMapped();
+
+			int32 NumRead = 0;
+			int32 NumBad = 0;
+			int32 TextLength = 0;
+			FAiBridgeCaptureRecord Record;
+			while (Reader->Next(Record))
+			{
+				if (Record.IsBinary())
+				{
+					int32 Index = -1;
+					FMemory::Memcpy(&Index, Record.Payload.GetData(), sizeof(Index));
+					NumBad += !Record.IsOutbound() || Index != NumRead ? 1 : 0;
+				}
+				else
+				{
+					TextLength = Record.GetText().Len();
+					NumBad += Record.IsOutbound() || TextLength != Text.Len() ? 1 : 0;
+				}
+				++NumRead;
+			}
+			ReadSeconds[Mode] = FPlatformTime::Seconds() - ReadStart;
+			bPassed &= NumRead == NumFrames && NumBad == 0;
+		}
+
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*Path);
+
+		const double Megabytes = Written / (1024.0 * 1024.0);
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.Capture] %d frames, %.1f MB: write %.1f MB/s, read %s %.0f frames/s %.1f MB/s, read streamed %.0f frames/s %.1f MB/s -> %s"),
+			NumFrames, Megabytes,
+			Megabytes / FMath::Max(WriteSeconds, 1e-6),
+			bWasMapped ? TEXT("mapped") : TEXT("in memory"),
+			NumFrames / FMath::Max(ReadSeconds[0], 1e-6), Megabytes / FMath::Max(ReadSeconds[0], 1e-6),
+			NumFrames / FMath::Max(ReadSeconds[1], 1e-6), Megabytes / FMath::Max(ReadSeconds[1], 1e-6),
+			bPassed ? TEXT("PASS") : TEXT("FAIL"));
+	}
+
+	/**
+	 * Streams synthetic 16-bit TTS audio in 100 ms chunks through the decode stage at the provider rate,
+	 * reading the mixer-rate output back as an audio thread would, and reports the worker cost per
+	 * second of audio.
+	 */
+	void BenchDecode(const TArray<FString>& Args)
+	{
+		const int32 Seconds = ParseIntArg(Args, 0, 60);
+		const int32 InputRate = ParseIntArg(Args, 1, 22050);
+		const int32 OutputRate = ParseIntArg(Args, 2, 48000);
+		const int32 OutputChannels = ParseIntArg(Args, 3, 2);
+		const TArray<int16> Pcm = MakeSyntheticSpeech(InputRate, Seconds);
+
+		FAudioDecodeStage Stage(OutputRate, OutputChannels);
+		Stage.BeginStream(FString::Printf(TEXT("pcm_%d"), InputRate));
+
+		TArray<float> ReadBuffer;
+		ReadBuffer.SetNumUninitialized(1024 * OutputChannels);
+		uint64 FramesRead = 0;
+
+		const int32 ChunkSamples = InputRate / 10;
+		const double Start = FPlatformTime::Seconds();
+		for (int32 Offset = 0; Offset < Pcm.Num(); Offset += ChunkSamples)
+		{
+			const int32 Count = FMath::Min(ChunkSamples, Pcm.Num() - Offset);
+			Stage.PushEncoded(TArray<uint8>(reinterpret_cast<const uint8*>(Pcm.GetData() + Offset), Count * sizeof(int16)));
+
+			// Drain whatever is ready, the way the audio render thread would between pushes
+			while (const int32 Read = Stage.Read(ReadBuffer.GetData(), 1024))
+			{
+				FramesRead += Read;
+			}
+		}
+		Stage.Flush();
+		while (const int32 Read = Stage.Read(ReadBuffer.GetData(), 1024))
+		{
+			FramesRead += Read;
+		}
+		const double TotalSeconds = FPlatformTime::Seconds() - Start;
+
+		// The filter delays the output by half its taps but drops nothing, every input frame maps to an output
+		const FAudioDecodeStats Stats = Stage.GetStats();
+		const double ExpectedFrames = (double)Pcm.Num() * OutputRate / InputRate;
+		const bool bPassed = FramesRead == Stats.OutputFrames && FMath::Abs((double)FramesRead - ExpectedFrames) <= 2.0;
+
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.Decode] %ds pcm_%d -> %d Hz x%d: decode+resample %.3f ms per second of audio (%.0fx realtime), %.1f ms wall, %llu/%.0f frames out, %d extra blocks -> %s"),
+			Seconds, InputRate, OutputRate, OutputChannels,
+			Stats.ProcessSeconds * 1000.0 / Seconds,
+			Seconds / FMath::Max(Stats.ProcessSeconds, 1e-9),
+			TotalSeconds * 1000.0,
+			FramesRead, ExpectedFrames,
+			Stats.ExtraBlocks,
+			bPassed ? TEXT("PASS") : TEXT("FAIL"));
+	}
+
+	/**
+	 * Builds an index of synthetic snippets, then searches it with five-word phrases taken from random
+	 * snippets and reports the cost per query and how often the source snippet ranks first.
+	 */
+	void BenchKnowledge(const TArray<FString>& Args)
+	{
+		const int32 NumSnippets = ParseIntArg(Args, 0, 10000);
+		const int32 NumQueries = ParseIntArg(Args, 1, 1000);
+		constexpr int32 WordsPerSnippet = 40;
+		constexpr int32 WordsPerQuery = 5;
+		const FString Path = FPaths::ProjectSavedDir() / TEXT("KnowledgeBench.abki");
+
+		// Made-up words from a syllable set, so they share trigrams the way real vocabulary does
+		static const TCHAR* const Syllables[] =
+		{
+			TEXT("ka"), TEXT("lo"), TEXT("mi"), TEXT("ne"), TEXT("ru"), TEXT("ta"), TEXT("shi"), TEXT("po"), TEXT("ve"), TEXT("za"),
+			TEXT("qu"), TEXT("den"), TEXT("mar"), TEXT("tol"), TEXT("fen"), TEXT("gri"), TEXT("bo"), TEXT("lu"), TEXT("sa"), TEXT("wen"),
+		};
+		FRandomStream Random(1234);
+		TArray<FString> Vocabulary;
+		for (int32 Index = 0; Index < 5000; ++Index)
+		{
+			FString Word;
+			for (int32 Syllable = Random.RandRange(2, 4); Syllable > 0; --Syllable)
+			{
+				Word += Syllables[Random.RandHelper(UE_ARRAY_COUNT(Syllables))];
+			}
+			Vocabulary.Add(MoveTemp(Word));
+		}
+
+		TArray<TArray<int32>> SnippetWords;
+		TArray<FString> Snippets;
+		for (int32 Snippet = 0; Snippet < NumSnippets; ++Snippet)
+		{
+			TArray<int32>& Words = SnippetWords.AddDefaulted_GetRef();
+			FString& Text = Snippets.AddDefaulted_GetRef();
+			for (int32 Word = 0; Word < WordsPerSnippet; ++Word)
+			{
+				Words.Add(Random.RandHelper(Vocabulary.Num()));
+				Text += Vocabulary[Words.Last()];
+				Text += TEXT(' ');
+			}
+		}
+
+		const double BuildStart = FPlatformTime::Seconds();
+		if (!FKnowledgeIndex::Build(Snippets, Path))
+		{
+			return;
+		}
+		const double BuildSeconds = FPlatformTime::Seconds() - BuildStart;
+
+		TUniquePtr<FKnowledgeIndex> Index = FKnowledgeIndex::Open(Path);
+		if (!Index)
+		{
+			return;
+		}
+
+		TArray<FString> Queries;
+		TArray<int32> Targets;
+		for (int32 Query = 0; Query < NumQueries; ++Query)
+		{
+			const int32 Target = Random.RandHelper(NumSnippets);
+			const int32 First = Random.RandHelper(WordsPerSnippet - WordsPerQuery);
+			FString& Text = Queries.AddDefaulted_GetRef();
+			for (int32 Word = First; Word < First + WordsPerQuery; ++Word)
+			{
+				Text += Vocabulary[SnippetWords[Target][Word]];
+				Text += TEXT(' ');
+			}
+			Targets.Add(Target);
+		}
+
+		TArray<FKnowledgeHit> Hits;
+		int32 NumCorrect = 0;
+		const double SearchStart = FPlatformTime::Seconds();
+		for (int32 Query = 0; Query < NumQueries; ++Query)
+		{
+			Index->Search(Queries[Query], 4, 0.0f, Hits);
+			NumCorrect += Hits.Num() > 0 && Hits[0].Snippet == Targets[Query] ? 1 : 0;
+		}
+		const double SearchSeconds = FPlatformTime::Seconds() - SearchStart;
+
+		const bool bWasMapped = Index->IsMapped();
+		Index.Reset();
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*Path);
+
+		const double Accuracy = (double)NumCorrect / FMath::Max(NumQueries, 1);
+		const bool bPassed = Accuracy >= 0.95;
+
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.Knowledge] %d snippets (%s), build %.1f ms: %.1f us per query, top-1 %.1f%% over %d queries -> %s"),
+			NumSnippets, bWasMapped ? TEXT("mapped") : TEXT("in memory"),
+			BuildSeconds * 1000.0,
+			SearchSeconds * 1e6 / FMath::Max(NumQueries, 1),
+			Accuracy * 100.0, NumQueries,
+			bPassed ? TEXT("PASS") : TEXT("FAIL"));
+	}
+
+	/**
+	 * Counts and encodes synthetic chat text with the configured model's rank table, or with a small
+	 * synthetic table when none is installed, and reports throughput in tokens per second. Checks that
+	 * Count agrees with Encode and that decoding returns the original bytes.
+	 */
+	void BenchTokenizer(const TArray<FString>& Args)
+	{
+		const int32 Kilobytes = ParseIntArg(Args, 0, 256);
+		const FString Model = TEXT("gpt-4o-mini");
+
+		TSharedPtr<FBpeTokenizer, ESPMode::ThreadSafe> Tokenizer = FBpeTokenizer::ForModel(Model);
+		FString TableName = AiBridgeTokenizer::GetEncodingForModel(Model);
+		const FString SyntheticPath = FPaths::ProjectSavedDir() / TEXT("TokenizerBench.abtok");
+		if (!Tokenizer->IsExact())
+		{
+			// All bytes, then every pair and triple over lowercase letters and space, so merges run the way they do on English
+			TArray<TArray<uint8>> Tokens;
+			for (int32 Byte = 0; Byte < 256; ++Byte)
+			{
+				Tokens.Add({ (uint8)Byte });
+			}
+			const FAnsiStringView Alphabet = "abcdefghijklmnopqrstuvwxyz ";
+			for (const ANSICHAR First : Alphabet)
+			{
+				for (const ANSICHAR Second : Alphabet)
+				{
+					Tokens.Add({ (uint8)First, (uint8)Second });
+				}
+			}
+			for (const ANSICHAR First : Alphabet)
+			{
+				for (const ANSICHAR Second : Alphabet)
+				{
+					for (const ANSICHAR Third : Alphabet)
+					{
+						Tokens.Add({ (uint8)First, (uint8)Second, (uint8)Third });
+					}
+				}
+			}
+
+			if (!FBpeTokenizer::Compile(Tokens, AiBridgeTokenizer::GetPreTokenizer(TableName), SyntheticPath))
+			{
+				return;
+			}
+			Tokenizer = MakeShareable(FBpeTokenizer::Open(SyntheticPath).Release());
+			if (!Tokenizer)
+			{
+				return;
+			}
+			TableName = TEXT("synthetic");
+		}
+
+		static const TCHAR* const Words[] =
+		{
+			TEXT("hello"), TEXT("traveler"), TEXT("what"), TEXT("brings"), TEXT("you"), TEXT("here"), TEXT("today"), TEXT("the"),
+			TEXT("village"), TEXT("market"), TEXT("opens"), TEXT("at"), TEXT("dawn"), TEXT("I'm"), TEXT("looking"), TEXT("for"),
+			TEXT("blacksmith"), TEXT("Could"), TEXT("tell"), TEXT("me"), TEXT("about"), TEXT("XRLab"), TEXT("development"),
+			TEXT("services"), TEXT("Unreal"), TEXT("Engine"), TEXT("they've"), TEXT("escalate"), TEXT("customer"), TEXT("issue"),
+		};
+		static const TCHAR* const Separators[] = { TEXT(" "), TEXT(" "), TEXT(" "), TEXT(", "), TEXT(". "), TEXT("? "), TEXT("!\n"), TEXT(" 2024 "), TEXT("\n\n") };
+
+		FRandomStream Random(1234);
+		TStringBuilder<1024> Builder;
+		FString Text;
+		while (Text.Len() < Kilobytes * 1024)
+		{
+			Builder.Reset();
+			for (int32 Word = 0; Word < 64; ++Word)
+			{
+				Builder << Words[Random.RandHelper(UE_ARRAY_COUNT(Words))] << Separators[Random.RandHelper(UE_ARRAY_COUNT(Separators))];
+			}
+			Text.Append(Builder.GetData(), Builder.Len());
+		}
+
+		const double CountStart = FPlatformTime::Seconds();
+		const int32 Counted = Tokenizer->Count(Text);
+		const double CountSeconds = FPlatformTime::Seconds() - CountStart;
+
+		TArray<uint32> Encoded;
+		const double EncodeStart = FPlatformTime::Seconds();
+		Tokenizer->Encode(Text, Encoded);
+		const double EncodeSeconds = FPlatformTime::Seconds() - EncodeStart;
+
+		TArray<uint8> Decoded;
+		Tokenizer->Decode(Encoded, Decoded);
+		const FTCHARToUTF8 Utf8(*Text, Text.Len());
+		const bool bPassed = Counted == Encoded.Num()
+			&& Decoded.Num() == Utf8.Length()
+			&& FMemory::Memcmp(Decoded.GetData(), Utf8.Get(), Decoded.Num()) == 0;
+
+		const bool bWasMapped = Tokenizer->IsMapped();
+		Tokenizer.Reset();
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*SyntheticPath);
+
+		const double Megabytes = Utf8.Length() / (1024.0 * 1024.0);
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.Tokenizer] %.1f MB with the %s table (%s), %d tokens: count %.2f M tokens/s %.1f MB/s, encode %.2f M tokens/s -> %s"),
+			Megabytes, *TableName, bWasMapped ? TEXT("mapped") : TEXT("in memory"), Counted,
+			Counted / FMath::Max(CountSeconds, 1e-9) / 1e6, Megabytes / FMath::Max(CountSeconds, 1e-9),
+			Encoded.Num() / FMath::Max(EncodeSeconds, 1e-9) / 1e6,
+			bPassed ? TEXT("PASS") : TEXT("FAIL"));
+	}
+
+	void BenchPrompt(const TArray<FString>& Args)
+	{
+		const int32 Turns = ParseIntArg(Args, 0, 10000);
+
+		// About the size of a persona with its selected knowledge, variables spread through it
+		FString PersonaSource = TEXT("You are ${npcName}, the blacksmith of ${village}.\n\n${knowledge}CUSTOMER CONTEXT:\n\"${customerContext}\"\n\nGUIDELINES:\n");
+		for (int32 Line = 1; Line <= 40; ++Line)
+		{
+			PersonaSource += FString::Printf(TEXT("%d. Stay in character as ${npcName} and keep answers about ${village} short and \"friendly\".\n"), Line);
+		}
+		const TCHAR* const RequestSource = TEXT(R"({"type": "textinput", "text": "${text|json}", "context": {"systemPrompt": "${systemPrompt|json}", "llmModel": "${llmModel|json}"}})");
+
+		const FString NpcName = TEXT("Gerrit");
+		const FString Village = TEXT("Oosterholt");
+		const FString Knowledge = TEXT("KNOWLEDGE:\nSwords cost 40 silver.\tShields cost 25 silver.\nThe forge closes at sunset.\n\n");
+		const FString Model = TEXT("gpt-4o-mini");
+		TArray<FString> Utterances;
+		for (int32 Index = 0; Index < 64; ++Index)
+		{
+			Utterances.Add(FString::Printf(TEXT("Could you \"sharpen\" my sword before the market opens? (%d)"), Index));
+		}
+
+		FPromptTemplate Persona;
+		Persona.Compile(PersonaSource);
+		FPromptTemplate Request;
+		Request.Compile(RequestSource);
+
+		TArray<FPromptTemplateValue> PersonaValues;
+		TArray<FPromptTemplateValue> RequestValues;
+		TArray<uint8> PromptBuffer;
+		TArray<uint8> RequestBuffer;
+		auto RenderCompiled = [&](const FString& Utterance, const FString& CustomerContext)
+		{
+			FXxHash64Builder Hash;
+			PromptBuffer.Reset();
+			Persona.SetValue(PersonaValues, TEXT("npcName"), FPromptTemplateValue(NpcName));
+			Persona.SetValue(PersonaValues, TEXT("village"), FPromptTemplateValue(Village));
+			Persona.SetValue(PersonaValues, TEXT("knowledge"), FPromptTemplateValue(Knowledge));
+			Persona.SetValue(PersonaValues, TEXT("customerContext"), FPromptTemplateValue(CustomerContext));
+			Persona.Render(PersonaValues, PromptBuffer, &Hash);
+
+			RequestBuffer.Reset();
+			Request.SetValue(RequestValues, TEXT("text"), FPromptTemplateValue(Utterance));
+			Request.SetValue(RequestValues, TEXT("systemPrompt"), FPromptTemplateValue(PromptBuffer));
+			Request.SetValue(RequestValues, TEXT("llmModel"), FPromptTemplateValue(Model));
+			Request.Render(RequestValues, RequestBuffer);
+			return Hash.Finalize().Hash;
+		};
+
+		// What the requests did before: replace every placeholder in a fresh string, escape, convert
+		static const TArray<TCHAR> JsonEscapes = { TEXT('\\'), TEXT('"'), TEXT('\n'), TEXT('\r'), TEXT('\t') };
+		const FString BaselineSource = FString(RequestSource).Replace(TEXT("|json"), TEXT(""));
+		auto RenderReplace = [&](const FString& Utterance, const FString& CustomerContext)
+		{
+			FString Prompt = PersonaSource;
+			Prompt.ReplaceInline(TEXT("${npcName}"), *NpcName);
+			Prompt.ReplaceInline(TEXT("${village}"), *Village);
+			Prompt.ReplaceInline(TEXT("${knowledge}"), *Knowledge);
+			Prompt.ReplaceInline(TEXT("${customerContext}"), *CustomerContext);
+
+			FString Json = BaselineSource;
+			Json.ReplaceInline(TEXT("${text}"), *Utterance.ReplaceCharWithEscapedChar(&JsonEscapes));
+			Json.ReplaceInline(TEXT("${systemPrompt}"), *Prompt.ReplaceCharWithEscapedChar(&JsonEscapes));
+			Json.ReplaceInline(TEXT("${llmModel}"), *Model);
+			const FTCHARToUTF8 Utf8(*Json, Json.Len());
+			return TArray<uint8>(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+		};
+
+		const FString Context = TEXT("Returning customer, bought a shield last week.");
+		const uint64 FirstHash = RenderCompiled(Utterances[0], Context);
+		const TArray<uint8> Reference = RenderReplace(Utterances[0], Context);
+		const bool bSameBytes = RequestBuffer == Reference;
+		const bool bStableHash = RenderCompiled(Utterances[1], Context) == FirstHash;
+		const bool bHashTracksPrompt = RenderCompiled(Utterances[0], TEXT("First visit.")) != FirstHash;
+
+		int64 Checksum = 0;
+		const double CompiledStart = FPlatformTime::Seconds();
+		for (int32 Turn = 0; Turn < Turns; ++Turn)
+		{
+			Checksum += (int64)RenderCompiled(Utterances[Turn % Utterances.Num()], Context) + RequestBuffer.Num();
+		}
+		const double CompiledSeconds = FPlatformTime::Seconds() - CompiledStart;
+
+		const double ReplaceStart = FPlatformTime::Seconds();
+		for (int32 Turn = 0; Turn < Turns; ++Turn)
+		{
+			Checksum += RenderReplace(Utterances[Turn % Utterances.Num()], Context).Num();
+		}
+		const double ReplaceSeconds = FPlatformTime::Seconds() - ReplaceStart;
+
+		const bool bPassed = bSameBytes && bStableHash && bHashTracksPrompt;
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.Prompt] %d turns of %d byte requests: compiled %.2f us/turn, replace %.2f us/turn (%.1fx), hash %016llx, checksum %lld -> %s"),
+			Turns, RequestBuffer.Num(),
+			CompiledSeconds * 1e6 / Turns, ReplaceSeconds * 1e6 / Turns, ReplaceSeconds / FMath::Max(CompiledSeconds, 1e-9),
+			FirstHash, Checksum,
+			bPassed ? TEXT("PASS") : TEXT("FAIL"));
+	}
+
+	void BenchLog(const TArray<FString>& Args)
+	{
+		const int32 NumProducers = ParseIntArg(Args, 0, 4);
+		const int32 EventsPerProducer = ParseIntArg(Args, 1, 50000);
+
+		// A reply the size of a long LLM answer, the old log wrote all of it on the game thread
+		FString Body = TEXT(R"({"type":"llm_response","text":")");
+		while (Body.Len() < 4096)
+		{
+			Body += TEXT("The blacksmith sharpens your sword while telling you about the market. ");
+		}
+		Body += TEXT(R"("})");
+
+		AiBridgeLog::Flush();
+		const FAiBridgeLogStats Before = AiBridgeLog::GetStats();
+
+		// VeryVerbose events are queued and formatted-or-filtered by the writer like any other, without filling the log
+		const double Start = FPlatformTime::Seconds();
+		TArray<TFuture<void>> Producers;
+		for (int32 Producer = 0; Producer < NumProducers; ++Producer)
+		{
+			Producers.Add(Async(EAsyncExecution::Thread, [&Body, EventsPerProducer]()
+			{
+				for (int32 Index = 0; Index < EventsPerProducer; ++Index)
+				{
+					AiBridgeLog::Emit(ELogVerbosity::VeryVerbose, TEXT("bench.log"), {
+						FAiBridgeLogField::Int(TEXT("seq"), Index),
+						FAiBridgeLogField::Payload(TEXT("body"), Body),
+						FAiBridgeLogField::Secret(TEXT("token"), Body) });
+				}
+			}));
+		}
+		for (TFuture<void>& Producer : Producers)
+		{
+			Producer.Wait();
+		}
+		const double EmitSeconds = FPlatformTime::Seconds() - Start;
+
+		AiBridgeLog::Flush();
+		const FAiBridgeLogStats After = AiBridgeLog::GetStats();
+		const uint64 Emitted = After.Emitted - Before.Emitted;
+		const uint64 Written = After.Written - Before.Written;
+		const uint64 Dropped = After.Dropped - Before.Dropped;
+		const int32 NumEvents = NumProducers * EventsPerProducer;
+
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.Log] %d producers x %d events of %d chars: %.0f ns/event on the caller, %llu written, %llu dropped (ring of %d) -> %s"),
+			NumProducers, EventsPerProducer, Body.Len(),
+			EmitSeconds * 1e9 / FMath::Max(EventsPerProducer, 1),
+			Written, Dropped, After.Capacity,
+			Emitted == (uint64)NumEvents && Written + Dropped == Emitted ? TEXT("PASS") : TEXT("FAIL"));
+	}
+
+	/**
+	 * Streams TTS audio into a decode stage nobody plays back, as on a kiosk left talking to an empty
+	 * room, then checks the stage never held more than its audio budget and that every decoded frame
+	 * was either read back or counted as dropped.
+	 */
+	void BenchMemory(const TArray<FString>& Args)
+	{
+		const int32 Seconds = ParseIntArg(Args, 0, 120);
+		const int32 BudgetKB = ParseIntArg(Args, 1, 1024);
+		constexpr int32 InputRate = 22050;
+		const TArray<int16> Pcm = MakeSyntheticSpeech(InputRate, Seconds);
+
+		TSharedRef<FAiBridgeMemoryStream, ESPMode::ThreadSafe> Memory = AiBridgeMemory::CreateStream(TEXT("Bench.Memory"));
+		Memory->SetBudget(EAiBridgeMemoryCategory::Audio, BudgetKB * 1024ll);
+
+		FAudioDecodeStats Stats;
+		uint64 FramesRead = 0;
+		{
+			FAudioDecodeStage Stage(48000, 1, 1024, 32, Memory);
+			Stage.BeginStream(FString::Printf(TEXT("pcm_%d"), InputRate));
+
+			const int32 ChunkSamples = InputRate / 10;
+			for (int32 Offset = 0; Offset < Pcm.Num(); Offset += ChunkSamples)
+			{
+				const int32 Count = FMath::Min(ChunkSamples, Pcm.Num() - Offset);
+				Stage.PushEncoded(TArray<uint8>(reinterpret_cast<const uint8*>(Pcm.GetData() + Offset), Count * sizeof(int16)));
+			}
+			Stage.Flush();
+
+			TArray<float> ReadBuffer;
+			ReadBuffer.SetNumUninitialized(1024);
+			while (const int32 Read = Stage.Read(ReadBuffer.GetData(), 1024))
+			{
+				FramesRead += Read;
+			}
+			Stats = Stage.GetStats();
+		}
+
+		const FAiBridgeMemoryUsage Usage = Memory->GetUsage(EAiBridgeMemoryCategory::Audio);
+		const bool bPassed = Usage.Peak <= Usage.Budget && Usage.Current == 0 && FramesRead + Stats.DroppedFrames == Stats.OutputFrames;
+
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.Memory] %ds unplayed TTS, %d KB budget: peak %.1f KB, %d extra blocks, %llu frames kept, %lld dropped, %d chunks dropped, %.1f KB evicted -> %s"),
+			Seconds, BudgetKB, Usage.Peak / 1024.0, Stats.ExtraBlocks,
+			FramesRead, Stats.DroppedFrames, Stats.DroppedChunks, Usage.EvictedBytes / 1024.0,
+			bPassed ? TEXT("PASS") : TEXT("FAIL"));
+	}
+
+	void BenchTtsAdapt(const TArray<FString>& Args)
+	{
+		const int32 RepliesPerPhase = ParseIntArg(Args, 0, 4);
+		const int32 ReplyKB = ParseIntArg(Args, 1, 64);
+		constexpr int32 FragmentBytes = 4096;
+		constexpr double SecondsBetweenReplies = 3.0;
+		/** Frames are only seen, and stamped, when the game thread ticks */
+		constexpr double TickSeconds = 1.0 / 60.0;
+
+		// A venue network that degrades step by step and recovers
+		const float PhaseKbps[] = { 2000.0f, 500.0f, 250.0f, 60.0f, 2000.0f };
+
+		const UAiBridgeSettings* Settings = GetDefault<UAiBridgeSettings>();
+		// As a bridge that decodes TTS audio sees the ladder
+		auto IsUsable = [](const FAiBridgeTtsFormat& Format) { return AiBridgeAudio::HasDecoder(Format.OutputFormat); };
+
+		FAiBridgeThroughputMeter Meter;
+		FTtsFormatSelector Selector;
+		Selector.Configure(Settings->TtsFormats, Settings->TtsUpgradeHeadroom);
+
+		double Now = 0.0;
+		bool bPassed = true;
+		for (const float Kbps : PhaseKbps)
+		{
+			const double SecondsPerFragment = FragmentBytes * 8 / (Kbps * 1000.0);
+			for (int32 Reply = 0; Reply < RepliesPerPhase; ++Reply)
+			{
+				for (int32 Sent = 0; Sent < ReplyKB * 1024; Sent += FragmentBytes)
+				{
+					Meter.AddFrame(FragmentBytes, FMath::CeilToDouble(Now / TickSeconds) * TickSeconds, TickSeconds);
+					Now += SecondsPerFragment;
+				}
+				Now += SecondsBetweenReplies;
+				Meter.Flush(Now);
+				Selector.Update(Meter.GetStats().EstimatedKbps, IsUsable);
+			}
+
+			// Once the estimate has settled the choice should be what the true link speed picks
+			FTtsFormatSelector Reference;
+			Reference.Configure(Settings->TtsFormats, Settings->TtsUpgradeHeadroom);
+			Reference.Update(Kbps, IsUsable);
+
+			const FAiBridgeTtsFormat* Chosen = Selector.GetCurrent();
+			const FAiBridgeTtsFormat* Expected = Reference.GetCurrent();
+			const bool bMatches = Chosen != nullptr && Expected != nullptr && Chosen->OutputFormat == Expected->OutputFormat;
+			bPassed &= bMatches;
+
+			UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.TtsAdapt] link %.0f kbps: estimated %.0f kbps, chose %s (%s), expected %s"),
+				Kbps, Meter.GetStats().EstimatedKbps,
+				Chosen != nullptr ? *Chosen->OutputFormat : TEXT("none"), Chosen != nullptr ? *Chosen->StreamingMode : TEXT("-"),
+				Expected != nullptr ? *Expected->OutputFormat : TEXT("none"));
+		}
+
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.TtsAdapt] %d replies of %d KB per phase, %d samples -> %s"),
+			RepliesPerPhase, ReplyKB, Meter.GetStats().Samples, bPassed ? TEXT("PASS") : TEXT("FAIL"));
+	}
+
+	void BenchRateLimit(const TArray<FString>& Args)
+	{
+		const int32 Seconds = ParseIntArg(Args, 0, 300);
+		const int32 MashSize = ParseIntArg(Args, 1, 12);
+		constexpr double TickSeconds = 0.1;
+		constexpr double SecondsBetweenMashes = 7.0;
+
+		FAiBridgeRateLimit Limit;
+		Limit.Bucket = TEXT("Bench");
+		FAiBridgeRateLimiter Limiter;
+		Limiter.Configure({ Limit });
+
+		// Simulated time, sends record when they went out and in which order they were submitted
+		TArray<double> SendTimes;
+		TArray<int32> SendOrder;
+		int32 Submitted = 0;
+		double Now = 0.0;
+		double NextMash = 0.0;
+		double SubmitSeconds = 0.0;
+		while (Now < Seconds)
+		{
+			if (Now >= NextMash)
+			{
+				const double SubmitStart = FPlatformTime::Seconds();
+				for (int32 Index = 0; Index < MashSize; ++Index)
+				{
+					const int32 Order = Submitted++;
+					Limiter.Submit(Limit.Bucket, [&SendTimes, &SendOrder, &Now, Order]() { SendTimes.Add(Now); SendOrder.Add(Order); return true; }, Now);
+				}
+				SubmitSeconds += FPlatformTime::Seconds() - SubmitStart;
+				NextMash += SecondsBetweenMashes;
+			}
+			Limiter.Tick(Now);
+			Now += TickSeconds;
+		}
+
+		// No window may carry more than the burst plus what the rate refills during it
+		const double TokensPerSecond = Limit.RequestsPerMinute / 60.0;
+		bool bWithinQuota = true;
+		for (int32 First = 0, Last = 0; Last < SendTimes.Num(); ++Last)
+		{
+			while (SendTimes[Last] - SendTimes[First] > 60.0)
+			{
+				++First;
+			}
+			bWithinQuota &= Last - First + 1 <= Limit.Burst + FMath::CeilToInt32((SendTimes[Last] - SendTimes[First]) * TokensPerSecond);
+		}
+
+		bool bInOrder = true;
+		for (int32 Index = 1; Index < SendOrder.Num(); ++Index)
+		{
+			bInOrder &= SendOrder[Index] > SendOrder[Index - 1];
+		}
+
+		const FAiBridgeRateLimiterStats Stats = Limiter.GetStats();
+		const bool bAccounted = Stats.Admitted + Stats.Rejected + Stats.Queued == Submitted && Stats.Admitted == SendTimes.Num();
+		const bool bPassed = bWithinQuota && bInOrder && bAccounted;
+
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.RateLimit] %ds of %d-turn mashes at %.0f/min: %d submitted, %lld sent, %lld throttled, %lld rejected, %d queued, longest wait %.1f s, %.2f us per submit -> %s"),
+			Seconds, MashSize, Limit.RequestsPerMinute, Submitted, Stats.Admitted, Stats.Throttled, Stats.Rejected, Stats.Queued,
+			Stats.MaxWaitMs / 1000.0f, Submitted > 0 ? SubmitSeconds * 1e6 / Submitted : 0.0,
+			bPassed ? TEXT("PASS") : TEXT("FAIL"));
+	}
+
+	void BenchTranscript(const TArray<FString>& Args)
+	{
+		const int32 NumDeltas = FMath::Max(ParseIntArg(Args, 0, 20000), 100);
+
+		// Token-sized deltas that split words anywhere, with a paragraph break now and then
+		FRandomStream Random(4321);
+		TArray<FString> Deltas;
+		FString Expected;
+		while (Deltas.Num() < NumDeltas)
+		{
+			FString Word;
+			const int32 WordLen = Random.RandRange(1, 9);
+			for (int32 Index = 0; Index < WordLen; ++Index)
+			{
+				Word.AppendChar(TEXT('a') + Random.RandRange(0, 25));
+			}
+			Word += Random.FRand() < 0.02f ? TEXT(".\n\n") : TEXT(" ");
+
+			const int32 Split = Random.RandRange(1, Word.Len());
+			Deltas.Add(Word.Left(Split));
+			if (Split < Word.Len())
+			{
+				Deltas.Add(Word.RightChop(Split));
+			}
+			Expected += Word;
+		}
+
+		// Ends on a word, newlines at the very end are not part of the text until something follows them
+		Deltas.Add(TEXT("end"));
+		Expected += TEXT("end");
+
+		// What the game thread does per delta with the rope: append, then build text for new runs and the open one,
+		// as SAiBridgeTranscript does. Characters handed to text layout stand in for shaping cost.
+		const int32 Window = Deltas.Num() / 10;
+		FAiBridgeTranscript Transcript;
+		int32 NumBuilt = 0;
+		bool bLastBuiltOpen = false;
+		int64 Checksum = 0;
+		int64 RopeLaidOut[2] = { 0, 0 };
+		double RopeSeconds[2] = { 0.0, 0.0 };
+		for (int32 Index = 0; Index < Deltas.Num(); ++Index)
+		{
+			const double Start = FPlatformTime::Seconds();
+			int64 LaidOut = 0;
+			Transcript.Append(Deltas[Index]);
+			for (int32 Run = bLastBuiltOpen ? NumBuilt - 1 : NumBuilt; Run < Transcript.NumRuns(); ++Run)
+			{
+				const FText RunText = FText::FromStringView(Transcript.GetRunText(Run));
+				LaidOut += RunText.ToString().Len();
+			}
+			NumBuilt = Transcript.NumRuns();
+			bLastBuiltOpen = Transcript.IsLastRunOpen();
+			const double Elapsed = FPlatformTime::Seconds() - Start;
+
+			Checksum += LaidOut;
+			const int32 Slot = Index < Window ? 0 : (Index >= Deltas.Num() - Window ? 1 : INDEX_NONE);
+			if (Slot != INDEX_NONE)
+			{
+				RopeLaidOut[Slot] += LaidOut;
+				RopeSeconds[Slot] += Elapsed;
+			}
+		}
+		const bool bSameText = Transcript.ToString() == Expected;
+
+		// What a subtitle text block bound to the whole reply does: append, then set and lay out all of it again
+		FString Whole;
+		int64 WholeLaidOut[2] = { 0, 0 };
+		double WholeSeconds[2] = { 0.0, 0.0 };
+		for (int32 Index = 0; Index < Deltas.Num(); ++Index)
+		{
+			const double Start = FPlatformTime::Seconds();
+			Whole += Deltas[Index];
+			const FText WholeText = FText::FromString(Whole);
+			const int64 LaidOut = WholeText.ToString().Len();
+			const double Elapsed = FPlatformTime::Seconds() - Start;
+
+			Checksum += LaidOut;
+			const int32 Slot = Index < Window ? 0 : (Index >= Deltas.Num() - Window ? 1 : INDEX_NONE);
+			if (Slot != INDEX_NONE)
+			{
+				WholeLaidOut[Slot] += LaidOut;
+				WholeSeconds[Slot] += Elapsed;
+			}
+		}
+
+		// The rope lays out what a delta touched; the whole text grows with the reply
+		const bool bConstant = RopeLaidOut[1] <= RopeLaidOut[0] * 2;
+		const bool bPassed = bSameText && bConstant;
+
+		UE_LOG(LogAiBridge, Log, TEXT("[AiBridge.Bench.Transcript] %d deltas, %d chars in %d runs: rope lays out %.1f chars and takes %.3f us per delta early, %.1f chars and %.3f us late; whole text %.1f chars and %.3f us early, %.1f chars and %.3f us late, checksum %lld -> %s"),
+			Deltas.Num(), Transcript.Len(), Transcript.NumRuns(),
+			(double)RopeLaidOut[0] / Window, RopeSeconds[0] * 1e6 / Window, (double)RopeLaidOut[1] / Window, RopeSeconds[1] * 1e6 / Window,
+			(double)WholeLaidOut[0] / Window, WholeSeconds[0] * 1e6 / Window, (double)WholeLaidOut[1] / Window, WholeSeconds[1] * 1e6 / Window,
+			Checksum,
+			bPassed ? TEXT("PASS") : TEXT("FAIL"));
+	}
+}
+
+static FAutoConsoleCommand GAiBridgeBenchLipSyncCommand(
+	TEXT("AiBridge.Bench.LipSync"),
+	TEXT("Measures viseme analysis cost per second of audio. Usage: AiBridge.Bench.LipSync [Seconds=60] [SampleRate=22050]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchLipSync));
+
+static FAutoConsoleCommand GAiBridgeBenchSendStressCommand(
+	TEXT("AiBridge.Bench.SendStress"),
+	TEXT("Sends from many threads through one outbox and checks completeness and per-stream order. Usage: AiBridge.Bench.SendStress [Producers=16] [FramesPerProducer=20000]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchSendStress));
+
+static FAutoConsoleCommand GAiBridgeBenchCaptureCommand(
+	TEXT("AiBridge.Bench.Capture"),
+	TEXT("Writes a synthetic capture and reads it back mapped and streamed, checking every frame. Usage: AiBridge.Bench.Capture [Frames=200000] [PayloadBytes=512]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchCapture));
+
+static FAutoConsoleCommand GAiBridgeBenchDecodeCommand(
+	TEXT("AiBridge.Bench.Decode"),
+	TEXT("Measures TTS decode and resampling cost per second of audio on the worker pipe. Usage: AiBridge.Bench.Decode [Seconds=60] [InputRate=22050] [OutputRate=48000] [Channels=2]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchDecode));
+
+static FAutoConsoleCommand GAiBridgeBenchKnowledgeCommand(
+	TEXT("AiBridge.Bench.Knowledge"),
+	TEXT("Measures knowledge index search cost and top-1 accuracy on synthetic snippets. Usage: AiBridge.Bench.Knowledge [Snippets=10000] [Queries=1000]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchKnowledge));
+
+static FAutoConsoleCommand GAiBridgeBenchTokenizerCommand(
+	TEXT("AiBridge.Bench.Tokenizer"),
+	TEXT("Measures prompt token counting and encoding throughput and checks they agree. Usage: AiBridge.Bench.Tokenizer [Kilobytes=256]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchTokenizer));
+
+static FAutoConsoleCommand GAiBridgeBenchPromptCommand(
+	TEXT("AiBridge.Bench.Prompt"),
+	TEXT("Measures building a text input request from compiled templates against string replacement and checks both agree. Usage: AiBridge.Bench.Prompt [Turns=10000]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchPrompt));
+
+static FAutoConsoleCommand GAiBridgeBenchLogCommand(
+	TEXT("AiBridge.Bench.Log"),
+	TEXT("Measures the caller-side cost of structured log events from several threads and checks every event is written or counted as dropped. Usage: AiBridge.Bench.Log [Producers=4] [EventsPerProducer=50000]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchLog));
+
+static FAutoConsoleCommand GAiBridgeBenchMemoryCommand(
+	TEXT("AiBridge.Bench.Memory"),
+	TEXT("Streams TTS audio nobody plays back and checks the decode stage stays within its audio budget. Usage: AiBridge.Bench.Memory [Seconds=120] [BudgetKB=1024]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchMemory));
+
+static FAutoConsoleCommand GAiBridgeBenchTtsAdaptCommand(
+	TEXT("AiBridge.Bench.TtsAdapt"),
+	TEXT("Replays replies over a link that slows down and recovers, checking the measured throughput picks the TTS format the true speed would. Usage: AiBridge.Bench.TtsAdapt [RepliesPerPhase=4] [ReplyKB=64]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchTtsAdapt));
+
+static FAutoConsoleCommand GAiBridgeBenchRateLimitCommand(
+	TEXT("AiBridge.Bench.RateLimit"),
+	TEXT("Mashes turns into the rate limiter in simulated time, checking sends stay within the quota, keep their order and every turn is accounted for. Usage: AiBridge.Bench.RateLimit [Seconds=300] [MashSize=12]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchRateLimit));
+
+static FAutoConsoleCommand GAiBridgeBenchTranscriptCommand(
+	TEXT("AiBridge.Bench.Transcript"),
+	TEXT("Streams a long reply into the transcript delta by delta, checking the text laid out per delta stays the same at the end as at the start. Usage: AiBridge.Bench.Transcript [Deltas=20000]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&AiBridgeBenchmarks::BenchTranscript));
+
+#endif
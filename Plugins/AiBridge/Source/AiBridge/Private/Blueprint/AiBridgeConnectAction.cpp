@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Blueprint/AiBridgeConnectAction.h"
+#include "Subsystems/AiBridgeWebSocketSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+
+UAiBridgeConnectAction* UAiBridgeConnectAction::ConnectAiBridge(UObject* WorldContextObject)
+{
+	UAiBridgeConnectAction* Action = NewObject<UAiBridgeConnectAction>();
+
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	const UGameInstance* GameInstance = World != nullptr ? World->GetGameInstance() : nullptr;
+	if (GameInstance != nullptr)
+	{
+		Action->Subsystem = GameInstance->GetSubsystem<UAiBridgeWebSocketSubsystem>();
+		Action->RegisterWithGameInstance(WorldContextObject);
+	}
+	return Action;
+}
+
+void UAiBridgeConnectAction::Activate()
+{
+	UAiBridgeWebSocketSubsystem* Bridge = Subsystem.Get();
+	if (Bridge == nullptr)
+	{
+		Finish(false);
+		return;
+	}
+
+	// The connection may take a JWT round trip and failovers, the subsystem can outlive this node or not
+	Bridge->EnsureConnection([WeakThis = TWeakObjectPtr<UAiBridgeConnectAction>(this)](bool bConnected)
+	{
+		if (UAiBridgeConnectAction* This = WeakThis.Get())
+		{
+			This->Finish(bConnected);
+		}
+	});
+}
+
+void UAiBridgeConnectAction::Finish(bool bConnected)
+{
+	if (bConnected)
+	{
+		OnConnected.Broadcast();
+	}
+	else
+	{
+		OnFailed.Broadcast();
+	}
+	SetReadyToDestroy();
+}
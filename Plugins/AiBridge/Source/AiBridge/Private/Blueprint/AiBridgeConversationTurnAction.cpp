@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Blueprint/AiBridgeConversationTurnAction.h"
+#include "Subsystems/AiBridgeWebSocketSubsystem.h"
+#include "Prompt/AiBridgePromptTemplate.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+
+UAiBridgeConversationTurnAction* UAiBridgeConversationTurnAction::SendConversationTurn(UObject* WorldContextObject, const FString& Text, FName Npc, UAiBridgePromptTemplate* Persona, const TMap<FString, FString>& Variables, bool bWaitForAudio, float TimeoutSeconds)
+{
+	UAiBridgeConversationTurnAction* Action = NewObject<UAiBridgeConversationTurnAction>();
+	Action->Text = Text;
+	Action->Npc = Npc;
+	Action->Persona = Persona;
+	Action->Variables = Variables;
+	Action->bWaitForAudio = bWaitForAudio;
+	Action->TimeoutSeconds = TimeoutSeconds;
+
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	const UGameInstance* GameInstance = World != nullptr ? World->GetGameInstance() : nullptr;
+	if (GameInstance != nullptr)
+	{
+		Action->Subsystem = GameInstance->GetSubsystem<UAiBridgeWebSocketSubsystem>();
+		Action->RegisterWithGameInstance(WorldContextObject);
+	}
+	return Action;
+}
+
+void UAiBridgeConversationTurnAction::Activate()
+{
+	UAiBridgeWebSocketSubsystem* Bridge = Subsystem.Get();
+	if (Bridge == nullptr)
+	{
+		Fail(TEXT("AiBridge is not available"));
+		return;
+	}
+
+	Bridge->EnsureConnection([WeakThis = TWeakObjectPtr<UAiBridgeConversationTurnAction>(this)](bool bConnected)
+	{
+		if (UAiBridgeConversationTurnAction* This = WeakThis.Get())
+		{
+			if (bConnected)
+			{
+				This->Send();
+			}
+			else
+			{
+				This->Fail(TEXT("Could not connect"));
+			}
+		}
+	});
+}
+
+void UAiBridgeConversationTurnAction::Send()
+{
+	UAiBridgeWebSocketSubsystem* Bridge = Subsystem.Get();
+	if (Bridge == nullptr)
+	{
+		Fail(TEXT("AiBridge is not available"));
+		return;
+	}
+
+	// The tracker outlives nodes that are torn down with their game instance, the handlers check first
+	const TWeakObjectPtr<UAiBridgeConversationTurnAction> WeakThis(this);
+
+	FAiBridgeReplyHandlers Handlers;
+	Handlers.OnFirstToken = [WeakThis](const FString& Reply)
+	{
+		if (UAiBridgeConversationTurnAction* This = WeakThis.Get())
+		{
+			This->OnFirstToken.Broadcast(This->RequestId, Reply);
+		}
+	};
+	Handlers.OnDelta = [WeakThis](const FString& Delta)
+	{
+		if (UAiBridgeConversationTurnAction* This = WeakThis.Get())
+		{
+			This->OnTextDelta.Broadcast(This->RequestId, Delta);
+		}
+	};
+	Handlers.OnAudioStart = [WeakThis]()
+	{
+		if (UAiBridgeConversationTurnAction* This = WeakThis.Get())
+		{
+			This->OnAudioStart.Broadcast(This->RequestId, FString());
+		}
+	};
+	Handlers.OnComplete = [WeakThis](const FString& Reply)
+	{
+		UAiBridgeConversationTurnAction* This = WeakThis.Get();
+		if (This == nullptr)
+		{
+			return;
+		}
+
+		UAiBridgeWebSocketSubsystem* Owner = This->Subsystem.Get();
+		if (Owner != nullptr && !This->Npc.IsNone())
+		{
+			Owner->AddHistoryMessage(This->Npc, FAiBridgeChatMessage(TEXT("user"), This->Text));
+			Owner->AddHistoryMessage(This->Npc, FAiBridgeChatMessage(TEXT("assistant"), Reply));
+		}
+
+		This->OnComplete.Broadcast(This->RequestId, Reply);
+		This->SetReadyToDestroy();
+	};
+	Handlers.OnFailed = [WeakThis](const FString& Error)
+	{
+		if (UAiBridgeConversationTurnAction* This = WeakThis.Get())
+		{
+			This->Fail(Error);
+		}
+	};
+
+	const TArray<FAiBridgeChatMessage> History = Npc.IsNone() ? TArray<FAiBridgeChatMessage>() : Bridge->GetHistory(Npc);
+	RequestId = Bridge->SendConversationTurn(Text, History, Persona, Variables, MoveTemp(Handlers), bWaitForAudio, TimeoutSeconds);
+}
+
+void UAiBridgeConversationTurnAction::Fail(const FString& Error)
+{
+	OnFailed.Broadcast(RequestId, Error);
+	SetReadyToDestroy();
+}
@@ -0,0 +1,319 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Capture/AiBridgeCapture.h"
+#include "Logging/AiBridgeLog.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace AiBridgeCapture
+{
+	/** Records are written out in blocks of about this size */
+	constexpr int32 FlushThreshold = 256 * 1024;
+
+	void WriteRecordHeader(uint8* Out, uint64 TimeMicros, uint8 Flags, uint32 Size)
+	{
+		FMemory::Memcpy(Out, &TimeMicros, sizeof(TimeMicros));
+		Out[8] = Flags;
+		FMemory::Memcpy(Out + 9, &Size, sizeof(Size));
+	}
+
+	void ReadRecordHeader(const uint8* In, FAiBridgeCaptureRecord& OutRecord, uint32& OutSize)
+	{
+		FMemory::Memcpy(&OutRecord.TimeMicros, In, sizeof(OutRecord.TimeMicros));
+		OutRecord.Flags = In[8];
+		FMemory::Memcpy(&OutSize, In + 9, sizeof(OutSize));
+	}
+
+	FString ResolvePath(const FString& Path)
+	{
+		FString Resolved = FPaths::IsRelative(Path)
+			? FPaths::ProjectSavedDir() / TEXT("AiBridgeCaptures") / Path
+			: Path;
+
+		if (FPaths::GetExtension(Resolved).IsEmpty())
+		{
+			Resolved += TEXT(".aibcap");
+		}
+		return FPaths::ConvertRelativePathToFull(Resolved);
+	}
+
+	FString MakeCapturePath(const FString& Directory, const FString& ConnectionId)
+	{
+		const FString Name = FPaths::MakeValidFileName(ConnectionId.IsEmpty() ? TEXT("AiBridge") : ConnectionId, TEXT('_'))
+			+ TEXT("-") + FDateTime::Now().ToString();
+
+		FString Path = ResolvePath(Directory / Name);
+		for (int32 Suffix = 2; FPaths::FileExists(Path); ++Suffix)
+		{
+			Path = ResolvePath(Directory / FString::Printf(TEXT("%s-%d"), *Name, Suffix));
+		}
+		return Path;
+	}
+}
+
+FString FAiBridgeCaptureRecord::GetText() const
+{
+	const FUTF8ToTCHAR Converted(reinterpret_cast<const UTF8CHAR*>(Payload.GetData()), Payload.Num());
+	return FString(Converted.Length(), Converted.Get());
+}
+
+TSharedPtr<FAiBridgeCaptureWriter, ESPMode::ThreadSafe> FAiBridgeCaptureWriter::Create(const FString& Path)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Path));
+
+	TUniquePtr<IFileHandle> File(PlatformFile.OpenWrite(*Path));
+	if (!File)
+	{
+		UE_LOG(LogAiBridge, Error, TEXT("[Capture] Could not open %s for writing"), *Path);
+		return nullptr;
+	}
+
+	uint8 Header[AiBridgeCapture::HeaderSize];
+	const int64 StartTicks = FDateTime::UtcNow().GetTicks();
+	FMemory::Memcpy(Header, &AiBridgeCapture::Magic, 4);
+	FMemory::Memcpy(Header + 4, &AiBridgeCapture::Version, 4);
+	FMemory::Memcpy(Header + 8, &StartTicks, 8);
+	File->Write(Header, sizeof(Header));
+
+	return MakeShareable(new FAiBridgeCaptureWriter(MoveTemp(File), Path));
+}
+
+FAiBridgeCaptureWriter::FAiBridgeCaptureWriter(TUniquePtr<IFileHandle>&& InFile, const FString& InPath)
+	: File(MoveTemp(InFile))
+	, Path(InPath)
+	, StartSeconds(FPlatformTime::Seconds())
+{
+	Buffer.Reserve(AiBridgeCapture::FlushThreshold + 64 * 1024);
+}
+
+FAiBridgeCaptureWriter::~FAiBridgeCaptureWriter()
+{
+	Close();
+}
+
+void FAiBridgeCaptureWriter::WriteText(bool bOutbound, const FString& Text)
+{
+	// Convert outside the lock, a game thread Flush or Close only contends for the copy
+	const FTCHARToUTF8 Utf8(*Text, Text.Len());
+	Append(bOutbound ? AiBridgeCapture::FlagOutbound : 0, Utf8.Get(), Utf8.Length());
+}
+
+void FAiBridgeCaptureWriter::WriteText(bool bOutbound, const void* Utf8, SIZE_T Size)
+{
+	Append(bOutbound ? AiBridgeCapture::FlagOutbound : 0, Utf8, (uint32)Size);
+}
+
+void FAiBridgeCaptureWriter::WriteBinary(bool bOutbound, const void* Data, SIZE_T Size)
+{
+	Append((bOutbound ? AiBridgeCapture::FlagOutbound : 0) | AiBridgeCapture::FlagBinary, Data, (uint32)Size);
+}
+
+void FAiBridgeCaptureWriter::Append(uint8 Flags, const void* Data, uint32 Size)
+{
+	const uint64 TimeMicros = (uint64)FMath::Max(0.0, (FPlatformTime::Seconds() - StartSeconds) * 1e6);
+
+	FScopeLock ScopeLock(&Lock);
+	if (!File)
+	{
+		return;
+	}
+
+	const int32 Start = Buffer.AddUninitialized(AiBridgeCapture::RecordHeaderSize + Size);
+	AiBridgeCapture::WriteRecordHeader(Buffer.GetData() + Start, TimeMicros, Flags, Size);
+	FMemory::Memcpy(Buffer.GetData() + Start + AiBridgeCapture::RecordHeaderSize, Data, Size);
+
+	++NumRecords;
+	NumBytes += AiBridgeCapture::RecordHeaderSize + Size;
+
+	if (Buffer.Num() >= AiBridgeCapture::FlushThreshold)
+	{
+		FlushLocked();
+	}
+}
+
+void FAiBridgeCaptureWriter::Flush()
+{
+	FScopeLock ScopeLock(&Lock);
+	FlushLocked();
+	if (File)
+	{
+		File->Flush();
+	}
+}
+
+void FAiBridgeCaptureWriter::FlushLocked()
+{
+	if (File && Buffer.Num() > 0)
+	{
+		File->Write(Buffer.GetData(), Buffer.Num());
+	}
+	Buffer.Reset();
+}
+
+void FAiBridgeCaptureWriter::Close()
+{
+	FScopeLock ScopeLock(&Lock);
+	if (!File)
+	{
+		return;
+	}
+
+	FlushLocked();
+	File.Reset();
+
+	UE_LOG(LogAiBridge, Log, TEXT("[Capture] Closed %s: %llu frames, %.1f KB"), *Path, NumRecords, NumBytes / 1024.0);
+}
+
+bool FAiBridgeCaptureWriter::IsOpen() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return File.IsValid();
+}
+
+uint64 FAiBridgeCaptureWriter::GetNumRecords() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return NumRecords;
+}
+
+uint64 FAiBridgeCaptureWriter::GetNumBytes() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return NumBytes;
+}
+
+TUniquePtr<FAiBridgeCaptureReader> FAiBridgeCaptureReader::Open(const FString& Path, bool bAllowMapping)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	TUniquePtr<IFileHandle> File(PlatformFile.OpenRead(*Path));
+	if (!File)
+	{
+		UE_LOG(LogAiBridge, Error, TEXT("[Capture] Could not open %s"), *Path);
+		return nullptr;
+	}
+
+	uint8 Header[AiBridgeCapture::HeaderSize];
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	if (!File->Read(Header, sizeof(Header)))
+	{
+		UE_LOG(LogAiBridge, Error, TEXT("[Capture] %s is too short to be a capture"), *Path);
+		return nullptr;
+	}
+	FMemory::Memcpy(&Magic, Header, 4);
+	FMemory::Memcpy(&Version, Header + 4, 4);
+	if (Magic != AiBridgeCapture::Magic || Version != AiBridgeCapture::Version)
+	{
+		UE_LOG(LogAiBridge, Error, TEXT("[Capture] %s is not a version %u capture"), *Path, AiBridgeCapture::Version);
+		return nullptr;
+	}
+
+	TUniquePtr<FAiBridgeCaptureReader> Reader(new FAiBridgeCaptureReader());
+	Reader->Size = File->Size();
+
+	if (Reader->Size < MapThreshold)
+	{
+		File.Reset();
+		if (!FFileHelper::LoadFileToArray(Reader->Contents, *Path))
+		{
+			return nullptr;
+		}
+		Reader->Data = Reader->Contents.GetData();
+		Reader->Size = Reader->Contents.Num();
+		return Reader;
+	}
+
+	if (bAllowMapping)
+	{
+		Reader->MappedFile.Reset(PlatformFile.OpenMapped(*Path));
+		if (Reader->MappedFile)
+		{
+			Reader->MappedRegion.Reset(Reader->MappedFile->MapRegion(0, Reader->Size));
+		}
+		if (Reader->MappedRegion)
+		{
+			Reader->Data = Reader->MappedRegion->GetMappedPtr();
+			Reader->Size = Reader->MappedRegion->GetMappedSize();
+			return Reader;
+		}
+		Reader->MappedFile.Reset();
+	}
+
+	// No mapping on this platform, read record by record
+	Reader->File = MoveTemp(File);
+	return Reader;
+}
+
+FAiBridgeCaptureReader::~FAiBridgeCaptureReader()
+{
+	// The region must go before the handle it was mapped from
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+bool FAiBridgeCaptureReader::Next(FAiBridgeCaptureRecord& OutRecord)
+{
+	if (Offset + AiBridgeCapture::RecordHeaderSize > Size)
+	{
+		return false;
+	}
+
+	uint32 PayloadSize = 0;
+
+	if (Data != nullptr)
+	{
+		AiBridgeCapture::ReadRecordHeader(Data + Offset, OutRecord, PayloadSize);
+		const int64 PayloadOffset = Offset + AiBridgeCapture::RecordHeaderSize;
+		if (PayloadOffset + PayloadSize > Size)
+		{
+			// A capture cut short by a crash ends at its last complete record
+			return false;
+		}
+
+		OutRecord.Payload = TArrayView<const uint8>(Data + PayloadOffset, PayloadSize);
+		Offset = PayloadOffset + PayloadSize;
+		return true;
+	}
+
+	if (!File)
+	{
+		return false;
+	}
+
+	uint8 RecordHeader[AiBridgeCapture::RecordHeaderSize];
+	if (!File->Read(RecordHeader, sizeof(RecordHeader)))
+	{
+		return false;
+	}
+	AiBridgeCapture::ReadRecordHeader(RecordHeader, OutRecord, PayloadSize);
+
+	// Checked before allocating, a torn or corrupt header must not size the scratch buffer
+	if (Offset + AiBridgeCapture::RecordHeaderSize + PayloadSize > Size || PayloadSize > (uint32)MAX_int32)
+	{
+		return false;
+	}
+
+	Scratch.SetNumUninitialized(PayloadSize, EAllowShrinking::No);
+	if (!File->Read(Scratch.GetData(), PayloadSize))
+	{
+		return false;
+	}
+
+	OutRecord.Payload = TArrayView<const uint8>(Scratch.GetData(), PayloadSize);
+	Offset += AiBridgeCapture::RecordHeaderSize + PayloadSize;
+	return true;
+}
+
+void FAiBridgeCaptureReader::Rewind()
+{
+	Offset = AiBridgeCapture::HeaderSize;
+	if (File)
+	{
+		File->Seek(Offset);
+	}
+}
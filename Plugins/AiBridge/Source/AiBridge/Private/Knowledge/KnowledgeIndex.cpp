@@ -0,0 +1,472 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Knowledge/KnowledgeIndex.h"
+#include "Logging/AiBridgeLog.h"
+#include "Memory/AiBridgeMemory.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Math/VectorRegister.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace KnowledgeIndex
+{
+	constexpr uint32 Magic = 0x494B4241; // "ABKI"
+	constexpr uint32 Version = 1;
+
+	struct FHeader
+	{
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		uint32 Dimensions = 0;
+		uint32 Count = 0;
+		uint32 NormsOffset = 0;
+		uint32 VectorsOffset = 0;
+		uint32 TextOffsetsOffset = 0;
+		uint32 TextOffset = 0;
+	};
+	static_assert(sizeof(FHeader) == 32, "The header is part of the file format");
+
+	constexpr float WordWeight = 1.0f;
+	constexpr float PairWeight = 0.5f;
+	constexpr float TrigramWeight = 0.25f;
+
+	/** FNV-1a, seeded per feature kind so a word and a trigram with the same letters land apart */
+	uint32 Hash(const TCHAR* Chars, int32 Len, uint32 Seed)
+	{
+		uint32 Value = 2166136261u ^ Seed;
+		for (int32 Index = 0; Index < Len; ++Index)
+		{
+			Value = (Value ^ (uint32)Chars[Index]) * 16777619u;
+		}
+		// Final avalanche so the low bits used for the bucket depend on every character
+		Value ^= Value >> 15;
+		Value *= 0x2C1B3C6Du;
+		Value ^= Value >> 12;
+		return Value;
+	}
+
+	/** Words that match almost every snippet and only dilute the score */
+	bool IsStopWord(FStringView Word)
+	{
+		static const TCHAR* const StopWords[] =
+		{
+			TEXT("the"), TEXT("and"), TEXT("for"), TEXT("are"), TEXT("but"), TEXT("not"), TEXT("you"), TEXT("your"),
+			TEXT("with"), TEXT("this"), TEXT("that"), TEXT("from"), TEXT("they"), TEXT("have"), TEXT("has"), TEXT("was"),
+			TEXT("were"), TEXT("what"), TEXT("which"), TEXT("who"), TEXT("will"), TEXT("would"), TEXT("can"), TEXT("could"),
+			TEXT("about"), TEXT("there"), TEXT("their"), TEXT("them"), TEXT("then"), TEXT("than"), TEXT("its"), TEXT("our"),
+			TEXT("any"), TEXT("all"), TEXT("how"), TEXT("does"), TEXT("did"), TEXT("is"), TEXT("it"), TEXT("of"),
+			TEXT("to"), TEXT("in"), TEXT("on"), TEXT("at"), TEXT("an"), TEXT("or"), TEXT("be"), TEXT("do"), TEXT("we"),
+			TEXT("me"), TEXT("my"), TEXT("so"), TEXT("if"), TEXT("as"), TEXT("by"), TEXT("up"), TEXT("us"),
+		};
+
+		// Compared by hash, the lookup runs for every word of every query
+		static const TSet<uint32> StopHashes = []()
+		{
+			TSet<uint32> Hashes;
+			for (const TCHAR* StopWord : StopWords)
+			{
+				Hashes.Add(Hash(StopWord, FCString::Strlen(StopWord), 0x03));
+			}
+			return Hashes;
+		}();
+		return StopHashes.Contains(Hash(Word.GetData(), Word.Len(), 0x03));
+	}
+
+	void AddFeature(uint32 FeatureHash, float Weight, float* Vector)
+	{
+		const uint32 Bucket = FeatureHash & (AiBridgeKnowledge::Dimensions - 1);
+		Vector[Bucket] += (FeatureHash & 0x80000000u) ? -Weight : Weight;
+	}
+
+	uint32 Align16(uint32 Offset)
+	{
+		return (Offset + 15u) & ~15u;
+	}
+}
+
+void AiBridgeKnowledge::Embed(FStringView Text, const float* Weights, float* OutVector)
+{
+	FMemory::Memzero(OutVector, Dimensions * sizeof(float));
+
+	// Lowercased word with ^ and $ markers around it, the trigrams need the word boundaries
+	TStringBuilder<64> Word;
+	uint32 PreviousWordHash = 0;
+
+	const int32 Length = Text.Len();
+	for (int32 Start = 0; Start < Length;)
+	{
+		if (!FChar::IsAlnum(Text[Start]))
+		{
+			++Start;
+			continue;
+		}
+
+		Word.Reset();
+		Word.AppendChar(TEXT('^'));
+		int32 End = Start;
+		for (; End < Length && FChar::IsAlnum(Text[End]); ++End)
+		{
+			Word.AppendChar(FChar::ToLower(Text[End]));
+		}
+		Word.AppendChar(TEXT('$'));
+		Start = End;
+
+		const FStringView Bare(Word.GetData() + 1, Word.Len() - 2);
+		if (Bare.Len() < 2 || KnowledgeIndex::IsStopWord(Bare))
+		{
+			continue;
+		}
+
+		const uint32 WordHash = KnowledgeIndex::Hash(Bare.GetData(), Bare.Len(), 0x01);
+		KnowledgeIndex::AddFeature(WordHash, KnowledgeIndex::WordWeight, OutVector);
+
+		if (PreviousWordHash != 0)
+		{
+			KnowledgeIndex::AddFeature(HashCombineFast(PreviousWordHash, WordHash), KnowledgeIndex::PairWeight, OutVector);
+		}
+		PreviousWordHash = WordHash;
+
+		// Trigrams let escalate match escalation and plurals match singulars
+		for (int32 Offset = 0; Offset + 3 <= Word.Len(); ++Offset)
+		{
+			KnowledgeIndex::AddFeature(KnowledgeIndex::Hash(Word.GetData() + Offset, 3, 0x02), KnowledgeIndex::TrigramWeight, OutVector);
+		}
+	}
+
+	if (Weights != nullptr)
+	{
+		for (int32 Index = 0; Index < Dimensions; Index += 4)
+		{
+			VectorStore(VectorMultiply(VectorLoad(OutVector + Index), VectorLoad(Weights + Index)), OutVector + Index);
+		}
+	}
+}
+
+float AiBridgeKnowledge::Quantize(const float* Vector, int8* OutVector)
+{
+	float MaxAbs = 0.0f;
+	for (int32 Index = 0; Index < Dimensions; ++Index)
+	{
+		MaxAbs = FMath::Max(MaxAbs, FMath::Abs(Vector[Index]));
+	}
+
+	const float Scale = MaxAbs > UE_SMALL_NUMBER ? 127.0f / MaxAbs : 0.0f;
+	int32 SumSquares = 0;
+	for (int32 Index = 0; Index < Dimensions; ++Index)
+	{
+		const int32 Value = FMath::Clamp(FMath::RoundToInt32(Vector[Index] * Scale), -127, 127);
+		OutVector[Index] = (int8)Value;
+		SumSquares += Value * Value;
+	}
+	return FMath::Sqrt((float)SumSquares);
+}
+
+int32 AiBridgeKnowledge::DotInt8(const int8* A, const int8* B)
+{
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	int32x4_t Sum = vdupq_n_s32(0);
+	for (int32 Index = 0; Index < Dimensions; Index += 16)
+	{
+		const int8x16_t VecA = vld1q_s8(A + Index);
+		const int8x16_t VecB = vld1q_s8(B + Index);
+		Sum = vpadalq_s16(Sum, vmull_s8(vget_low_s8(VecA), vget_low_s8(VecB)));
+		Sum = vpadalq_s16(Sum, vmull_s8(vget_high_s8(VecA), vget_high_s8(VecB)));
+	}
+	return vaddvq_s32(Sum);
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+	// SSE2 has no signed byte multiply: widen to 16 bits by unpacking each byte with itself and shifting
+	// the copy out arithmetically, then multiply-add pairs into 32-bit lanes
+	__m128i Sum = _mm_setzero_si128();
+	for (int32 Index = 0; Index < Dimensions; Index += 16)
+	{
+		const __m128i VecA = _mm_loadu_si128(reinterpret_cast<const __m128i*>(A + Index));
+		const __m128i VecB = _mm_loadu_si128(reinterpret_cast<const __m128i*>(B + Index));
+		const __m128i LowA = _mm_srai_epi16(_mm_unpacklo_epi8(VecA, VecA), 8);
+		const __m128i LowB = _mm_srai_epi16(_mm_unpacklo_epi8(VecB, VecB), 8);
+		const __m128i HighA = _mm_srai_epi16(_mm_unpackhi_epi8(VecA, VecA), 8);
+		const __m128i HighB = _mm_srai_epi16(_mm_unpackhi_epi8(VecB, VecB), 8);
+		Sum = _mm_add_epi32(Sum, _mm_madd_epi16(LowA, LowB));
+		Sum = _mm_add_epi32(Sum, _mm_madd_epi16(HighA, HighB));
+	}
+
+	alignas(16) int32 Lanes[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(Lanes), Sum);
+	return Lanes[0] + Lanes[1] + Lanes[2] + Lanes[3];
+#else
+	int32 Sum = 0;
+	for (int32 Index = 0; Index < Dimensions; ++Index)
+	{
+		Sum += A[Index] * B[Index];
+	}
+	return Sum;
+#endif
+}
+
+bool FKnowledgeIndex::Build(const TArray<FString>& Snippets, const FString& Path)
+{
+	LLM_SCOPE_BYTAG(AiBridge_Knowledge);
+
+	using namespace AiBridgeKnowledge;
+
+	const int32 SnippetCount = Snippets.Num();
+
+	// Raw vectors first, the weights depend on how many snippets use each bucket
+	TArray<float> Raw;
+	Raw.SetNumUninitialized(SnippetCount * Dimensions);
+	TArray<int32> DocumentFrequency;
+	DocumentFrequency.SetNumZeroed(Dimensions);
+	for (int32 Snippet = 0; Snippet < SnippetCount; ++Snippet)
+	{
+		float* Vector = Raw.GetData() + Snippet * Dimensions;
+		Embed(Snippets[Snippet], nullptr, Vector);
+		for (int32 Index = 0; Index < Dimensions; ++Index)
+		{
+			DocumentFrequency[Index] += Vector[Index] != 0.0f ? 1 : 0;
+		}
+	}
+
+	KnowledgeIndex::FHeader Header;
+	Header.Magic = KnowledgeIndex::Magic;
+	Header.Version = KnowledgeIndex::Version;
+	Header.Dimensions = Dimensions;
+	Header.Count = SnippetCount;
+	Header.NormsOffset = sizeof(Header) + Dimensions * sizeof(float);
+	Header.VectorsOffset = KnowledgeIndex::Align16(Header.NormsOffset + SnippetCount * sizeof(float));
+	Header.TextOffsetsOffset = Header.VectorsOffset + SnippetCount * Dimensions;
+	Header.TextOffset = Header.TextOffsetsOffset + (SnippetCount + 1) * sizeof(uint32);
+
+	TArray<uint8> File;
+	File.SetNumZeroed(Header.TextOffset);
+	FMemory::Memcpy(File.GetData(), &Header, sizeof(Header));
+
+	float* OutWeights = reinterpret_cast<float*>(File.GetData() + sizeof(Header));
+	for (int32 Index = 0; Index < Dimensions; ++Index)
+	{
+		OutWeights[Index] = FMath::Loge((SnippetCount + 1.0f) / (DocumentFrequency[Index] + 1.0f)) + 1.0f;
+	}
+
+	for (int32 Snippet = 0; Snippet < SnippetCount; ++Snippet)
+	{
+		float* Vector = Raw.GetData() + Snippet * Dimensions;
+		for (int32 Index = 0; Index < Dimensions; ++Index)
+		{
+			Vector[Index] *= OutWeights[Index];
+		}
+
+		int8* Quantized = reinterpret_cast<int8*>(File.GetData() + Header.VectorsOffset) + Snippet * Dimensions;
+		const float Norm = Quantize(Vector, Quantized);
+		FMemory::Memcpy(File.GetData() + Header.NormsOffset + Snippet * sizeof(float), &Norm, sizeof(Norm));
+	}
+
+	for (int32 Snippet = 0; Snippet < SnippetCount; ++Snippet)
+	{
+		const uint32 Offset = File.Num() - Header.TextOffset;
+		FMemory::Memcpy(File.GetData() + Header.TextOffsetsOffset + Snippet * sizeof(uint32), &Offset, sizeof(Offset));
+
+		const FTCHARToUTF8 Utf8(*Snippets[Snippet], Snippets[Snippet].Len());
+		File.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+	}
+	const uint32 End = File.Num() - Header.TextOffset;
+	FMemory::Memcpy(File.GetData() + Header.TextOffsetsOffset + SnippetCount * sizeof(uint32), &End, sizeof(End));
+
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*FPaths::GetPath(Path));
+	if (!FFileHelper::SaveArrayToFile(File, *Path))
+	{
+		UE_LOG(LogAiBridge, Error, TEXT("[Knowledge] Could not write %s"), *Path);
+		return false;
+	}
+
+	UE_LOG(LogAiBridge, Log, TEXT("[Knowledge] Built %s: %d snippets, %.1f KB"), *Path, SnippetCount, File.Num() / 1024.0);
+	return true;
+}
+
+TArray<FString> FKnowledgeIndex::SplitSnippets(const FString& Text)
+{
+	TArray<FString> Lines;
+	Text.ParseIntoArrayLines(Lines, false);
+
+	TArray<FString> Snippets;
+	FString Current;
+	for (const FString& Line : Lines)
+	{
+		const FString Trimmed = Line.TrimStartAndEnd();
+		if (Trimmed.IsEmpty())
+		{
+			if (!Current.IsEmpty())
+			{
+				Snippets.Add(MoveTemp(Current));
+				Current.Reset();
+			}
+			continue;
+		}
+
+		if (!Current.IsEmpty())
+		{
+			Current += TEXT("\n");
+		}
+		Current += Trimmed;
+	}
+
+	if (!Current.IsEmpty())
+	{
+		Snippets.Add(MoveTemp(Current));
+	}
+	return Snippets;
+}
+
+TUniquePtr<FKnowledgeIndex> FKnowledgeIndex::Open(const FString& Path)
+{
+	LLM_SCOPE_BYTAG(AiBridge_Knowledge);
+
+	TUniquePtr<FKnowledgeIndex> Index(new FKnowledgeIndex());
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	Index->MappedFile.Reset(PlatformFile.OpenMapped(*Path));
+	if (Index->MappedFile)
+	{
+		Index->MappedRegion.Reset(Index->MappedFile->MapRegion(0, Index->MappedFile->GetFileSize()));
+	}
+
+	if (Index->MappedRegion)
+	{
+		if (Index->Bind(Index->MappedRegion->GetMappedPtr(), Index->MappedRegion->GetMappedSize()))
+		{
+			return Index;
+		}
+	}
+	else if (FFileHelper::LoadFileToArray(Index->Contents, *Path, FILEREAD_Silent))
+	{
+		// No mapping on this platform
+		if (Index->Bind(Index->Contents.GetData(), Index->Contents.Num()))
+		{
+			return Index;
+		}
+	}
+
+	UE_LOG(LogAiBridge, Warning, TEXT("[Knowledge] %s is missing or not a version %u knowledge index"), *Path, KnowledgeIndex::Version);
+	return nullptr;
+}
+
+FKnowledgeIndex::~FKnowledgeIndex()
+{
+	// The region must go before the handle it was mapped from
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+bool FKnowledgeIndex::Bind(const uint8* Data, int64 Size)
+{
+	KnowledgeIndex::FHeader Header;
+	if (Size < (int64)sizeof(Header))
+	{
+		return false;
+	}
+	FMemory::Memcpy(&Header, Data, sizeof(Header));
+
+	if (Header.Magic != KnowledgeIndex::Magic || Header.Version != KnowledgeIndex::Version
+		|| Header.Dimensions != AiBridgeKnowledge::Dimensions)
+	{
+		return false;
+	}
+
+	// Every section must follow the one before and end inside the file, sized in 64 bits so a corrupt count
+	// cannot wrap. Norms and text offsets are read in place, so they must be aligned for their type
+	const int64 NumSnippets = Header.Count;
+	const int64 WeightsEnd = sizeof(Header) + (int64)Header.Dimensions * sizeof(float);
+	const int64 NormsEnd = (int64)Header.NormsOffset + NumSnippets * sizeof(float);
+	const int64 VectorsEnd = (int64)Header.VectorsOffset + NumSnippets * Header.Dimensions;
+	const int64 TextOffsetsEnd = (int64)Header.TextOffsetsOffset + (NumSnippets + 1) * sizeof(uint32);
+	if (Header.NormsOffset < WeightsEnd || Header.VectorsOffset < NormsEnd
+		|| Header.TextOffsetsOffset < VectorsEnd || Header.TextOffset < TextOffsetsEnd || Header.TextOffset > Size
+		|| Header.NormsOffset % alignof(float) != 0 || Header.TextOffsetsOffset % alignof(uint32) != 0)
+	{
+		return false;
+	}
+
+	const uint32* Offsets = reinterpret_cast<const uint32*>(Data + Header.TextOffsetsOffset);
+	for (int64 Index = 0; Index < NumSnippets; ++Index)
+	{
+		if (Offsets[Index] > Offsets[Index + 1])
+		{
+			return false;
+		}
+	}
+	if (Header.TextOffset + (int64)Offsets[NumSnippets] > Size)
+	{
+		return false;
+	}
+
+	Count = Header.Count;
+	Weights = reinterpret_cast<const float*>(Data + sizeof(Header));
+	Norms = reinterpret_cast<const float*>(Data + Header.NormsOffset);
+	Vectors = reinterpret_cast<const int8*>(Data + Header.VectorsOffset);
+	TextOffsets = Offsets;
+	Text = reinterpret_cast<const UTF8CHAR*>(Data + Header.TextOffset);
+	return true;
+}
+
+void FKnowledgeIndex::Search(FStringView Query, int32 MaxHits, float MinScore, TArray<FKnowledgeHit>& OutHits) const
+{
+	using namespace AiBridgeKnowledge;
+
+	OutHits.Reset();
+	if (Count == 0 || MaxHits <= 0)
+	{
+		return;
+	}
+
+	alignas(16) float QueryVector[Dimensions];
+	alignas(16) int8 QueryQuantized[Dimensions];
+	Embed(Query, Weights, QueryVector);
+	const float QueryNorm = Quantize(QueryVector, QueryQuantized);
+	if (QueryNorm <= 0.0f)
+	{
+		return;
+	}
+
+	// Kept sorted best first; MaxHits is a handful, insertion beats a heap at this size
+	float Threshold = MinScore;
+	for (int32 Snippet = 0; Snippet < Count; ++Snippet)
+	{
+		const float Norm = Norms[Snippet];
+		if (Norm <= 0.0f)
+		{
+			continue;
+		}
+
+		const float Score = DotInt8(QueryQuantized, Vectors + Snippet * Dimensions) / (QueryNorm * Norm);
+		if (Score < Threshold)
+		{
+			continue;
+		}
+
+		int32 Insert = OutHits.Num();
+		while (Insert > 0 && OutHits[Insert - 1].Score < Score)
+		{
+			--Insert;
+		}
+		OutHits.Insert(FKnowledgeHit{ Snippet, Score }, Insert);
+
+		if (OutHits.Num() > MaxHits)
+		{
+			OutHits.Pop(EAllowShrinking::No);
+		}
+		if (OutHits.Num() == MaxHits)
+		{
+			Threshold = FMath::Max(MinScore, OutHits.Last().Score);
+		}
+	}
+}
+
+FString FKnowledgeIndex::GetSnippet(int32 Index) const
+{
+	if (Index < 0 || Index >= Count)
+	{
+		return FString();
+	}
+
+	const FUTF8ToTCHAR Converted(Text + TextOffsets[Index], TextOffsets[Index + 1] - TextOffsets[Index]);
+	return FString(Converted.Length(), Converted.Get());
+}
@@ -0,0 +1,238 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LipSync/VisemeAnalyzer.h"
+#include "Memory/AiBridgeMemory.h"
+
+namespace VisemeAnalyzer
+{
+	/** 10 ms hop, the same resolution the server-side aligners use */
+	constexpr int32 HopsPerSecond = 100;
+
+	/** Relative level below which a hop counts as silence */
+	constexpr float SilenceLevel = 0.06f;
+
+	/** Relative level below which a voiced hop is treated as a lip closure */
+	constexpr float ClosureLevel = 0.16f;
+
+	/** Extra time a character-aligned key is held before easing back to silence */
+	constexpr uint32 AlignmentTailMs = 80;
+
+	uint8 Quantize(float Value)
+	{
+		return (uint8)FMath::RoundToInt32(FMath::Clamp(Value, 0.0f, 1.0f) * 255.0f);
+	}
+
+	EVisemeChannel ChannelForCharacter(TCHAR Char, bool& bOutIsSilence)
+	{
+		bOutIsSilence = false;
+		switch (FChar::ToLower(Char))
+		{
+		case 'a': case 'h':
+			return EVisemeChannel::AA;
+		case 'e': case 'i': case 'y':
+			return EVisemeChannel::EE;
+		case 'o': case 'u': case 'w': case 'q':
+			return EVisemeChannel::OO;
+		case 'f': case 'v': case 's': case 'z': case 'c': case 'x': case 'j':
+			return EVisemeChannel::FF;
+		case 'm': case 'b': case 'p':
+			return EVisemeChannel::MBP;
+		default:
+			bOutIsSilence = !FChar::IsAlnum(Char);
+			return EVisemeChannel::AA;
+		}
+	}
+}
+
+FVisemeAnalyzer::FVisemeAnalyzer()
+	: Pipe(TEXT("AiBridgeVisemePipe"))
+	, Track(MakeUnique<FVisemeTrack>())
+{
+}
+
+FVisemeAnalyzer::~FVisemeAnalyzer()
+{
+	Flush();
+}
+
+void FVisemeAnalyzer::BeginUtterance(int32 InSampleRate, int32 InNumChannels)
+{
+	Pipe.Launch(TEXT("AiBridgeVisemeBegin"), [this, InSampleRate, InNumChannels]()
+	{
+		SampleRate = FMath::Max(InSampleRate, VisemeAnalyzer::HopsPerSecond);
+		NumChannels = FMath::Max(InNumChannels, 1);
+		SamplesConsumed = 0;
+		PeakRms = 0.0f;
+		LastSample = 0.0f;
+		bUsingAlignment = false;
+		Pending.Reset();
+		Track->Reset();
+	});
+}
+
+void FVisemeAnalyzer::PushPcm16(TArray<uint8>&& Chunk)
+{
+	Pipe.Launch(TEXT("AiBridgeVisemeAnalyze"), [this, Chunk = MoveTemp(Chunk)]()
+	{
+		LLM_SCOPE_BYTAG(AiBridge_Audio);
+
+		const int32 NumFrames = Chunk.Num() / (int32)(sizeof(int16) * NumChannels);
+		const int16* Pcm = reinterpret_cast<const int16*>(Chunk.GetData());
+
+		if (bUsingAlignment)
+		{
+			// Timing comes from the server, the audio only tells us how far playback got
+			SamplesConsumed += NumFrames;
+			return;
+		}
+
+		// Downmix to mono floats; the loop is simple enough for the compiler to vectorize
+		const int32 Offset = Pending.Num();
+		Pending.AddUninitialized(NumFrames);
+		float* Out = Pending.GetData() + Offset;
+		const float Scale = 1.0f / (32768.0f * NumChannels);
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			int32 Sum = 0;
+			for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				Sum += Pcm[Frame * NumChannels + Channel];
+			}
+			Out[Frame] = Sum * Scale;
+		}
+
+		AnalyzePending();
+	});
+}
+
+void FVisemeAnalyzer::PushPcmFloat(TArray<float>&& Samples)
+{
+	Pipe.Launch(TEXT("AiBridgeVisemeAnalyze"), [this, Samples = MoveTemp(Samples)]()
+	{
+		LLM_SCOPE_BYTAG(AiBridge_Audio);
+
+		const int32 NumFrames = Samples.Num() / NumChannels;
+
+		if (bUsingAlignment)
+		{
+			SamplesConsumed += NumFrames;
+			return;
+		}
+
+		const int32 Offset = Pending.Num();
+		Pending.AddUninitialized(NumFrames);
+		float* Out = Pending.GetData() + Offset;
+		const float Scale = 1.0f / NumChannels;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			float Sum = 0.0f;
+			for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+			{
+				Sum += Samples[Frame * NumChannels + Channel];
+			}
+			Out[Frame] = Sum * Scale;
+		}
+
+		AnalyzePending();
+	});
+}
+
+void FVisemeAnalyzer::PushCharacterAlignment(const FString& Characters, TArray<float>&& StartTimesSeconds)
+{
+	Pipe.Launch(TEXT("AiBridgeVisemeAlignment"), [this, Characters, StartTimes = MoveTemp(StartTimesSeconds)]()
+	{
+		bUsingAlignment = true;
+		Pending.Reset();
+
+		const int32 Num = FMath::Min(Characters.Len(), StartTimes.Num());
+		uint32 LastTimeMs = 0;
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			bool bIsSilence = false;
+			const EVisemeChannel Channel = VisemeAnalyzer::ChannelForCharacter(Characters[Index], bIsSilence);
+
+			FVisemeKey Key;
+			Key.TimeMs = FMath::Max(LastTimeMs, (uint32)FMath::Max(0.0f, StartTimes[Index] * 1000.0f));
+			if (!bIsSilence)
+			{
+				Key.Amplitude = 200;
+				Key.Weights[(int32)Channel] = 255;
+			}
+			Track->Append(Key);
+			LastTimeMs = Key.TimeMs;
+		}
+
+		if (Num > 0)
+		{
+			FVisemeKey Tail;
+			Tail.TimeMs = LastTimeMs + VisemeAnalyzer::AlignmentTailMs;
+			Track->Append(Tail);
+		}
+	});
+}
+
+void FVisemeAnalyzer::Flush()
+{
+	Pipe.WaitUntilEmpty();
+}
+
+void FVisemeAnalyzer::AnalyzePending()
+{
+	const int32 HopSize = SampleRate / VisemeAnalyzer::HopsPerSecond;
+	const int32 NumHops = Pending.Num() / HopSize;
+
+	for (int32 Hop = 0; Hop < NumHops; ++Hop)
+	{
+		const float* Samples = Pending.GetData() + Hop * HopSize;
+		const FAudioFrameFeatures Features = AiBridgeAudio::AnalyzeFrame(Samples, HopSize, LastSample);
+		LastSample = Samples[HopSize - 1];
+
+		// Slow-decaying peak so the mouth opening is relative to this voice's loudness
+		PeakRms = FMath::Max(Features.Rms, PeakRms * 0.995f);
+
+		const uint32 TimeMs = (uint32)(SamplesConsumed * 1000 / SampleRate);
+		Track->Append(MapFeatures(Features, PeakRms, SampleRate, TimeMs));
+		SamplesConsumed += HopSize;
+	}
+
+	Pending.RemoveAt(0, NumHops * HopSize, EAllowShrinking::No);
+}
+
+FVisemeKey FVisemeAnalyzer::MapFeatures(const FAudioFrameFeatures& Features, float PeakRms, int32 SampleRate, uint32 TimeMs)
+{
+	using namespace VisemeAnalyzer;
+
+	FVisemeKey Key;
+	Key.TimeMs = TimeMs;
+
+	const float Level = PeakRms > UE_SMALL_NUMBER ? FMath::Clamp(Features.Rms / PeakRms, 0.0f, 1.0f) : 0.0f;
+	if (Level < SilenceLevel)
+	{
+		return Key;
+	}
+
+	Key.Amplitude = Quantize(Level);
+
+	if (Level < ClosureLevel)
+	{
+		Key.Weights[(int32)EVisemeChannel::MBP] = Quantize(1.0f - (Level - SilenceLevel) / (ClosureLevel - SilenceLevel));
+		return Key;
+	}
+
+	// Brightness is (1 - cos w) / 2 for a pure tone, invert it to get a centroid-like frequency
+	const float CentroidHz = SampleRate / UE_TWO_PI * FMath::Acos(1.0f - 2.0f * Features.Brightness);
+
+	const float Fricative = FMath::Clamp((Features.ZeroCrossingRate - 0.18f) / 0.15f, 0.0f, 1.0f);
+	const float Voiced = (1.0f - Fricative) * Level;
+
+	const float Rounded = FMath::Clamp((900.0f - CentroidHz) / 400.0f, 0.0f, 1.0f);
+	const float Spread = FMath::Clamp((CentroidHz - 1300.0f) / 500.0f, 0.0f, 1.0f);
+	const float Open = FMath::Max(0.0f, 1.0f - Rounded - Spread);
+
+	Key.Weights[(int32)EVisemeChannel::AA] = Quantize(Open * Voiced);
+	Key.Weights[(int32)EVisemeChannel::EE] = Quantize(Spread * Voiced);
+	Key.Weights[(int32)EVisemeChannel::OO] = Quantize(Rounded * Voiced);
+	Key.Weights[(int32)EVisemeChannel::FF] = Quantize(Fricative);
+	return Key;
+}
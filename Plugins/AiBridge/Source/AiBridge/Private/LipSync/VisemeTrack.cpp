@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LipSync/VisemeTrack.h"
+
+void FVisemeTrack::Append(const FVisemeKey& Key)
+{
+	const uint32 Index = Published.load(std::memory_order_relaxed);
+	Keys[Index % Capacity] = Key;
+	Published.store(Index + 1, std::memory_order_release);
+}
+
+void FVisemeTrack::Reset()
+{
+	Base.store(Published.load(std::memory_order_relaxed), std::memory_order_release);
+}
+
+FAiBridgeVisemeFrame FVisemeTrack::Sample(double TimeSeconds) const
+{
+	// Base first: a concurrent Reset can only move it up to a value <= the Published we read next
+	uint32 Begin = Base.load(std::memory_order_acquire);
+	const uint32 End = Published.load(std::memory_order_acquire);
+	if (End - Begin > Capacity / 2)
+	{
+		Begin = End - Capacity / 2;
+	}
+
+	FAiBridgeVisemeFrame Frame;
+	if (Begin == End)
+	{
+		return Frame;
+	}
+
+	const uint32 TimeMs = (uint32)FMath::Max(0.0, TimeSeconds * 1000.0);
+
+	// First key strictly after TimeMs
+	uint32 Lo = Begin;
+	uint32 Hi = End;
+	while (Lo < Hi)
+	{
+		const uint32 Mid = Lo + (Hi - Lo) / 2;
+		if (Keys[Mid % Capacity].TimeMs <= TimeMs)
+		{
+			Lo = Mid + 1;
+		}
+		else
+		{
+			Hi = Mid;
+		}
+	}
+
+	const FVisemeKey& B = Keys[FMath::Min(Lo, End - 1) % Capacity];
+	const FVisemeKey& A = Keys[(Lo > Begin ? Lo - 1 : Lo) % Capacity];
+
+	float Alpha = 0.0f;
+	if (B.TimeMs > A.TimeMs)
+	{
+		Alpha = FMath::Clamp(float(TimeMs - A.TimeMs) / float(B.TimeMs - A.TimeMs), 0.0f, 1.0f);
+	}
+
+	constexpr float Scale = 1.0f / 255.0f;
+	auto Lerp = [Alpha, Scale](uint8 From, uint8 To) { return FMath::Lerp((float)From, (float)To, Alpha) * Scale; };
+
+	Frame.Amplitude = Lerp(A.Amplitude, B.Amplitude);
+	Frame.AA = Lerp(A.Weights[(int32)EVisemeChannel::AA], B.Weights[(int32)EVisemeChannel::AA]);
+	Frame.EE = Lerp(A.Weights[(int32)EVisemeChannel::EE], B.Weights[(int32)EVisemeChannel::EE]);
+	Frame.OO = Lerp(A.Weights[(int32)EVisemeChannel::OO], B.Weights[(int32)EVisemeChannel::OO]);
+	Frame.FF = Lerp(A.Weights[(int32)EVisemeChannel::FF], B.Weights[(int32)EVisemeChannel::FF]);
+	Frame.MBP = Lerp(A.Weights[(int32)EVisemeChannel::MBP], B.Weights[(int32)EVisemeChannel::MBP]);
+	return Frame;
+}
+
+double FVisemeTrack::GetDuration() const
+{
+	const uint32 Begin = Base.load(std::memory_order_acquire);
+	const uint32 End = Published.load(std::memory_order_acquire);
+	return End > Begin ? Keys[(End - 1) % Capacity].TimeMs / 1000.0 : 0.0;
+}
@@ -0,0 +1,490 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Logging/AiBridgeLog.h"
+#include "Memory/AiBridgeMemory.h"
+#include "HAL/Event.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/Crc.h"
+#include "Misc/ScopeLock.h"
+
+DEFINE_LOG_CATEGORY(LogAiBridge);
+
+static TAutoConsoleVariable<int32> CVarLogPayloadPreview(
+	TEXT("AiBridge.Log.PayloadPreview"),
+	64,
+	TEXT("Characters of a message body kept in AiBridge log events, 0 logs the length only"));
+
+static TAutoConsoleVariable<bool> CVarLogSampleAll(
+	TEXT("AiBridge.Log.SampleAll"),
+	false,
+	TEXT("Write every sampled AiBridge log event instead of one in N"));
+
+bool FAiBridgeLogSampler::Sample()
+{
+	if (CVarLogSampleAll.GetValueOnAnyThread())
+	{
+		return true;
+	}
+	return Count.fetch_add(1, std::memory_order_relaxed) % EveryN == 0;
+}
+
+uint32 FAiBridgeLogSampler::GetRate() const
+{
+	return CVarLogSampleAll.GetValueOnAnyThread() ? 1 : EveryN;
+}
+
+#if !NO_LOGGING
+
+namespace
+{
+	constexpr int32 RingCapacity = 1024;
+	constexpr int32 MaxFields = 8;
+	constexpr int32 TextCapacity = 320;
+
+	/** The writer also wakes early when the ring is this full */
+	constexpr int32 WakeThreshold = RingCapacity / 2;
+	constexpr double WriteIntervalMs = 25.0;
+
+	struct FFieldRecord
+	{
+		const TCHAR* Key = nullptr;
+		FAiBridgeLogField::EKind Kind = FAiBridgeLogField::EKind::Int;
+		int64 IntValue = 0;
+		double FloatValue = 0.0;
+		int32 TextOffset = 0;
+		int32 TextLength = 0;
+		int32 FullLength = 0;
+		uint32 Fingerprint = 0;
+	};
+
+	struct FEventRecord
+	{
+		double Time = 0.0;
+		uint32 ThreadId = 0;
+		ELogVerbosity::Type Verbosity = ELogVerbosity::Log;
+		const TCHAR* Event = nullptr;
+		uint32 SampleRate = 1;
+		int32 NumFields = 0;
+		int32 TextLength = 0;
+		FFieldRecord Fields[MaxFields];
+		TCHAR Text[TextCapacity];
+	};
+
+	/**
+	 * Bounded multi-producer ring (Vyukov). A slot's sequence tells whose turn it is: equal to the
+	 * claim position it is free for that producer, one past it the record is published for the reader.
+	 */
+	class FEventRing
+	{
+	public:
+		FEventRing()
+		{
+			LLM_SCOPE_BYTAG(AiBridge_Log);
+			Slots = MakeUnique<FSlot[]>(RingCapacity);
+			for (int32 Index = 0; Index < RingCapacity; ++Index)
+			{
+				Slots[Index].Sequence.store(Index, std::memory_order_relaxed);
+			}
+		}
+
+		/** Any thread. False when the ring is full */
+		template <typename FillType>
+		bool Push(FillType&& Fill)
+		{
+			uint64 Position = EnqueuePosition.load(std::memory_order_relaxed);
+			FSlot* Slot = nullptr;
+			for (;;)
+			{
+				Slot = &Slots[Position & (RingCapacity - 1)];
+				const uint64 Sequence = Slot->Sequence.load(std::memory_order_acquire);
+				const int64 Difference = (int64)Sequence - (int64)Position;
+				if (Difference == 0)
+				{
+					if (EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (Difference < 0)
+				{
+					return false;
+				}
+				else
+				{
+					Position = EnqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+
+			Fill(Slot->Record);
+			Slot->Sequence.store(Position + 1, std::memory_order_release);
+			return true;
+		}
+
+		/** One reader at a time, callers serialize on the drain lock */
+		template <typename VisitType>
+		int32 Drain(VisitType&& Visit)
+		{
+			int32 NumDrained = 0;
+			for (;;)
+			{
+				FSlot& Slot = Slots[DequeuePosition & (RingCapacity - 1)];
+				if (Slot.Sequence.load(std::memory_order_acquire) != DequeuePosition + 1)
+				{
+					return NumDrained;
+				}
+
+				Visit(Slot.Record);
+				Slot.Sequence.store(DequeuePosition + RingCapacity, std::memory_order_release);
+				++DequeuePosition;
+				++NumDrained;
+			}
+		}
+
+		int32 GetNumQueued() const
+		{
+			return (int32)(EnqueuePosition.load(std::memory_order_relaxed) - DequeueSnapshot.load(std::memory_order_relaxed));
+		}
+
+		void PublishDequeuePosition() { DequeueSnapshot.store(DequeuePosition, std::memory_order_relaxed); }
+
+	private:
+		struct FSlot
+		{
+			std::atomic<uint64> Sequence{0};
+			FEventRecord Record;
+		};
+
+		TUniquePtr<FSlot[]> Slots;
+		alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> EnqueuePosition{0};
+		alignas(PLATFORM_CACHE_LINE_SIZE) uint64 DequeuePosition = 0;
+		std::atomic<uint64> DequeueSnapshot{0};
+	};
+
+	void AppendQuoted(FStringBuilderBase& Line, FStringView Text)
+	{
+		Line.AppendChar(TEXT('"'));
+		for (const TCHAR Char : Text)
+		{
+			switch (Char)
+			{
+			case TEXT('"'): Line.Append(TEXT("\\\"")); break;
+			case TEXT('\\'): Line.Append(TEXT("\\\\")); break;
+			case TEXT('\n'): Line.Append(TEXT("\\n")); break;
+			case TEXT('\r'): Line.Append(TEXT("\\r")); break;
+			case TEXT('\t'): Line.Append(TEXT("\\t")); break;
+			default: Line.AppendChar(Char < 0x20 ? TEXT(' ') : Char); break;
+			}
+		}
+		Line.AppendChar(TEXT('"'));
+	}
+
+	void FormatRecord(const FEventRecord& Record, FStringBuilderBase& Line)
+	{
+		Line << TEXT('[') << Record.Event << TEXT(']');
+		for (int32 Index = 0; Index < Record.NumFields; ++Index)
+		{
+			const FFieldRecord& Field = Record.Fields[Index];
+			const FStringView Text(Record.Text + Field.TextOffset, Field.TextLength);
+
+			Line << TEXT(' ') << Field.Key << TEXT('=');
+			switch (Field.Kind)
+			{
+			case FAiBridgeLogField::EKind::Int:
+				Line << Field.IntValue;
+				break;
+			case FAiBridgeLogField::EKind::Float:
+				Line.Appendf(TEXT("%.3f"), Field.FloatValue);
+				break;
+			case FAiBridgeLogField::EKind::Text:
+				AppendQuoted(Line, Text);
+				break;
+			case FAiBridgeLogField::EKind::Payload:
+				AppendQuoted(Line, Text);
+				if (Field.TextLength < Field.FullLength)
+				{
+					Line << TEXT("...");
+				}
+				Line << TEXT(' ') << Field.Key << TEXT(".len=") << Field.FullLength;
+				break;
+			case FAiBridgeLogField::EKind::Secret:
+				Line.Appendf(TEXT("<redacted len=%d crc=%08x>"), Field.FullLength, Field.Fingerprint);
+				break;
+			}
+		}
+
+		if (Record.SampleRate > 1)
+		{
+			Line << TEXT(" sample=1/") << Record.SampleRate;
+		}
+	}
+
+	void FillRecord(FEventRecord& Record, ELogVerbosity::Type Verbosity, const TCHAR* Event, TConstArrayView<FAiBridgeLogField> Fields, uint32 SampleRate)
+	{
+		Record.Time = FPlatformTime::Seconds() - GStartTime;
+		Record.ThreadId = FPlatformTLS::GetCurrentThreadId();
+		Record.Verbosity = Verbosity;
+		Record.Event = Event;
+		Record.SampleRate = SampleRate;
+		Record.NumFields = FMath::Min(Fields.Num(), MaxFields);
+		Record.TextLength = 0;
+
+		const int32 PreviewLength = FMath::Max(0, CVarLogPayloadPreview.GetValueOnAnyThread());
+		for (int32 Index = 0; Index < Record.NumFields; ++Index)
+		{
+			const FAiBridgeLogField& In = Fields[Index];
+			FFieldRecord& Out = Record.Fields[Index];
+			Out.Key = In.Key;
+			Out.Kind = In.Kind;
+			Out.IntValue = In.IntValue;
+			Out.FloatValue = In.FloatValue;
+			Out.TextOffset = Record.TextLength;
+			Out.TextLength = 0;
+			Out.FullLength = In.TextValue.Len();
+			Out.Fingerprint = 0;
+
+			int32 CopyLength = 0;
+			switch (In.Kind)
+			{
+			case FAiBridgeLogField::EKind::Text:
+				CopyLength = In.TextValue.Len();
+				break;
+			case FAiBridgeLogField::EKind::Payload:
+				CopyLength = FMath::Min(In.TextValue.Len(), PreviewLength);
+				break;
+			case FAiBridgeLogField::EKind::Secret:
+				Out.Fingerprint = FCrc::MemCrc32(In.TextValue.GetData(), In.TextValue.Len() * sizeof(TCHAR));
+				break;
+			default:
+				break;
+			}
+
+			CopyLength = FMath::Min(CopyLength, TextCapacity - Record.TextLength);
+			if (CopyLength > 0)
+			{
+				FMemory::Memcpy(Record.Text + Record.TextLength, In.TextValue.GetData(), CopyLength * sizeof(TCHAR));
+				Out.TextLength = CopyLength;
+				Record.TextLength += CopyLength;
+			}
+		}
+	}
+
+	FEventRing& GetRing()
+	{
+		static FEventRing Ring;
+		return Ring;
+	}
+
+	FCriticalSection DrainLock;
+	std::atomic<uint64> NumEmitted{0};
+	std::atomic<uint64> NumWritten{0};
+	std::atomic<uint64> NumDropped{0};
+	uint64 NumDroppedReported = 0;
+
+	/** Drain lock held */
+	void WriteQueued()
+	{
+		TStringBuilder<1024> Line;
+		const int32 NumDrained = GetRing().Drain([&Line](const FEventRecord& Record)
+		{
+			// Verbosity can be lowered after the event was queued
+			if (!LogAiBridge.IsSuppressed(Record.Verbosity))
+			{
+				Line.Reset();
+				FormatRecord(Record, Line);
+				GLog->Serialize(Line.ToString(), Record.Verbosity, LogAiBridge.GetCategoryName(), Record.Time);
+			}
+		});
+		GetRing().PublishDequeuePosition();
+		NumWritten.fetch_add(NumDrained, std::memory_order_relaxed);
+
+		const uint64 Dropped = NumDropped.load(std::memory_order_relaxed);
+		if (Dropped != NumDroppedReported)
+		{
+			UE_LOG(LogAiBridge, Warning, TEXT("[Log] Ring full, %llu events dropped"), Dropped - NumDroppedReported);
+			NumDroppedReported = Dropped;
+		}
+	}
+
+	class FLogWriter final : public FRunnable
+	{
+	public:
+		FLogWriter()
+		{
+			WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+			Thread = FRunnableThread::Create(this, TEXT("AiBridgeLog"), 0, TPri_BelowNormal);
+		}
+
+		virtual ~FLogWriter() override
+		{
+			if (Thread)
+			{
+				Thread->Kill(true);
+				delete Thread;
+				Thread = nullptr;
+			}
+			FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+		}
+
+		bool IsRunning() const { return Thread != nullptr; }
+
+		void Wake() { WakeEvent->Trigger(); }
+
+		virtual uint32 Run() override
+		{
+			while (!bStopping.load(std::memory_order_relaxed))
+			{
+				WakeEvent->Wait(FTimespan::FromMilliseconds(WriteIntervalMs));
+
+				FScopeLock ScopeLock(&DrainLock);
+				WriteQueued();
+			}
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			bStopping = true;
+			WakeEvent->Trigger();
+		}
+
+	private:
+		FRunnableThread* Thread = nullptr;
+		FEvent* WakeEvent = nullptr;
+		std::atomic<bool> bStopping{false};
+	};
+
+	FCriticalSection WriterLock;
+	TUniquePtr<FLogWriter> Writer;
+	std::atomic<FLogWriter*> ActiveWriter{nullptr};
+	std::atomic<bool> bShutDown{false};
+
+	/** Emits that may still hold the writer they picked up, Shutdown waits for them before deleting it */
+	std::atomic<int32> NumWriterUsers{0};
+
+	struct FWriterUse
+	{
+		FWriterUse() { NumWriterUsers.fetch_add(1); }
+		~FWriterUse() { NumWriterUsers.fetch_sub(1); }
+	};
+
+	FLogWriter* EnsureWriter()
+	{
+		FLogWriter* Current = ActiveWriter.load(std::memory_order_acquire);
+		if (Current != nullptr || bShutDown.load(std::memory_order_relaxed) || !FPlatformProcess::SupportsMultithreading())
+		{
+			return Current;
+		}
+
+		FScopeLock ScopeLock(&WriterLock);
+		if (!Writer && !bShutDown)
+		{
+			LLM_SCOPE_BYTAG(AiBridge_Log);
+			Writer = MakeUnique<FLogWriter>();
+			if (Writer->IsRunning())
+			{
+				ActiveWriter.store(Writer.Get(), std::memory_order_release);
+			}
+		}
+		return ActiveWriter.load(std::memory_order_acquire);
+	}
+}
+
+void AiBridgeLog::Emit(ELogVerbosity::Type Verbosity, const TCHAR* Event, TConstArrayView<FAiBridgeLogField> Fields, uint32 SampleRate)
+{
+	check((Verbosity & ELogVerbosity::VerbosityMask) > ELogVerbosity::Fatal);
+
+	// Counted before the writer is read, so Shutdown either sees this use or this Emit sees no writer
+	const FWriterUse WriterUse;
+	FLogWriter* LogWriter = EnsureWriter();
+	NumEmitted.fetch_add(1, std::memory_order_relaxed);
+
+	FEventRing& Ring = GetRing();
+	const bool bQueued = Ring.Push([&](FEventRecord& Record)
+	{
+		FillRecord(Record, (ELogVerbosity::Type)(Verbosity & ELogVerbosity::VerbosityMask), Event, Fields, SampleRate);
+	});
+	if (!bQueued)
+	{
+		NumDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	if (LogWriter == nullptr)
+	{
+		FScopeLock ScopeLock(&DrainLock);
+		WriteQueued();
+	}
+	else if (Ring.GetNumQueued() >= WakeThreshold)
+	{
+		LogWriter->Wake();
+	}
+}
+
+void AiBridgeLog::Flush()
+{
+	FScopeLock ScopeLock(&DrainLock);
+	WriteQueued();
+}
+
+void AiBridgeLog::Shutdown()
+{
+	TUniquePtr<FLogWriter> Stopped;
+	{
+		FScopeLock ScopeLock(&WriterLock);
+		bShutDown = true;
+		ActiveWriter = nullptr;
+		Stopped = MoveTemp(Writer);
+	}
+
+	// An Emit on another thread may have picked the writer up just before it was cleared and still wake it
+	while (NumWriterUsers.load() != 0)
+	{
+		FPlatformProcess::Yield();
+	}
+	Stopped.Reset();
+
+	Flush();
+}
+
+FAiBridgeLogStats AiBridgeLog::GetStats()
+{
+	FAiBridgeLogStats Stats;
+	Stats.Emitted = NumEmitted.load(std::memory_order_relaxed);
+	Stats.Written = NumWritten.load(std::memory_order_relaxed);
+	Stats.Dropped = NumDropped.load(std::memory_order_relaxed);
+	Stats.Capacity = RingCapacity;
+	return Stats;
+}
+
+static FAutoConsoleCommand GAiBridgeLogStatsCommand(
+	TEXT("AiBridge.Log.Stats"),
+	TEXT("Prints how many AiBridge log events were emitted, written and dropped"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		const FAiBridgeLogStats Stats = AiBridgeLog::GetStats();
+		UE_LOG(LogAiBridge, Display, TEXT("[Log] %llu emitted, %llu written, %llu dropped, ring of %d"), Stats.Emitted, Stats.Written, Stats.Dropped, Stats.Capacity);
+	}));
+
+#else
+
+void AiBridgeLog::Emit(ELogVerbosity::Type Verbosity, const TCHAR* Event, TConstArrayView<FAiBridgeLogField> Fields, uint32 SampleRate)
+{
+}
+
+void AiBridgeLog::Flush()
+{
+}
+
+void AiBridgeLog::Shutdown()
+{
+}
+
+FAiBridgeLogStats AiBridgeLog::GetStats()
+{
+	return FAiBridgeLogStats();
+}
+
+#endif
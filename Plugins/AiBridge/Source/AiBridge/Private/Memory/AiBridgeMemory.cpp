@@ -0,0 +1,224 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Memory/AiBridgeMemory.h"
+#include "Logging/AiBridgeLog.h"
+#include "Settings/AiBridgeSettings.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+
+LLM_DEFINE_TAG(AiBridge);
+LLM_DEFINE_TAG(AiBridge_Audio);
+LLM_DEFINE_TAG(AiBridge_Network);
+LLM_DEFINE_TAG(AiBridge_Prompt);
+LLM_DEFINE_TAG(AiBridge_Knowledge);
+LLM_DEFINE_TAG(AiBridge_Tokenizer);
+LLM_DEFINE_TAG(AiBridge_Log);
+
+namespace AiBridgeMemory
+{
+	constexpr int32 NumCategories = (int32)EAiBridgeMemoryCategory::Num;
+
+	struct FTotals
+	{
+		std::atomic<int64> Current{0};
+		std::atomic<int64> Peak{0};
+		std::atomic<int64> EvictedBytes{0};
+		std::atomic<uint64> Evictions{0};
+	};
+
+	FTotals Totals[NumCategories];
+
+	/** Live streams, each removes itself when destroyed */
+	FCriticalSection StreamsLock;
+	TArray<const FAiBridgeMemoryStream*> Streams;
+
+	void RaisePeak(std::atomic<int64>& Peak, int64 Value)
+	{
+		int64 Seen = Peak.load(std::memory_order_relaxed);
+		while (Value > Seen && !Peak.compare_exchange_weak(Seen, Value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void AddToTotal(EAiBridgeMemoryCategory Category, int64 Bytes)
+	{
+		FTotals& Total = Totals[(int32)Category];
+		RaisePeak(Total.Peak, Total.Current.fetch_add(Bytes, std::memory_order_relaxed) + Bytes);
+	}
+
+	FString FormatBytes(int64 Bytes)
+	{
+		return Bytes >= 1024 * 1024 ? FString::Printf(TEXT("%.2f MB"), Bytes / (1024.0 * 1024.0)) : FString::Printf(TEXT("%.1f KB"), Bytes / 1024.0);
+	}
+
+	FString FormatUsage(const FAiBridgeMemoryUsage& Usage)
+	{
+		return FString::Printf(TEXT("current %s, peak %s, budget %s, evicted %s in %llu"),
+			*FormatBytes(Usage.Current), *FormatBytes(Usage.Peak), Usage.Budget > 0 ? *FormatBytes(Usage.Budget) : TEXT("none"),
+			*FormatBytes(Usage.EvictedBytes), Usage.Evictions);
+	}
+}
+
+const TCHAR* LexToString(EAiBridgeMemoryCategory Category)
+{
+	switch (Category)
+	{
+	case EAiBridgeMemoryCategory::History: return TEXT("History");
+	case EAiBridgeMemoryCategory::Audio: return TEXT("Audio");
+	case EAiBridgeMemoryCategory::Messages: return TEXT("Messages");
+	default: return TEXT("Unknown");
+	}
+}
+
+FAiBridgeMemoryStream::FAiBridgeMemoryStream(FName InName)
+	: Name(InName)
+{
+	const UAiBridgeSettings* Settings = GetDefault<UAiBridgeSettings>();
+	SetBudget(EAiBridgeMemoryCategory::History, Settings->HistoryBudgetKB * 1024ll);
+	SetBudget(EAiBridgeMemoryCategory::Audio, Settings->AudioBudgetKB * 1024ll);
+	SetBudget(EAiBridgeMemoryCategory::Messages, Settings->MessagesBudgetKB * 1024ll);
+
+	FScopeLock ScopeLock(&AiBridgeMemory::StreamsLock);
+	AiBridgeMemory::Streams.Add(this);
+}
+
+FAiBridgeMemoryStream::~FAiBridgeMemoryStream()
+{
+	// Whatever the owner still held is freed with it
+	for (int32 Index = 0; Index < AiBridgeMemory::NumCategories; ++Index)
+	{
+		AiBridgeMemory::Totals[Index].Current.fetch_sub(Counters[Index].Current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	FScopeLock ScopeLock(&AiBridgeMemory::StreamsLock);
+	AiBridgeMemory::Streams.RemoveSingleSwap(this);
+}
+
+void FAiBridgeMemoryStream::Add(EAiBridgeMemoryCategory Category, int64 Bytes)
+{
+	FCounters& Counter = Counters[(int32)Category];
+	AiBridgeMemory::RaisePeak(Counter.Peak, Counter.Current.fetch_add(Bytes, std::memory_order_relaxed) + Bytes);
+	AiBridgeMemory::AddToTotal(Category, Bytes);
+}
+
+bool FAiBridgeMemoryStream::TryAdd(EAiBridgeMemoryCategory Category, int64 Bytes)
+{
+	FCounters& Counter = Counters[(int32)Category];
+	const int64 Budget = Counter.Budget.load(std::memory_order_relaxed);
+
+	int64 Current = Counter.Current.load(std::memory_order_relaxed);
+	do
+	{
+		if (Budget > 0 && Current + Bytes > Budget)
+		{
+			return false;
+		}
+	}
+	while (!Counter.Current.compare_exchange_weak(Current, Current + Bytes, std::memory_order_relaxed));
+
+	AiBridgeMemory::RaisePeak(Counter.Peak, Current + Bytes);
+	AiBridgeMemory::AddToTotal(Category, Bytes);
+	return true;
+}
+
+void FAiBridgeMemoryStream::Remove(EAiBridgeMemoryCategory Category, int64 Bytes)
+{
+	Counters[(int32)Category].Current.fetch_sub(Bytes, std::memory_order_relaxed);
+	AiBridgeMemory::Totals[(int32)Category].Current.fetch_sub(Bytes, std::memory_order_relaxed);
+}
+
+void FAiBridgeMemoryStream::NoteEvicted(EAiBridgeMemoryCategory Category, int64 Bytes)
+{
+	FCounters& Counter = Counters[(int32)Category];
+	Counter.EvictedBytes.fetch_add(Bytes, std::memory_order_relaxed);
+	Counter.Evictions.fetch_add(1, std::memory_order_relaxed);
+
+	AiBridgeMemory::FTotals& Total = AiBridgeMemory::Totals[(int32)Category];
+	Total.EvictedBytes.fetch_add(Bytes, std::memory_order_relaxed);
+	Total.Evictions.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64 FAiBridgeMemoryStream::GetOverBudget(EAiBridgeMemoryCategory Category) const
+{
+	const FCounters& Counter = Counters[(int32)Category];
+	const int64 Budget = Counter.Budget.load(std::memory_order_relaxed);
+	return Budget > 0 ? FMath::Max<int64>(Counter.Current.load(std::memory_order_relaxed) - Budget, 0) : 0;
+}
+
+void FAiBridgeMemoryStream::SetBudget(EAiBridgeMemoryCategory Category, int64 Bytes)
+{
+	Counters[(int32)Category].Budget.store(FMath::Max<int64>(Bytes, 0), std::memory_order_relaxed);
+}
+
+int64 FAiBridgeMemoryStream::GetBudget(EAiBridgeMemoryCategory Category) const
+{
+	return Counters[(int32)Category].Budget.load(std::memory_order_relaxed);
+}
+
+FAiBridgeMemoryUsage FAiBridgeMemoryStream::GetUsage(EAiBridgeMemoryCategory Category) const
+{
+	const FCounters& Counter = Counters[(int32)Category];
+
+	FAiBridgeMemoryUsage Usage;
+	Usage.Current = Counter.Current.load(std::memory_order_relaxed);
+	Usage.Peak = Counter.Peak.load(std::memory_order_relaxed);
+	Usage.Budget = Counter.Budget.load(std::memory_order_relaxed);
+	Usage.EvictedBytes = Counter.EvictedBytes.load(std::memory_order_relaxed);
+	Usage.Evictions = Counter.Evictions.load(std::memory_order_relaxed);
+	return Usage;
+}
+
+TSharedRef<FAiBridgeMemoryStream, ESPMode::ThreadSafe> AiBridgeMemory::CreateStream(FName Name)
+{
+	return MakeShared<FAiBridgeMemoryStream, ESPMode::ThreadSafe>(Name);
+}
+
+FAiBridgeMemoryUsage AiBridgeMemory::GetTotalUsage(EAiBridgeMemoryCategory Category)
+{
+	const FTotals& Total = Totals[(int32)Category];
+
+	FAiBridgeMemoryUsage Usage;
+	Usage.Current = Total.Current.load(std::memory_order_relaxed);
+	Usage.Peak = Total.Peak.load(std::memory_order_relaxed);
+	Usage.EvictedBytes = Total.EvictedBytes.load(std::memory_order_relaxed);
+	Usage.Evictions = Total.Evictions.load(std::memory_order_relaxed);
+	return Usage;
+}
+
+void AiBridgeMemory::LogReport()
+{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	const bool bTracking = FLowLevelMemTracker::IsEnabled();
+#else
+	const bool bTracking = false;
+#endif
+	UE_LOG(LogAiBridge, Display, TEXT("[Memory] Buffered AiBridge data%s"),
+		bTracking ? TEXT(", allocations by subsystem are under AiBridge/ in the LLM report") : TEXT(", run with -llm for allocations by subsystem"));
+
+	for (int32 Index = 0; Index < NumCategories; ++Index)
+	{
+		const EAiBridgeMemoryCategory Category = (EAiBridgeMemoryCategory)Index;
+		UE_LOG(LogAiBridge, Display, TEXT("[Memory] %-8s %s"), LexToString(Category), *FormatUsage(GetTotalUsage(Category)));
+	}
+
+	FScopeLock ScopeLock(&StreamsLock);
+	for (const FAiBridgeMemoryStream* Stream : Streams)
+	{
+		for (int32 Index = 0; Index < NumCategories; ++Index)
+		{
+			const EAiBridgeMemoryCategory Category = (EAiBridgeMemoryCategory)Index;
+			const FAiBridgeMemoryUsage Usage = Stream->GetUsage(Category);
+			if (Usage.Peak > 0 || Usage.Evictions > 0)
+			{
+				UE_LOG(LogAiBridge, Display, TEXT("[Memory]   %s %s: %s"), *Stream->GetName().ToString(), LexToString(Category), *FormatUsage(Usage));
+			}
+		}
+	}
+}
+
+static FAutoConsoleCommand GAiBridgeMemoryReportCommand(
+	TEXT("AiBridge.Memory.Report"),
+	TEXT("Logs current and peak buffered history, audio and messages by category and by stream, with budgets and evictions."),
+	FConsoleCommandDelegate::CreateStatic(&AiBridgeMemory::LogReport)
+);
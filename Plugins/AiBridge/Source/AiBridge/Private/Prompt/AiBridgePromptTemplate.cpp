@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Prompt/AiBridgePromptTemplate.h"
+#include "Settings/AiBridgeSettings.h"
+
+void UAiBridgePromptTemplate::SetTemplate(const FString& InTemplate)
+{
+	Template = InTemplate;
+	Compiled.Compile(Template);
+}
+
+const FPromptTemplate& UAiBridgePromptTemplate::GetCompiled() const
+{
+	if (!Compiled.IsCompiled())
+	{
+		Compiled.Compile(Template);
+	}
+	return Compiled;
+}
+
+void UAiBridgePromptTemplate::Render(const TMap<FString, FString>& Variables, TArray<uint8>& Out, FXxHash64Builder* Hash) const
+{
+	const FPromptTemplate& Prompt = GetCompiled();
+	const TMap<FString, FString>& ProjectVariables = GetDefault<UAiBridgeSettings>()->PromptVariables;
+
+	Values.Reset();
+	Values.SetNum(Prompt.NumVariables());
+	for (int32 Index = 0; Index < Prompt.NumVariables(); ++Index)
+	{
+		const FString& Name = Prompt.GetVariableName(Index);
+
+		const FString* Value = Variables.Find(Name);
+		if (Value == nullptr)
+		{
+			Value = Defaults.Find(Name);
+		}
+		if (Value == nullptr)
+		{
+			Value = ProjectVariables.Find(Name);
+		}
+		if (Value != nullptr)
+		{
+			Values[Index] = FPromptTemplateValue(*Value);
+		}
+	}
+
+	Prompt.Render(Values, Out, Hash);
+}
+
+FString UAiBridgePromptTemplate::RenderToString(const TMap<FString, FString>& Variables) const
+{
+	TArray<uint8> Utf8;
+	Render(Variables, Utf8);
+
+	const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Utf8.GetData()), Utf8.Num());
+	return FString(Converted.Length(), Converted.Get());
+}
+
+void UAiBridgePromptTemplate::PostLoad()
+{
+	Super::PostLoad();
+	Compiled.Compile(Template);
+}
+
+#if WITH_EDITOR
+void UAiBridgePromptTemplate::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	Compiled.Compile(Template);
+}
+#endif
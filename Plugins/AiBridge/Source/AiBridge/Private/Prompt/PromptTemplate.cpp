@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Prompt/PromptTemplate.h"
+#include "Logging/AiBridgeLog.h"
+#include "Hash/xxhash.h"
+
+namespace PromptTemplate
+{
+	void AppendConverted(const TCHAR* Chars, int32 Length, TArray<uint8>& Out)
+	{
+		if (Length <= 0)
+		{
+			return;
+		}
+
+		const int32 Size = FPlatformString::ConvertedLength<UTF8CHAR>(Chars, Length);
+		const int32 Start = Out.AddUninitialized(Size);
+		FPlatformString::Convert(reinterpret_cast<UTF8CHAR*>(Out.GetData() + Start), Size, Chars, Length);
+	}
+
+	FORCEINLINE bool NeedsJsonEscape(uint32 Char)
+	{
+		return Char < 0x20 || Char == '"' || Char == '\\';
+	}
+
+	void AppendJsonEscape(uint32 Char, TArray<uint8>& Out)
+	{
+		ANSICHAR Escape[7] = { '\\', 0 };
+		int32 Length = 2;
+		switch (Char)
+		{
+		case '"': Escape[1] = '"'; break;
+		case '\\': Escape[1] = '\\'; break;
+		case '\n': Escape[1] = 'n'; break;
+		case '\r': Escape[1] = 'r'; break;
+		case '\t': Escape[1] = 't'; break;
+		case '\b': Escape[1] = 'b'; break;
+		case '\f': Escape[1] = 'f'; break;
+		default:
+			FCStringAnsi::Snprintf(Escape, UE_ARRAY_COUNT(Escape), "\\u%04x", Char);
+			Length = 6;
+			break;
+		}
+		Out.Append(reinterpret_cast<const uint8*>(Escape), Length);
+	}
+}
+
+void AiBridgePrompt::AppendUtf8(FStringView Text, EPromptEscaping Escaping, TArray<uint8>& Out)
+{
+	if (Escaping == EPromptEscaping::None)
+	{
+		PromptTemplate::AppendConverted(Text.GetData(), Text.Len(), Out);
+		return;
+	}
+
+	// Runs between escapes are converted in one go; escapes are ASCII so surrogate pairs are never split
+	int32 RunStart = 0;
+	for (int32 Index = 0; Index < Text.Len(); ++Index)
+	{
+		if (PromptTemplate::NeedsJsonEscape((uint32)Text[Index]))
+		{
+			PromptTemplate::AppendConverted(Text.GetData() + RunStart, Index - RunStart, Out);
+			PromptTemplate::AppendJsonEscape((uint32)Text[Index], Out);
+			RunStart = Index + 1;
+		}
+	}
+	PromptTemplate::AppendConverted(Text.GetData() + RunStart, Text.Len() - RunStart, Out);
+}
+
+void AiBridgePrompt::AppendUtf8(TConstArrayView<uint8> Utf8, EPromptEscaping Escaping, TArray<uint8>& Out)
+{
+	if (Escaping == EPromptEscaping::None)
+	{
+		Out.Append(Utf8.GetData(), Utf8.Num());
+		return;
+	}
+
+	// Multi-byte sequences never contain ASCII bytes, so escaping byte by byte is safe
+	int32 RunStart = 0;
+	for (int32 Index = 0; Index < Utf8.Num(); ++Index)
+	{
+		if (PromptTemplate::NeedsJsonEscape(Utf8[Index]))
+		{
+			Out.Append(Utf8.GetData() + RunStart, Index - RunStart);
+			PromptTemplate::AppendJsonEscape(Utf8[Index], Out);
+			RunStart = Index + 1;
+		}
+	}
+	Out.Append(Utf8.GetData() + RunStart, Utf8.Num() - RunStart);
+}
+
+void FPromptTemplate::Compile(FStringView Source, EPromptEscaping Escaping)
+{
+	Segments.Reset();
+	Literals.Reset();
+	VariableNames.Reset();
+
+	FString Pending;
+	auto FlushLiteral = [this, &Pending, Escaping]()
+	{
+		if (Pending.IsEmpty())
+		{
+			return;
+		}
+
+		FSegment& Segment = Segments.AddDefaulted_GetRef();
+		Segment.Offset = Literals.Num();
+		AiBridgePrompt::AppendUtf8(Pending, Escaping, Literals);
+		Segment.Length = Literals.Num() - Segment.Offset;
+		Pending.Reset();
+	};
+
+	const int32 Length = Source.Len();
+	for (int32 Index = 0; Index < Length;)
+	{
+		if (Source[Index] == TEXT('$') && Index + 2 < Length && Source[Index + 1] == TEXT('$') && Source[Index + 2] == TEXT('{'))
+		{
+			Pending += TEXT("${");
+			Index += 3;
+			continue;
+		}
+
+		int32 Close = INDEX_NONE;
+		if (Source[Index] == TEXT('$') && Index + 1 < Length && Source[Index + 1] == TEXT('{') && Source.RightChop(Index + 2).FindChar(TEXT('}'), Close))
+		{
+			FStringView Name = Source.Mid(Index + 2, Close).TrimStartAndEnd();
+			EPromptEscaping VariableEscaping = Escaping;
+
+			int32 Bar = INDEX_NONE;
+			if (Name.FindChar(TEXT('|'), Bar))
+			{
+				const FStringView Filter = Name.RightChop(Bar + 1).TrimStartAndEnd();
+				Name = Name.Left(Bar).TrimEnd();
+				if (Filter.Equals(TEXT("json"), ESearchCase::IgnoreCase))
+				{
+					VariableEscaping = EPromptEscaping::Json;
+				}
+				else if (Filter.Equals(TEXT("raw"), ESearchCase::IgnoreCase))
+				{
+					VariableEscaping = EPromptEscaping::None;
+				}
+				else
+				{
+					UE_LOG(LogAiBridge, Warning, TEXT("[Prompt] Unknown filter '%.*s' on ${%.*s}"), Filter.Len(), Filter.GetData(), Name.Len(), Name.GetData());
+				}
+			}
+
+			FlushLiteral();
+
+			int32 Variable = FindVariable(Name);
+			if (Variable == INDEX_NONE)
+			{
+				Variable = VariableNames.Emplace(Name);
+			}
+
+			// The placeholder is kept, escaped like the literal text, for when no value is given
+			FSegment& Segment = Segments.AddDefaulted_GetRef();
+			Segment.Variable = Variable;
+			Segment.Escaping = VariableEscaping;
+			Segment.Offset = Literals.Num();
+			AiBridgePrompt::AppendUtf8(Source.Mid(Index, Close + 3), Escaping, Literals);
+			Segment.Length = Literals.Num() - Segment.Offset;
+
+			Index += Close + 3;
+			continue;
+		}
+
+		Pending.AppendChar(Source[Index]);
+		++Index;
+	}
+	FlushLiteral();
+
+	bCompiled = true;
+}
+
+int32 FPromptTemplate::FindVariable(FStringView Name) const
+{
+	for (int32 Index = 0; Index < VariableNames.Num(); ++Index)
+	{
+		if (Name.Equals(VariableNames[Index]))
+		{
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
+
+void FPromptTemplate::SetValue(TArray<FPromptTemplateValue>& Values, FStringView Name, const FPromptTemplateValue& Value) const
+{
+	Values.SetNum(VariableNames.Num(), EAllowShrinking::No);
+
+	const int32 Variable = FindVariable(Name);
+	if (Variable != INDEX_NONE)
+	{
+		Values[Variable] = Value;
+	}
+}
+
+void FPromptTemplate::Render(TConstArrayView<FPromptTemplateValue> Values, TArray<uint8>& Out, FXxHash64Builder* Hash) const
+{
+	for (const FSegment& Segment : Segments)
+	{
+		const int32 Start = Out.Num();
+
+		const FPromptTemplateValue* Value = Segment.Variable != INDEX_NONE && Values.IsValidIndex(Segment.Variable) ? &Values[Segment.Variable] : nullptr;
+		if (Value == nullptr || !Value->bSet)
+		{
+			Out.Append(Literals.GetData() + Segment.Offset, Segment.Length);
+		}
+		else if (Value->bUtf8)
+		{
+			AiBridgePrompt::AppendUtf8(Value->Utf8, Segment.Escaping, Out);
+		}
+		else
+		{
+			AiBridgePrompt::AppendUtf8(Value->Text, Segment.Escaping, Out);
+		}
+
+		if (Hash != nullptr)
+		{
+			Hash->Update(Out.GetData() + Start, Out.Num() - Start);
+		}
+	}
+}
@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Replication/AiBridgeDialogueReceiver.h"
+#include "Audio/AudioDecoder.h"
+#include "Logging/AiBridgeLog.h"
+#include "Memory/AiBridgeMemory.h"
+#include "Settings/AiBridgeSettings.h"
+#include "GameFramework/Actor.h"
+
+namespace AiBridgeDialogueReceiver
+{
+	/** Seconds of audio allowance a quiet client may bank, enough to start an utterance without a gap */
+	constexpr double MaxBurstSeconds = 0.5;
+
+	/** Seconds of audio at the budget rate that may wait for it, a whole batch reply fits */
+	constexpr double MaxQueuedSeconds = 30.0;
+}
+
+UAiBridgeDialogueReceiver::UAiBridgeDialogueReceiver()
+{
+	// Ticks on the server only while audio waits for the budget
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	SetIsReplicatedByDefault(true);
+}
+
+void UAiBridgeDialogueReceiver::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Speakers.Empty();
+	StartedTurns.Empty();
+	QueuedAudio.Empty();
+	QueuedAudioBytes = 0;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+FAudioDecodeStage* UAiBridgeDialogueReceiver::GetSpeakerAudio(const AActor* Speaker) const
+{
+	const FSpeakerStream* Stream = Speakers.Find(Speaker);
+	return Stream != nullptr ? Stream->Audio.Get() : nullptr;
+}
+
+uint32 UAiBridgeDialogueReceiver::GetStartedTurn(const AActor* Speaker) const
+{
+	const FStartedTurn* Turn = StartedTurns.Find(Speaker);
+	return Turn != nullptr ? Turn->TurnId : 0;
+}
+
+void UAiBridgeDialogueReceiver::SendBeginDialogue(AActor* Speaker, uint32 TurnId, const FString& AudioFormat)
+{
+	FStartedTurn& Turn = StartedTurns.Add(Speaker);
+	Turn.TurnId = TurnId;
+	Turn.BytesPerSecond = AiBridgeAudio::GetBytesPerSecond(AudioFormat);
+
+	// The client drops audio of the speaker's earlier turns once it hears of this one, do not spend budget on it
+	const int32 NumRemoved = QueuedAudio.RemoveAll([this, Speaker](const FQueuedAudio& Queued)
+	{
+		if (Queued.Speaker == Speaker)
+		{
+			QueuedAudioBytes -= Queued.Chunk.Num();
+			return true;
+		}
+		return false;
+	});
+	if (NumRemoved > 0)
+	{
+		AIBRIDGE_LOG_EVENT(Verbose, "replication.audio.superseded", FAiBridgeLogField::Text(TEXT("speaker"), GetNameSafe(Speaker)), FAiBridgeLogField::Int(TEXT("chunks"), NumRemoved));
+	}
+
+	ClientBeginDialogue(Speaker, TurnId, AudioFormat);
+}
+
+void UAiBridgeDialogueReceiver::SendText(AActor* Speaker, const FString& Text)
+{
+	// Text is small next to audio and must arrive, it is never held back but still draws on the allowance
+	TrySpendAudioBudget(0);
+	AudioAllowance -= Text.Len();
+
+	Stats.TextBytesSent += Text.Len();
+	ClientDialogueText(Speaker, Text);
+}
+
+bool UAiBridgeDialogueReceiver::SendAudio(AActor* Speaker, uint32 TurnId, uint16 Sequence, const TArray<uint8>& Chunk)
+{
+	// Behind queued chunks or over the allowance, the chunk waits its turn rather than being dropped
+	if (QueuedAudio.Num() == 0 && TrySpendAudioBudget(Chunk.Num()))
+	{
+		++Stats.AudioChunksSent;
+		Stats.AudioBytesSent += Chunk.Num();
+		ClientDialogueAudio(Speaker, TurnId, Sequence, Chunk);
+		return true;
+	}
+
+	const double MaxQueuedBytes = GetAudioBytesPerSecond() * AiBridgeDialogueReceiver::MaxQueuedSeconds;
+	if (QueuedAudioBytes + Chunk.Num() > MaxQueuedBytes)
+	{
+		++Stats.AudioChunksOverBudget;
+		AIBRIDGE_LOG_SAMPLED(50, Warning, "replication.audio.dropped", FAiBridgeLogField::Int(TEXT("bytes"), Chunk.Num()), FAiBridgeLogField::Int(TEXT("queued"), QueuedAudioBytes));
+		return false;
+	}
+
+	FQueuedAudio& Queued = QueuedAudio.AddDefaulted_GetRef();
+	Queued.Speaker = Speaker;
+	Queued.TurnId = TurnId;
+	Queued.Sequence = Sequence;
+	Queued.Chunk = Chunk;
+	QueuedAudioBytes += Chunk.Num();
+	++Stats.AudioChunksPaced;
+
+	SetComponentTickEnabled(true);
+	return true;
+}
+
+void UAiBridgeDialogueReceiver::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	SendQueuedAudio();
+}
+
+void UAiBridgeDialogueReceiver::SendQueuedAudio()
+{
+	int32 NumSent = 0;
+	while (NumSent < QueuedAudio.Num() && TrySpendAudioBudget(QueuedAudio[NumSent].Chunk.Num()))
+	{
+		FQueuedAudio& Queued = QueuedAudio[NumSent++];
+		QueuedAudioBytes -= Queued.Chunk.Num();
+
+		// A speaker gone meanwhile has nobody to resolve it on the client
+		if (AActor* Speaker = Queued.Speaker.Get())
+		{
+			++Stats.AudioChunksSent;
+			Stats.AudioBytesSent += Queued.Chunk.Num();
+			ClientDialogueAudio(Speaker, Queued.TurnId, Queued.Sequence, Queued.Chunk);
+		}
+	}
+	QueuedAudio.RemoveAt(0, NumSent, EAllowShrinking::No);
+
+	if (QueuedAudio.Num() == 0)
+	{
+		SetComponentTickEnabled(false);
+	}
+}
+
+int32 UAiBridgeDialogueReceiver::GetAudioBytesPerSecond() const
+{
+	const int32 Configured = GetDefault<UAiBridgeSettings>()->ReplicatedAudioBytesPerSecond;
+	if (Configured <= 0)
+	{
+		return 0;
+	}
+
+	// A budget below the format's own rate would leave every line playing slower than it is spoken
+	int32 BytesPerSecond = Configured;
+	for (const TPair<TWeakObjectPtr<const AActor>, FStartedTurn>& Turn : StartedTurns)
+	{
+		BytesPerSecond = FMath::Max(BytesPerSecond, Turn.Value.BytesPerSecond);
+	}
+	return BytesPerSecond;
+}
+
+bool UAiBridgeDialogueReceiver::TrySpendAudioBudget(int32 Bytes)
+{
+	const int32 BytesPerSecond = GetAudioBytesPerSecond();
+	if (BytesPerSecond <= 0)
+	{
+		return true;
+	}
+
+	// Token bucket refilled from the wall clock, the allowance goes negative only through text
+	const double Now = FPlatformTime::Seconds();
+	const double MaxAllowance = BytesPerSecond * AiBridgeDialogueReceiver::MaxBurstSeconds;
+	AudioAllowance = AllowanceTime > 0.0 ? FMath::Min(AudioAllowance + (Now - AllowanceTime) * BytesPerSecond, MaxAllowance) : MaxAllowance;
+	AllowanceTime = Now;
+
+	if (AudioAllowance < Bytes)
+	{
+		return false;
+	}
+	AudioAllowance -= Bytes;
+	return true;
+}
+
+void UAiBridgeDialogueReceiver::ClientBeginDialogue_Implementation(AActor* Speaker, uint32 TurnId, const FString& AudioFormat)
+{
+	// Speakers this client does not know, e.g. not yet relevant to it, have nobody to play them
+	if (Speaker == nullptr)
+	{
+		return;
+	}
+
+	FSpeakerStream& Stream = Speakers.FindOrAdd(Speaker);
+	Stream.TurnId = TurnId;
+	Stream.NextSequence = 0;
+
+	if (bDecodeAudio)
+	{
+		if (!Stream.Audio)
+		{
+			LLM_SCOPE_BYTAG(AiBridge_Audio);
+			Stream.Audio = MakeUnique<FAudioDecodeStage>(0, 1, 1024, 32, AiBridgeMemory::CreateStream(*FString::Printf(TEXT("Replicated.%s"), *Speaker->GetName())));
+		}
+		Stream.Audio->BeginStream(AudioFormat);
+	}
+
+	OnDialogueStarted.Broadcast(Speaker, AudioFormat);
+}
+
+void UAiBridgeDialogueReceiver::ClientDialogueText_Implementation(AActor* Speaker, const FString& Text)
+{
+	OnDialogueText.Broadcast(Speaker, Text);
+}
+
+void UAiBridgeDialogueReceiver::ClientDialogueAudio_Implementation(AActor* Speaker, uint32 TurnId, uint16 Sequence, const TArray<uint8>& Chunk)
+{
+	FSpeakerStream* Stream = Speakers.Find(Speaker);
+	if (Stream == nullptr || Stream->TurnId != TurnId)
+	{
+		return;
+	}
+
+	// Sequence numbers wrap, a chunk from behind the stream is late and no longer wanted
+	const int16 Gap = (int16)(Sequence - Stream->NextSequence);
+	if (Gap < 0)
+	{
+		return;
+	}
+
+	++Stats.AudioChunksReceived;
+	Stats.AudioChunksMissing += Gap;
+	Stream->NextSequence = Sequence + 1;
+
+	if (Stream->Audio)
+	{
+		Stream->Audio->PushEncoded(CopyTemp(Chunk));
+	}
+
+	AIBRIDGE_LOG_SAMPLED(50, Verbose, "replication.audio.in", FAiBridgeLogField::Int(TEXT("bytes"), Chunk.Num()), FAiBridgeLogField::Int(TEXT("missing"), (int64)Stats.AudioChunksMissing));
+}
@@ -0,0 +1,242 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Replication/AiBridgeReplicationSubsystem.h"
+#include "Replication/AiBridgeDialogueReceiver.h"
+#include "Logging/AiBridgeLog.h"
+#include "Memory/AiBridgeMemory.h"
+#include "Settings/AiBridgeSettings.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+bool UAiBridgeReplicationSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return GetDefault<UAiBridgeSettings>()->BridgeNetMode == EAiBridgeNetMode::ServerAuthoritative && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UAiBridgeReplicationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UAiBridgeReplicationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostLoginHandle = FGameModeEvents::GameModePostLoginEvent.AddUObject(this, &UAiBridgeReplicationSubsystem::HandlePostLogin);
+}
+
+void UAiBridgeReplicationSubsystem::Deinitialize()
+{
+	FGameModeEvents::GameModePostLoginEvent.Remove(PostLoginHandle);
+	Turns.Empty();
+	Receivers.Empty();
+
+	Super::Deinitialize();
+}
+
+void UAiBridgeReplicationSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Players who logged in before play began, the listen host among them
+	if (IsServer())
+	{
+		for (FConstPlayerControllerIterator It = InWorld.GetPlayerControllerIterator(); It; ++It)
+		{
+			AddReceiver(It->Get());
+		}
+	}
+}
+
+bool UAiBridgeReplicationSubsystem::IsServer() const
+{
+	return GetWorld()->GetNetMode() != NM_Client;
+}
+
+void UAiBridgeReplicationSubsystem::HandlePostLogin(AGameModeBase* GameMode, APlayerController* PlayerController)
+{
+	if (GameMode != nullptr && GameMode->GetWorld() == GetWorld())
+	{
+		AddReceiver(PlayerController);
+	}
+}
+
+UAiBridgeDialogueReceiver* UAiBridgeReplicationSubsystem::AddReceiver(APlayerController* PlayerController)
+{
+	if (PlayerController == nullptr)
+	{
+		return nullptr;
+	}
+
+	UAiBridgeDialogueReceiver* Receiver = PlayerController->FindComponentByClass<UAiBridgeDialogueReceiver>();
+	if (Receiver == nullptr)
+	{
+		Receiver = NewObject<UAiBridgeDialogueReceiver>(PlayerController, TEXT("AiBridgeDialogueReceiver"));
+		Receiver->RegisterComponent();
+	}
+
+	Receivers.AddUnique(Receiver);
+	return Receiver;
+}
+
+void UAiBridgeReplicationSubsystem::BeginDialogue(AActor* Speaker, const FString& AudioFormat)
+{
+	if (Speaker == nullptr || !IsServer())
+	{
+		return;
+	}
+
+	FTurn& Turn = Turns.FindOrAdd(Speaker);
+	Turn.TurnId = NextTurnId++;
+	Turn.NextSequence = 0;
+	Turn.Encoder.Reset();
+
+	FString Codec;
+	int32 SampleRate = 0;
+	Turn.bReencode = GetDefault<UAiBridgeSettings>()->bCompressReplicatedPcm && AiBridgeAudio::ParseOutputFormat(AudioFormat, Codec, SampleRate) && Codec == TEXT("pcm");
+	Turn.ReplicatedFormat = Turn.bReencode ? FString::Printf(TEXT("ulaw_%d"), SampleRate) : AudioFormat;
+
+	// Clients in range are told now, players who walk up mid-utterance before their first chunk
+	TArray<UAiBridgeDialogueReceiver*> Audience;
+	GatherAudience(Speaker, Turn, Audience);
+}
+
+void UAiBridgeReplicationSubsystem::PublishText(AActor* Speaker, const FString& Text)
+{
+	if (Speaker == nullptr || !IsServer())
+	{
+		return;
+	}
+
+	const FTurn* Turn = Turns.Find(Speaker);
+	if (Turn == nullptr)
+	{
+		BeginDialogue(Speaker, FString());
+		Turn = Turns.Find(Speaker);
+	}
+
+	TArray<UAiBridgeDialogueReceiver*> Audience;
+	GatherAudience(Speaker, *Turn, Audience);
+	for (UAiBridgeDialogueReceiver* Receiver : Audience)
+	{
+		Receiver->SendText(Speaker, Text);
+	}
+}
+
+void UAiBridgeReplicationSubsystem::PublishAudio(AActor* Speaker, TConstArrayView<uint8> Chunk)
+{
+	FTurn* Turn = Speaker != nullptr && IsServer() ? Turns.Find(Speaker) : nullptr;
+	if (Turn == nullptr || Turn->ReplicatedFormat.IsEmpty())
+	{
+		return;
+	}
+
+	LLM_SCOPE_BYTAG(AiBridge_Network);
+
+	// Encoded whether anyone listens or not, the encoder carries a split sample over to the next chunk
+	TConstArrayView<uint8> Payload = Chunk;
+	if (Turn->bReencode)
+	{
+		Encoded.Reset();
+		Turn->Encoder.Encode(Chunk, Encoded);
+		Payload = Encoded;
+	}
+
+	TArray<UAiBridgeDialogueReceiver*> Audience;
+	GatherAudience(Speaker, *Turn, Audience);
+
+	for (int32 Offset = 0; Offset < Payload.Num(); Offset += MaxAudioChunkBytes)
+	{
+		// Every piece takes a sequence number, sent or not, so clients see budget drops as gaps
+		const uint16 Sequence = Turn->NextSequence++;
+
+		Piece.Reset();
+		Piece.Append(Payload.GetData() + Offset, FMath::Min(MaxAudioChunkBytes, Payload.Num() - Offset));
+		for (UAiBridgeDialogueReceiver* Receiver : Audience)
+		{
+			Receiver->SendAudio(Speaker, Turn->TurnId, Sequence, Piece);
+		}
+	}
+}
+
+void UAiBridgeReplicationSubsystem::GatherAudience(AActor* Speaker, const FTurn& Turn, TArray<UAiBridgeDialogueReceiver*>& OutAudience)
+{
+	const float AudibleDistanceSq = FMath::Square(GetDefault<UAiBridgeSettings>()->ReplicationAudibleDistance);
+	const FVector SpeakerLocation = Speaker->GetActorLocation();
+
+	for (int32 Index = Receivers.Num() - 1; Index >= 0; --Index)
+	{
+		UAiBridgeDialogueReceiver* Receiver = Receivers[Index].Get();
+		APlayerController* PlayerController = Receiver != nullptr ? Cast<APlayerController>(Receiver->GetOwner()) : nullptr;
+		if (PlayerController == nullptr)
+		{
+			Receivers.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		if (FVector::DistSquared(ViewLocation, SpeakerLocation) > AudibleDistanceSq)
+		{
+			continue;
+		}
+
+		// The engine's relevancy decides too, a speaker the client does not have could not be resolved there
+		if (!PlayerController->IsLocalController() && !Speaker->IsNetRelevantFor(PlayerController, PlayerController->GetViewTarget(), ViewLocation))
+		{
+			continue;
+		}
+
+		if (Receiver->GetStartedTurn(Speaker) != Turn.TurnId)
+		{
+			Receiver->SendBeginDialogue(Speaker, Turn.TurnId, Turn.ReplicatedFormat);
+		}
+		OutAudience.Add(Receiver);
+	}
+}
+
+void UAiBridgeReplicationSubsystem::LogStats() const
+{
+	UE_LOG(LogAiBridge, Display, TEXT("[Replication] %s: %d receivers, %d speakers"), *GetWorld()->GetName(), Receivers.Num(), Turns.Num());
+
+	for (const TWeakObjectPtr<UAiBridgeDialogueReceiver>& WeakReceiver : Receivers)
+	{
+		if (const UAiBridgeDialogueReceiver* Receiver = WeakReceiver.Get())
+		{
+			const FAiBridgeDialogueChannelStats Stats = Receiver->GetStats();
+			UE_LOG(LogAiBridge, Display, TEXT("[Replication]   %s: text %llu B, audio %llu B in %llu chunks, %llu paced, %llu dropped over budget"),
+				*GetNameSafe(Receiver->GetOwner()), Stats.TextBytesSent, Stats.AudioBytesSent, Stats.AudioChunksSent, Stats.AudioChunksPaced, Stats.AudioChunksOverBudget);
+		}
+	}
+}
+
+static FAutoConsoleCommand GAiBridgeReplicationStatsCommand(
+	TEXT("AiBridge.Replication.Stats"),
+	TEXT("Logs the dialogue each client was sent by the server-authoritative bridge, and on clients what arrived and what went missing."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		for (TObjectIterator<UAiBridgeReplicationSubsystem> It; It; ++It)
+		{
+			if (It->GetWorld() != nullptr && It->IsServer())
+			{
+				It->LogStats();
+			}
+		}
+
+		for (TObjectIterator<UAiBridgeDialogueReceiver> It; It; ++It)
+		{
+			const UWorld* World = It->GetWorld();
+			if (World != nullptr && World->GetNetMode() == NM_Client && !It->IsTemplate())
+			{
+				const FAiBridgeDialogueChannelStats Stats = It->GetStats();
+				UE_LOG(LogAiBridge, Display, TEXT("[Replication] %s client %s: %llu audio chunks received, %llu missing"),
+					*World->GetName(), *GetNameSafe(It->GetOwner()), Stats.AudioChunksReceived, Stats.AudioChunksMissing);
+			}
+		}
+	})
+);
@@ -0,0 +1,276 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Routing/EndpointRouter.h"
+#include "Logging/AiBridgeLog.h"
+
+namespace EndpointRouter
+{
+	/** Weight of the newest sample in the smoothed round trip */
+	constexpr double RttSmoothing = 0.3;
+}
+
+void UAiBridgeEndpointRouter::Initialize(const TArray<FAiBridgeEndpoint>& InEndpoints, int32 InFailuresBeforeUnhealthy, float InProbeTimeout)
+{
+	Endpoints.Reset();
+	for (const FAiBridgeEndpoint& Endpoint : InEndpoints)
+	{
+		if (Endpoint.Url.IsEmpty())
+		{
+			continue;
+		}
+
+		FEndpointHealth& Health = Endpoints.AddDefaulted_GetRef();
+		Health.Endpoint = Endpoint;
+		Health.Endpoint.Url.RemoveFromEnd(TEXT("/"));
+	}
+
+	if (Endpoints.Num() == 0)
+	{
+		UE_LOG(LogAiBridge, Error, TEXT("[EndpointRouter] No AiBridge endpoints configured"));
+	}
+
+	ActiveIndex = 0;
+	FailuresBeforeUnhealthy = FMath::Max(1, InFailuresBeforeUnhealthy);
+	ProbeTimeout = InProbeTimeout;
+}
+
+void UAiBridgeEndpointRouter::StartProbing(float Interval)
+{
+	StopProbing();
+	bProbing = true;
+	ProbeAll();
+
+	if (Interval > 0.0f)
+	{
+		ProbeTicker = FTSTicker::GetCoreTicker().AddTicker(
+			FTickerDelegate::CreateUObject(this, &UAiBridgeEndpointRouter::TickProbes), Interval);
+	}
+}
+
+void UAiBridgeEndpointRouter::StopProbing()
+{
+	bProbing = false;
+	if (ProbeTicker.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(ProbeTicker);
+		ProbeTicker.Reset();
+	}
+}
+
+void UAiBridgeEndpointRouter::BeginDestroy()
+{
+	StopProbing();
+	Super::BeginDestroy();
+}
+
+bool UAiBridgeEndpointRouter::TickProbes(float DeltaTime)
+{
+	ProbeAll();
+	return true;
+}
+
+void UAiBridgeEndpointRouter::ProbeAll()
+{
+	for (int32 Index = 0; Index < Endpoints.Num(); ++Index)
+	{
+		if (!Endpoints[Index].bProbeInFlight)
+		{
+			Probe(Index);
+		}
+	}
+}
+
+void UAiBridgeEndpointRouter::Probe(int32 Index)
+{
+	FEndpointHealth& Health = Endpoints[Index];
+	Health.bProbeInFlight = true;
+
+	const FString HealthCheckUrl = Health.Endpoint.Url + TEXT("/health");
+	UE_LOG(LogAiBridge, Verbose, TEXT("[EndpointRouter] Probing %s"), *HealthCheckUrl);
+
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
+	Request->SetURL(HealthCheckUrl);
+	Request->SetVerb(TEXT("GET"));
+	Request->SetTimeout(ProbeTimeout);
+
+	const double StartTime = FPlatformTime::Seconds();
+	TWeakObjectPtr<UAiBridgeEndpointRouter> WeakThis(this);
+
+	Request->OnProcessRequestComplete().BindLambda(
+		[WeakThis, Index, StartTime](FHttpRequestPtr Req, FHttpResponsePtr Response, bool bWasSuccessful)
+		{
+			UAiBridgeEndpointRouter* Router = WeakThis.Get();
+			if (Router == nullptr || !Router->Endpoints.IsValidIndex(Index))
+			{
+				return;
+			}
+
+			// A 404 or a 401 proves something answers, not that the orchestrator behind it is up
+			const bool bHealthy = bWasSuccessful && Response.IsValid() && EHttpResponseCodes::IsOk(Response->GetResponseCode());
+
+			float SimulatedLatency = 0.0f;
+#if !UE_BUILD_SHIPPING
+			SimulatedLatency = Router->Endpoints[Index].Endpoint.SimulatedLatencyMs / 1000.0f;
+#endif
+			if (SimulatedLatency > 0.0f)
+			{
+				FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(
+					[WeakThis, Index, StartTime, bHealthy](float)
+					{
+						if (UAiBridgeEndpointRouter* DelayedRouter = WeakThis.Get())
+						{
+							DelayedRouter->HandleProbeResult(Index, StartTime, bHealthy);
+						}
+						return false;
+					}), SimulatedLatency);
+				return;
+			}
+
+			Router->HandleProbeResult(Index, StartTime, bHealthy);
+		});
+
+	Request->ProcessRequest();
+}
+
+void UAiBridgeEndpointRouter::HandleProbeResult(int32 Index, double StartTime, bool bHealthy)
+{
+	if (!Endpoints.IsValidIndex(Index))
+	{
+		return;
+	}
+
+	FEndpointHealth& Health = Endpoints[Index];
+	Health.bProbeInFlight = false;
+
+	if (!bHealthy)
+	{
+		Health.ConsecutiveFailures++;
+		UE_LOG(LogAiBridge, Warning, TEXT("[EndpointRouter] %s failed its health probe (%d in a row)"), *Health.Endpoint.Url, Health.ConsecutiveFailures);
+		return;
+	}
+
+	const double RttMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	Health.LastRttMs = RttMs;
+	Health.SmoothedRttMs = Health.SmoothedRttMs < 0.0
+		? RttMs
+		: FMath::Lerp(Health.SmoothedRttMs, RttMs, EndpointRouter::RttSmoothing);
+	Health.ConsecutiveFailures = 0;
+
+	UE_LOG(LogAiBridge, Log, TEXT("[EndpointRouter] %s healthy, rtt %.0f ms (smoothed %.0f ms)"), *Health.Endpoint.Url, RttMs, Health.SmoothedRttMs);
+}
+
+int32 UAiBridgeEndpointRouter::FindBestIndex(int32 ExcludeIndex) const
+{
+	int32 BestIndex = INDEX_NONE;
+	for (int32 Index = 0; Index < Endpoints.Num(); ++Index)
+	{
+		const FEndpointHealth& Candidate = Endpoints[Index];
+		if (Index == ExcludeIndex || !IsHealthy(Candidate))
+		{
+			continue;
+		}
+
+		if (BestIndex == INDEX_NONE)
+		{
+			BestIndex = Index;
+			continue;
+		}
+
+		// Measured endpoints beat unmeasured ones, unmeasured ones keep their configured order
+		const FEndpointHealth& Best = Endpoints[BestIndex];
+		if (Candidate.SmoothedRttMs >= 0.0 && (Best.SmoothedRttMs < 0.0 || Candidate.SmoothedRttMs < Best.SmoothedRttMs))
+		{
+			BestIndex = Index;
+		}
+	}
+	return BestIndex;
+}
+
+const FAiBridgeEndpoint& UAiBridgeEndpointRouter::SelectEndpoint()
+{
+	const int32 BestIndex = FindBestIndex(INDEX_NONE);
+	if (BestIndex != INDEX_NONE)
+	{
+		ActiveIndex = BestIndex;
+	}
+	else if (Endpoints.Num() > 0)
+	{
+		// Everything is failing; retry the one with the fewest failures rather than giving up
+		ActiveIndex = 0;
+		for (int32 Index = 1; Index < Endpoints.Num(); ++Index)
+		{
+			if (Endpoints[Index].ConsecutiveFailures < Endpoints[ActiveIndex].ConsecutiveFailures)
+			{
+				ActiveIndex = Index;
+			}
+		}
+	}
+
+	return GetActiveEndpoint();
+}
+
+const FAiBridgeEndpoint& UAiBridgeEndpointRouter::GetActiveEndpoint() const
+{
+	static const FAiBridgeEndpoint None;
+	return Endpoints.IsValidIndex(ActiveIndex) ? Endpoints[ActiveIndex].Endpoint : None;
+}
+
+bool UAiBridgeEndpointRouter::Failover()
+{
+	if (!Endpoints.IsValidIndex(ActiveIndex))
+	{
+		return false;
+	}
+
+	// A failed connect is strong evidence, take the endpoint out of rotation until a probe succeeds
+	FEndpointHealth& Failed = Endpoints[ActiveIndex];
+	Failed.ConsecutiveFailures = FMath::Max(Failed.ConsecutiveFailures + 1, FailuresBeforeUnhealthy);
+	UE_LOG(LogAiBridge, Warning, TEXT("[EndpointRouter] Connect to %s failed"), *Failed.Endpoint.Url);
+
+	const int32 NextIndex = FindBestIndex(ActiveIndex);
+	if (NextIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	ActiveIndex = NextIndex;
+	UE_LOG(LogAiBridge, Log, TEXT("[EndpointRouter] Failing over to %s"), *Endpoints[ActiveIndex].Endpoint.Url);
+	return true;
+}
+
+void UAiBridgeEndpointRouter::ReportSuccess()
+{
+	if (Endpoints.IsValidIndex(ActiveIndex))
+	{
+		Endpoints[ActiveIndex].ConsecutiveFailures = 0;
+	}
+}
+
+int32 UAiBridgeEndpointRouter::GetNumHealthyEndpoints() const
+{
+	int32 Count = 0;
+	for (const FEndpointHealth& Health : Endpoints)
+	{
+		Count += IsHealthy(Health) ? 1 : 0;
+	}
+	return Count;
+}
+
+FString UAiBridgeEndpointRouter::Describe() const
+{
+	FString Result;
+	for (int32 Index = 0; Index < Endpoints.Num(); ++Index)
+	{
+		const FEndpointHealth& Health = Endpoints[Index];
+		Result += FString::Printf(TEXT("%s %s [%s] rtt %.0f ms, smoothed %.0f ms, failures %d%s\n"),
+			Index == ActiveIndex ? TEXT("*") : TEXT(" "),
+			*Health.Endpoint.Url,
+			*Health.Endpoint.Location,
+			Health.LastRttMs,
+			Health.SmoothedRttMs,
+			Health.ConsecutiveFailures,
+			IsHealthy(Health) ? TEXT("") : TEXT(" (unhealthy)"));
+	}
+	return Result;
+}
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Settings/AiBridgeSettings.h"
+
+UAiBridgeSettings::UAiBridgeSettings()
+{
+	FAiBridgeEndpoint Default;
+	Default.Url = TEXT("https://api-orchestrator-service-936031000571.europe-west4.run.app");
+	Default.Location = TEXT("europe-west4");
+	Endpoints.Add(Default);
+
+	PromptVariables.Add(TEXT("serviceConfig.escalationThreshold"), TEXT("100 EUR"));
+
+	RateLimits.AddDefaulted();
+
+	// From 353 kbps of raw pcm down to 64 kbps of mu-law. Without decoding only the pcm rungs are playable,
+	// with it opus is built in; mp3 rungs would only be picked once an mp3 decoder is registered
+	auto AddTtsFormat = [this](const TCHAR* OutputFormat, const TCHAR* StreamingMode, float MinKbps)
+	{
+		FAiBridgeTtsFormat& Format = TtsFormats.AddDefaulted_GetRef();
+		Format.OutputFormat = OutputFormat;
+		Format.StreamingMode = StreamingMode;
+		Format.MinKbps = MinKbps;
+	};
+	AddTtsFormat(TEXT("pcm_22050"), TEXT("batch"), 700.0f);
+	AddTtsFormat(TEXT("pcm_16000"), TEXT("streaming"), 400.0f);
+	AddTtsFormat(TEXT("opus_48000_96"), TEXT("batch"), 320.0f);
+	AddTtsFormat(TEXT("opus_48000_32"), TEXT("streaming"), 80.0f);
+	AddTtsFormat(TEXT("ulaw_8000"), TEXT("streaming"), 0.0f);
+}
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/AiBridgeKnowledgeSubsystem.h"
+#include "Logging/AiBridgeLog.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Settings/AiBridgeSettings.h"
+#include "UObject/UObjectIterator.h"
+
+void UAiBridgeKnowledgeSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const UAiBridgeSettings* Settings = GetDefault<UAiBridgeSettings>();
+	TopK = Settings->KnowledgeTopK;
+	MinScore = Settings->KnowledgeMinScore;
+
+	if (!Settings->KnowledgeIndexPath.IsEmpty())
+	{
+		LoadIndex(Settings->KnowledgeIndexPath);
+	}
+}
+
+void UAiBridgeKnowledgeSubsystem::Deinitialize()
+{
+	Index.Reset();
+	Super::Deinitialize();
+}
+
+bool UAiBridgeKnowledgeSubsystem::LoadIndex(const FString& Path)
+{
+	Index = FKnowledgeIndex::Open(ResolvePath(Path));
+	if (!Index)
+	{
+		return false;
+	}
+
+	UE_LOG(LogAiBridge, Log, TEXT("[Knowledge] Loaded %d snippets from %s (%s)"), Index->Num(), *Path, Index->IsMapped() ? TEXT("mapped") : TEXT("loaded"));
+	return true;
+}
+
+FString UAiBridgeKnowledgeSubsystem::SelectKnowledge(const FString& Utterance) const
+{
+	if (!Index)
+	{
+		return FString();
+	}
+
+	Index->Search(Utterance, TopK, MinScore, Hits);
+
+	FString Knowledge;
+	for (const FKnowledgeHit& Hit : Hits)
+	{
+		if (!Knowledge.IsEmpty())
+		{
+			Knowledge += TEXT("\n\n");
+		}
+		Knowledge += Index->GetSnippet(Hit.Snippet);
+	}
+	return Knowledge;
+}
+
+bool UAiBridgeKnowledgeSubsystem::BuildIndex(const FString& SourcePath, const FString& IndexPath)
+{
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *ResolvePath(SourcePath)))
+	{
+		UE_LOG(LogAiBridge, Error, TEXT("[Knowledge] Could not read %s"), *SourcePath);
+		return false;
+	}
+
+	return FKnowledgeIndex::Build(FKnowledgeIndex::SplitSnippets(Text), ResolvePath(IndexPath));
+}
+
+FString UAiBridgeKnowledgeSubsystem::ResolvePath(const FString& Path)
+{
+	return FPaths::IsRelative(Path) ? FPaths::Combine(FPaths::ProjectDir(), Path) : Path;
+}
+
+static FAutoConsoleCommand GAiBridgeKnowledgeBuildCommand(
+	TEXT("AiBridge.Knowledge.Build"),
+	TEXT("Builds a knowledge index from a text file with one snippet per paragraph and loads it. Usage: AiBridge.Knowledge.Build <Source.txt> [Index=Saved/Knowledge.abki]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		if (Args.Num() < 1)
+		{
+			UE_LOG(LogAiBridge, Warning, TEXT("[Knowledge] Usage: AiBridge.Knowledge.Build <Source.txt> [Index=Saved/Knowledge.abki]"));
+			return;
+		}
+
+		const FString IndexPath = Args.Num() > 1 ? Args[1] : TEXT("Saved/Knowledge.abki");
+		if (!UAiBridgeKnowledgeSubsystem::BuildIndex(Args[0], IndexPath))
+		{
+			return;
+		}
+
+		for (TObjectIterator<UAiBridgeKnowledgeSubsystem> It(RF_ClassDefaultObject); It; ++It)
+		{
+			It->LoadIndex(IndexPath);
+		}
+	}));
+
+static FAutoConsoleCommand GAiBridgeKnowledgeQueryCommand(
+	TEXT("AiBridge.Knowledge.Query"),
+	TEXT("Logs the snippets the loaded knowledge index selects for a sentence. Usage: AiBridge.Knowledge.Query <text>"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const FString Query = FString::Join(Args, TEXT(" "));
+		for (TObjectIterator<UAiBridgeKnowledgeSubsystem> It(RF_ClassDefaultObject); It; ++It)
+		{
+			const FKnowledgeIndex* Index = It->GetIndex();
+			if (Index == nullptr)
+			{
+				UE_LOG(LogAiBridge, Log, TEXT("[Knowledge] No index loaded"));
+				continue;
+			}
+
+			TArray<FKnowledgeHit> Hits;
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			Index->Search(Query, GetDefault<UAiBridgeSettings>()->KnowledgeTopK, 0.0f, Hits);
+			const double Micros = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles) * 1e6;
+
+			UE_LOG(LogAiBridge, Log, TEXT("[Knowledge] %d hits in %.1f us"), Hits.Num(), Micros);
+			for (const FKnowledgeHit& Hit : Hits)
+			{
+				UE_LOG(LogAiBridge, Log, TEXT("[Knowledge]   %.3f #%d %s"), Hit.Score, Hit.Snippet, *Index->GetSnippet(Hit.Snippet).Left(120).Replace(TEXT("\n"), TEXT(" ")));
+			}
+		}
+	}));
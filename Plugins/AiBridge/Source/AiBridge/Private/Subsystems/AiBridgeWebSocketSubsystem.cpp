@@ -2,27 +2,274 @@
 
 
 #include "Subsystems/AiBridgeWebSocketSubsystem.h"
+#include "Logging/AiBridgeLog.h"
 
 #include "WebSocketsModule.h"
 #include "Authentication/JwtAuthenticationService.h"
 #include "WebSocket/WebSocketConnection.h"
+#include "Routing/EndpointRouter.h"
+#include "Settings/AiBridgeSettings.h"
+#include "Subsystems/AiBridgeKnowledgeSubsystem.h"
+#include "Tokenizer/BpeTokenizer.h"
+#include "Prompt/AiBridgePromptTemplate.h"
+#include "Replication/AiBridgeReplicationSubsystem.h"
+#include "Audio/AiBridgeTtsSoundWave.h"
+#include "Hash/xxhash.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+
+namespace AiBridgeWebSocketSubsystem
+{
+    /** Knowledge sent when no index is loaded, it used to be part of every system prompt */
+    const TCHAR* const InlineKnowledge = TEXT("COMPANY INFORMATION:\nSaxion XRLab is a Mixed Reality lab which focus on innovation using VR and AR solutions.\n\nPRODUCT KNOWLEDGE:\nWe offer development services for any kind of media which needs VR or AR. Including development using Unity and Unreal.\n\n");
+
+    /** Model the requests ask for, also picks the tokenizer that budgets them */
+    const TCHAR* const LlmModel = TEXT("gpt-4o-mini");
+
+    /** TTS settings asked for when adaptive TTS formats are off */
+    const TCHAR* const DefaultTtsStreamingMode = TEXT("batch");
+    const TCHAR* const DefaultTtsModel = TEXT("eleven_turbo_v2_5");
+
+    /** Built-in persona, used when no DefaultPersona is configured */
+    const TCHAR* const DefaultPersona = TEXT("You are a professional customer service agent for XRLab.\n\n${knowledge}CUSTOMER CONTEXT:\n\"${customerContext}\"\n\nSERVICE GUIDELINES:\n1. Greet customers warmly and professionally\n2. Listen actively to understand the issue\n3. Provide accurate information from the knowledge base\n4. If you don't know something, say so and offer to escalate\n5. Always confirm the customer's issue is resolved before ending\n6. Keep responses concise but complete\n\nESCALATION TRIGGERS:\n- Technical issues beyond basic troubleshooting\n- Billing disputes over ${serviceConfig.escalationThreshold}\n- Complaints about employee conduct\n- Legal or compliance questions\n\nWhen escalating, explain why and what will happen next.");
+
+    const TCHAR* const TextInputTemplate = TEXT(R"(
+        {
+          "type": "textinput",
+          "text": "${text|json}",
+          "requestId": "${requestId|json}",
+          "timestamp":1771596968241,
+          "isNpcInitiated": false,
+          "context": {
+            "systemPrompt": "${systemPrompt|json}",
+            "messages": ${messages},
+            "voiceId": "EXAVITQu4vr4xnSDxMaL",
+            "llmModel": "${llmModel|json}",
+            "llmProvider": "openai",
+            "temperature": 0.7,
+            "maxTokens": 500,
+            "language": "en-US",
+            "ttsStreamingMode": "${ttsStreamingMode|json}",
+            "ttsModel": "${ttsModel|json}",
+            "ttsOutputFormat": "${ttsOutputFormat|json}",
+            "sttProvider": "google",
+
+            "voiceStability": 0.5,
+            "voiceSimilarityBoost": 0.75,
+            "voiceStyle": 0.6,
+            "voiceUseSpeakerBoost": true,
+            "voiceSpeed": 1.0,
+            "ttsLanguageCode": "en",
+
+            "responseFormat": "json_object",
+            "location": "${location|json}",
+
+            "contextCacheName": "projects/my-project/locations/${location|json}/cachedContents/${contextCacheId}"
+          }
+        }
+    )");
+
+    const TCHAR* const MessageTemplate = TEXT(R"({"role": "${role|json}", "content": "${content|json}"})");
+
+    /** Both request templates are compiled on first use and shared by every subsystem */
+    FPromptTemplate CompileTemplate(const TCHAR* Source)
+    {
+        FPromptTemplate Template;
+        Template.Compile(Source);
+        return Template;
+    }
+
+    const FPromptTemplate& GetTextInputTemplate()
+    {
+        static const FPromptTemplate Template = CompileTemplate(TextInputTemplate);
+        return Template;
+    }
+
+    const FPromptTemplate& GetMessageTemplate()
+    {
+        static const FPromptTemplate Template = CompileTemplate(MessageTemplate);
+        return Template;
+    }
+
+    /** How often conversation turns are checked for timeouts and audio that never came, and queued turns released */
+    constexpr float RequestTickInterval = 0.1f;
+
+    /** Reconnects tried after a live link drops, waiting twice as long after each failure */
+    constexpr int32 MaxLinkRecoveries = 5;
+    constexpr float LinkRecoveryBaseDelay = 1.0f;
+    constexpr float LinkRecoveryMaxDelay = 30.0f;
+
+    /** Timeout of turns sent without a caller waiting for the reply */
+    constexpr float DefaultTurnTimeout = 30.0f;
+
+    /** Rate limit bucket every conversation turn is paced by */
+    const TCHAR* const TurnsBucket = TEXT("Turns");
+
+    /** Identifies what a turn asks and what it waits for, turns with the same hash get the same reply */
+    uint64 HashTurn(const FString& Text, const TArray<FAiBridgeChatMessage>& History, const UAiBridgePromptTemplate* Persona, const TMap<FString, FString>& Variables, bool bExpectAudio)
+    {
+        FXxHash64Builder Hash;
+        auto AddString = [&Hash](const FString& String)
+        {
+            const int32 Length = String.Len();
+            Hash.Update(&Length, sizeof(Length));
+            Hash.Update(*String, Length * sizeof(TCHAR));
+        };
+
+        AddString(Text);
+        for (const FAiBridgeChatMessage& Message : History)
+        {
+            AddString(Message.Role);
+            AddString(Message.Content);
+        }
+        Hash.Update(&Persona, sizeof(Persona));
+        for (const TPair<FString, FString>& Variable : Variables)
+        {
+            AddString(Variable.Key);
+            AddString(Variable.Value);
+        }
+
+        // A turn waiting for its audio completes later than one that only wants the text, they cannot share a request
+        Hash.Update(&bExpectAudio, sizeof(bExpectAudio));
+        return Hash.Finalize().Hash;
+    }
+
+    /** What a kept history message costs against the history budget */
+    int64 GetMessageBytes(const FAiBridgeChatMessage& Message)
+    {
+        return sizeof(FAiBridgeChatMessage) + Message.Role.GetAllocatedSize() + Message.Content.GetAllocatedSize();
+    }
+}
 
 void UAiBridgeWebSocketSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
     Super::Initialize(Collection);
     
+    const UAiBridgeSettings* Settings = GetDefault<UAiBridgeSettings>();
+    Router = NewObject<UAiBridgeEndpointRouter>(this);
+    Router->Initialize(Settings->Endpoints, Settings->FailuresBeforeUnhealthy, Settings->ProbeTimeout);
+
     AuthService = NewObject<UJwtAuthenticationService>(this);
-    AuthService->Initialize(ApiBaseUrl);
+    AuthService->Initialize(Router->SelectEndpoint().Url);
+
+    VisemeAnalyzer = MakeUnique<FVisemeAnalyzer>();
+    TtsAudioStage = MakeShared<FAudioDecodeStage, ESPMode::ThreadSafe>(0, 1, 1024, 32, AiBridgeMemory::CreateStream(TEXT("Tts")));
+    TtsAudioStage->BeginStream(TtsOutputFormat);
+    PlayingTtsFormat = TtsOutputFormat;
+    TtsFormats.Configure(Settings->TtsFormats, Settings->TtsUpgradeHeadroom);
+    RateLimiter.Configure(Settings->RateLimits);
+    TtsStreamingMode = AiBridgeWebSocketSubsystem::DefaultTtsStreamingMode;
+    TtsModel = AiBridgeWebSocketSubsystem::DefaultTtsModel;
+
+    // Create WS once: it reconnects itself and its outbox stays valid for worker threads across sessions
+    WebSocket = NewObject<UWebSocketConnection>(this);
+    WebSocket->HeartbeatInterval = Settings->HeartbeatInterval;
+    WebSocket->HeartbeatTimeout = Settings->HeartbeatTimeout;
+    WebSocket->bReconnectOnDrop = false;
+    Outbox = WebSocket->GetOutbox();
+
+    DefaultPersona = Settings->DefaultPersona.LoadSynchronous();
+    if (DefaultPersona == nullptr)
+    {
+        DefaultPersona = NewObject<UAiBridgePromptTemplate>(this);
+        DefaultPersona->SetTemplate(AiBridgeWebSocketSubsystem::DefaultPersona);
+        DefaultPersona->Defaults.Add(TEXT("customerContext"), TEXT("No customer context available."));
+    }
+
+    // Bind events
+    WebSocket->OnTextMessage = [this](const FString& Msg)
+    {
+        // Replies can run to kilobytes of LLM output, only a preview is kept and it is written off the game thread
+        AIBRIDGE_LOG_EVENT(Log, "ws.text.in", FAiBridgeLogField::Payload(TEXT("body"), Msg));
+
+        RequestTracker.HandleText(Msg, FPlatformTime::Seconds());
+
+        if (UAiBridgeReplicationSubsystem* Replication = GetReplication())
+        {
+            Replication->PublishText(ReplicatedSpeaker.Get(), Msg);
+        }
+    };
+
+    WebSocket->OnBinaryMessage = [this](const TArray<uint8>& Data)
+    {
+        AIBRIDGE_LOG_SAMPLED(50, Verbose, "ws.binary.in", FAiBridgeLogField::Int(TEXT("bytes"), Data.Num()));
+
+        // First, so a turn whose audio starts here has its format in place before its bytes are decoded
+        RequestTracker.HandleBinary(FPlatformTime::Seconds());
+
+        // Decoded audio reaches lip sync through the stage's tap, whatever the codec; raw bytes only if they are pcm
+        if (bDecodeTtsAudio)
+        {
+            UpdateLipSyncTap();
+            TtsAudioStage->PushEncoded(CopyTemp(Data));
+        }
+        else if (bAnalyzeLipSync)
+        {
+            VisemeAnalyzer->PushPcm16(CopyTemp(Data));
+        }
+
+        if (UAiBridgeReplicationSubsystem* Replication = GetReplication())
+        {
+            Replication->PublishAudio(ReplicatedSpeaker.Get(), Data);
+        }
+    };
+
+    WebSocket->OnDisconnected = [this]()
+    {
+        UE_LOG(LogAiBridge, Log, TEXT("[disconnect]"));
+        RateLimiter.Reset();
+        RequestTracker.FailAll(TEXT("Connection lost"));
+
+        // A drop outside a connect attempt lost a live session: blame the endpoint and let the router pick where to go
+        if (!bIsConnecting && OwnsBridge())
+        {
+            Router->Failover();
+            RecoverLink(1);
+        }
+    };
+
+    // A turn asked for its TTS format when it was built, the stage moves to it once that turn's audio actually arrives
+    RequestTracker.OnRequestAudioStart = [this](const FString& RequestId)
+    {
+        FString Format;
+        if (TurnTtsFormats.RemoveAndCopyValue(RequestId, Format) && Format != PlayingTtsFormat)
+        {
+            StartTtsAudioStream(Format);
+        }
+    };
+
+    RequestTicker = FTSTicker::GetCoreTicker().AddTicker(
+        FTickerDelegate::CreateUObject(this, &UAiBridgeWebSocketSubsystem::TickRequests), AiBridgeWebSocketSubsystem::RequestTickInterval);
     
-    InitializeConnectionSequence();
+    // A server-authoritative bridge cannot tell a client from a listen host before the first travel, only
+    // a dedicated server warms up at startup and the others wait for their first connect
+    if (Settings->BridgeNetMode == EAiBridgeNetMode::EveryInstance || IsRunningDedicatedServer())
+    {
+        InitializeConnectionSequence();
+    }
     
-    UE_LOG(LogTemp, Log, TEXT("UAiBridgeWebSocketSubsystem Initialized"));
+    UE_LOG(LogAiBridge, Log, TEXT("UAiBridgeWebSocketSubsystem Initialized"));
 }
 
 void UAiBridgeWebSocketSubsystem::Deinitialize()
 {
-    UE_LOG(LogTemp, Log, TEXT("UAiBridgeWebSocketSubsystem Deinitialized"));
+    UE_LOG(LogAiBridge, Log, TEXT("UAiBridgeWebSocketSubsystem Deinitialized"));
+    FTSTicker::GetCoreTicker().RemoveTicker(RequestTicker);
+    FTSTicker::GetCoreTicker().RemoveTicker(RecoveryTicker);
+    RateLimiter.Reset();
+    RequestTracker.FailAll(TEXT("Bridge shut down"));
+    PendingTurns.Empty();
+    TurnTtsFormats.Empty();
     Disconnect();
+    Router->StopProbing();
+
+    // The TTS sound may keep the stage alive, it must stop calling into the analyzer before that goes
+    TtsAudioStage->SetPcmTap(nullptr);
+    TtsAudioStage->Flush();
+    bLipSyncTapped = false;
+    VisemeAnalyzer.Reset();
+    TtsAudioStage.Reset();
+    Conversations.Empty();
     Super::Deinitialize();
 }
 
@@ -30,7 +277,7 @@ void UAiBridgeWebSocketSubsystem::Connect()
 {
     EnsureConnection([this](bool Success) { 
         
-        UE_LOG(LogTemp, Log, TEXT("[UnifiedWebSocket] Connected to server %d"), Success);
+        UE_LOG(LogAiBridge, Log, TEXT("[UnifiedWebSocket] Connected to server %d"), Success);
         
     } );
     /*
@@ -44,18 +291,18 @@ void UAiBridgeWebSocketSubsystem::Connect()
 
     Socket->OnConnected().AddLambda([this]()
     {
-        UE_LOG(LogTemp, Log, TEXT("WebSocket Connected"));
+        UE_LOG(LogAiBridge, Log, TEXT("WebSocket Connected"));
         OnConnected.Broadcast();
     });
 
     Socket->OnConnectionError().AddLambda([](const FString& Error)
     {
-        UE_LOG(LogTemp, Error, TEXT("WebSocket Error: %s"), *Error);
+        UE_LOG(LogAiBridge, Error, TEXT("WebSocket Error: %s"), *Error);
     });
 
     Socket->OnClosed().AddLambda([this](int32 StatusCode, const FString& Reason, bool bWasClean)
     {
-        UE_LOG(LogTemp, Warning, TEXT("WebSocket Closed: %s"), *Reason);
+        UE_LOG(LogAiBridge, Warning, TEXT("WebSocket Closed: %s"), *Reason);
         OnDisconnected.Broadcast();
     });
 
@@ -80,6 +327,9 @@ void UAiBridgeWebSocketSubsystem::Connect()
 
 void UAiBridgeWebSocketSubsystem::Disconnect()
 {
+    FTSTicker::GetCoreTicker().RemoveTicker(RecoveryTicker);
+    RecoveryTicker.Reset();
+
     if (WebSocket!= nullptr)
     {
         WebSocket->Disconnect();
@@ -102,13 +352,41 @@ void UAiBridgeWebSocketSubsystem::SendBinary(const TArray<uint8>& Data)
     }
 }
 
+bool UAiBridgeWebSocketSubsystem::SendTextAnyThread(FString&& Message)
+{
+    return Outbox.IsValid() && Outbox->SendText(MoveTemp(Message));
+}
+
+bool UAiBridgeWebSocketSubsystem::SendBinaryAnyThread(TArray<uint8>&& Data)
+{
+    return Outbox.IsValid() && Outbox->SendBinary(MoveTemp(Data));
+}
+
 bool UAiBridgeWebSocketSubsystem::IsConnected() const
 {
     return WebSocket!= nullptr && WebSocket->IsConnected();
 }
 
+FAiBridgeHeartbeatStats UAiBridgeWebSocketSubsystem::GetConnectionStats() const
+{
+    return WebSocket != nullptr ? WebSocket->GetHeartbeatStats() : FAiBridgeHeartbeatStats();
+}
+
+FAiBridgeThroughputStats UAiBridgeWebSocketSubsystem::GetDownstreamStats() const
+{
+    return WebSocket != nullptr ? WebSocket->GetDownstreamStats() : FAiBridgeThroughputStats();
+}
+
 void UAiBridgeWebSocketSubsystem::EnsureConnection(TFunction<void(bool)> Callback)
 {
+    // 0. Clients of a server-authoritative session only receive
+    if (!OwnsBridge())
+    {
+        UE_LOG(LogAiBridge, Log, TEXT("[Replication] Not connecting, the server owns the bridge"));
+        Callback(false);
+        return;
+    }
+
     // 1. Already connected
     if (WebSocket!= nullptr && WebSocket->IsConnected())
     {
@@ -116,30 +394,52 @@ void UAiBridgeWebSocketSubsystem::EnsureConnection(TFunction<void(bool)> Callbac
         return;
     }
     
-    // 3. Start connection
+    // 2. One attempt at a time, whoever asks while it runs gets its outcome
+    ConnectCallbacks.Add(MoveTemp(Callback));
+    if (bIsConnecting)
+    {
+        return;
+    }
     bIsConnecting = true;
 
+    // Hosts that skipped the startup sequence still need measured endpoints to choose from
+    StartEndpointProbing();
+
+    ConnectToBestEndpoint();
+}
+
+void UAiBridgeWebSocketSubsystem::ConnectToBestEndpoint()
+{
+    // 3. Pick the lowest latency healthy endpoint
+    const FString ApiBaseUrl = Router->SelectEndpoint().Url;
+    AuthService->Initialize(ApiBaseUrl);
+
+    // 4. Start connection
     double StartTime = FPlatformTime::Seconds();
     
     AuthService->GetAuthToken(
         TEXT("UnifiedConnection"),
         TEXT("player"),
         TEXT("03BwqvuxqQaQ8m8i8r869nBfvf+nQj8uF8BTA9LgZR0="),
-        [this, Callback, StartTime](const FString& JwtToken)
+        [this, StartTime, ApiBaseUrl](const FString& JwtToken)
         {
             double JwtTime = (FPlatformTime::Seconds() - StartTime) * 1000.0;
 
             bool bEnableVerboseLogging = true;
             if (bEnableVerboseLogging)
             {
-                UE_LOG(LogTemp, Log, TEXT("[UnifiedWebSocket New] JWT took %.0f ms"), JwtTime);
+                UE_LOG(LogAiBridge, Log, TEXT("[UnifiedWebSocket New] JWT took %.0f ms"), JwtTime);
             }
 
             if (JwtToken.IsEmpty())
             {
-                UE_LOG(LogTemp, Error, TEXT("Failed to get JWT"));
-                bIsConnecting = false;
-                Callback(false);
+                UE_LOG(LogAiBridge, Error, TEXT("Failed to get JWT"));
+                if (Router->Failover())
+                {
+                    ConnectToBestEndpoint();
+                    return;
+                }
+                FinishConnecting(false);
                 return;
             }
             
@@ -165,45 +465,24 @@ void UAiBridgeWebSocketSubsystem::EnsureConnection(TFunction<void(bool)> Callbac
                 *FGenericPlatformHttp::UrlEncode(JwtToken)
             );
             
-            //UE_LOG(LogTemp, Log, TEXT("[On WebSocket] URL: %s"), *FullUrl);
+            //UE_LOG(LogAiBridge, Log, TEXT("[On WebSocket] URL: %s"), *FullUrl);
             
             
             bEnableVerboseLogging = true;
             
-            // Create WS
-            WebSocket = NewObject<UWebSocketConnection>(this);
-
-            
-            
-            // Bind events
-            WebSocket->OnTextMessage = [this](const FString& Msg)
-            {
-                UE_LOG(LogTemp, Log, TEXT("[Message] %s"), *Msg);
-            };
-
-            WebSocket->OnBinaryMessage = [this](const TArray<uint8>& Data)
-            {
-                UE_LOG(LogTemp, Log, TEXT("[On Binary] %d bytes"), Data.Num());
-            };
-
-            WebSocket->OnDisconnected = [this]()
-            {
-                UE_LOG(LogTemp, Log, TEXT("[disconnect]"));
-            };
-
             double WsStart = FPlatformTime::Seconds();
 
             WebSocket->Connect(
                 FullUrl,
                 TEXT("UnifiedConnection"),
                 JwtToken,
-                [this, Callback, StartTime, WsStart, FullUrl, &bEnableVerboseLogging](bool bConnected)
+                [this, StartTime, WsStart, FullUrl, bEnableVerboseLogging](bool bConnected)
                 {
                     double WsTime = (FPlatformTime::Seconds() - WsStart) * 1000.0;
 
                     if (bEnableVerboseLogging)
                     {
-                        UE_LOG(LogTemp, Log, TEXT("[UnifiedWebSocket] WS took %.0f ms"), WsTime);
+                        UE_LOG(LogAiBridge, Log, TEXT("[UnifiedWebSocket] WS took %.0f ms"), WsTime);
                     }
 
                     if (bConnected)
@@ -211,19 +490,22 @@ void UAiBridgeWebSocketSubsystem::EnsureConnection(TFunction<void(bool)> Callbac
 
                         double Total = (FPlatformTime::Seconds() - StartTime) * 1000.0;
 
-                        UE_LOG(LogTemp, Log, TEXT("[UnifiedWebSocket] Connected (%.0f ms total)"), Total);
+                        UE_LOG(LogAiBridge, Log, TEXT("[UnifiedWebSocket] Connected (%.0f ms total)"), Total);
 
-                        bIsConnecting = false;
-                        Callback(true);
+                        Router->ReportSuccess();
+                        FinishConnecting(true);
                     }
                     else
                     {
-                        UE_LOG(LogTemp, Error, TEXT("WebSocket failed"));
-
-                        bIsConnecting = false;
+                        UE_LOG(LogAiBridge, Error, TEXT("WebSocket failed"));
 
-                        bIsConnecting = false;
-                        Callback(false);
+                        // Try the next best endpoint before reporting failure, still as the same attempt
+                        if (Router->Failover())
+                        {
+                            ConnectToBestEndpoint();
+                            return;
+                        }
+                        FinishConnecting(false);
                     }
                 }
             );
@@ -233,172 +515,464 @@ void UAiBridgeWebSocketSubsystem::EnsureConnection(TFunction<void(bool)> Callbac
     
 }
 
-void UAiBridgeWebSocketSubsystem::SendSomethingCrazy()
+void UAiBridgeWebSocketSubsystem::RecoverLink(int32 Attempt)
 {
-    //F2FF1DD549380EB9EF7DAA80CA9AC7FF
-    FString JsonString = TEXT(R"(
+    RecoveryTicker.Reset();
+    UE_LOG(LogAiBridge, Warning, TEXT("[UnifiedWebSocket] Link lost, reconnect attempt %d"), Attempt);
+
+    EnsureConnection([this, Attempt](bool bSuccess)
+    {
+        if (bSuccess || Attempt >= AiBridgeWebSocketSubsystem::MaxLinkRecoveries || !OwnsBridge())
         {
-          "type": "textinput",
-          "text": "Hello, do you know my name?",
-          "requestId": "eec34af9-8dda-4f6c-9e65-cc18631a5b7b",
-          "timestamp":1771596968241,
-          "isNpcInitiated": false,
-          "context": {
-            "systemPrompt": "You are a professional customer service agent for XRLab.\n\nCOMPANY INFORMATION:\nSaxion XRLab is a Mixed Reality lab which focus on innovation using VR and AR solutions.\n\nPRODUCT KNOWLEDGE:\nWe offer development services for any kind of media which needs VR or AR. Including development using Unity and Unreal.\n\nCUSTOMER CONTEXT:\n\"No customer context available.\"\n\nSERVICE GUIDELINES:\n1. Greet customers warmly and professionally\n2. Listen actively to understand the issue\n3. Provide accurate information from the knowledge base\n4. If you don't know something, say so and offer to escalate\n5. Always confirm the customer's issue is resolved before ending\n6. Keep responses concise but complete\n\nESCALATION TRIGGERS:\n- Technical issues beyond basic troubleshooting\n- Billing disputes over ${serviceConfig.escalationThreshold}\n- Complaints about employee conduct\n- Legal or compliance questions\n\nWhen escalating, explain why and what will happen next.",
-            "messages": [{
-                "role": "user",
-                "content": "Hi there! my name is Daniel"
-              },
-              {
-                "role": "assistant",
-                "content": "Hello traveler! What brings you here?"
-              }],
-            "voiceId": "EXAVITQu4vr4xnSDxMaL",
-            "llmModel": "gpt-4o-mini",
-            "llmProvider": "openai",
-            "temperature": 0.7,
-            "maxTokens": 500,
-            "language": "en-US",
-            "ttsStreamingMode": "batch",
-            "ttsModel": "eleven_turbo_v2_5",
-            "sttProvider": "google",
+            return;
+        }
 
-            "voiceStability": 0.5,
-            "voiceSimilarityBoost": 0.75,
-            "voiceStyle": 0.6,
-            "voiceUseSpeakerBoost": true,
-            "voiceSpeed": 1.0,
-            "ttsLanguageCode": "en",
+        const float Delay = FMath::Min(AiBridgeWebSocketSubsystem::LinkRecoveryBaseDelay * (1 << (Attempt - 1)), AiBridgeWebSocketSubsystem::LinkRecoveryMaxDelay);
+        RecoveryTicker = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(this, [this, Attempt](float)
+        {
+            RecoverLink(Attempt + 1);
+            return false;
+        }), Delay);
+    });
+}
 
-            "responseFormat": "json_object",
-            "location": "europe-west4",
+void UAiBridgeWebSocketSubsystem::FinishConnecting(bool bSuccess)
+{
+    bIsConnecting = false;
 
-            "contextCacheName": "projects/my-project/locations/europe-west4/cachedContents/abc123"
-          }
-        }
-    )");
+    // A callback may ask for the connection again, that starts a new attempt with its own callbacks
+    TArray<TFunction<void(bool)>> Callbacks = MoveTemp(ConnectCallbacks);
+    ConnectCallbacks.Reset();
+    for (TFunction<void(bool)>& Callback : Callbacks)
+    {
+        Callback(bSuccess);
+    }
+}
+
+void UAiBridgeWebSocketSubsystem::SendSomethingCrazy()
+{
+    //F2FF1DD549380EB9EF7DAA80CA9AC7FF
     FString GuidString = FGuid::NewGuid().ToString();
     
-    UE_LOG(LogTemp, Warning, TEXT("%s"), *GuidString);
-    WebSocket->SendText(JsonString);
+    UE_LOG(LogAiBridge, Warning, TEXT("%s"), *GuidString);
+    TArray<FAiBridgeChatMessage> History;
+    History.Emplace(TEXT("user"), TEXT("Hi there! my name is Daniel"));
+    History.Emplace(TEXT("assistant"), TEXT("Hello traveler! What brings you here?"));
+    SendConversationTurn(TEXT("Hello, do you know my name?"), History, nullptr, {}, {}, false, AiBridgeWebSocketSubsystem::DefaultTurnTimeout);
 }
 
 void UAiBridgeWebSocketSubsystem::SendSomething()
 {
-    FString JsonString = TEXT(R"(
+    TArray<FAiBridgeChatMessage> History;
+    History.Emplace(TEXT("user"), TEXT("Hi there!"));
+    History.Emplace(TEXT("assistant"), TEXT("Hello traveler! What brings you here?"));
+    SendConversationTurn(TEXT("Hello, how are you today?"), History, nullptr, {}, {}, false, AiBridgeWebSocketSubsystem::DefaultTurnTimeout);
+}
+
+void UAiBridgeWebSocketSubsystem::SendTextInput(const FString& Text, const TArray<FAiBridgeChatMessage>& History, UAiBridgePromptTemplate* Persona, const TMap<FString, FString>& Variables)
+{
+    // Tracked without handlers all the same, so the limiter paces it and duplicates of it are coalesced
+    SendConversationTurn(Text, History, Persona, Variables, {}, false, AiBridgeWebSocketSubsystem::DefaultTurnTimeout);
+}
+
+FString UAiBridgeWebSocketSubsystem::SendConversationTurn(const FString& Text, const TArray<FAiBridgeChatMessage>& History, UAiBridgePromptTemplate* Persona, const TMap<FString, FString>& Variables, FAiBridgeReplyHandlers&& Handlers, bool bExpectAudio, float TimeoutSeconds)
+{
+    const FString RequestId = FGuid::NewGuid().ToString(EGuidFormats::DigitsWithHyphensLower);
+
+    if (!IsConnected())
+    {
+        if (Handlers.OnFailed)
         {
-          "type": "textinput",
-          "text": "Hello, how are you today?",
-          "requestId": "8d303a8a-ff39-4462-8ad2-10037c1727cc",
-          "timestamp":1771596968241,
-          "isNpcInitiated": false,
-          "context": {
-            "systemPrompt": "You are a professional customer service agent for XRLab.\n\nCOMPANY INFORMATION:\nSaxion XRLab is a Mixed Reality lab which focus on innovation using VR and AR solutions.\n\nPRODUCT KNOWLEDGE:\nWe offer development services for any kind of media which needs VR or AR. Including development using Unity and Unreal.\n\nCUSTOMER CONTEXT:\n\"No customer context available.\"\n\nSERVICE GUIDELINES:\n1. Greet customers warmly and professionally\n2. Listen actively to understand the issue\n3. Provide accurate information from the knowledge base\n4. If you don't know something, say so and offer to escalate\n5. Always confirm the customer's issue is resolved before ending\n6. Keep responses concise but complete\n\nESCALATION TRIGGERS:\n- Technical issues beyond basic troubleshooting\n- Billing disputes over ${serviceConfig.escalationThreshold}\n- Complaints about employee conduct\n- Legal or compliance questions\n\nWhen escalating, explain why and what will happen next.",
-            "messages": [{
-                "role": "user",
-                "content": "Hi there!"
-              },
-              {
-                "role": "assistant",
-                "content": "Hello traveler! What brings you here?"
-              }],
-            "voiceId": "EXAVITQu4vr4xnSDxMaL",
-            "llmModel": "gpt-4o-mini",
-            "llmProvider": "openai",
-            "temperature": 0.7,
-            "maxTokens": 500,
-            "language": "en-US",
-            "ttsStreamingMode": "batch",
-            "ttsModel": "eleven_turbo_v2_5",
-            "sttProvider": "google",
+            Handlers.OnFailed(TEXT("Not connected"));
+        }
+        return RequestId;
+    }
 
-            "voiceStability": 0.5,
-            "voiceSimilarityBoost": 0.75,
-            "voiceStyle": 0.6,
-            "voiceUseSpeakerBoost": true,
-            "voiceSpeed": 1.0,
-            "ttsLanguageCode": "en",
+    // Button mashes and NPCs repeating a line get the reply that is already on its way
+    const bool bCoalesce = GetDefault<UAiBridgeSettings>()->bCoalesceDuplicateTurns;
+    const uint64 TurnHash = bCoalesce ? AiBridgeWebSocketSubsystem::HashTurn(Text, History, Persona, Variables, bExpectAudio) : 0;
+    if (const FString* Pending = bCoalesce ? PendingTurns.Find(TurnHash) : nullptr)
+    {
+        const FString PendingId = *Pending;
+        if (RequestTracker.Join(PendingId, MoveTemp(Handlers)))
+        {
+            RateLimiter.NoteCoalesced();
+            return PendingId;
+        }
+        PendingTurns.Remove(TurnHash);
+    }
 
-            "responseFormat": "json_object",
-            "location": "europe-west4",
+    // Tracked before it is sent so not even an immediate reply can miss it
+    const double Now = FPlatformTime::Seconds();
+    RequestTracker.Begin(RequestId, MoveTemp(Handlers), bExpectAudio, Now, TimeoutSeconds);
+    if (bCoalesce)
+    {
+        PendingTurns.Add(TurnHash, RequestId);
+    }
 
-            "contextCacheName": "projects/my-project/locations/europe-west4/cachedContents/abc123"
-          }
+    // Built now, a turn that waits for its bucket still goes out as it was asked
+    const bool bSubmitted = RateLimiter.Submit(AiBridgeWebSocketSubsystem::TurnsBucket,
+        [this, RequestId, Request = CopyTemp(BuildTextInputRequest(Text, RequestId, History, Persona, Variables))]() mutable
+        {
+            // Failed or cancelled while it waited for its bucket, nobody would hear the reply
+            if (!RequestTracker.Contains(RequestId))
+            {
+                return false;
+            }
+
+            // The timeout runs from here, time spent held back by the limiter is not the server's
+            RequestTracker.MarkSent(RequestId, FPlatformTime::Seconds());
+            WebSocket->SendUtf8Text(MoveTemp(Request));
+            return true;
+        }, Now);
+
+    if (!bSubmitted)
+    {
+        RequestTracker.Fail(RequestId, TEXT("Rate limited, too many turns are waiting"));
+    }
+    return RequestId;
+}
+
+void UAiBridgeWebSocketSubsystem::CancelConversationTurn(const FString& RequestId)
+{
+    RequestTracker.Cancel(RequestId);
+}
+
+bool UAiBridgeWebSocketSubsystem::TickRequests(float DeltaTime)
+{
+    const double Now = FPlatformTime::Seconds();
+    RateLimiter.Tick(Now);
+    RequestTracker.Tick(Now);
+
+    // Turns that completed or failed can no longer be joined
+    for (auto It = PendingTurns.CreateIterator(); It; ++It)
+    {
+        if (!RequestTracker.Contains(It.Value()))
+        {
+            It.RemoveCurrent();
         }
-    )");
-    WebSocket->SendText(JsonString);
+    }
+
+    // Nor can their audio start any more
+    for (auto It = TurnTtsFormats.CreateIterator(); It; ++It)
+    {
+        if (!RequestTracker.Contains(It.Key()))
+        {
+            It.RemoveCurrent();
+        }
+    }
+    return true;
 }
 
-void UAiBridgeWebSocketSubsystem::InitializeConnectionSequence()
+void UAiBridgeWebSocketSubsystem::AddHistoryMessage(FName Npc, const FAiBridgeChatMessage& Message)
 {
-    if (sendWakeUpCall)
+    LLM_SCOPE_BYTAG(AiBridge_Prompt);
+
+    FNpcConversation& Conversation = Conversations.FindOrAdd(Npc);
+    if (!Conversation.Memory)
     {
-        SendWakeUpCallAsync();
+        Conversation.Memory = AiBridgeMemory::CreateStream(*FString::Printf(TEXT("Npc.%s"), *Npc.ToString()));
     }
-    PreFetchJwtToken();
+
+    Conversation.Messages.Add(Message);
+    Conversation.Memory->Add(EAiBridgeMemoryCategory::History, AiBridgeWebSocketSubsystem::GetMessageBytes(Message));
+
+    // Oldest first, the newest message is always kept
+    int32 NumEvicted = 0;
+    int64 EvictedBytes = 0;
+    while (Conversation.Memory->GetOverBudget(EAiBridgeMemoryCategory::History) > 0 && NumEvicted < Conversation.Messages.Num() - 1)
+    {
+        const int64 Bytes = AiBridgeWebSocketSubsystem::GetMessageBytes(Conversation.Messages[NumEvicted++]);
+        Conversation.Memory->Remove(EAiBridgeMemoryCategory::History, Bytes);
+        EvictedBytes += Bytes;
+    }
+
+    if (NumEvicted > 0)
+    {
+        Conversation.Messages.RemoveAt(0, NumEvicted, EAllowShrinking::No);
+        Conversation.Memory->NoteEvicted(EAiBridgeMemoryCategory::History, EvictedBytes);
+    }
+}
+
+TArray<FAiBridgeChatMessage> UAiBridgeWebSocketSubsystem::GetHistory(FName Npc) const
+{
+    const FNpcConversation* Conversation = Conversations.Find(Npc);
+    return Conversation != nullptr ? Conversation->Messages : TArray<FAiBridgeChatMessage>();
 }
 
-void UAiBridgeWebSocketSubsystem::SendWakeUpCallAsync() const
+void UAiBridgeWebSocketSubsystem::ClearHistory(FName Npc)
 {
-    bool bEnableVerboseLogging = true;
-    if (!GetWorld())
+    Conversations.Remove(Npc);
+}
+
+const TArray<uint8>& UAiBridgeWebSocketSubsystem::BuildTextInputRequest(const FString& Text, const FString& RequestId, TArray<FAiBridgeChatMessage> History, const UAiBridgePromptTemplate* Persona, const TMap<FString, FString>& Variables)
+{
+    LLM_SCOPE_BYTAG(AiBridge_Prompt);
+
+    UpdateTtsFormat();
+    TurnTtsFormats.Add(RequestId, TtsOutputFormat);
+
+    if (Persona == nullptr)
+    {
+        Persona = DefaultPersona;
+    }
+
+    PromptVariables = Variables;
+    if (!PromptVariables.Contains(TEXT("knowledge")))
+    {
+        PromptVariables.Add(TEXT("knowledge"), SelectKnowledgeText(Text));
+    }
+
+    // The cache id names the exact prompt the server may cache, hashed while it is written
+    FXxHash64Builder PromptHash;
+    PromptHash.Update(AiBridgeWebSocketSubsystem::LlmModel, FCString::Strlen(AiBridgeWebSocketSubsystem::LlmModel) * sizeof(TCHAR));
+    PromptBuffer.Reset();
+    Persona->Render(PromptVariables, PromptBuffer, &PromptHash);
+    const FString ContextCacheId = FString::Printf(TEXT("%016llx"), PromptHash.Finalize().Hash);
+
+    // Trim the history here rather than have the server reject or truncate the request
+    const int32 Budget = GetDefault<UAiBridgeSettings>()->PromptTokenBudget;
+    const TSharedRef<FBpeTokenizer, ESPMode::ThreadSafe> Tokenizer = FBpeTokenizer::ForModel(AiBridgeWebSocketSubsystem::LlmModel);
+    const FUTF8ToTCHAR SystemPrompt(reinterpret_cast<const ANSICHAR*>(PromptBuffer.GetData()), PromptBuffer.Num());
+    const int32 NumMessages = History.Num();
+    const int32 PromptTokens = AiBridgeTokenizer::TrimHistoryToBudget(*Tokenizer, FStringView(SystemPrompt.Get(), SystemPrompt.Length()), Text, Budget, History);
+    if (History.Num() < NumMessages)
+    {
+        UE_LOG(LogAiBridge, Log, TEXT("[Tokenizer] Dropped %d of %d history messages to fit %d prompt tokens"), NumMessages - History.Num(), NumMessages, Budget);
+    }
+    if (Budget > 0 && PromptTokens > Budget)
+    {
+        UE_LOG(LogAiBridge, Warning, TEXT("[Tokenizer] System prompt and utterance alone take %d tokens, over the budget of %d"), PromptTokens, Budget);
+    }
+
+    const FPromptTemplate& MessageTemplate = AiBridgeWebSocketSubsystem::GetMessageTemplate();
+    MessagesBuffer.Reset();
+    MessagesBuffer.Add('[');
+    for (const FAiBridgeChatMessage& Message : History)
+    {
+        if (MessagesBuffer.Num() > 1)
+        {
+            MessagesBuffer.Add(',');
+        }
+        MessageTemplate.SetValue(MessageValues, TEXT("role"), FPromptTemplateValue(Message.Role));
+        MessageTemplate.SetValue(MessageValues, TEXT("content"), FPromptTemplateValue(Message.Content));
+        MessageTemplate.Render(MessageValues, MessagesBuffer);
+    }
+    MessagesBuffer.Add(']');
+
+    const FPromptTemplate& RequestTemplate = AiBridgeWebSocketSubsystem::GetTextInputTemplate();
+    RequestTemplate.SetValue(RequestValues, TEXT("text"), FPromptTemplateValue(Text));
+    RequestTemplate.SetValue(RequestValues, TEXT("requestId"), FPromptTemplateValue(RequestId));
+    RequestTemplate.SetValue(RequestValues, TEXT("systemPrompt"), FPromptTemplateValue(PromptBuffer));
+    RequestTemplate.SetValue(RequestValues, TEXT("messages"), FPromptTemplateValue(MessagesBuffer));
+    RequestTemplate.SetValue(RequestValues, TEXT("llmModel"), FPromptTemplateValue(AiBridgeWebSocketSubsystem::LlmModel));
+    RequestTemplate.SetValue(RequestValues, TEXT("location"), FPromptTemplateValue(Router->GetActiveEndpoint().Location));
+    RequestTemplate.SetValue(RequestValues, TEXT("contextCacheId"), FPromptTemplateValue(ContextCacheId));
+    RequestTemplate.SetValue(RequestValues, TEXT("ttsStreamingMode"), FPromptTemplateValue(TtsStreamingMode));
+    RequestTemplate.SetValue(RequestValues, TEXT("ttsModel"), FPromptTemplateValue(TtsModel));
+    RequestTemplate.SetValue(RequestValues, TEXT("ttsOutputFormat"), FPromptTemplateValue(TtsOutputFormat));
+    RequestBuffer.Reset();
+    RequestTemplate.Render(RequestValues, RequestBuffer);
+
+    // The values point into this call's strings, drop them before they dangle
+    RequestValues.Reset();
+    MessageValues.Reset();
+    return RequestBuffer;
+}
+
+FString UAiBridgeWebSocketSubsystem::SelectKnowledgeText(const FString& Utterance) const
+{
+    const UAiBridgeKnowledgeSubsystem* Knowledge = GetGameInstance()->GetSubsystem<UAiBridgeKnowledgeSubsystem>();
+    if (Knowledge == nullptr || !Knowledge->HasIndex())
+    {
+        return AiBridgeWebSocketSubsystem::InlineKnowledge;
+    }
+
+    const FString Selected = Knowledge->SelectKnowledge(Utterance);
+    if (Selected.IsEmpty())
+    {
+        return FString();
+    }
+
+    return FString(TEXT("KNOWLEDGE:\n")) + Selected + TEXT("\n\n");
+}
+
+void UAiBridgeWebSocketSubsystem::BeginLipSyncUtterance()
+{
+    VisemeAnalyzer->BeginUtterance(bDecodeTtsAudio ? TtsAudioStage->GetOutputSampleRate() : LipSyncSampleRate, bDecodeTtsAudio ? TtsAudioStage->GetOutputChannels() : 1);
+}
+
+void UAiBridgeWebSocketSubsystem::UpdateLipSyncTap()
+{
+    if (bLipSyncTapped == bAnalyzeLipSync)
     {
-        UE_LOG(LogTemp, Warning, TEXT("[UnifiedWebSocket] No World available"));
         return;
     }
-    
-    FTimerHandle TimerHandle;
 
-    GetWorld()->GetTimerManager().SetTimer(
-        TimerHandle,
-        [this, bEnableVerboseLogging]()
+    bLipSyncTapped = bAnalyzeLipSync;
+    if (!bLipSyncTapped)
+    {
+        TtsAudioStage->SetPcmTap(nullptr);
+        return;
+    }
+
+    // Deinitialize removes the tap and flushes the stage before the analyzer goes
+    FVisemeAnalyzer* Analyzer = VisemeAnalyzer.Get();
+    TtsAudioStage->SetPcmTap([Analyzer](TArrayView<const float> Samples)
+    {
+        Analyzer->PushPcmFloat(TArray<float>(Samples));
+    });
+}
+
+USoundWave* UAiBridgeWebSocketSubsystem::GetTtsSound()
+{
+    if (TtsSound == nullptr)
+    {
+        TtsSound = NewObject<UAiBridgeTtsSoundWave>(this);
+        TtsSound->SetStage(TtsAudioStage);
+    }
+
+    bDecodeTtsAudio = true;
+    return TtsSound;
+}
+
+void UAiBridgeWebSocketSubsystem::BeginTtsAudioStream()
+{
+    StartTtsAudioStream(TtsOutputFormat);
+}
+
+void UAiBridgeWebSocketSubsystem::StartTtsAudioStream(const FString& Format)
+{
+    FString Codec;
+    int32 SampleRate = 0;
+    if (AiBridgeAudio::ParseOutputFormat(Format, Codec, SampleRate) && Codec == TEXT("pcm"))
+    {
+        LipSyncSampleRate = SampleRate;
+    }
+
+    PlayingTtsFormat = Format;
+    TtsAudioStage->BeginStream(Format);
+
+    if (UAiBridgeReplicationSubsystem* Replication = GetReplication())
+    {
+        Replication->BeginDialogue(ReplicatedSpeaker.Get(), Format);
+    }
+}
+
+void UAiBridgeWebSocketSubsystem::UpdateTtsFormat()
+{
+    if (!GetDefault<UAiBridgeSettings>()->bAdaptiveTtsFormat || WebSocket == nullptr)
+    {
+        return;
+    }
+
+    // Only what this client can play: decoded audio needs a decoder for the codec, and without decoding
+    // OnBinaryMessage listeners and lip sync get the bytes as they come, which only works for raw pcm
+    const FAiBridgeThroughputStats Downstream = WebSocket->GetDownstreamStats();
+    const bool bChanged = TtsFormats.Update(Downstream.EstimatedKbps, [this](const FAiBridgeTtsFormat& Format)
+    {
+        FString Codec;
+        int32 SampleRate = 0;
+        if (!AiBridgeAudio::ParseOutputFormat(Format.OutputFormat, Codec, SampleRate))
         {
-            FString HealthCheckUrl = ApiBaseUrl;
-            HealthCheckUrl.RemoveFromEnd(TEXT("/"));
-            HealthCheckUrl += TEXT("/health");
+            return false;
+        }
+        return bDecodeTtsAudio ? AiBridgeAudio::HasDecoder(Format.OutputFormat) : Codec == TEXT("pcm");
+    });
 
-            if (bEnableVerboseLogging)
-            {
-                UE_LOG(LogTemp, Log, TEXT("[UnifiedWebSocket] Sending wake-up call to: %s"), *HealthCheckUrl);
-            }
+    const FAiBridgeTtsFormat* Format = TtsFormats.GetCurrent();
+    if (!bChanged || Format == nullptr)
+    {
+        return;
+    }
 
-            TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request =
-                FHttpModule::Get().CreateRequest();
+    TtsStreamingMode = Format->StreamingMode;
+    TtsModel = Format->Model;
+    if (Format->OutputFormat == TtsOutputFormat)
+    {
+        return;
+    }
 
-            Request->SetURL(HealthCheckUrl);
-            Request->SetVerb(TEXT("GET"));
-            Request->SetTimeout(10.0f);
+    UE_LOG(LogAiBridge, Log, TEXT("[Tts] Downstream at %.0f kbps, asking for %s instead of %s (%s)"),
+        Downstream.EstimatedKbps, *Format->OutputFormat, *TtsOutputFormat, *Format->StreamingMode);
 
-            Request->OnProcessRequestComplete().BindLambda(
-                [this, bEnableVerboseLogging](FHttpRequestPtr Req, FHttpResponsePtr Response, bool bWasSuccessful)
-                {
-                    if (!Response.IsValid())
-                    {
-                        UE_LOG(LogTemp, Warning, TEXT("[UnifiedWebSocket] Wake-up failed: No response"));
-                        return;
-                    }
+    // Only what the next turn asks for: the reply still playing keeps its format until this turn's audio starts
+    TtsOutputFormat = Format->OutputFormat;
+}
 
-                    int32 Code = Response->GetResponseCode();
+bool UAiBridgeWebSocketSubsystem::OwnsBridge() const
+{
+    if (GetDefault<UAiBridgeSettings>()->BridgeNetMode != EAiBridgeNetMode::ServerAuthoritative)
+    {
+        return true;
+    }
 
-                    if (bWasSuccessful || Code == 404)
-                    {
-                        if (bEnableVerboseLogging)
-                        {
-                            UE_LOG(LogTemp, Log, TEXT("[UnifiedWebSocket] Cloud Run service warmed up successfully"));
-                        }
-                    }
-                    else
-                    {
-                        UE_LOG(LogTemp, Warning, TEXT("[UnifiedWebSocket] Wake-up call failed: %d"), Code);
-                    }
-                }
-            );
+    const UWorld* World = GetGameInstance()->GetWorld();
+    return World == nullptr || World->GetNetMode() != NM_Client;
+}
 
-            Request->ProcessRequest();
-        },
-        0.1f,
-        false
-    );
+void UAiBridgeWebSocketSubsystem::SetReplicatedSpeaker(AActor* Speaker)
+{
+    ReplicatedSpeaker = Speaker;
+
+    if (UAiBridgeReplicationSubsystem* Replication = GetReplication())
+    {
+        Replication->BeginDialogue(Speaker, PlayingTtsFormat);
+    }
+}
+
+UAiBridgeReplicationSubsystem* UAiBridgeWebSocketSubsystem::GetReplication() const
+{
+    const AActor* Speaker = ReplicatedSpeaker.Get();
+    return Speaker != nullptr ? UWorld::GetSubsystem<UAiBridgeReplicationSubsystem>(Speaker->GetWorld()) : nullptr;
+}
+
+FAiBridgeVisemeFrame UAiBridgeWebSocketSubsystem::GetVisemeFrame(float PlaybackTime) const
+{
+    return VisemeAnalyzer.IsValid() ? VisemeAnalyzer->GetTrack().Sample(PlaybackTime) : FAiBridgeVisemeFrame();
+}
+
+TSharedRef<FVoiceActivityDetector, ESPMode::ThreadSafe> UAiBridgeWebSocketSubsystem::CreateVoiceUploadGate()
+{
+    TSharedRef<FVoiceActivityDetector, ESPMode::ThreadSafe> Gate = MakeShared<FVoiceActivityDetector, ESPMode::ThreadSafe>(VadSettings);
+    TSharedRef<FAiBridgeOutbox, ESPMode::ThreadSafe> GateOutbox = Outbox.ToSharedRef();
+
+    // The detector runs on the capture thread and sends straight from there, one stream from one thread keeps its order
+    Gate->OnVoicedAudio = [GateOutbox](TArrayView<const int16> Pcm, int32 SampleRate)
+    {
+        GateOutbox->SendBinary(TArray<uint8>(reinterpret_cast<const uint8*>(Pcm.GetData()), Pcm.Num() * sizeof(int16)));
+    };
+
+    if (!EndOfUtteranceMessage.IsEmpty())
+    {
+        Gate->OnEndOfUtterance = [GateOutbox, Message = EndOfUtteranceMessage]()
+        {
+            GateOutbox->SendText(CopyTemp(Message));
+        };
+    }
+
+    VoiceUploadGate = Gate;
+    return Gate;
+}
+
+FAiBridgeVadStats UAiBridgeWebSocketSubsystem::GetVadStats() const
+{
+    return VoiceUploadGate.IsValid() ? VoiceUploadGate->GetStats() : FAiBridgeVadStats();
+}
+
+void UAiBridgeWebSocketSubsystem::InitializeConnectionSequence()
+{
+    StartEndpointProbing();
+    PreFetchJwtToken();
+}
+
+void UAiBridgeWebSocketSubsystem::StartEndpointProbing() const
+{
+    // The /health wake-up doubles as the latency probe that drives endpoint selection
+    if (!Router->IsProbing())
+    {
+        Router->StartProbing(GetDefault<UAiBridgeSettings>()->ProbeInterval);
+    }
 }
 
 
@@ -415,7 +989,45 @@ void UAiBridgeWebSocketSubsystem::PreFetchJwtToken()
             CachedToken = Token;
             bJwtReady = !Token.IsEmpty();
 
-            UE_LOG(LogTemp, Log, TEXT("JWT ready. Token: %s"), *CachedToken);
+            AIBRIDGE_LOG_EVENT(Log, "auth.jwt.ready", FAiBridgeLogField::Secret(TEXT("token"), CachedToken));
         }
     );
 }
+
+static FAutoConsoleCommandWithWorld GAiBridgeEndpointsDumpCommand(
+    TEXT("AiBridge.Endpoints.Dump"),
+    TEXT("Lists configured AiBridge endpoints with their measured round trip and health"),
+    FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+    {
+        const UGameInstance* GameInstance = World != nullptr ? World->GetGameInstance() : nullptr;
+        if (const UAiBridgeWebSocketSubsystem* Subsystem = GameInstance != nullptr ? GameInstance->GetSubsystem<UAiBridgeWebSocketSubsystem>() : nullptr)
+        {
+            UE_LOG(LogAiBridge, Display, TEXT("[EndpointRouter]\n%s"), *Subsystem->GetEndpointRouter()->Describe());
+        }
+    }));
+
+static FAutoConsoleCommandWithWorld GAiBridgeRateLimitStatsCommand(
+    TEXT("AiBridge.RateLimit.Stats"),
+    TEXT("Logs how many AiBridge turns were sent, held back, refused and coalesced by the client-side rate limiter"),
+    FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+    {
+        const UGameInstance* GameInstance = World != nullptr ? World->GetGameInstance() : nullptr;
+        if (const UAiBridgeWebSocketSubsystem* Subsystem = GameInstance != nullptr ? GameInstance->GetSubsystem<UAiBridgeWebSocketSubsystem>() : nullptr)
+        {
+            const FAiBridgeRateLimiterStats Stats = Subsystem->GetRateLimiterStats();
+            UE_LOG(LogAiBridge, Display, TEXT("[RateLimit] %lld admitted, %lld throttled, %lld rejected, %lld coalesced, %d queued, longest wait %.0f ms"),
+                Stats.Admitted, Stats.Throttled, Stats.Rejected, Stats.Coalesced, Stats.Queued, Stats.MaxWaitMs);
+        }
+    }));
+
+static FAutoConsoleCommandWithWorld GAiBridgeEndpointsProbeCommand(
+    TEXT("AiBridge.Endpoints.Probe"),
+    TEXT("Probes every AiBridge endpoint's /health now"),
+    FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+    {
+        const UGameInstance* GameInstance = World != nullptr ? World->GetGameInstance() : nullptr;
+        if (const UAiBridgeWebSocketSubsystem* Subsystem = GameInstance != nullptr ? GameInstance->GetSubsystem<UAiBridgeWebSocketSubsystem>() : nullptr)
+        {
+            Subsystem->GetEndpointRouter()->ProbeAll();
+        }
+    }));
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CoreMinimal.h"
+#include "Async/Async.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+#include "WebSocket/WebSocketConnection.h"
+#include <atomic>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace AiBridgeIoThreadTests
+{
+	/** How long the game thread stays blocked, split into windows that must each see traffic */
+	constexpr int32 NumWindows = 10;
+	constexpr double WindowSeconds = 0.1;
+
+	/** A 20 ms audio frame every 10 ms, twice the rate of live capture */
+	constexpr int32 FrameBytes = 640;
+	constexpr float FramePeriodSeconds = 0.01f;
+
+	/** Spins the calling thread until Condition holds or Seconds pass, nothing is ticked meanwhile */
+	template <typename ConditionType>
+	bool WaitFor(double Seconds, ConditionType&& Condition)
+	{
+		const double Deadline = FPlatformTime::Seconds() + Seconds;
+		while (!Condition())
+		{
+			if (FPlatformTime::Seconds() > Deadline)
+			{
+				return false;
+			}
+			FPlatformProcess::Sleep(0.001f);
+		}
+		return true;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAiBridgeStalledGameThreadTest, "AiBridge.WebSocket.StalledGameThread",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAiBridgeStalledGameThreadTest::RunTest(const FString& Parameters)
+{
+	using namespace AiBridgeIoThreadTests;
+
+	UWebSocketConnection* Connection = NewObject<UWebSocketConnection>(GetTransientPackage());
+	Connection->HeartbeatInterval = 0.0f;
+	TSharedRef<FAiBridgeOutbox, ESPMode::ThreadSafe> Outbox = Connection->GetOutbox();
+
+	// The game thread is never ticked from here on, the I/O thread has to connect the transport by itself
+	Connection->Connect(TEXT("loopback://stall"), TEXT("StalledGameThreadTest"), FString(), [](bool) {});
+	if (!TestTrue(TEXT("Connected without the game thread"), WaitFor(5.0, [&Outbox]() { return Outbox->IsLinkUp(); })))
+	{
+		Connection->Disconnect();
+		return false;
+	}
+
+	const FAiBridgeIoStats Before = Connection->GetIoStats();
+	const double StallEnd = FPlatformTime::Seconds() + NumWindows * WindowSeconds;
+
+	std::atomic<int32> NumProduced{0};
+	TFuture<void> Producer = Async(EAsyncExecution::Thread, [Outbox, StallEnd, &NumProduced]()
+	{
+		while (FPlatformTime::Seconds() < StallEnd)
+		{
+			TArray<uint8> Frame;
+			Frame.SetNumZeroed(FrameBytes);
+			if (Outbox->SendBinary(MoveTemp(Frame)))
+			{
+				++NumProduced;
+			}
+			FPlatformProcess::Sleep(FramePeriodSeconds);
+		}
+	});
+
+	// Stalled: every window must see frames written and echoed back, none may wait for a tick
+	int32 NumSilentWindows = 0;
+	FAiBridgeIoStats Last = Before;
+	for (int32 Window = 0; Window < NumWindows - 1; ++Window)
+	{
+		FPlatformProcess::Sleep(WindowSeconds);
+
+		const FAiBridgeIoStats Stats = Connection->GetIoStats();
+		if (Stats.FramesSent == Last.FramesSent || Stats.FramesReceived == Last.FramesReceived)
+		{
+			++NumSilentWindows;
+		}
+		Last = Stats;
+	}
+
+	Producer.Wait();
+	WaitFor(1.0, [Connection, &Before, &NumProduced]()
+	{
+		return Connection->GetIoStats().FramesReceived - Before.FramesReceived >= (uint64)NumProduced.load();
+	});
+
+	const FAiBridgeIoStats After = Connection->GetIoStats();
+	TestTrue(TEXT("Frames produced"), NumProduced.load() > 0);
+	TestEqual(TEXT("Windows without traffic while the game thread was stalled"), NumSilentWindows, 0);
+	TestEqual(TEXT("Frames written while the game thread was stalled"), (int32)(After.FramesSent - Before.FramesSent), NumProduced.load());
+	TestEqual(TEXT("Frames echoed while the game thread was stalled"), (int32)(After.FramesReceived - Before.FramesReceived), NumProduced.load());
+	TestEqual(TEXT("Frames left in the outbox"), After.OutboundQueued, 0);
+
+	// The echoes are received, it is only their dispatch that waits for the game thread
+	TestTrue(TEXT("Echoes queued for the game thread"), After.InboundQueued >= NumProduced.load());
+
+	Connection->Disconnect();
+	return true;
+}
+
+#endif
@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "Misc/AutomationTest.h"
+#include "Transport/LoopbackWebSocket.h"
+#include "Transport/NetworkConditionWebSocket.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace AiBridgeNetworkConditionTests
+{
+	/** How often the test ticks the transports, the resolution of every timing it measures */
+	constexpr float TickSeconds = 0.002f;
+
+	/** Scheduling slack allowed below a delay the shim must impose */
+	constexpr double ToleranceSeconds = 0.01;
+
+	/** The shim over a loopback echo server, both ticked by the test alone */
+	struct FHarness
+	{
+		FTSTicker Ticker;
+		TSharedRef<FLoopbackWebSocket> Loopback;
+		TSharedRef<FNetworkConditionWebSocket> Shim;
+
+		bool bConnected = false;
+		int32 NumClosed = 0;
+		int32 LastCloseCode = 0;
+		bool bLastCloseClean = true;
+		TArray<FString> Texts;
+		int32 BinaryBytes = 0;
+		int32 NumBinary = 0;
+
+		explicit FHarness(const FNetworkConditions& Conditions)
+			: Loopback(MakeShared<FLoopbackWebSocket>(Ticker))
+			, Shim(MakeShared<FNetworkConditionWebSocket>(Loopback, Ticker))
+		{
+			Shim->SetConditionsOverride(Conditions);
+			Shim->OnConnected().AddLambda([this]() { bConnected = true; });
+			Shim->OnClosed().AddLambda([this](int32 StatusCode, const FString& Reason, bool bWasClean)
+			{
+				++NumClosed;
+				LastCloseCode = StatusCode;
+				bLastCloseClean = bWasClean;
+			});
+			Shim->OnMessage().AddLambda([this](const FString& Message) { Texts.Add(Message); });
+			Shim->OnBinaryMessage().AddLambda([this](const void* Data, SIZE_T Size, bool bIsLastFragment)
+			{
+				++NumBinary;
+				BinaryBytes += (int32)Size;
+			});
+		}
+
+		/** Ticks in real time until Condition holds or Seconds pass, returns the seconds it took or a negative on timeout */
+		template <typename ConditionType>
+		double TickUntil(double Seconds, ConditionType&& Condition)
+		{
+			const double Start = FPlatformTime::Seconds();
+			while (!Condition())
+			{
+				if (FPlatformTime::Seconds() - Start > Seconds)
+				{
+					return -1.0;
+				}
+				FPlatformProcess::Sleep(TickSeconds);
+				Ticker.Tick(TickSeconds);
+			}
+			return FPlatformTime::Seconds() - Start;
+		}
+
+		bool Connect()
+		{
+			Shim->Connect();
+			return TickUntil(5.0, [this]() { return bConnected; }) >= 0.0;
+		}
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAiBridgeNetSimLatencyTest, "AiBridge.NetSim.Latency",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAiBridgeNetSimLatencyTest::RunTest(const FString& Parameters)
+{
+	using namespace AiBridgeNetworkConditionTests;
+
+	FNetworkConditions Conditions;
+	Conditions.LatencyMs = 100.0f;
+	FHarness Harness(Conditions);
+
+	// The server's answer to the handshake crosses the impaired link
+	const double Start = FPlatformTime::Seconds();
+	if (!TestTrue(TEXT("Connected"), Harness.Connect()))
+	{
+		return false;
+	}
+	TestTrue(TEXT("Handshake was delayed"), FPlatformTime::Seconds() - Start >= 0.1 - ToleranceSeconds);
+
+	// Out to the echo server and back, latency applies in each direction
+	Harness.Shim->Send(TEXT("hello"));
+	const double EchoSeconds = Harness.TickUntil(5.0, [&Harness]() { return Harness.Texts.Num() > 0; });
+	TestTrue(TEXT("Echo arrived"), EchoSeconds >= 0.0);
+	TestTrue(TEXT("Echo took a round trip"), EchoSeconds >= 0.2 - ToleranceSeconds);
+	TestTrue(TEXT("Echo was not held much longer than a round trip"), EchoSeconds < 1.0);
+	TestEqual(TEXT("Echo"), Harness.Texts.Num() > 0 ? Harness.Texts[0] : FString(), FString(TEXT("hello")));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAiBridgeNetSimBandwidthTest, "AiBridge.NetSim.Bandwidth",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAiBridgeNetSimBandwidthTest::RunTest(const FString& Parameters)
+{
+	using namespace AiBridgeNetworkConditionTests;
+
+	// 10 KB/s each way
+	FNetworkConditions Conditions;
+	Conditions.BandwidthKbps = 80.0f;
+	FHarness Harness(Conditions);
+
+	if (!TestTrue(TEXT("Connected"), Harness.Connect()))
+	{
+		return false;
+	}
+
+	constexpr int32 NumFrames = 8;
+	constexpr int32 FrameBytes = 500;
+	TArray<uint8> Frame;
+	Frame.SetNumZeroed(FrameBytes);
+	for (int32 Index = 0; Index < NumFrames; ++Index)
+	{
+		Harness.Shim->Send(Frame.GetData(), Frame.Num(), true);
+	}
+
+	// 4000 bytes need 0.4 s on the way out, the last frame 0.05 s more on the way back
+	const double Seconds = Harness.TickUntil(5.0, [&Harness]() { return Harness.NumBinary == NumFrames; });
+	TestTrue(TEXT("Every frame echoed"), Seconds >= 0.0);
+	TestEqual(TEXT("Bytes echoed"), Harness.BinaryBytes, NumFrames * FrameBytes);
+	TestTrue(TEXT("Frames were held to the bandwidth cap"), Seconds >= 0.45 - ToleranceSeconds);
+	TestTrue(TEXT("Frames were not held much longer than the cap needs"), Seconds < 2.0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAiBridgeNetSimDisconnectTest, "AiBridge.NetSim.Disconnect",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAiBridgeNetSimDisconnectTest::RunTest(const FString& Parameters)
+{
+	using namespace AiBridgeNetworkConditionTests;
+
+	FNetworkConditions Conditions;
+	Conditions.LatencyMs = 50.0f;
+	FHarness Harness(Conditions);
+
+	if (!TestTrue(TEXT("Connected"), Harness.Connect()))
+	{
+		return false;
+	}
+
+	// In flight when the link goes, it must be lost with it
+	Harness.Shim->Send(TEXT("lost"));
+
+	// Asked for twice, as the console command and a random drop might, from a thread that does not tick the shim
+	Harness.Shim->RequestDisconnect();
+	Harness.Shim->RequestDisconnect();
+	Harness.Ticker.Tick(TickSeconds);
+
+	TestEqual(TEXT("Closes reported"), Harness.NumClosed, 1);
+	TestEqual(TEXT("Close code"), Harness.LastCloseCode, 1006);
+	TestFalse(TEXT("Close was clean"), Harness.bLastCloseClean);
+	TestFalse(TEXT("Connected after the drop"), Harness.Shim->IsConnected());
+	TestEqual(TEXT("Frames in flight after the drop"), Harness.Shim->GetNumInFlight(), 0);
+
+	// Neither the inner socket's own close nor the lost frame may surface later
+	Harness.Shim->RequestDisconnect();
+	Harness.Shim->Send(TEXT("after"));
+	Harness.TickUntil(0.2, []() { return false; });
+	TestEqual(TEXT("Closes reported once the link settled"), Harness.NumClosed, 1);
+	TestEqual(TEXT("Messages received after the drop"), Harness.Texts.Num(), 0);
+
+	// Reconnecting brings the link back
+	Harness.bConnected = false;
+	TestTrue(TEXT("Reconnected"), Harness.Connect());
+	TestTrue(TEXT("Connected after reconnecting"), Harness.Shim->IsConnected());
+
+	return true;
+}
+
+#endif
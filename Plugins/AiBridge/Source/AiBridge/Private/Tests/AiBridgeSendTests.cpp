@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CoreMinimal.h"
+#include "Algo/AllOf.h"
+#include "Async/Async.h"
+#include "Misc/AutomationTest.h"
+#include "Transport/TransportWebSocketBase.h"
+#include "UObject/Package.h"
+#include "WebSocket/WebSocketConnection.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace AiBridgeSendTests
+{
+	constexpr int32 NumSenders = 8;
+	constexpr int32 FramesPerSender = 2000;
+
+	/** Socket stand-in that records the sender and sequence number of every "sender:seq" text frame */
+	class FRecordingWebSocket : public FTransportWebSocketBase
+	{
+	public:
+		virtual void Connect() override {}
+		virtual void Close(int32 Code, const FString& Reason) override {}
+		virtual bool IsConnected() override { return true; }
+		virtual void Send(const void* Data, SIZE_T Size, bool bIsBinary) override {}
+
+		virtual void Send(const FString& Data) override
+		{
+			FString Sender;
+			FString Seq;
+			Data.Split(TEXT(":"), &Sender, &Seq);
+			Written.Emplace(FCString::Atoi(*Sender), FCString::Atoi(*Seq));
+		}
+
+		TArray<TPair<int32, int32>> Written;
+	};
+
+	/** Runs NumSenders threads calling SendText on Connection, each with its own ordered stream */
+	TArray<TFuture<void>> StartSenders(UWebSocketConnection* Connection)
+	{
+		TArray<TFuture<void>> Senders;
+		for (int32 Sender = 0; Sender < NumSenders; ++Sender)
+		{
+			Senders.Add(Async(EAsyncExecution::Thread, [Connection, Sender]()
+			{
+				for (int32 Seq = 0; Seq < FramesPerSender; ++Seq)
+				{
+					Connection->SendText(FString::Printf(TEXT("%d:%d"), Sender, Seq));
+				}
+			}));
+		}
+		return Senders;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAiBridgeConcurrentSendersTest, "AiBridge.WebSocket.ConcurrentSenders",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAiBridgeConcurrentSendersTest::RunTest(const FString& Parameters)
+{
+	using namespace AiBridgeSendTests;
+
+	UWebSocketConnection* Connection = NewObject<UWebSocketConnection>(GetTransientPackage());
+	TSharedRef<FAiBridgeOutbox, ESPMode::ThreadSafe> Outbox = Connection->GetOutbox();
+	FRecordingWebSocket Recorder;
+
+	// Link down: no sender may queue anything
+	{
+		TArray<TFuture<void>> Senders = StartSenders(Connection);
+		for (TFuture<void>& Sender : Senders)
+		{
+			Sender.Wait();
+		}
+		TestEqual(TEXT("Frames queued while the link is down"), Outbox->GetNumQueued(), 0);
+	}
+
+	// Link up, as the I/O thread marks it on connect. The connection never connected and has no I/O thread,
+	// so the test thread stands in for it and flushes while the senders run
+	Outbox->SetLinkUp(true);
+	{
+		TArray<TFuture<void>> Senders = StartSenders(Connection);
+		while (!Algo::AllOf(Senders, [](const TFuture<void>& Sender) { return Sender.IsReady(); }))
+		{
+			Outbox->Flush(&Recorder);
+			FPlatformProcess::Sleep(0.001f);
+		}
+		Outbox->Flush(&Recorder);
+	}
+	Outbox->SetLinkUp(false);
+
+	TestEqual(TEXT("Frames written"), Recorder.Written.Num(), NumSenders * FramesPerSender);
+	TestEqual(TEXT("Frames left queued"), Outbox->GetNumQueued(), 0);
+
+	TArray<int32> NextSeq;
+	NextSeq.SetNumZeroed(NumSenders);
+	int32 NumOutOfOrder = 0;
+	for (const TPair<int32, int32>& Frame : Recorder.Written)
+	{
+		if (!NextSeq.IsValidIndex(Frame.Key) || Frame.Value != NextSeq[Frame.Key])
+		{
+			++NumOutOfOrder;
+			continue;
+		}
+		++NextSeq[Frame.Key];
+	}
+	TestEqual(TEXT("Frames out of order or duplicated"), NumOutOfOrder, 0);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,794 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Tokenizer/BpeTokenizer.h"
+#include "Logging/AiBridgeLog.h"
+#include "Memory/AiBridgeMemory.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Hash/xxhash.h"
+#include "Misc/Base64.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+#include "Settings/AiBridgeSettings.h"
+
+namespace BpeTokenizer
+{
+	constexpr uint32 Magic = 0x4B544241; // "ABTK"
+	constexpr uint32 Version = 1;
+
+	struct FHeader
+	{
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		uint32 PreTokenizer = 0;
+		uint32 NumRanks = 0;
+		uint32 TableSize = 0;
+		uint32 TableOffset = 0;
+		uint32 RankOffsetsOffset = 0;
+		uint32 BytesOffset = 0;
+	};
+	static_assert(sizeof(FHeader) == 32, "The header is part of the file format");
+
+	/** Pieces up to this many UTF-8 bytes are converted and merged without touching the heap */
+	constexpr int32 InlinePieceBytes = 256;
+
+	enum EClass : uint8
+	{
+		Letter = 1 << 0,
+		Upper = 1 << 1,
+		Lower = 1 << 2,
+		Mark = 1 << 3,
+		Number = 1 << 4,
+		Space = 1 << 5,
+	};
+
+	const uint8* GetAsciiClasses()
+	{
+		static const struct FAsciiClasses
+		{
+			uint8 Table[128] = {};
+
+			FAsciiClasses()
+			{
+				for (int32 Char = 'a'; Char <= 'z'; ++Char)
+				{
+					Table[Char] = Letter | Lower;
+					Table[Char - 'a' + 'A'] = Letter | Upper;
+				}
+				for (int32 Char = '0'; Char <= '9'; ++Char)
+				{
+					Table[Char] = Number;
+				}
+				for (const char Char : { ' ', '\t', '\n', '\v', '\f', '\r' })
+				{
+					Table[(int32)Char] = Space;
+				}
+			}
+		} Classes;
+		return Classes.Table;
+	}
+
+	/** Code point at Index, returns how many code units it takes */
+	FORCEINLINE int32 DecodeChar(const TCHAR* Chars, int32 Length, int32 Index, uint32& OutCodePoint)
+	{
+		const uint32 Unit = (uint32)Chars[Index];
+		if (sizeof(TCHAR) == 2 && Unit >= 0xD800 && Unit < 0xDC00 && Index + 1 < Length)
+		{
+			const uint32 Low = (uint32)Chars[Index + 1];
+			if (Low >= 0xDC00 && Low < 0xE000)
+			{
+				OutCodePoint = 0x10000 + ((Unit - 0xD800) << 10) + (Low - 0xDC00);
+				return 2;
+			}
+		}
+		OutCodePoint = Unit;
+		return 1;
+	}
+
+	/**
+	 * Unicode category flags the tiktoken regexes test for. Exact for ASCII; elsewhere the platform's
+	 * character classification stands in for the Unicode tables, which only moves piece boundaries.
+	 */
+	FORCEINLINE uint8 ClassAt(const TCHAR* Chars, int32 Length, int32 Index, int32& OutWidth)
+	{
+		uint32 CodePoint;
+		OutWidth = DecodeChar(Chars, Length, Index, CodePoint);
+		if (CodePoint < 128)
+		{
+			return GetAsciiClasses()[CodePoint];
+		}
+		if (CodePoint >= 0x300 && CodePoint < 0x370)
+		{
+			return Mark;
+		}
+		if (CodePoint > 0xFFFF)
+		{
+			// Emoji and pictographs are symbols, the rest of the supplementary planes is mostly ideographs
+			return CodePoint >= 0x1F000 && CodePoint < 0x20000 ? 0 : Letter;
+		}
+
+		const TCHAR Char = (TCHAR)CodePoint;
+		if (FChar::IsWhitespace(Char))
+		{
+			return Space;
+		}
+		if (FChar::IsDigit(Char))
+		{
+			return Number;
+		}
+		if (FChar::IsAlpha(Char))
+		{
+			return Letter | (FChar::IsUpper(Char) ? Upper : 0) | (FChar::IsLower(Char) ? Lower : 0);
+		}
+		return 0;
+	}
+
+	// o200k splits words at case changes: [\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]*[\p{Ll}\p{Lm}\p{Lo}\p{M}]+
+	FORCEINLINE bool IsUpperClass(uint8 Class) { return (Class & Mark) || ((Class & Letter) && !(Class & Lower)); }
+	FORCEINLINE bool IsLowerClass(uint8 Class) { return (Class & Mark) || ((Class & Letter) && !(Class & Upper)); }
+	FORCEINLINE bool IsPunctuation(uint8 Class) { return !(Class & (Space | Letter | Number)); }
+	FORCEINLINE bool IsLineBreak(TCHAR Char) { return Char == TEXT('\r') || Char == TEXT('\n'); }
+
+	/** Length of an English contraction ('s 't 're 've 'm 'll 'd, any case) at Index */
+	int32 MatchContraction(const TCHAR* Chars, int32 Length, int32 Index)
+	{
+		if (Index + 1 >= Length || Chars[Index] != TEXT('\''))
+		{
+			return 0;
+		}
+
+		const TCHAR First = FChar::ToLower(Chars[Index + 1]);
+		if (First == TEXT('s') || First == TEXT('t') || First == TEXT('m') || First == TEXT('d'))
+		{
+			return 2;
+		}
+		if (Index + 2 < Length)
+		{
+			const TCHAR Second = FChar::ToLower(Chars[Index + 2]);
+			if ((First == TEXT('r') && Second == TEXT('e')) || (First == TEXT('v') && Second == TEXT('e')) || (First == TEXT('l') && Second == TEXT('l')))
+			{
+				return 3;
+			}
+		}
+		return 0;
+	}
+
+	/** o200k word: optional uppercase run, then a lowercase run, or an uppercase-only word, then a contraction */
+	int32 MatchCasedWord(const TCHAR* Chars, int32 Length, int32 Start)
+	{
+		int32 Width = 0;
+		int32 UpperEnd = Start;
+		int32 LastBoth = INDEX_NONE;
+		int32 LastBothWidth = 0;
+		while (UpperEnd < Length)
+		{
+			const uint8 Class = ClassAt(Chars, Length, UpperEnd, Width);
+			if (!IsUpperClass(Class))
+			{
+				break;
+			}
+			if (IsLowerClass(Class))
+			{
+				LastBoth = UpperEnd;
+				LastBothWidth = Width;
+			}
+			UpperEnd += Width;
+		}
+
+		int32 LowerEnd = UpperEnd;
+		while (LowerEnd < Length && IsLowerClass(ClassAt(Chars, Length, LowerEnd, Width)))
+		{
+			LowerEnd += Width;
+		}
+
+		int32 End = UpperEnd;
+		if (LowerEnd > UpperEnd)
+		{
+			End = LowerEnd;
+		}
+		else if (LastBoth != INDEX_NONE)
+		{
+			// The lowercase run may not be empty, so the regex backtracks to the last character in both classes
+			End = LastBoth + LastBothWidth;
+		}
+		return End + MatchContraction(Chars, Length, End);
+	}
+
+	/**
+	 * End of the piece starting at Index. A hand-written equivalent of the encoding's split regex, e.g. o200k:
+	 * [^\r\n\p{L}\p{N}]?<cased word>(contraction)? | \p{N}{1,3} | ' '?[^\s\p{L}\p{N}]+[\r\n/]* | \s*[\r\n]+ | \s+(?!\S) | \s+
+	 */
+	int32 NextPiece(const TCHAR* Chars, int32 Length, int32 Index, EBpePreTokenizer PreTokenizer)
+	{
+		const bool bO200k = PreTokenizer == EBpePreTokenizer::O200k;
+		const uint8 WordClasses = bO200k ? (Letter | Mark) : Letter;
+
+		if (!bO200k)
+		{
+			if (const int32 Contraction = MatchContraction(Chars, Length, Index))
+			{
+				return Index + Contraction;
+			}
+		}
+
+		int32 Width = 0;
+		const uint8 FirstClass = ClassAt(Chars, Length, Index, Width);
+		const int32 FirstWidth = Width;
+
+		// A word, which may take one leading character that is not a letter, digit or line break
+		int32 WordStart = Index;
+		uint8 WordClass = FirstClass;
+		if (!(FirstClass & (WordClasses | Number)) && !IsLineBreak(Chars[Index]) && Index + Width < Length)
+		{
+			int32 NextWidth = 0;
+			const uint8 NextClass = ClassAt(Chars, Length, Index + Width, NextWidth);
+			if (NextClass & WordClasses)
+			{
+				WordStart = Index + Width;
+				WordClass = NextClass;
+			}
+		}
+		if (WordClass & WordClasses)
+		{
+			if (bO200k)
+			{
+				return MatchCasedWord(Chars, Length, WordStart);
+			}
+
+			int32 End = WordStart;
+			while (End < Length && (ClassAt(Chars, Length, End, Width) & Letter))
+			{
+				End += Width;
+			}
+			return End;
+		}
+
+		// Up to three digits
+		if (FirstClass & Number)
+		{
+			int32 End = Index;
+			for (int32 Digit = 0; Digit < 3 && End < Length && (ClassAt(Chars, Length, End, Width) & Number); ++Digit)
+			{
+				End += Width;
+			}
+			return End;
+		}
+
+		// Punctuation, optionally after a space, with the line breaks that follow it
+		int32 End = Chars[Index] == TEXT(' ') ? Index + 1 : Index;
+		if (End < Length && IsPunctuation(ClassAt(Chars, Length, End, Width)))
+		{
+			do
+			{
+				End += Width;
+			}
+			while (End < Length && IsPunctuation(ClassAt(Chars, Length, End, Width)));
+
+			while (End < Length && (IsLineBreak(Chars[End]) || (bO200k && Chars[End] == TEXT('/'))))
+			{
+				++End;
+			}
+			return End;
+		}
+
+		if (FirstClass & Space)
+		{
+			End = Index;
+			int32 LastLineBreak = INDEX_NONE;
+			while (End < Length && (ClassAt(Chars, Length, End, Width) & Space))
+			{
+				LastLineBreak = IsLineBreak(Chars[End]) ? End : LastLineBreak;
+				End += Width;
+			}
+
+			// cl100k keeps trailing whitespace in one piece, line breaks and all
+			if (!bO200k && End == Length)
+			{
+				return End;
+			}
+			if (LastLineBreak != INDEX_NONE)
+			{
+				return LastLineBreak + 1;
+			}
+			// The last space of a run goes with the word after it
+			return End < Length && End - Index > 1 ? End - 1 : End;
+		}
+
+		return Index + FirstWidth;
+	}
+
+	/** Calls Visit(Bytes, Length) with the UTF-8 of every piece of Text */
+	template <typename VisitType>
+	void ForEachPiece(FStringView Text, EBpePreTokenizer PreTokenizer, VisitType&& Visit)
+	{
+		TArray<uint8, TInlineAllocator<InlinePieceBytes>> Utf8;
+		const TCHAR* Chars = Text.GetData();
+		const int32 Length = Text.Len();
+
+		for (int32 Start = 0; Start < Length;)
+		{
+			const int32 End = NextPiece(Chars, Length, Start, PreTokenizer);
+
+			Utf8.Reset();
+			for (int32 Index = Start; Index < End;)
+			{
+				uint32 CodePoint;
+				Index += DecodeChar(Chars, Length, Index, CodePoint);
+				if (CodePoint >= 0xD800 && CodePoint < 0xE000)
+				{
+					// Unpaired surrogate
+					CodePoint = 0xFFFD;
+				}
+
+				if (CodePoint < 0x80)
+				{
+					Utf8.Add((uint8)CodePoint);
+				}
+				else if (CodePoint < 0x800)
+				{
+					Utf8.Add((uint8)(0xC0 | (CodePoint >> 6)));
+					Utf8.Add((uint8)(0x80 | (CodePoint & 0x3F)));
+				}
+				else if (CodePoint < 0x10000)
+				{
+					Utf8.Add((uint8)(0xE0 | (CodePoint >> 12)));
+					Utf8.Add((uint8)(0x80 | ((CodePoint >> 6) & 0x3F)));
+					Utf8.Add((uint8)(0x80 | (CodePoint & 0x3F)));
+				}
+				else
+				{
+					Utf8.Add((uint8)(0xF0 | (CodePoint >> 18)));
+					Utf8.Add((uint8)(0x80 | ((CodePoint >> 12) & 0x3F)));
+					Utf8.Add((uint8)(0x80 | ((CodePoint >> 6) & 0x3F)));
+					Utf8.Add((uint8)(0x80 | (CodePoint & 0x3F)));
+				}
+			}
+
+			Visit(Utf8.GetData(), Utf8.Num());
+			Start = End;
+		}
+	}
+
+	/** Without a table: one token per piece, plus one per five bytes past the eighth */
+	FORCEINLINE int32 EstimatePiece(int32 Length)
+	{
+		return 1 + FMath::Max(0, Length - 8) / 5;
+	}
+
+	FString GetTablePath(const FString& Encoding)
+	{
+		const FString& Directory = GetDefault<UAiBridgeSettings>()->TokenizerDirectory;
+		const FString Resolved = FPaths::IsRelative(Directory) ? FPaths::Combine(FPaths::ProjectDir(), Directory) : Directory;
+		return FPaths::Combine(Resolved, Encoding + TEXT(".abtok"));
+	}
+
+	/** Tokenizers by encoding name, shared by every request builder */
+	FCriticalSection CacheLock;
+
+	TMap<FString, TSharedRef<FBpeTokenizer, ESPMode::ThreadSafe>>& GetCache()
+	{
+		static TMap<FString, TSharedRef<FBpeTokenizer, ESPMode::ThreadSafe>> Cache;
+		return Cache;
+	}
+}
+
+FString AiBridgeTokenizer::GetEncodingForModel(const FString& Model)
+{
+	const FString Lower = Model.ToLower();
+
+	// gpt-4o has to be tested before the gpt-4 prefix
+	static const TCHAR* const O200kPrefixes[] = { TEXT("gpt-4o"), TEXT("chatgpt-4o"), TEXT("gpt-4.1"), TEXT("gpt-4.5"), TEXT("gpt-5"), TEXT("o1"), TEXT("o3"), TEXT("o4") };
+	for (const TCHAR* Prefix : O200kPrefixes)
+	{
+		if (Lower.StartsWith(Prefix))
+		{
+			return TEXT("o200k_base");
+		}
+	}
+
+	static const TCHAR* const Cl100kPrefixes[] = { TEXT("gpt-4"), TEXT("gpt-3.5"), TEXT("text-embedding-") };
+	for (const TCHAR* Prefix : Cl100kPrefixes)
+	{
+		if (Lower.StartsWith(Prefix))
+		{
+			return TEXT("cl100k_base");
+		}
+	}
+
+	// Providers other than OpenAI publish no tokenizer, the current OpenAI encoding is the closest estimate
+	return TEXT("o200k_base");
+}
+
+EBpePreTokenizer AiBridgeTokenizer::GetPreTokenizer(const FString& Encoding)
+{
+	return Encoding.StartsWith(TEXT("cl100k")) ? EBpePreTokenizer::Cl100k : EBpePreTokenizer::O200k;
+}
+
+bool FBpeTokenizer::Compile(const TArray<TArray<uint8>>& Tokens, EBpePreTokenizer PreTokenizer, const FString& Path)
+{
+	const uint32 RankCount = Tokens.Num();
+	// At most half full, so probes stay short
+	const uint32 TableSize = FMath::RoundUpToPowerOfTwo(FMath::Max(RankCount * 2, 16u));
+
+	uint32 NumBytes = 0;
+	for (const TArray<uint8>& Token : Tokens)
+	{
+		NumBytes += Token.Num();
+	}
+
+	BpeTokenizer::FHeader Header;
+	Header.Magic = BpeTokenizer::Magic;
+	Header.Version = BpeTokenizer::Version;
+	Header.PreTokenizer = (uint32)PreTokenizer;
+	Header.NumRanks = RankCount;
+	Header.TableSize = TableSize;
+	Header.TableOffset = sizeof(Header);
+	Header.RankOffsetsOffset = Header.TableOffset + TableSize * sizeof(FEntry);
+	Header.BytesOffset = Header.RankOffsetsOffset + (RankCount + 1) * sizeof(uint32);
+
+	TArray<uint8> File;
+	File.SetNumZeroed(Header.BytesOffset + NumBytes);
+	FMemory::Memcpy(File.GetData(), &Header, sizeof(Header));
+
+	FEntry* OutTable = reinterpret_cast<FEntry*>(File.GetData() + Header.TableOffset);
+	for (uint32 Slot = 0; Slot < TableSize; ++Slot)
+	{
+		OutTable[Slot] = { 0, MAX_uint32 };
+	}
+
+	uint32* OutOffsets = reinterpret_cast<uint32*>(File.GetData() + Header.RankOffsetsOffset);
+	uint32 Offset = 0;
+	for (uint32 Rank = 0; Rank < RankCount; ++Rank)
+	{
+		const TArray<uint8>& Token = Tokens[Rank];
+		OutOffsets[Rank] = Offset;
+		FMemory::Memcpy(File.GetData() + Header.BytesOffset + Offset, Token.GetData(), Token.Num());
+		Offset += Token.Num();
+
+		// Gaps in the rank sequence stay empty and are never looked up
+		if (Token.Num() == 0)
+		{
+			continue;
+		}
+
+		const uint64 Hash = FXxHash64::HashBuffer(Token.GetData(), Token.Num()).Hash;
+		uint32 Slot = (uint32)(Hash >> 32) & (TableSize - 1);
+		while (OutTable[Slot].Rank != MAX_uint32)
+		{
+			Slot = (Slot + 1) & (TableSize - 1);
+		}
+		OutTable[Slot] = { (uint32)Hash, Rank };
+	}
+	OutOffsets[RankCount] = Offset;
+
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*FPaths::GetPath(Path));
+	if (!FFileHelper::SaveArrayToFile(File, *Path))
+	{
+		UE_LOG(LogAiBridge, Error, TEXT("[Tokenizer] Could not write %s"), *Path);
+		return false;
+	}
+
+	UE_LOG(LogAiBridge, Log, TEXT("[Tokenizer] Compiled %s: %u ranks, %.1f KB"), *Path, RankCount, File.Num() / 1024.0);
+	return true;
+}
+
+bool FBpeTokenizer::CompileTiktoken(const FString& SourcePath, const FString& Encoding, const FString& Path)
+{
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *SourcePath))
+	{
+		UE_LOG(LogAiBridge, Error, TEXT("[Tokenizer] Could not read %s"), *SourcePath);
+		return false;
+	}
+
+	TArray<FString> Lines;
+	Text.ParseIntoArrayLines(Lines);
+
+	TArray<TArray<uint8>> Tokens;
+	for (const FString& Line : Lines)
+	{
+		FString Base64;
+		FString Rank;
+		if (!Line.Split(TEXT(" "), &Base64, &Rank) || !Rank.IsNumeric())
+		{
+			UE_LOG(LogAiBridge, Error, TEXT("[Tokenizer] %s is not a tiktoken rank file: '%s'"), *SourcePath, *Line.Left(64));
+			return false;
+		}
+
+		const int32 Index = FCString::Atoi(*Rank);
+		if (Index >= Tokens.Num())
+		{
+			Tokens.SetNum(Index + 1);
+		}
+		FBase64::Decode(Base64, Tokens[Index]);
+	}
+
+	return Compile(Tokens, AiBridgeTokenizer::GetPreTokenizer(Encoding), Path);
+}
+
+TUniquePtr<FBpeTokenizer> FBpeTokenizer::Open(const FString& Path)
+{
+	LLM_SCOPE_BYTAG(AiBridge_Tokenizer);
+
+	TUniquePtr<FBpeTokenizer> Tokenizer(new FBpeTokenizer(EBpePreTokenizer::O200k));
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	Tokenizer->MappedFile.Reset(PlatformFile.OpenMapped(*Path));
+	if (Tokenizer->MappedFile)
+	{
+		Tokenizer->MappedRegion.Reset(Tokenizer->MappedFile->MapRegion(0, Tokenizer->MappedFile->GetFileSize()));
+	}
+
+	if (Tokenizer->MappedRegion)
+	{
+		if (Tokenizer->Bind(Tokenizer->MappedRegion->GetMappedPtr(), Tokenizer->MappedRegion->GetMappedSize()))
+		{
+			return Tokenizer;
+		}
+	}
+	else if (FFileHelper::LoadFileToArray(Tokenizer->Contents, *Path, FILEREAD_Silent))
+	{
+		// No mapping on this platform
+		if (Tokenizer->Bind(Tokenizer->Contents.GetData(), Tokenizer->Contents.Num()))
+		{
+			return Tokenizer;
+		}
+	}
+
+	UE_LOG(LogAiBridge, Warning, TEXT("[Tokenizer] %s is missing or not a version %u rank table"), *Path, BpeTokenizer::Version);
+	return nullptr;
+}
+
+TSharedRef<FBpeTokenizer, ESPMode::ThreadSafe> FBpeTokenizer::ForModel(const FString& Model)
+{
+	const FString Encoding = AiBridgeTokenizer::GetEncodingForModel(Model);
+
+	FScopeLock ScopeLock(&BpeTokenizer::CacheLock);
+	TMap<FString, TSharedRef<FBpeTokenizer, ESPMode::ThreadSafe>>& Cache = BpeTokenizer::GetCache();
+	if (const TSharedRef<FBpeTokenizer, ESPMode::ThreadSafe>* Found = Cache.Find(Encoding))
+	{
+		return *Found;
+	}
+
+	TUniquePtr<FBpeTokenizer> Opened = Open(BpeTokenizer::GetTablePath(Encoding));
+	if (!Opened)
+	{
+		UE_LOG(LogAiBridge, Warning, TEXT("[Tokenizer] No %s table, token counts for %s are estimates. Compile one with AiBridge.Tokenizer.Compile"), *Encoding, *Model);
+		Opened.Reset(new FBpeTokenizer(AiBridgeTokenizer::GetPreTokenizer(Encoding)));
+	}
+
+	return Cache.Add(Encoding, TSharedRef<FBpeTokenizer, ESPMode::ThreadSafe>(Opened.Release()));
+}
+
+FBpeTokenizer::~FBpeTokenizer()
+{
+	// The region must go before the handle it was mapped from
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+bool FBpeTokenizer::Bind(const uint8* Data, int64 Size)
+{
+	BpeTokenizer::FHeader Header;
+	if (Size < (int64)sizeof(Header))
+	{
+		return false;
+	}
+	FMemory::Memcpy(&Header, Data, sizeof(Header));
+
+	if (Header.Magic != BpeTokenizer::Magic || Header.Version != BpeTokenizer::Version
+		|| !FMath::IsPowerOfTwo(Header.TableSize) || Header.NumRanks > (uint32)MAX_int32
+		|| Header.PreTokenizer > (uint32)EBpePreTokenizer::O200k)
+	{
+		return false;
+	}
+
+	// Every section must lie inside the file and be aligned for the words read from it
+	const int64 TableEnd = (int64)Header.TableOffset + (int64)Header.TableSize * (int64)sizeof(FEntry);
+	const int64 RankOffsetsEnd = (int64)Header.RankOffsetsOffset + ((int64)Header.NumRanks + 1) * (int64)sizeof(uint32);
+	if (Header.TableOffset < sizeof(Header) || TableEnd > Size
+		|| Header.RankOffsetsOffset < sizeof(Header) || RankOffsetsEnd > Size
+		|| Header.BytesOffset > Size
+		|| Header.TableOffset % alignof(FEntry) != 0 || Header.RankOffsetsOffset % alignof(uint32) != 0)
+	{
+		return false;
+	}
+
+	// Offsets must ascend within the token bytes, so every token read by Lookup is inside the file
+	const uint32* Offsets = reinterpret_cast<const uint32*>(Data + Header.RankOffsetsOffset);
+	for (uint32 Rank = 0; Rank < Header.NumRanks; ++Rank)
+	{
+		if (Offsets[Rank] > Offsets[Rank + 1])
+		{
+			return false;
+		}
+	}
+	if (Header.BytesOffset + (int64)Offsets[Header.NumRanks] > Size)
+	{
+		return false;
+	}
+
+	const FEntry* Entries = reinterpret_cast<const FEntry*>(Data + Header.TableOffset);
+	for (uint32 Slot = 0; Slot < Header.TableSize; ++Slot)
+	{
+		if (Entries[Slot].Rank != MAX_uint32 && Entries[Slot].Rank >= Header.NumRanks)
+		{
+			return false;
+		}
+	}
+
+	PreTokenizer = (EBpePreTokenizer)Header.PreTokenizer;
+	NumRanks = Header.NumRanks;
+	TableMask = Header.TableSize - 1;
+	Table = Entries;
+	RankOffsets = Offsets;
+	TokenBytes = Data + Header.BytesOffset;
+	return true;
+}
+
+uint32 FBpeTokenizer::Lookup(const uint8* Bytes, int32 Length) const
+{
+	const uint64 Hash = FXxHash64::HashBuffer(Bytes, Length).Hash;
+
+	// A table without an empty slot would probe forever, one lap is every slot there is
+	uint32 Slot = (uint32)(Hash >> 32) & TableMask;
+	for (uint32 Probe = 0; Probe <= TableMask; ++Probe, Slot = (Slot + 1) & TableMask)
+	{
+		const FEntry& Entry = Table[Slot];
+		if (Entry.Rank == MAX_uint32)
+		{
+			return MAX_uint32;
+		}
+
+		if (Entry.Hash == (uint32)Hash)
+		{
+			const uint32 Offset = RankOffsets[Entry.Rank];
+			if (RankOffsets[Entry.Rank + 1] - Offset == (uint32)Length && FMemory::Memcmp(TokenBytes + Offset, Bytes, Length) == 0)
+			{
+				return Entry.Rank;
+			}
+		}
+	}
+	return MAX_uint32;
+}
+
+template <typename EmitType>
+int32 FBpeTokenizer::MergePiece(const uint8* Bytes, int32 Length, EmitType&& Emit) const
+{
+	if (Length == 1 || Lookup(Bytes, Length) != MAX_uint32)
+	{
+		Emit(0, Length);
+		return 1;
+	}
+
+	// tiktoken's merge: repeatedly join the adjacent pair whose union has the lowest rank.
+	// Parts[Index].Rank is the rank of Parts[Index] joined with Parts[Index + 1]
+	struct FPart
+	{
+		int32 Start;
+		uint32 Rank;
+	};
+	TArray<FPart, TInlineAllocator<BpeTokenizer::InlinePieceBytes + 1>> Parts;
+	Parts.SetNumUninitialized(Length + 1);
+	for (int32 Index = 0; Index + 1 < Length; ++Index)
+	{
+		Parts[Index] = { Index, Lookup(Bytes + Index, 2) };
+	}
+	Parts[Length - 1] = { Length - 1, MAX_uint32 };
+	Parts[Length] = { Length, MAX_uint32 };
+
+	// Rank of Parts[Index] once the part after it has been merged into the next one
+	auto RankAfterMerge = [this, Bytes, &Parts](int32 Index)
+	{
+		return Index + 3 < Parts.Num()
+			? Lookup(Bytes + Parts[Index].Start, Parts[Index + 3].Start - Parts[Index].Start)
+			: MAX_uint32;
+	};
+
+	for (;;)
+	{
+		uint32 MinRank = MAX_uint32;
+		int32 MinIndex = INDEX_NONE;
+		for (int32 Index = 0; Index + 1 < Parts.Num(); ++Index)
+		{
+			if (Parts[Index].Rank < MinRank)
+			{
+				MinRank = Parts[Index].Rank;
+				MinIndex = Index;
+			}
+		}
+		if (MinIndex == INDEX_NONE)
+		{
+			break;
+		}
+
+		if (MinIndex > 0)
+		{
+			Parts[MinIndex - 1].Rank = RankAfterMerge(MinIndex - 1);
+		}
+		Parts[MinIndex].Rank = RankAfterMerge(MinIndex);
+		Parts.RemoveAt(MinIndex + 1, 1, EAllowShrinking::No);
+	}
+
+	for (int32 Index = 0; Index + 1 < Parts.Num(); ++Index)
+	{
+		Emit(Parts[Index].Start, Parts[Index + 1].Start);
+	}
+	return Parts.Num() - 1;
+}
+
+int32 FBpeTokenizer::Count(FStringView Text) const
+{
+	int32 Total = 0;
+	BpeTokenizer::ForEachPiece(Text, PreTokenizer, [this, &Total](const uint8* Bytes, int32 Length)
+	{
+		Total += NumRanks > 0 ? MergePiece(Bytes, Length, [](int32, int32) {}) : BpeTokenizer::EstimatePiece(Length);
+	});
+	return Total;
+}
+
+void FBpeTokenizer::Encode(FStringView Text, TArray<uint32>& OutTokens) const
+{
+	if (NumRanks == 0)
+	{
+		return;
+	}
+
+	BpeTokenizer::ForEachPiece(Text, PreTokenizer, [this, &OutTokens](const uint8* Bytes, int32 Length)
+	{
+		MergePiece(Bytes, Length, [this, Bytes, &OutTokens](int32 Start, int32 End)
+		{
+			OutTokens.Add(Lookup(Bytes + Start, End - Start));
+		});
+	});
+}
+
+void FBpeTokenizer::Decode(TConstArrayView<uint32> Tokens, TArray<uint8>& OutBytes) const
+{
+	for (const uint32 Token : Tokens)
+	{
+		if (Token < (uint32)NumRanks)
+		{
+			OutBytes.Append(TokenBytes + RankOffsets[Token], RankOffsets[Token + 1] - RankOffsets[Token]);
+		}
+	}
+}
+
+static FAutoConsoleCommand GAiBridgeTokenizerCompileCommand(
+	TEXT("AiBridge.Tokenizer.Compile"),
+	TEXT("Compiles a tiktoken rank file into the tokenizer directory and uses it from the next request. Usage: AiBridge.Tokenizer.Compile <o200k_base.tiktoken> [Encoding=file name]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		if (Args.Num() < 1)
+		{
+			UE_LOG(LogAiBridge, Warning, TEXT("[Tokenizer] Usage: AiBridge.Tokenizer.Compile <o200k_base.tiktoken> [Encoding=file name]"));
+			return;
+		}
+
+		const FString Encoding = Args.Num() > 1 ? Args[1] : FPaths::GetBaseFilename(Args[0]);
+		if (FBpeTokenizer::CompileTiktoken(Args[0], Encoding, BpeTokenizer::GetTablePath(Encoding)))
+		{
+			FScopeLock ScopeLock(&BpeTokenizer::CacheLock);
+			BpeTokenizer::GetCache().Remove(Encoding);
+		}
+	}));
+
+static FAutoConsoleCommand GAiBridgeTokenizerCountCommand(
+	TEXT("AiBridge.Tokenizer.Count"),
+	TEXT("Logs the tokens a sentence costs with the encoding of a model. Usage: AiBridge.Tokenizer.Count <Model> <text>"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		if (Args.Num() < 2)
+		{
+			UE_LOG(LogAiBridge, Warning, TEXT("[Tokenizer] Usage: AiBridge.Tokenizer.Count <Model> <text>"));
+			return;
+		}
+
+		const TSharedRef<FBpeTokenizer, ESPMode::ThreadSafe> Tokenizer = FBpeTokenizer::ForModel(Args[0]);
+		const FString Text = FString::Join(TArrayView<const FString>(Args).RightChop(1), TEXT(" "));
+		UE_LOG(LogAiBridge, Log, TEXT("[Tokenizer] %d tokens (%s, %s)"), Tokenizer->Count(Text),
+			*AiBridgeTokenizer::GetEncodingForModel(Args[0]), Tokenizer->IsExact() ? TEXT("exact") : TEXT("estimated"));
+	}));
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Tokenizer/PromptBudget.h"
+#include "Tokenizer/BpeTokenizer.h"
+
+namespace PromptBudget
+{
+	/** Start and end markers around every chat message */
+	constexpr int32 TokensPerMessage = 3;
+
+	/** The reply is primed with an assistant header */
+	constexpr int32 TokensPerReply = 3;
+}
+
+int32 AiBridgeTokenizer::CountMessage(const FBpeTokenizer& Tokenizer, FStringView Role, FStringView Content)
+{
+	return PromptBudget::TokensPerMessage + Tokenizer.Count(Role) + Tokenizer.Count(Content);
+}
+
+int32 AiBridgeTokenizer::TrimHistoryToBudget(const FBpeTokenizer& Tokenizer, FStringView SystemPrompt, FStringView Utterance, int32 Budget, TArray<FAiBridgeChatMessage>& History)
+{
+	int32 Total = CountMessage(Tokenizer, TEXT("system"), SystemPrompt)
+		+ CountMessage(Tokenizer, TEXT("user"), Utterance)
+		+ PromptBudget::TokensPerReply;
+
+	TArray<int32, TInlineAllocator<32>> Costs;
+	for (const FAiBridgeChatMessage& Message : History)
+	{
+		Total += Costs.Add_GetRef(CountMessage(Tokenizer, Message.Role, Message.Content));
+	}
+
+	int32 NumDropped = 0;
+	while (Budget > 0 && Total > Budget && NumDropped < History.Num())
+	{
+		Total -= Costs[NumDropped++];
+	}
+	History.RemoveAt(0, NumDropped, EAllowShrinking::No);
+
+	return Total;
+}
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Transcript/AiBridgeTranscript.h"
+
+void FAiBridgeTranscript::Append(FStringView Delta)
+{
+	if (Delta.IsEmpty())
+	{
+		return;
+	}
+
+	for (const TCHAR Char : Delta)
+	{
+		if (Char == TEXT('\r'))
+		{
+			continue;
+		}
+
+		if (Char == TEXT('\n'))
+		{
+			// A second newline in a row leaves an empty paragraph behind
+			if (bNewParagraph)
+			{
+				StartRun();
+			}
+			bRunOpen = false;
+			bNewParagraph = true;
+			continue;
+		}
+
+		const bool bWhitespace = FChar::IsWhitespace(Char);
+		if (!bRunOpen || (bAfterWhitespace && !bWhitespace))
+		{
+			StartRun();
+		}
+
+		MakeRoom();
+		Chunks.Last().Add(Char);
+		++Runs.Last().Len;
+		++NumChars;
+		bAfterWhitespace = bWhitespace;
+	}
+
+	++Version;
+}
+
+void FAiBridgeTranscript::Reset()
+{
+	Chunks.Reset();
+	Runs.Reset();
+	NumChars = 0;
+	bRunOpen = false;
+	bAfterWhitespace = false;
+	bNewParagraph = false;
+	++Generation;
+	++Version;
+}
+
+FStringView FAiBridgeTranscript::GetRunText(int32 Index) const
+{
+	const FAiBridgeTranscriptRun& Run = Runs[Index];
+	return FStringView(Chunks[Run.Chunk].GetData() + Run.Start, Run.Len);
+}
+
+FString FAiBridgeTranscript::ToString() const
+{
+	FString Text;
+	Text.Reserve(NumChars);
+	for (int32 Index = 0; Index < Runs.Num(); ++Index)
+	{
+		if (Runs[Index].bNewParagraph)
+		{
+			Text.AppendChar(TEXT('\n'));
+		}
+		Text.Append(GetRunText(Index));
+	}
+	return Text;
+}
+
+void FAiBridgeTranscript::StartRun()
+{
+	if (Chunks.Num() == 0 || Chunks.Last().Num() == ChunkChars)
+	{
+		Chunks.AddDefaulted_GetRef().Reserve(ChunkChars);
+	}
+
+	FAiBridgeTranscriptRun& Run = Runs.AddDefaulted_GetRef();
+	Run.Chunk = Chunks.Num() - 1;
+	Run.Start = Chunks.Last().Num();
+	Run.bNewParagraph = bNewParagraph;
+
+	if (bNewParagraph)
+	{
+		++NumChars;
+	}
+	bNewParagraph = false;
+	bRunOpen = true;
+	bAfterWhitespace = false;
+}
+
+void FAiBridgeTranscript::MakeRoom()
+{
+	if (Chunks.Last().Num() < ChunkChars)
+	{
+		return;
+	}
+
+	// A word as long as a chunk is split where it is, it would not fit the next one either
+	if (Runs.Last().Len >= ChunkChars)
+	{
+		StartRun();
+		return;
+	}
+
+	// Chunks are reserved once and never grow, so views of the runs before stay valid
+	const int32 Full = Chunks.Num() - 1;
+	Chunks.AddDefaulted_GetRef().Reserve(ChunkChars);
+
+	FAiBridgeTranscriptRun& Run = Runs.Last();
+	Chunks.Last().Append(Chunks[Full].GetData() + Run.Start, Run.Len);
+	Chunks[Full].SetNum(Run.Start, EAllowShrinking::No);
+	Run.Chunk = Chunks.Num() - 1;
+	Run.Start = 0;
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Transcript/AiBridgeTranscriptWidget.h"
+#include "Transcript/AiBridgeTranscript.h"
+#include "Transcript/SAiBridgeTranscript.h"
+#include "Styling/CoreStyle.h"
+
+#define LOCTEXT_NAMESPACE "AiBridge"
+
+UAiBridgeTranscriptWidget::UAiBridgeTranscriptWidget()
+	: Font(FCoreStyle::GetDefaultFontStyle("Regular", 24))
+	, ColorAndOpacity(FLinearColor::White)
+	, Transcript(MakeShared<FAiBridgeTranscript>())
+{
+}
+
+void UAiBridgeTranscriptWidget::AppendText(const FString& Delta)
+{
+	// The Slate widget picks the change up on its next tick, however many deltas came in between
+	Transcript->Append(Delta);
+}
+
+void UAiBridgeTranscriptWidget::Clear()
+{
+	Transcript->Reset();
+}
+
+FString UAiBridgeTranscriptWidget::GetText() const
+{
+	return Transcript->ToString();
+}
+
+void UAiBridgeTranscriptWidget::SynchronizeProperties()
+{
+	Super::SynchronizeProperties();
+
+	if (MyTranscript.IsValid())
+	{
+		MyTranscript->SetFont(Font);
+		MyTranscript->SetTextColor(ColorAndOpacity);
+		MyTranscript->SetAutoScroll(bAutoScroll);
+	}
+}
+
+void UAiBridgeTranscriptWidget::ReleaseSlateResources(bool bReleaseChildren)
+{
+	Super::ReleaseSlateResources(bReleaseChildren);
+	MyTranscript.Reset();
+}
+
+#if WITH_EDITOR
+const FText UAiBridgeTranscriptWidget::GetPaletteCategory()
+{
+	return LOCTEXT("AiBridgePaletteCategory", "AiBridge");
+}
+#endif
+
+TSharedRef<SWidget> UAiBridgeTranscriptWidget::RebuildWidget()
+{
+	MyTranscript = SNew(SAiBridgeTranscript)
+		.Transcript(Transcript)
+		.Font(Font)
+		.ColorAndOpacity(ColorAndOpacity)
+		.AutoScroll(bAutoScroll);
+	return MyTranscript.ToSharedRef();
+}
+
+#undef LOCTEXT_NAMESPACE
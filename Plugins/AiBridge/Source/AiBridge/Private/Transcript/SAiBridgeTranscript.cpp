@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Transcript/SAiBridgeTranscript.h"
+#include "Transcript/AiBridgeTranscript.h"
+#include "Widgets/Layout/SScrollBox.h"
+#include "Widgets/Layout/SWrapBox.h"
+#include "Widgets/Text/STextBlock.h"
+
+void SAiBridgeTranscript::Construct(const FArguments& InArgs)
+{
+	Transcript = InArgs._Transcript;
+	Font = InArgs._Font;
+	TextColor = InArgs._ColorAndOpacity;
+	bAutoScroll = InArgs._AutoScroll;
+
+	ChildSlot
+	[
+		SAssignNew(ScrollBox, SScrollBox)
+	];
+
+	Update();
+}
+
+void SAiBridgeTranscript::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
+{
+	SCompoundWidget::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
+	Update();
+}
+
+void SAiBridgeTranscript::SetTranscript(const TSharedPtr<const FAiBridgeTranscript>& InTranscript)
+{
+	if (Transcript != InTranscript)
+	{
+		Transcript = InTranscript;
+		Clear();
+	}
+}
+
+void SAiBridgeTranscript::SetFont(const FSlateFontInfo& InFont)
+{
+	if (Font != InFont)
+	{
+		Font = InFont;
+		Clear();
+	}
+}
+
+void SAiBridgeTranscript::SetTextColor(const FSlateColor& InColor)
+{
+	if (TextColor != InColor)
+	{
+		TextColor = InColor;
+		Clear();
+	}
+}
+
+void SAiBridgeTranscript::Update()
+{
+	if (!Transcript.IsValid())
+	{
+		return;
+	}
+
+	if (Transcript->GetGeneration() != BuiltGeneration)
+	{
+		Clear();
+		BuiltGeneration = Transcript->GetGeneration();
+	}
+
+	const int32 NumRuns = Transcript->NumRuns();
+	if (Transcript->GetVersion() == BuiltVersion && NumBuilt == NumRuns)
+	{
+		return;
+	}
+	BuiltVersion = Transcript->GetVersion();
+
+	// The only run laid out before that may have changed since
+	if (bLastBuiltOpen && LastBlock.IsValid())
+	{
+		LastBlock->SetText(FText::FromStringView(Transcript->GetRunText(NumBuilt - 1)));
+	}
+
+	for (int32 Index = NumBuilt; Index < NumRuns; ++Index)
+	{
+		if (!Paragraph.IsValid() || Transcript->GetRun(Index).bNewParagraph)
+		{
+			ScrollBox->AddSlot()
+			[
+				SAssignNew(Paragraph, SWrapBox)
+				.UseAllottedSize(true)
+			];
+		}
+
+		Paragraph->AddSlot()
+		[
+			SAssignNew(LastBlock, STextBlock)
+			.Font(Font)
+			.ColorAndOpacity(TextColor)
+			.Text(FText::FromStringView(Transcript->GetRunText(Index)))
+		];
+	}
+
+	const bool bGrew = NumRuns > NumBuilt;
+	NumBuilt = NumRuns;
+	bLastBuiltOpen = Transcript->IsLastRunOpen();
+
+	if (bAutoScroll && bGrew)
+	{
+		ScrollBox->ScrollToEnd();
+	}
+}
+
+void SAiBridgeTranscript::Clear()
+{
+	if (ScrollBox.IsValid())
+	{
+		ScrollBox->ClearChildren();
+	}
+	Paragraph.Reset();
+	LastBlock.Reset();
+	NumBuilt = 0;
+	bLastBuiltOpen = false;
+}
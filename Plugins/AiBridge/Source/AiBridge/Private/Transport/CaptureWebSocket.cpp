@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Transport/CaptureWebSocket.h"
+#include "Capture/AiBridgeCapture.h"
+
+FCaptureWebSocket::FCaptureWebSocket(TSharedRef<IWebSocket> InInner, TSharedRef<FAiBridgeCaptureWriter, ESPMode::ThreadSafe> InWriter)
+	: Inner(InInner)
+	, Writer(InWriter)
+{
+	Inner->OnConnected().AddRaw(this, &FCaptureWebSocket::HandleInnerConnected);
+	Inner->OnConnectionError().AddRaw(this, &FCaptureWebSocket::HandleInnerConnectionError);
+	Inner->OnClosed().AddRaw(this, &FCaptureWebSocket::HandleInnerClosed);
+	Inner->OnMessage().AddRaw(this, &FCaptureWebSocket::HandleInnerMessage);
+	Inner->OnBinaryMessage().AddRaw(this, &FCaptureWebSocket::HandleInnerBinaryMessage);
+	Inner->OnMessageSent().AddRaw(this, &FCaptureWebSocket::HandleInnerMessageSent);
+}
+
+FCaptureWebSocket::~FCaptureWebSocket()
+{
+	Inner->OnConnected().RemoveAll(this);
+	Inner->OnConnectionError().RemoveAll(this);
+	Inner->OnClosed().RemoveAll(this);
+	Inner->OnMessage().RemoveAll(this);
+	Inner->OnBinaryMessage().RemoveAll(this);
+	Inner->OnMessageSent().RemoveAll(this);
+
+	// Keep what was recorded so far on disk even if the game never stops the capture
+	Writer->Flush();
+}
+
+void FCaptureWebSocket::Send(const FString& Data)
+{
+	Writer->WriteText(true, Data);
+	Inner->Send(Data);
+}
+
+void FCaptureWebSocket::Send(const void* Data, SIZE_T Size, bool bIsBinary)
+{
+	if (bIsBinary)
+	{
+		Writer->WriteBinary(true, Data, Size);
+	}
+	else
+	{
+		Writer->WriteText(true, Data, Size);
+	}
+	Inner->Send(Data, Size, bIsBinary);
+}
+
+void FCaptureWebSocket::HandleInnerConnected()
+{
+	ConnectedEvent.Broadcast();
+}
+
+void FCaptureWebSocket::HandleInnerConnectionError(const FString& Error)
+{
+	ConnectionErrorEvent.Broadcast(Error);
+}
+
+void FCaptureWebSocket::HandleInnerClosed(int32 StatusCode, const FString& Reason, bool bWasClean)
+{
+	Writer->Flush();
+	ClosedEvent.Broadcast(StatusCode, Reason, bWasClean);
+}
+
+void FCaptureWebSocket::HandleInnerMessage(const FString& Message)
+{
+	Writer->WriteText(false, Message);
+	MessageEvent.Broadcast(Message);
+}
+
+void FCaptureWebSocket::HandleInnerBinaryMessage(const void* Data, SIZE_T Size, bool bIsLastFragment)
+{
+	Writer->WriteBinary(false, Data, Size);
+	BinaryMessageEvent.Broadcast(Data, Size, bIsLastFragment);
+}
+
+void FCaptureWebSocket::HandleInnerMessageSent(const FString& Message)
+{
+	MessageSentEvent.Broadcast(Message);
+}
@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Transport/LoopbackWebSocket.h"
+
+FLoopbackWebSocket::FLoopbackWebSocket(FTSTicker& Ticker)
+{
+	TickerHandle = Ticker.AddTicker(FTickerDelegate::CreateRaw(this, &FLoopbackWebSocket::Tick));
+}
+
+FLoopbackWebSocket::~FLoopbackWebSocket()
+{
+	FTSTicker::RemoveTicker(TickerHandle);
+}
+
+void FLoopbackWebSocket::Connect()
+{
+	bConnecting = true;
+}
+
+void FLoopbackWebSocket::Close(int32 Code, const FString& Reason)
+{
+	const bool bWasConnected = bConnected;
+	bConnecting = false;
+	bConnected = false;
+	Pending.Empty();
+
+	if (bWasConnected)
+	{
+		ClosedEvent.Broadcast(Code, Reason, true);
+	}
+}
+
+void FLoopbackWebSocket::Send(const FString& Data)
+{
+	if (!bConnected)
+	{
+		return;
+	}
+
+	FEcho Echo;
+	Echo.Text = Data;
+	Pending.Enqueue(MoveTemp(Echo));
+}
+
+void FLoopbackWebSocket::Send(const void* Data, SIZE_T Size, bool bIsBinary)
+{
+	if (!bConnected)
+	{
+		return;
+	}
+
+	FEcho Echo;
+	Echo.bIsText = !bIsBinary;
+	if (Echo.bIsText)
+	{
+		const FUTF8ToTCHAR Converted(static_cast<const ANSICHAR*>(Data), (int32)Size);
+		Echo.Text = FString(Converted.Length(), Converted.Get());
+	}
+	else
+	{
+		Echo.Bytes.Append(static_cast<const uint8*>(Data), Size);
+	}
+	Pending.Enqueue(MoveTemp(Echo));
+}
+
+bool FLoopbackWebSocket::Tick(float DeltaTime)
+{
+	if (bConnecting)
+	{
+		bConnecting = false;
+		bConnected = true;
+		ConnectedEvent.Broadcast();
+	}
+
+	// Take everything out first so handlers may send again without being echoed in the same tick
+	TArray<FEcho> Delivering;
+	FEcho Queued;
+	while (Pending.Dequeue(Queued))
+	{
+		Delivering.Add(MoveTemp(Queued));
+	}
+
+	for (const FEcho& Echo : Delivering)
+	{
+		if (!bConnected)
+		{
+			break;
+		}
+
+		if (Echo.bIsText)
+		{
+			// Heartbeat pings come back as pongs so RTT and dead-link handling run too
+			FString Reply = Echo.Text.StartsWith(TEXT(R"({"type":"ping")"))
+				? Echo.Text.Replace(TEXT(R"("type":"ping")"), TEXT(R"("type":"pong")"))
+				: Echo.Text;
+			MessageEvent.Broadcast(Reply);
+		}
+		else
+		{
+			BinaryMessageEvent.Broadcast(Echo.Bytes.GetData(), Echo.Bytes.Num(), true);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,410 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Transport/NetworkConditionWebSocket.h"
+#include "Logging/AiBridgeLog.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<bool> CVarNetSimEnable(
+	TEXT("AiBridge.NetSim.Enable"),
+	false,
+	TEXT("Wrap new AiBridge connections in the network condition simulator"));
+
+static TAutoConsoleVariable<float> CVarNetSimLatencyMs(
+	TEXT("AiBridge.NetSim.LatencyMs"),
+	0.0f,
+	TEXT("One-way latency added to each direction, in milliseconds"));
+
+static TAutoConsoleVariable<float> CVarNetSimJitterMs(
+	TEXT("AiBridge.NetSim.JitterMs"),
+	0.0f,
+	TEXT("Random extra one-way delay, in milliseconds"));
+
+static TAutoConsoleVariable<float> CVarNetSimBandwidthKbps(
+	TEXT("AiBridge.NetSim.BandwidthKbps"),
+	0.0f,
+	TEXT("Link capacity per direction in kilobits per second, 0 = unlimited"));
+
+static TAutoConsoleVariable<float> CVarNetSimBurstPeriodMs(
+	TEXT("AiBridge.NetSim.BurstPeriodMs"),
+	0.0f,
+	TEXT("Hold inbound frames and release them in bursts on this period, in milliseconds"));
+
+static TAutoConsoleVariable<float> CVarNetSimDisconnectMeanSeconds(
+	TEXT("AiBridge.NetSim.DisconnectMeanSeconds"),
+	0.0f,
+	TEXT("Mean time between random connection drops, 0 = never"));
+
+namespace NetworkConditionWebSocket
+{
+	/** Shims live on the I/O threads of their connections, the console commands walk them from the game thread */
+	FCriticalSection ActiveSocketsLock;
+	TArray<FNetworkConditionWebSocket*> ActiveSockets;
+}
+
+FNetworkConditions FNetworkConditions::FromConsoleVariables()
+{
+	FNetworkConditions Conditions;
+	Conditions.LatencyMs = FMath::Max(0.0f, CVarNetSimLatencyMs.GetValueOnAnyThread());
+	Conditions.JitterMs = FMath::Max(0.0f, CVarNetSimJitterMs.GetValueOnAnyThread());
+	Conditions.BandwidthKbps = FMath::Max(0.0f, CVarNetSimBandwidthKbps.GetValueOnAnyThread());
+	Conditions.BurstPeriodMs = FMath::Max(0.0f, CVarNetSimBurstPeriodMs.GetValueOnAnyThread());
+	Conditions.DisconnectMeanSeconds = FMath::Max(0.0f, CVarNetSimDisconnectMeanSeconds.GetValueOnAnyThread());
+	return Conditions;
+}
+
+bool FNetworkConditions::IsSimulationEnabled()
+{
+	return CVarNetSimEnable.GetValueOnAnyThread();
+}
+
+FNetworkConditionWebSocket::FNetworkConditionWebSocket(TSharedRef<IWebSocket> InInner, FTSTicker& Ticker)
+	: Inner(InInner)
+	, Random(FPlatformTime::Cycles())
+{
+	Inner->OnConnected().AddRaw(this, &FNetworkConditionWebSocket::HandleInnerConnected);
+	Inner->OnConnectionError().AddRaw(this, &FNetworkConditionWebSocket::HandleInnerConnectionError);
+	Inner->OnClosed().AddRaw(this, &FNetworkConditionWebSocket::HandleInnerClosed);
+	Inner->OnMessage().AddRaw(this, &FNetworkConditionWebSocket::HandleInnerMessage);
+	Inner->OnBinaryMessage().AddRaw(this, &FNetworkConditionWebSocket::HandleInnerBinaryMessage);
+
+	Conditions = FNetworkConditions::FromConsoleVariables();
+	TickerHandle = Ticker.AddTicker(FTickerDelegate::CreateRaw(this, &FNetworkConditionWebSocket::Tick));
+
+	FScopeLock Lock(&NetworkConditionWebSocket::ActiveSocketsLock);
+	NetworkConditionWebSocket::ActiveSockets.Add(this);
+}
+
+FNetworkConditionWebSocket::~FNetworkConditionWebSocket()
+{
+	{
+		FScopeLock Lock(&NetworkConditionWebSocket::ActiveSocketsLock);
+		NetworkConditionWebSocket::ActiveSockets.RemoveSingleSwap(this);
+	}
+	FTSTicker::RemoveTicker(TickerHandle);
+
+	Inner->OnConnected().RemoveAll(this);
+	Inner->OnConnectionError().RemoveAll(this);
+	Inner->OnClosed().RemoveAll(this);
+	Inner->OnMessage().RemoveAll(this);
+	Inner->OnBinaryMessage().RemoveAll(this);
+}
+
+void FNetworkConditionWebSocket::ForEachActive(TFunctionRef<void(FNetworkConditionWebSocket&)> Callback)
+{
+	// Held throughout, so no shim can be destroyed while Callback uses it
+	FScopeLock Lock(&NetworkConditionWebSocket::ActiveSocketsLock);
+	for (FNetworkConditionWebSocket* Socket : NetworkConditionWebSocket::ActiveSockets)
+	{
+		Callback(*Socket);
+	}
+}
+
+void FNetworkConditionWebSocket::SetConditionsOverride(const FNetworkConditions& InConditions)
+{
+	Conditions = InConditions;
+	bHasOverride = true;
+}
+
+void FNetworkConditionWebSocket::Connect()
+{
+	bSimulatedDown = false;
+	bDisconnectRequested = false;
+	Inner->Connect();
+}
+
+void FNetworkConditionWebSocket::Close(int32 Code, const FString& Reason)
+{
+	Inner->Close(Code, Reason);
+}
+
+bool FNetworkConditionWebSocket::IsConnected()
+{
+	return !bSimulatedDown && Inner->IsConnected();
+}
+
+void FNetworkConditionWebSocket::SetTextMessageMemoryLimit(uint64 TextMessageMemoryLimit)
+{
+	Inner->SetTextMessageMemoryLimit(TextMessageMemoryLimit);
+}
+
+void FNetworkConditionWebSocket::Send(const FString& Data)
+{
+	if (bSimulatedDown)
+	{
+		return;
+	}
+
+	FFrame Frame;
+	Frame.Kind = EFrameKind::Text;
+	Frame.Text = Data;
+	Submitted.Enqueue(MoveTemp(Frame));
+}
+
+void FNetworkConditionWebSocket::Send(const void* Data, SIZE_T Size, bool bIsBinary)
+{
+	if (bSimulatedDown)
+	{
+		return;
+	}
+
+	FFrame Frame;
+	Frame.Kind = EFrameKind::Binary;
+	Frame.Bytes.Append(static_cast<const uint8*>(Data), Size);
+	Frame.bIsBinary = bIsBinary;
+	Submitted.Enqueue(MoveTemp(Frame));
+}
+
+void FNetworkConditionWebSocket::SimulateDisconnect()
+{
+	// The random drop and the console command may both fire, the link only goes down once
+	if (bSimulatedDown.exchange(true))
+	{
+		return;
+	}
+
+	UE_LOG(LogAiBridge, Warning, TEXT("[NetSim] Simulating connection drop (%d frames lost)"), NumInFlight);
+
+	// Everything still on the wire is lost with the link
+	Inbound.Frames.Empty();
+	Outbound.Frames.Empty();
+	Submitted.Empty();
+	NumInFlight = 0;
+
+	// The inner socket reports its own close later, HandleInnerClosed drops it: this is the only close the owner sees
+	Inner->Close(1001, TEXT("Simulated disconnect"));
+
+	ClosedEvent.Broadcast(1006, TEXT("Simulated disconnect"), false);
+}
+
+void FNetworkConditionWebSocket::Enqueue(FLink& Link, FFrame&& Frame, int32 NumBytes, bool bInbound)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	// Serialization on a capped link: a frame cannot start before the previous one finished
+	double SentTime = Now;
+	if (Conditions.BandwidthKbps > 0.0f)
+	{
+		SentTime = FMath::Max(Now, Link.FreeTime) + (NumBytes * 8.0) / (Conditions.BandwidthKbps * 1000.0);
+		Link.FreeTime = SentTime;
+	}
+
+	double DueTime = SentTime + (Conditions.LatencyMs + Random.FRandRange(0.0f, Conditions.JitterMs)) / 1000.0;
+
+	if (bInbound && Conditions.BurstPeriodMs > 0.0f)
+	{
+		const double Period = Conditions.BurstPeriodMs / 1000.0;
+		DueTime = FMath::CeilToDouble(DueTime / Period) * Period;
+	}
+
+	// The real link is TCP, jitter may delay frames but never reorder them
+	DueTime = FMath::Max(DueTime, Link.LastDueTime);
+	Link.LastDueTime = DueTime;
+
+	Frame.DueTime = DueTime;
+	Link.Frames.Enqueue(MoveTemp(Frame));
+	NumInFlight++;
+}
+
+bool FNetworkConditionWebSocket::Tick(float DeltaTime)
+{
+	if (!bHasOverride)
+	{
+		Conditions = FNetworkConditions::FromConsoleVariables();
+	}
+
+	if (bDisconnectRequested.exchange(false))
+	{
+		SimulateDisconnect();
+		return true;
+	}
+
+	if (!bSimulatedDown && Conditions.DisconnectMeanSeconds > 0.0f && Inner->IsConnected()
+		&& Random.FRand() < DeltaTime / Conditions.DisconnectMeanSeconds)
+	{
+		SimulateDisconnect();
+		return true;
+	}
+
+	FFrame Sent;
+	while (Submitted.Dequeue(Sent))
+	{
+		const int32 NumBytes = Sent.Kind == EFrameKind::Text
+			? FTCHARToUTF8_Convert::ConvertedLength(*Sent.Text, Sent.Text.Len())
+			: Sent.Bytes.Num();
+		Enqueue(Outbound, MoveTemp(Sent), NumBytes, false);
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	for (FLink* Link : { &Outbound, &Inbound })
+	{
+		const bool bInbound = Link == &Inbound;
+		while (FFrame* Frame = Link->Frames.Peek())
+		{
+			if (Frame->DueTime > Now)
+			{
+				break;
+			}
+
+			FFrame Due;
+			Link->Frames.Dequeue(Due);
+			NumInFlight--;
+			Deliver(Due, bInbound);
+
+			// A delivered close or drop may have emptied the queues under us
+			if (bSimulatedDown)
+			{
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+void FNetworkConditionWebSocket::Deliver(FFrame& Frame, bool bInbound)
+{
+	if (!bInbound)
+	{
+		if (Frame.Kind == EFrameKind::Text)
+		{
+			Inner->Send(Frame.Text);
+			MessageSentEvent.Broadcast(Frame.Text);
+		}
+		else
+		{
+			Inner->Send(Frame.Bytes.GetData(), Frame.Bytes.Num(), Frame.bIsBinary);
+		}
+		return;
+	}
+
+	switch (Frame.Kind)
+	{
+	case EFrameKind::Text:
+		MessageEvent.Broadcast(Frame.Text);
+		break;
+	case EFrameKind::Binary:
+		BinaryMessageEvent.Broadcast(Frame.Bytes.GetData(), Frame.Bytes.Num(), Frame.bIsLastFragment);
+		break;
+	case EFrameKind::Connected:
+		ConnectedEvent.Broadcast();
+		break;
+	case EFrameKind::ConnectionError:
+		ConnectionErrorEvent.Broadcast(Frame.Text);
+		break;
+	case EFrameKind::Closed:
+		ClosedEvent.Broadcast(Frame.StatusCode, Frame.Text, Frame.bWasClean);
+		break;
+	}
+}
+
+void FNetworkConditionWebSocket::HandleInnerConnected()
+{
+	if (bSimulatedDown)
+	{
+		return;
+	}
+
+	// The handshake needs a full round trip over the impaired link
+	FFrame Frame;
+	Frame.Kind = EFrameKind::Connected;
+	Enqueue(Inbound, MoveTemp(Frame), 0, true);
+	Inbound.LastDueTime += Conditions.LatencyMs / 1000.0;
+}
+
+void FNetworkConditionWebSocket::HandleInnerConnectionError(const FString& Error)
+{
+	if (bSimulatedDown)
+	{
+		return;
+	}
+
+	FFrame Frame;
+	Frame.Kind = EFrameKind::ConnectionError;
+	Frame.Text = Error;
+	Enqueue(Inbound, MoveTemp(Frame), 0, true);
+}
+
+void FNetworkConditionWebSocket::HandleInnerClosed(int32 StatusCode, const FString& Reason, bool bWasClean)
+{
+	// A dropped link already reported its close
+	if (bSimulatedDown)
+	{
+		return;
+	}
+
+	FFrame Frame;
+	Frame.Kind = EFrameKind::Closed;
+	Frame.Text = Reason;
+	Frame.StatusCode = StatusCode;
+	Frame.bWasClean = bWasClean;
+	Enqueue(Inbound, MoveTemp(Frame), 0, true);
+}
+
+void FNetworkConditionWebSocket::HandleInnerMessage(const FString& Message)
+{
+	if (bSimulatedDown)
+	{
+		return;
+	}
+
+	FFrame Frame;
+	Frame.Kind = EFrameKind::Text;
+	Frame.Text = Message;
+	Enqueue(Inbound, MoveTemp(Frame), FTCHARToUTF8_Convert::ConvertedLength(*Message, Message.Len()), true);
+}
+
+void FNetworkConditionWebSocket::HandleInnerBinaryMessage(const void* Data, SIZE_T Size, bool bIsLastFragment)
+{
+	if (bSimulatedDown)
+	{
+		return;
+	}
+
+	FFrame Frame;
+	Frame.Kind = EFrameKind::Binary;
+	Frame.Bytes.Append(static_cast<const uint8*>(Data), Size);
+	Frame.bIsLastFragment = bIsLastFragment;
+	Enqueue(Inbound, MoveTemp(Frame), (int32)Size, true);
+}
+
+static FAutoConsoleCommand GAiBridgeNetSimDisconnectCommand(
+	TEXT("AiBridge.NetSim.Disconnect"),
+	TEXT("Drops every simulated AiBridge connection as if the network went away"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FNetworkConditionWebSocket::ForEachActive([](FNetworkConditionWebSocket& Socket) { Socket.RequestDisconnect(); });
+	}));
+
+static FAutoConsoleCommand GAiBridgeNetSimPresetCommand(
+	TEXT("AiBridge.NetSim.Preset"),
+	TEXT("Applies a named set of impairments: Off, Good, VenueWifi, Congested, Flaky"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		struct FPreset { const TCHAR* Name; float Latency; float Jitter; float Bandwidth; float Burst; float Disconnect; };
+		static const FPreset Presets[] =
+		{
+			{ TEXT("Off"),        0.0f,   0.0f,    0.0f,   0.0f,  0.0f },
+			{ TEXT("Good"),      15.0f,   3.0f,    0.0f,   0.0f,  0.0f },
+			{ TEXT("VenueWifi"), 60.0f,  40.0f, 2000.0f, 100.0f,  0.0f },
+			{ TEXT("Congested"),150.0f,  80.0f,  256.0f, 200.0f,  0.0f },
+			{ TEXT("Flaky"),     80.0f, 120.0f, 1000.0f, 100.0f, 45.0f },
+		};
+
+		const FString Name = Args.Num() > 0 ? Args[0] : FString();
+		for (const FPreset& Preset : Presets)
+		{
+			if (Name.Equals(Preset.Name, ESearchCase::IgnoreCase))
+			{
+				CVarNetSimEnable->Set(Preset.Latency > 0.0f, ECVF_SetByConsole);
+				CVarNetSimLatencyMs->Set(Preset.Latency, ECVF_SetByConsole);
+				CVarNetSimJitterMs->Set(Preset.Jitter, ECVF_SetByConsole);
+				CVarNetSimBandwidthKbps->Set(Preset.Bandwidth, ECVF_SetByConsole);
+				CVarNetSimBurstPeriodMs->Set(Preset.Burst, ECVF_SetByConsole);
+				CVarNetSimDisconnectMeanSeconds->Set(Preset.Disconnect, ECVF_SetByConsole);
+				UE_LOG(LogAiBridge, Display, TEXT("[NetSim] Applied preset %s (takes effect on the next connect if simulation was off)"), Preset.Name);
+				return;
+			}
+		}
+		UE_LOG(LogAiBridge, Warning, TEXT("[NetSim] Unknown preset '%s'"), *Name);
+	}));
@@ -0,0 +1,204 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Transport/ReplayWebSocket.h"
+#include "Logging/AiBridgeLog.h"
+
+namespace ReplayWebSocket
+{
+	/**
+	 * With speed=0, frames delivered per tick. The I/O thread ticks every couple of milliseconds, this keeps
+	 * a replay well ahead of realtime without outrunning the messages budget before the game thread drains it
+	 */
+	constexpr int32 MaxFramesPerTick = 64;
+
+	bool IsPong(const FAiBridgeCaptureRecord& Record)
+	{
+		static const ANSICHAR Prefix[] = R"({"type":"pong")";
+		const int32 PrefixLen = UE_ARRAY_COUNT(Prefix) - 1;
+		return !Record.IsBinary() && Record.Payload.Num() >= PrefixLen && FMemory::Memcmp(Record.Payload.GetData(), Prefix, PrefixLen) == 0;
+	}
+}
+
+FReplayWebSocket::FReplayWebSocket(const FString& Url, FTSTicker& Ticker)
+{
+	FString Target = Url.Mid(FCString::Strlen(TEXT("replay://")));
+	FString Query;
+	int32 QueryStart = INDEX_NONE;
+	if (Target.FindChar(TEXT('?'), QueryStart))
+	{
+		Query = Target.Mid(QueryStart + 1);
+		Target.LeftInline(QueryStart);
+	}
+
+	TArray<FString> Params;
+	Query.ParseIntoArray(Params, TEXT("&"));
+	for (const FString& Param : Params)
+	{
+		FString Key = Param;
+		FString Value;
+		Param.Split(TEXT("="), &Key, &Value);
+
+		if (Key.Equals(TEXT("speed"), ESearchCase::IgnoreCase))
+		{
+			Speed = FMath::Max(0.0f, FCString::Atof(*Value));
+		}
+		else if (Key.Equals(TEXT("loop"), ESearchCase::IgnoreCase))
+		{
+			bLoop = Value.IsEmpty() || FCString::Atoi(*Value) != 0;
+		}
+	}
+
+	Path = AiBridgeCapture::ResolvePath(Target);
+	Reader = FAiBridgeCaptureReader::Open(Path);
+
+	TickerHandle = Ticker.AddTicker(FTickerDelegate::CreateRaw(this, &FReplayWebSocket::Tick));
+}
+
+FReplayWebSocket::~FReplayWebSocket()
+{
+	FTSTicker::RemoveTicker(TickerHandle);
+}
+
+void FReplayWebSocket::Connect()
+{
+	bConnecting = true;
+}
+
+void FReplayWebSocket::Close(int32 Code, const FString& Reason)
+{
+	const bool bWasConnected = bConnected;
+	bConnecting = false;
+	bConnected = false;
+	Pings.Empty();
+
+	if (bWasConnected)
+	{
+		ClosedEvent.Broadcast(Code, Reason, true);
+	}
+}
+
+void FReplayWebSocket::Send(const FString& Data)
+{
+	if (!bConnected)
+	{
+		return;
+	}
+
+	if (Data.StartsWith(TEXT(R"({"type":"ping")")))
+	{
+		Pings.Enqueue(Data);
+		return;
+	}
+
+	++NumDropped;
+}
+
+void FReplayWebSocket::Send(const void* Data, SIZE_T Size, bool bIsBinary)
+{
+	if (bConnected)
+	{
+		++NumDropped;
+	}
+}
+
+bool FReplayWebSocket::Tick(float DeltaTime)
+{
+	if (bConnecting)
+	{
+		bConnecting = false;
+
+		if (!Reader || bFinished)
+		{
+			ConnectionErrorEvent.Broadcast(Reader ? TEXT("Replay already finished") : FString::Printf(TEXT("Could not open capture %s"), *Path));
+			return true;
+		}
+
+		// Every connect plays the capture from the start
+		Reader->Rewind();
+		bHasPending = false;
+		bPassStarted = false;
+		NumDeliveredThisPass = 0;
+
+		bConnected = true;
+		ConnectedEvent.Broadcast();
+	}
+
+	// Answer heartbeat pings like a live orchestrator would
+	FString Ping;
+	while (bConnected && Pings.Dequeue(Ping))
+	{
+		MessageEvent.Broadcast(Ping.Replace(TEXT(R"("type":"ping")"), TEXT(R"("type":"pong")")));
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	int32 Budget = ReplayWebSocket::MaxFramesPerTick;
+
+	while (bConnected)
+	{
+		if (!bHasPending && !ReadNext())
+		{
+			if (bLoop && NumDeliveredThisPass > 0)
+			{
+				Reader->Rewind();
+				bPassStarted = false;
+				NumDeliveredThisPass = 0;
+				continue;
+			}
+
+			UE_LOG(LogAiBridge, Log, TEXT("[Replay] Finished %s: %llu frames delivered, %llu sent frames dropped"), *Path, NumDelivered, NumDropped.load());
+			bFinished = true;
+			Close(1000, TEXT("Replay finished"));
+			break;
+		}
+		bHasPending = true;
+
+		if (!bPassStarted)
+		{
+			bPassStarted = true;
+			PassStartMicros = Pending.TimeMicros;
+			PassStartSeconds = Now;
+		}
+
+		if (Speed > 0.0f)
+		{
+			const double DueSeconds = PassStartSeconds + (Pending.TimeMicros - PassStartMicros) / 1e6 / Speed;
+			if (DueSeconds > Now)
+			{
+				break;
+			}
+		}
+		else if (Budget-- <= 0)
+		{
+			break;
+		}
+
+		bHasPending = false;
+		++NumDelivered;
+		++NumDeliveredThisPass;
+
+		if (Pending.IsBinary())
+		{
+			BinaryMessageEvent.Broadcast(Pending.Payload.GetData(), Pending.Payload.Num(), true);
+		}
+		else
+		{
+			MessageEvent.Broadcast(Pending.GetText());
+		}
+	}
+
+	return true;
+}
+
+bool FReplayWebSocket::ReadNext()
+{
+	while (Reader->Next(Pending))
+	{
+		// Replies to the recorded session's pings would only confuse the live heartbeat
+		if (!Pending.IsOutbound() && !ReplayWebSocket::IsPong(Pending))
+		{
+			return true;
+		}
+	}
+	return false;
+}
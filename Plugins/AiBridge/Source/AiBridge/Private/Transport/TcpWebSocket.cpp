@@ -0,0 +1,871 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Transport/TcpWebSocket.h"
+#include "Logging/AiBridgeLog.h"
+#include "AddressInfoTypes.h"
+#include "IPAddress.h"
+#include "Misc/Base64.h"
+#include "Misc/SecureHash.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+#if WITH_SSL
+#include "Ssl.h"
+#include "Interfaces/ISslManager.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#endif
+#define UI UI_ST
+THIRD_PARTY_INCLUDES_START
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+THIRD_PARTY_INCLUDES_END
+#undef UI
+#if PLATFORM_WINDOWS
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+#endif
+
+namespace TcpWebSocket
+{
+	constexpr uint8 OpContinuation = 0x0;
+	constexpr uint8 OpText = 0x1;
+	constexpr uint8 OpBinary = 0x2;
+	constexpr uint8 OpClose = 0x8;
+	constexpr uint8 OpPing = 0x9;
+	constexpr uint8 OpPong = 0xA;
+
+	/** Appended to the client key to form the accept value the server must answer with */
+	constexpr ANSICHAR AcceptGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+	/** A handshake reply is a few hundred bytes, a server sending more without a blank line is not one */
+	constexpr int32 MaxHandshakeBytes = 16 * 1024;
+
+	/** Largest message reassembled, a whole batch TTS reply fits well within it */
+	constexpr int64 DefaultMaxMessageBytes = 32 * 1024 * 1024;
+
+	/** Time a server gets to answer our close before the socket is dropped anyway */
+	constexpr double CloseTimeoutSeconds = 2.0;
+
+	constexpr int32 ReadChunkBytes = 64 * 1024;
+
+	FString ComputeAccept(const FString& Key)
+	{
+		const FTCHARToUTF8 Utf8(*Key, Key.Len());
+		TArray<uint8> Input;
+		Input.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+		Input.Append(reinterpret_cast<const uint8*>(AcceptGuid), UE_ARRAY_COUNT(AcceptGuid) - 1);
+
+		uint8 Hash[FSHA1::DigestSize];
+		FSHA1::HashBuffer(Input.GetData(), Input.Num(), Hash);
+		return FBase64::Encode(Hash, FSHA1::DigestSize);
+	}
+
+	FString Utf8ToString(const uint8* Data, int32 Size)
+	{
+		const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Data), Size);
+		return FString(Converted.Length(), Converted.Get());
+	}
+
+#if WITH_SSL
+	FString LastTlsError()
+	{
+		ANSICHAR Buffer[256] = {};
+		ERR_error_string_n(ERR_get_error(), Buffer, sizeof(Buffer));
+		return UTF8_TO_TCHAR(Buffer);
+	}
+#endif
+}
+
+FTcpWebSocket::FTcpWebSocket(const FString& InUrl, FTSTicker& Ticker)
+	: Url(InUrl)
+	, MaxMessageBytes(TcpWebSocket::DefaultMaxMessageBytes)
+	, MaskRandom(FPlatformTime::Cycles() ^ (uint32)(UPTRINT)this)
+{
+	ParseUrl();
+	TickerHandle = Ticker.AddTicker(FTickerDelegate::CreateRaw(this, &FTcpWebSocket::Tick));
+}
+
+FTcpWebSocket::~FTcpWebSocket()
+{
+	FTSTicker::RemoveTicker(TickerHandle);
+	DestroySocket();
+}
+
+void FTcpWebSocket::ParseUrl()
+{
+	FString Rest;
+	if (Url.StartsWith(TEXT("wss://"), ESearchCase::IgnoreCase))
+	{
+		bSecure = true;
+		Rest = Url.Mid(6);
+	}
+	else if (Url.StartsWith(TEXT("ws://"), ESearchCase::IgnoreCase))
+	{
+		Rest = Url.Mid(5);
+	}
+	else
+	{
+		return;
+	}
+
+	int32 ResourceStart = INDEX_NONE;
+	for (int32 Index = 0; Index < Rest.Len(); ++Index)
+	{
+		if (Rest[Index] == TEXT('/') || Rest[Index] == TEXT('?'))
+		{
+			ResourceStart = Index;
+			break;
+		}
+	}
+
+	const FString Authority = ResourceStart == INDEX_NONE ? Rest : Rest.Left(ResourceStart);
+	Resource = ResourceStart == INDEX_NONE ? TEXT("/") : Rest.Mid(ResourceStart);
+	if (Resource.StartsWith(TEXT("?")))
+	{
+		Resource.InsertAt(0, TEXT('/'));
+	}
+
+	// [v6]:port, host:port or host
+	const int32 BracketEnd = Authority.StartsWith(TEXT("[")) ? Authority.Find(TEXT("]")) : INDEX_NONE;
+	int32 PortStart = INDEX_NONE;
+	Authority.FindLastChar(TEXT(':'), PortStart);
+	if (PortStart != INDEX_NONE && PortStart > BracketEnd)
+	{
+		Host = Authority.Left(PortStart);
+		Port = FCString::Atoi(*Authority.Mid(PortStart + 1));
+	}
+	else
+	{
+		Host = Authority;
+		Port = bSecure ? 443 : 80;
+	}
+	HostHeader = Authority;
+	Host.TrimCharInline(TEXT('['), nullptr);
+	Host.TrimCharInline(TEXT(']'), nullptr);
+
+	bValidUrl = !Host.IsEmpty() && Port > 0 && Port < 65536;
+}
+
+void FTcpWebSocket::Connect()
+{
+	DestroySocket();
+	Incoming.Reset();
+	Message.Reset();
+	MessageOpcode = 0;
+
+	if (!bValidUrl)
+	{
+		State = EState::Closed;
+		ConnectionErrorEvent.Broadcast(FString::Printf(TEXT("Not a ws:// or wss:// url: %s"), *Url));
+		return;
+	}
+
+#if !WITH_SSL
+	if (bSecure)
+	{
+		State = EState::Closed;
+		ConnectionErrorEvent.Broadcast(TEXT("wss:// needs TLS, which this platform was built without"));
+		return;
+	}
+#endif
+
+	ISocketSubsystem* Sockets = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	if (Sockets == nullptr)
+	{
+		State = EState::Closed;
+		ConnectionErrorEvent.Broadcast(TEXT("No socket subsystem"));
+		return;
+	}
+
+	// Name lookup can take seconds, it runs on a worker and the result is picked up by the next tick
+	State = EState::Resolving;
+	Resolved = MakeShared<FResolveQueue, ESPMode::ThreadSafe>();
+	Sockets->GetAddressInfoAsync([Resolved = Resolved](FAddressInfoResult Result)
+	{
+		TSharedPtr<FInternetAddr> Address;
+		if (Result.ReturnCode == SE_NO_ERROR && Result.Results.Num() > 0)
+		{
+			Address = Result.Results[0].Address;
+		}
+		Resolved->Enqueue(MoveTemp(Address));
+	}, *Host, *FString::FromInt(Port), EAddressInfoFlags::Default, NAME_None, ESocketType::SOCKTYPE_Streaming);
+}
+
+void FTcpWebSocket::Close(int32 Code, const FString& Reason)
+{
+	if (State != EState::Open)
+	{
+		// Nothing was established, there is no one to tell
+		if (State != EState::Closing)
+		{
+			DestroySocket();
+			State = EState::Closed;
+		}
+		return;
+	}
+
+	// Code and reason, the reason cut to what fits a control frame
+	const FTCHARToUTF8 Utf8(*Reason, Reason.Len());
+	TArray<uint8, TInlineAllocator<125>> Payload;
+	Payload.Add((uint8)(Code >> 8));
+	Payload.Add((uint8)Code);
+	Payload.Append(reinterpret_cast<const uint8*>(Utf8.Get()), FMath::Min(Utf8.Length(), 123));
+	SendFrame(TcpWebSocket::OpClose, Payload.GetData(), Payload.Num());
+	WriteSocket();
+
+	State = EState::Closing;
+	CloseCode = Code;
+	CloseReason = Reason;
+	CloseDeadline = FPlatformTime::Seconds() + TcpWebSocket::CloseTimeoutSeconds;
+}
+
+void FTcpWebSocket::Send(const FString& Data)
+{
+	if (State != EState::Open)
+	{
+		return;
+	}
+
+	const FTCHARToUTF8 Utf8(*Data, Data.Len());
+	SendFrame(TcpWebSocket::OpText, reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+	WriteSocket();
+	MessageSentEvent.Broadcast(Data);
+}
+
+void FTcpWebSocket::Send(const void* Data, SIZE_T Size, bool bIsBinary)
+{
+	if (State != EState::Open)
+	{
+		return;
+	}
+
+	// Without bIsBinary the bytes are UTF-8 text, as for the engine sockets
+	SendFrame(bIsBinary ? TcpWebSocket::OpBinary : TcpWebSocket::OpText, static_cast<const uint8*>(Data), (int32)Size);
+	WriteSocket();
+}
+
+void FTcpWebSocket::SetTextMessageMemoryLimit(uint64 TextMessageMemoryLimit)
+{
+	MaxMessageBytes = (int64)FMath::Min<uint64>(TextMessageMemoryLimit, (uint64)MAX_int32);
+}
+
+bool FTcpWebSocket::Tick(float DeltaTime)
+{
+	switch (State)
+	{
+	case EState::Resolving:
+	{
+		TSharedPtr<FInternetAddr> Address;
+		if (Resolved.IsValid() && Resolved->Dequeue(Address))
+		{
+			Resolved.Reset();
+			BeginConnect(Address);
+		}
+		break;
+	}
+
+	case EState::Connecting:
+	{
+		if (Socket->GetConnectionState() == SCS_ConnectionError)
+		{
+			Fail(FString::Printf(TEXT("Could not connect to %s:%d"), *Host, Port));
+			break;
+		}
+
+		if (Socket->Wait(ESocketWaitConditions::WaitForWrite, FTimespan::Zero()))
+		{
+			if (bSecure)
+			{
+				if (BeginTls())
+				{
+					State = EState::TlsHandshake;
+					ContinueTls();
+				}
+			}
+			else
+			{
+				State = EState::Upgrading;
+				SendHandshake();
+			}
+		}
+		break;
+	}
+
+	case EState::TlsHandshake:
+	case EState::Upgrading:
+	case EState::Open:
+	case EState::Closing:
+	{
+		if (!ReadSocket())
+		{
+			// A server may close the TCP connection right after its close frame, parse what came first
+			if (State == EState::Open || State == EState::Closing)
+			{
+				ReadFrames();
+			}
+			if (State == EState::Open || State == EState::Closing)
+			{
+				Fail(TEXT("Connection lost"));
+			}
+			else if (State != EState::Closed)
+			{
+				Fail(FString::Printf(TEXT("Connection to %s:%d failed"), *Host, Port));
+			}
+			break;
+		}
+
+		if (State == EState::TlsHandshake && !ContinueTls())
+		{
+			break;
+		}
+
+		if (State == EState::Upgrading && !ReadHandshake())
+		{
+			break;
+		}
+
+		if ((State == EState::Open || State == EState::Closing) && !ReadFrames())
+		{
+			break;
+		}
+
+		if (!WriteSocket())
+		{
+			Fail(TEXT("Connection lost"));
+			break;
+		}
+
+		if (State == EState::Closing && FPlatformTime::Seconds() > CloseDeadline)
+		{
+			Finish(CloseCode, CloseReason, false);
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	return true;
+}
+
+void FTcpWebSocket::BeginConnect(const TSharedPtr<FInternetAddr>& Address)
+{
+	if (!Address.IsValid())
+	{
+		Fail(FString::Printf(TEXT("Could not resolve %s"), *Host));
+		return;
+	}
+
+	ISocketSubsystem* Sockets = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+
+	Socket = Sockets->CreateSocket(NAME_Stream, TEXT("AiBridge WebSocket"), Address->GetProtocolType());
+	if (Socket == nullptr)
+	{
+		Fail(TEXT("Could not create a socket"));
+		return;
+	}
+
+	Socket->SetNonBlocking(true);
+	Socket->SetNoDelay(true);
+
+	// Non-blocking: a connect in progress counts as success, Tick watches for it to complete
+	if (!Socket->Connect(*Address))
+	{
+		Fail(FString::Printf(TEXT("Could not connect to %s:%d"), *Host, Port));
+		return;
+	}
+	State = EState::Connecting;
+}
+
+bool FTcpWebSocket::BeginTls()
+{
+#if WITH_SSL
+	FSslContextCreateOptions Options;
+	SslContext = FSslModule::Get().GetSslManager().CreateSslContext(Options);
+	if (SslContext == nullptr)
+	{
+		Fail(TEXT("Could not create a TLS context"));
+		return false;
+	}
+	SSL_CTX_set_verify(SslContext, SSL_VERIFY_PEER, nullptr);
+
+	Ssl = SSL_new(SslContext);
+	TlsIn = BIO_new(BIO_s_mem());
+	TlsOut = BIO_new(BIO_s_mem());
+	SSL_set_bio(Ssl, TlsIn, TlsOut);
+	SSL_set_connect_state(Ssl);
+
+	// Server name for virtual hosting, and the name the certificate must be issued for
+	const FTCHARToUTF8 HostUtf8(*Host, Host.Len());
+	SSL_set_tlsext_host_name(Ssl, HostUtf8.Get());
+	SSL_set1_host(Ssl, HostUtf8.Get());
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool FTcpWebSocket::ContinueTls()
+{
+#if WITH_SSL
+	const int32 Result = SSL_do_handshake(Ssl);
+	if (Result == 1)
+	{
+		State = EState::Upgrading;
+		SendHandshake();
+		return true;
+	}
+
+	const int32 Error = SSL_get_error(Ssl, Result);
+	if (Error != SSL_ERROR_WANT_READ && Error != SSL_ERROR_WANT_WRITE)
+	{
+		const long Verify = SSL_get_verify_result(Ssl);
+		Fail(Verify != X509_V_OK
+			? FString::Printf(TEXT("TLS handshake with %s failed: %s"), *Host, UTF8_TO_TCHAR(X509_verify_cert_error_string(Verify)))
+			: FString::Printf(TEXT("TLS handshake with %s failed: %s"), *Host, *TcpWebSocket::LastTlsError()));
+		return false;
+	}
+
+	// The handshake records the library wrote wait in the memory buffer
+	WritePlain(nullptr, 0);
+	return WriteSocket();
+#else
+	return false;
+#endif
+}
+
+void FTcpWebSocket::SendHandshake()
+{
+	const FGuid Nonce = FGuid::NewGuid();
+	HandshakeKey = FBase64::Encode(reinterpret_cast<const uint8*>(&Nonce), sizeof(Nonce));
+
+	const FString Request = FString::Printf(
+		TEXT("GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n"),
+		*Resource, *HostHeader, *HandshakeKey);
+
+	const FTCHARToUTF8 Utf8(*Request, Request.Len());
+	WritePlain(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+	WriteSocket();
+}
+
+bool FTcpWebSocket::ReadHandshake()
+{
+	static const uint8 HeaderEnd[] = { '\r', '\n', '\r', '\n' };
+
+	int32 End = INDEX_NONE;
+	for (int32 Index = 0; Index + 4 <= Incoming.Num(); ++Index)
+	{
+		if (FMemory::Memcmp(Incoming.GetData() + Index, HeaderEnd, 4) == 0)
+		{
+			End = Index;
+			break;
+		}
+	}
+
+	if (End == INDEX_NONE)
+	{
+		if (Incoming.Num() > TcpWebSocket::MaxHandshakeBytes)
+		{
+			Fail(TEXT("Handshake reply too long"));
+			return false;
+		}
+		return true;
+	}
+
+	const FString Reply = TcpWebSocket::Utf8ToString(Incoming.GetData(), End);
+	Incoming.RemoveAt(0, End + 4, EAllowShrinking::No);
+
+	TArray<FString> Lines;
+	Reply.ParseIntoArray(Lines, TEXT("\r\n"));
+
+	FString StatusLine = Lines.Num() > 0 ? Lines[0] : FString();
+	FString Accept;
+	for (int32 Index = 1; Index < Lines.Num(); ++Index)
+	{
+		FString Name;
+		FString Value;
+		if (Lines[Index].Split(TEXT(":"), &Name, &Value) && Name.TrimStartAndEnd().Equals(TEXT("Sec-WebSocket-Accept"), ESearchCase::IgnoreCase))
+		{
+			Accept = Value.TrimStartAndEnd();
+		}
+	}
+
+	TArray<FString> Status;
+	StatusLine.ParseIntoArrayWS(Status);
+	if (Status.Num() < 2 || Status[1] != TEXT("101"))
+	{
+		Fail(FString::Printf(TEXT("Handshake rejected: %s"), *StatusLine));
+		return false;
+	}
+
+	if (Accept != TcpWebSocket::ComputeAccept(HandshakeKey))
+	{
+		Fail(TEXT("Handshake reply has the wrong Sec-WebSocket-Accept"));
+		return false;
+	}
+
+	State = EState::Open;
+	ConnectedEvent.Broadcast();
+
+	// Frames sent right behind the reply arrived with it
+	return ReadFrames();
+}
+
+bool FTcpWebSocket::ReadFrames()
+{
+	int32 Offset = 0;
+	while (State == EState::Open || State == EState::Closing)
+	{
+		const uint8* Data = Incoming.GetData() + Offset;
+		const int32 Available = Incoming.Num() - Offset;
+		if (Available < 2)
+		{
+			break;
+		}
+
+		const bool bFin = (Data[0] & 0x80) != 0;
+		const uint8 Opcode = Data[0] & 0x0F;
+		const bool bMasked = (Data[1] & 0x80) != 0;
+		uint64 Length = Data[1] & 0x7F;
+		int32 HeaderSize = 2;
+
+		if (Length == 126)
+		{
+			if (Available < 4)
+			{
+				break;
+			}
+			Length = ((uint64)Data[2] << 8) | Data[3];
+			HeaderSize = 4;
+		}
+		else if (Length == 127)
+		{
+			if (Available < 10)
+			{
+				break;
+			}
+			Length = 0;
+			for (int32 Index = 2; Index < 10; ++Index)
+			{
+				Length = (Length << 8) | Data[Index];
+			}
+			HeaderSize = 10;
+		}
+
+		// Servers never mask, RFC 6455 5.1, and no extension was negotiated
+		if (bMasked || (Data[0] & 0x70) != 0)
+		{
+			Abort(1002, TEXT("Protocol error"));
+			return false;
+		}
+
+		if (Length > (uint64)MaxMessageBytes || Message.Num() + (int64)Length > MaxMessageBytes)
+		{
+			Abort(1009, TEXT("Message too big"));
+			return false;
+		}
+
+		if ((uint64)Available < HeaderSize + Length)
+		{
+			break;
+		}
+
+		const uint8* Payload = Data + HeaderSize;
+		const int32 PayloadSize = (int32)Length;
+		Offset += HeaderSize + PayloadSize;
+
+		if (Opcode >= TcpWebSocket::OpClose)
+		{
+			if (!bFin || PayloadSize > 125)
+			{
+				Abort(1002, TEXT("Protocol error"));
+				return false;
+			}
+
+			if (Opcode == TcpWebSocket::OpPing)
+			{
+				if (State == EState::Open)
+				{
+					SendFrame(TcpWebSocket::OpPong, Payload, PayloadSize);
+				}
+			}
+			else if (Opcode == TcpWebSocket::OpClose)
+			{
+				const int32 Code = PayloadSize >= 2 ? (Payload[0] << 8) | Payload[1] : 1005;
+				const FString Reason = PayloadSize > 2 ? TcpWebSocket::Utf8ToString(Payload + 2, PayloadSize - 2) : FString();
+
+				// Answer a close the server started, ours it just confirmed
+				if (State == EState::Open)
+				{
+					SendFrame(TcpWebSocket::OpClose, Payload, FMath::Min(PayloadSize, 2));
+					WriteSocket();
+				}
+				Finish(State == EState::Closing ? CloseCode : Code, State == EState::Closing ? CloseReason : Reason, true);
+				return false;
+			}
+			continue;
+		}
+
+		if ((Opcode == TcpWebSocket::OpContinuation) != (MessageOpcode != 0) || Opcode > TcpWebSocket::OpBinary)
+		{
+			Abort(1002, TEXT("Protocol error"));
+			return false;
+		}
+
+		if (Opcode != TcpWebSocket::OpContinuation)
+		{
+			MessageOpcode = Opcode;
+		}
+		Message.Append(Payload, PayloadSize);
+
+		if (!bFin || State != EState::Open)
+		{
+			continue;
+		}
+
+		const uint8 Completed = MessageOpcode;
+		MessageOpcode = 0;
+		if (Completed == TcpWebSocket::OpText)
+		{
+			MessageEvent.Broadcast(TcpWebSocket::Utf8ToString(Message.GetData(), Message.Num()));
+		}
+		else
+		{
+			BinaryMessageEvent.Broadcast(Message.GetData(), Message.Num(), true);
+		}
+		Message.Reset();
+	}
+
+	if (Offset > 0)
+	{
+		Incoming.RemoveAt(0, FMath::Min(Offset, Incoming.Num()), EAllowShrinking::No);
+	}
+	return State == EState::Open || State == EState::Closing;
+}
+
+bool FTcpWebSocket::ReadSocket()
+{
+	if (Socket == nullptr)
+	{
+		return false;
+	}
+
+	uint8 Buffer[TcpWebSocket::ReadChunkBytes];
+	for (;;)
+	{
+		int32 NumRead = 0;
+		if (!Socket->Recv(Buffer, sizeof(Buffer), NumRead))
+		{
+			// Orderly shutdown or a reset, a stream socket with nothing to read reports success
+			return false;
+		}
+		if (NumRead <= 0)
+		{
+			break;
+		}
+
+#if WITH_SSL
+		if (Ssl != nullptr)
+		{
+			BIO_write(TlsIn, Buffer, NumRead);
+			continue;
+		}
+#endif
+		Incoming.Append(Buffer, NumRead);
+	}
+
+#if WITH_SSL
+	// Decrypt whatever complete records arrived, the handshake consumes its own
+	if (Ssl != nullptr && State != EState::TlsHandshake)
+	{
+		for (;;)
+		{
+			const int32 NumDecrypted = SSL_read(Ssl, Buffer, sizeof(Buffer));
+			if (NumDecrypted > 0)
+			{
+				Incoming.Append(Buffer, NumDecrypted);
+				continue;
+			}
+
+			const int32 Error = SSL_get_error(Ssl, NumDecrypted);
+			if (Error == SSL_ERROR_WANT_READ || Error == SSL_ERROR_WANT_WRITE)
+			{
+				break;
+			}
+
+			// The peer ending the TLS session is an orderly close, anything else is worth a line in the log
+			if (Error != SSL_ERROR_ZERO_RETURN)
+			{
+				UE_LOG(LogAiBridge, Warning, TEXT("TLS read from %s failed: %s"), *Host, *TcpWebSocket::LastTlsError());
+			}
+			return false;
+		}
+	}
+#endif
+	return true;
+}
+
+bool FTcpWebSocket::WriteSocket()
+{
+	if (Socket == nullptr)
+	{
+		return false;
+	}
+
+	while (OutgoingOffset < Outgoing.Num())
+	{
+		int32 NumSent = 0;
+		if (!Socket->Send(Outgoing.GetData() + OutgoingOffset, Outgoing.Num() - OutgoingOffset, NumSent))
+		{
+			// A full send buffer is not an error, the rest goes out on a later tick
+			return ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetLastErrorCode() == SE_EWOULDBLOCK;
+		}
+		if (NumSent <= 0)
+		{
+			break;
+		}
+		OutgoingOffset += NumSent;
+	}
+
+	if (OutgoingOffset == Outgoing.Num())
+	{
+		Outgoing.Reset();
+		OutgoingOffset = 0;
+	}
+	else if (OutgoingOffset > 64 * 1024 && OutgoingOffset * 2 > Outgoing.Num())
+	{
+		Outgoing.RemoveAt(0, OutgoingOffset, EAllowShrinking::No);
+		OutgoingOffset = 0;
+	}
+	return true;
+}
+
+void FTcpWebSocket::WritePlain(const uint8* Data, int32 Size)
+{
+#if WITH_SSL
+	if (Ssl != nullptr)
+	{
+		if (Size > 0)
+		{
+			// Memory buffers take everything, there is no partial write to retry
+			SSL_write(Ssl, Data, Size);
+		}
+
+		uint8 Buffer[16 * 1024];
+		int32 NumRead = 0;
+		while ((NumRead = BIO_read(TlsOut, Buffer, sizeof(Buffer))) > 0)
+		{
+			Outgoing.Append(Buffer, NumRead);
+		}
+		return;
+	}
+#endif
+	Outgoing.Append(Data, Size);
+}
+
+void FTcpWebSocket::SendFrame(uint8 Opcode, const uint8* Payload, int32 Size)
+{
+	FrameScratch.Reset(Size + 14);
+	FrameScratch.Add(0x80 | Opcode);
+
+	if (Size < 126)
+	{
+		FrameScratch.Add(0x80 | (uint8)Size);
+	}
+	else if (Size <= 0xFFFF)
+	{
+		FrameScratch.Add(0x80 | 126);
+		FrameScratch.Add((uint8)(Size >> 8));
+		FrameScratch.Add((uint8)Size);
+	}
+	else
+	{
+		FrameScratch.Add(0x80 | 127);
+		for (int32 Shift = 56; Shift >= 0; Shift -= 8)
+		{
+			FrameScratch.Add((uint8)((uint64)Size >> Shift));
+		}
+	}
+
+	const uint32 MaskKey = MaskRandom.GetUnsignedInt();
+	uint8 Mask[4];
+	FMemory::Memcpy(Mask, &MaskKey, sizeof(Mask));
+	FrameScratch.Append(Mask, 4);
+
+	const int32 PayloadStart = FrameScratch.AddUninitialized(Size);
+	uint8* Masked = FrameScratch.GetData() + PayloadStart;
+	for (int32 Index = 0; Index < Size; ++Index)
+	{
+		Masked[Index] = Payload[Index] ^ Mask[Index & 3];
+	}
+
+	WritePlain(FrameScratch.GetData(), FrameScratch.Num());
+}
+
+void FTcpWebSocket::Fail(const FString& Error, int32 Code)
+{
+	const bool bWasOpen = State == EState::Open || State == EState::Closing;
+	DestroySocket();
+	State = EState::Closed;
+
+	if (bWasOpen)
+	{
+		ClosedEvent.Broadcast(Code, Error, false);
+	}
+	else
+	{
+		ConnectionErrorEvent.Broadcast(Error);
+	}
+}
+
+void FTcpWebSocket::Abort(int32 Code, const FString& Reason)
+{
+	Close(Code, Reason);
+	Finish(Code, Reason, false);
+}
+
+void FTcpWebSocket::Finish(int32 Code, const FString& Reason, bool bWasClean)
+{
+	if (State == EState::Closed)
+	{
+		return;
+	}
+
+	DestroySocket();
+	State = EState::Closed;
+	ClosedEvent.Broadcast(Code, Reason, bWasClean);
+}
+
+void FTcpWebSocket::DestroySocket()
+{
+#if WITH_SSL
+	if (Ssl != nullptr)
+	{
+		// Frees the memory buffers with it
+		SSL_free(Ssl);
+		Ssl = nullptr;
+		TlsIn = nullptr;
+		TlsOut = nullptr;
+	}
+	if (SslContext != nullptr)
+	{
+		FSslModule::Get().GetSslManager().DestroySslContext(SslContext);
+		SslContext = nullptr;
+	}
+#endif
+
+	if (Socket != nullptr)
+	{
+		Socket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+
+	Resolved.Reset();
+	Outgoing.Reset();
+	OutgoingOffset = 0;
+}
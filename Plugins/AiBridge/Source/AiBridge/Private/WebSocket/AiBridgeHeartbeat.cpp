@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WebSocket/AiBridgeHeartbeat.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	/** Unanswered pings kept for matching, older ones are counted as missed */
+	constexpr int32 MaxOutstandingPings = 16;
+
+	/** Pongs are a few dozen characters, longer frames are rejected without reading them */
+	constexpr int32 MaxPongChars = 128;
+}
+
+void FAiBridgeHeartbeat::Configure(float InInterval, float InTimeout)
+{
+	FScopeLock ScopeLock(&Lock);
+	Interval = FMath::Max(0.0f, InInterval);
+	Timeout = FMath::Max(InInterval, InTimeout);
+}
+
+void FAiBridgeHeartbeat::Reset(double Now)
+{
+	FScopeLock ScopeLock(&Lock);
+	NextPingTime = Now + Interval;
+	LastInboundTime = Now;
+	Outstanding.Reset();
+}
+
+bool FAiBridgeHeartbeat::TickPing(double Now, FString& OutPing)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	if (Interval <= 0.0f || Now < NextPingTime)
+	{
+		return false;
+	}
+
+	NextPingTime = Now + Interval;
+
+	// Expire pings that can no longer be answered in time, oldest first
+	int32 NumExpired = 0;
+	while (NumExpired < Outstanding.Num()
+		&& (Now - Outstanding[NumExpired].SendTime > Timeout || Outstanding.Num() - NumExpired >= MaxOutstandingPings))
+	{
+		++NumExpired;
+	}
+
+	if (NumExpired > 0)
+	{
+		Outstanding.RemoveAt(0, NumExpired, EAllowShrinking::No);
+		Stats.PongsMissed += NumExpired;
+	}
+
+	FOutstandingPing& Ping = Outstanding.AddDefaulted_GetRef();
+	Ping.Seq = NextSeq++;
+	Ping.SendTime = Now;
+	++Stats.PingsSent;
+
+	OutPing = FString::Printf(TEXT(R"({"type":"ping","seq":%u})"), Ping.Seq);
+	return true;
+}
+
+void FAiBridgeHeartbeat::NotifyInbound(double ReceiveTime)
+{
+	FScopeLock ScopeLock(&Lock);
+	LastInboundTime = FMath::Max(LastInboundTime, ReceiveTime);
+}
+
+bool FAiBridgeHeartbeat::HandleMessage(const FString& Message, double ReceiveTime)
+{
+	// Cheap reject before parsing, this runs on every text frame
+	if (Message.Len() > MaxPongChars || !Message.Contains(TEXT("\"pong\"")))
+	{
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> Json;
+	const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Message);
+	FString Type;
+	if (!FJsonSerializer::Deserialize(Reader, Json) || !Json.IsValid() || !Json->TryGetStringField(TEXT("type"), Type) || Type != TEXT("pong"))
+	{
+		return false;
+	}
+
+	uint32 Seq = 0;
+	Json->TryGetNumberField(TEXT("seq"), Seq);
+
+	FScopeLock ScopeLock(&Lock);
+	LastInboundTime = FMath::Max(LastInboundTime, ReceiveTime);
+
+	const int32 Index = Outstanding.IndexOfByPredicate([Seq](const FOutstandingPing& Ping) { return Ping.Seq == Seq; });
+	if (Index == INDEX_NONE)
+	{
+		// Late reply to a ping already counted as missed, still a reply
+		return true;
+	}
+
+	const float RttMs = static_cast<float>((ReceiveTime - Outstanding[Index].SendTime) * 1000.0);
+	Outstanding.RemoveAt(Index, 1, EAllowShrinking::No);
+
+	// RFC 6298: RTTVAR first, against the previous SRTT
+	if (!bHasRtt)
+	{
+		Stats.SmoothedRttMs = RttMs;
+		Stats.RttJitterMs = RttMs * 0.5f;
+		Stats.MinRttMs = RttMs;
+		bHasRtt = true;
+	}
+	else
+	{
+		Stats.RttJitterMs = 0.75f * Stats.RttJitterMs + 0.25f * FMath::Abs(Stats.SmoothedRttMs - RttMs);
+		Stats.SmoothedRttMs = 0.875f * Stats.SmoothedRttMs + 0.125f * RttMs;
+		Stats.MinRttMs = FMath::Min(Stats.MinRttMs, RttMs);
+	}
+
+	Stats.LastRttMs = RttMs;
+	++Stats.PongsReceived;
+	return true;
+}
+
+bool FAiBridgeHeartbeat::IsDead(double Now) const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Interval > 0.0f && Now - LastInboundTime > Timeout;
+}
+
+FAiBridgeHeartbeatStats FAiBridgeHeartbeat::GetStats(double Now) const
+{
+	FScopeLock ScopeLock(&Lock);
+	FAiBridgeHeartbeatStats Result = Stats;
+	Result.SecondsSinceLastInbound = static_cast<float>(Now - LastInboundTime);
+	return Result;
+}
@@ -0,0 +1,378 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WebSocket/AiBridgeIoThread.h"
+#include "Logging/AiBridgeLog.h"
+#include "Memory/AiBridgeMemory.h"
+#include "WebSocket/AiBridgeOutbox.h"
+#include "HAL/RunnableThread.h"
+#include "IWebSocket.h"
+
+namespace AiBridgeIoThread
+{
+	/** Upper bound on how long the thread sleeps with nothing to do, keeps the wake cadence steady */
+	constexpr double MaxIdleWaitSeconds = 0.05;
+}
+
+FAiBridgeIoThread::FAiBridgeIoThread(TSharedRef<FAiBridgeOutbox, ESPMode::ThreadSafe> InOutbox, TSharedPtr<FAiBridgeMemoryStream, ESPMode::ThreadSafe> InMemory)
+	: Outbox(InOutbox)
+	, Memory(InMemory)
+{
+	Thread = FRunnableThread::Create(this, TEXT("AiBridgeIo"), 0, TPri_AboveNormal);
+}
+
+FAiBridgeIoThread::~FAiBridgeIoThread()
+{
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	// The thread is gone, nothing else can be touching the transport
+	DropTransport();
+}
+
+uint32 FAiBridgeIoThread::Open(FTransportFactory&& MakeTransport, double ConnectTimeout)
+{
+	check(IsInGameThread());
+
+	const uint32 NewSession = NextSession++;
+	Commands.Enqueue([this, NewSession, ConnectTimeout, MakeTransport = MoveTemp(MakeTransport)]() mutable
+	{
+		// Frames queued for the previous transport belong to a session that no longer exists
+		DropTransport();
+		Outbox->Flush(nullptr);
+
+		Session = NewSession;
+		Socket = MakeTransport(Ticker);
+		Socket->OnConnected().AddRaw(this, &FAiBridgeIoThread::HandleConnected);
+		Socket->OnConnectionError().AddRaw(this, &FAiBridgeIoThread::HandleConnectionError);
+		Socket->OnClosed().AddRaw(this, &FAiBridgeIoThread::HandleClosed);
+		Socket->OnMessage().AddRaw(this, &FAiBridgeIoThread::HandleMessage);
+		Socket->OnBinaryMessage().AddRaw(this, &FAiBridgeIoThread::HandleBinaryMessage);
+
+		ConnectTimeoutSeconds = ConnectTimeout;
+		ConnectDeadline = FPlatformTime::Seconds() + ConnectTimeout;
+		Socket->Connect();
+	});
+	Outbox->Wake();
+
+	return NewSession;
+}
+
+void FAiBridgeIoThread::Close(int32 Code, const FString& Reason)
+{
+	check(IsInGameThread());
+
+	Commands.Enqueue([this, Code, Reason]()
+	{
+		// What was queued before the close still goes out ahead of it
+		Outbox->Flush(Socket.Get());
+		DropTransport(Code, Reason);
+	});
+	Outbox->Wake();
+}
+
+uint64 FAiBridgeIoThread::Schedule(double DelaySeconds, TUniqueFunction<void()>&& Callback)
+{
+	check(IsInGameThread());
+
+	const uint64 Id = NextTimerId++;
+	LiveTimers.Add(Id);
+
+	FTimer Timer;
+	Timer.DueTime = FPlatformTime::Seconds() + DelaySeconds;
+	Timer.Id = Id;
+	Timer.Callback = MoveTemp(Callback);
+
+	Commands.Enqueue([this, Timer = MoveTemp(Timer)]() mutable
+	{
+		Timers.HeapPush(MoveTemp(Timer), [](const FTimer& A, const FTimer& B) { return A.DueTime < B.DueTime; });
+	});
+	Outbox->Wake();
+
+	return Id;
+}
+
+void FAiBridgeIoThread::Cancel(uint64 TimerId)
+{
+	check(IsInGameThread());
+
+	// The timer may already be on its way to the game thread, RunDueCallbacks skips ids that are not live
+	LiveTimers.Remove(TimerId);
+}
+
+void FAiBridgeIoThread::RunDueCallbacks()
+{
+	check(IsInGameThread());
+
+	FDueCallback Due;
+	while (DueCallbacks.Dequeue(Due))
+	{
+		if (LiveTimers.Remove(Due.Id) > 0)
+		{
+			Due.Callback();
+		}
+	}
+}
+
+void FAiBridgeIoThread::DrainEvents(TFunctionRef<void(FAiBridgeIoEvent&)> Handler)
+{
+	check(IsInGameThread());
+
+	FAiBridgeIoEvent Event;
+	while (Events.Dequeue(Event))
+	{
+		--InboundQueued;
+		Handler(Event);
+	}
+}
+
+FAiBridgeIoStats FAiBridgeIoThread::GetStats() const
+{
+	FAiBridgeIoStats Stats;
+	Stats.LoopIterations = LoopIterations.load(std::memory_order_relaxed);
+	Stats.FramesReceived = FramesReceived.load(std::memory_order_relaxed);
+	Stats.InboundQueued = InboundQueued.load(std::memory_order_relaxed);
+	Stats.MaxWakeLatenessMs = MaxWakeLatenessMs.load(std::memory_order_relaxed);
+	return Stats;
+}
+
+uint32 FAiBridgeIoThread::Run()
+{
+	LLM_SCOPE_BYTAG(AiBridge_Network);
+
+	double PlannedWake = FPlatformTime::Seconds();
+	double LastTickTime = PlannedWake;
+
+	while (!bStopping)
+	{
+		const double Now = FPlatformTime::Seconds();
+
+		const float LatenessMs = static_cast<float>((Now - PlannedWake) * 1000.0);
+		if (LatenessMs > MaxWakeLatenessMs.load(std::memory_order_relaxed))
+		{
+			MaxWakeLatenessMs.store(LatenessMs, std::memory_order_relaxed);
+		}
+
+		TUniqueFunction<void()> Command;
+		while (Commands.Dequeue(Command))
+		{
+			Command();
+		}
+
+		// Transports read, write and raise their events from here
+		Ticker.Tick(static_cast<float>(Now - LastTickTime));
+		LastTickTime = Now;
+
+		// Never from inside the transport's own event
+		if (bTransportDone)
+		{
+			DropTransport();
+		}
+
+		ServiceLink(FPlatformTime::Seconds());
+		FireDueTimers(FPlatformTime::Seconds());
+		++LoopIterations;
+
+		double WaitSeconds = Socket.IsValid() ? ServiceIntervalSeconds : AiBridgeIoThread::MaxIdleWaitSeconds;
+		if (Timers.Num() > 0)
+		{
+			WaitSeconds = FMath::Clamp(Timers.HeapTop().DueTime - FPlatformTime::Seconds(), 0.0, WaitSeconds);
+		}
+
+		PlannedWake = FPlatformTime::Seconds() + WaitSeconds;
+		if (Outbox->WaitForWork(WaitSeconds))
+		{
+			// Woken early by new work, that is not lateness
+			PlannedWake = FPlatformTime::Seconds();
+		}
+	}
+
+	return 0;
+}
+
+void FAiBridgeIoThread::Stop()
+{
+	bStopping = true;
+	Outbox->Wake();
+}
+
+void FAiBridgeIoThread::ServiceLink(double Now)
+{
+	if (!Socket.IsValid())
+	{
+		return;
+	}
+
+	if (!bLinkOpen)
+	{
+		if (Now >= ConnectDeadline)
+		{
+			DropTransport();
+
+			FAiBridgeIoEvent Event;
+			Event.Kind = EAiBridgeIoEventKind::ConnectionError;
+			Event.Text = FString::Printf(TEXT("Connect timed out after %.1fs"), ConnectTimeoutSeconds);
+			PostEvent(MoveTemp(Event));
+		}
+		return;
+	}
+
+	if (Heartbeat.IsDead(Now))
+	{
+		const FAiBridgeHeartbeatStats Stats = Heartbeat.GetStats(Now);
+		UE_LOG(LogAiBridge, Warning, TEXT("Heartbeat: nothing received for %.1fs (%d pongs missed), dropping half-open link"),
+			Stats.SecondsSinceLastInbound, Stats.PongsMissed);
+
+		// A half-open socket may never report its own close, tear it down and report one for it
+		DropTransport(1001, TEXT("Heartbeat timeout"));
+
+		FAiBridgeIoEvent Event;
+		Event.Kind = EAiBridgeIoEventKind::Closed;
+		Event.StatusCode = 1006;
+		Event.Text = TEXT("Heartbeat timeout");
+		PostEvent(MoveTemp(Event));
+		return;
+	}
+
+	// Queued behind what producers already sent and stamped as it is written
+	FString Ping;
+	if (Heartbeat.TickPing(Now, Ping))
+	{
+		Outbox->SendText(MoveTemp(Ping));
+	}
+
+	Outbox->Flush(Socket.Get());
+}
+
+void FAiBridgeIoThread::DropTransport(int32 Code, const FString& Reason)
+{
+	Outbox->SetLinkUp(false);
+	bLinkOpen = false;
+	bTransportDone = false;
+
+	if (!Socket.IsValid())
+	{
+		return;
+	}
+
+	TSharedPtr<IWebSocket> Dropped = MoveTemp(Socket);
+	Dropped->OnConnected().RemoveAll(this);
+	Dropped->OnConnectionError().RemoveAll(this);
+	Dropped->OnClosed().RemoveAll(this);
+	Dropped->OnMessage().RemoveAll(this);
+	Dropped->OnBinaryMessage().RemoveAll(this);
+	Dropped->Close(Code, Reason);
+}
+
+void FAiBridgeIoThread::PostEvent(FAiBridgeIoEvent&& Event)
+{
+	Event.Session = Session;
+	if (Event.ReceiveTime == 0.0)
+	{
+		Event.ReceiveTime = FPlatformTime::Seconds();
+	}
+
+	++InboundQueued;
+	Events.Enqueue(MoveTemp(Event));
+}
+
+void FAiBridgeIoThread::FireDueTimers(double Now)
+{
+	while (Timers.Num() > 0 && Timers.HeapTop().DueTime <= Now)
+	{
+		FTimer Timer;
+		Timers.HeapPop(Timer, [](const FTimer& A, const FTimer& B) { return A.DueTime < B.DueTime; }, EAllowShrinking::No);
+
+		FDueCallback Due;
+		Due.Id = Timer.Id;
+		Due.Callback = MoveTemp(Timer.Callback);
+		DueCallbacks.Enqueue(MoveTemp(Due));
+	}
+}
+
+void FAiBridgeIoThread::HandleConnected()
+{
+	bLinkOpen = true;
+	Heartbeat.Reset(FPlatformTime::Seconds());
+	Outbox->SetLinkUp(true);
+
+	FAiBridgeIoEvent Event;
+	Event.Kind = EAiBridgeIoEventKind::Connected;
+	PostEvent(MoveTemp(Event));
+}
+
+void FAiBridgeIoThread::HandleConnectionError(const FString& Error)
+{
+	Outbox->SetLinkUp(false);
+	bLinkOpen = false;
+	bTransportDone = true;
+
+	FAiBridgeIoEvent Event;
+	Event.Kind = EAiBridgeIoEventKind::ConnectionError;
+	Event.Text = Error;
+	PostEvent(MoveTemp(Event));
+}
+
+void FAiBridgeIoThread::HandleClosed(int32 StatusCode, const FString& Reason, bool bWasClean)
+{
+	Outbox->SetLinkUp(false);
+	bLinkOpen = false;
+	bTransportDone = true;
+
+	FAiBridgeIoEvent Event;
+	Event.Kind = EAiBridgeIoEventKind::Closed;
+	Event.Text = Reason;
+	Event.StatusCode = StatusCode;
+	Event.bWasClean = bWasClean;
+	PostEvent(MoveTemp(Event));
+}
+
+void FAiBridgeIoThread::HandleMessage(const FString& Message)
+{
+	const double ReceiveTime = FPlatformTime::Seconds();
+	Heartbeat.NotifyInbound(ReceiveTime);
+
+	// Heartbeat replies are link bookkeeping, not messages for the game
+	if (Heartbeat.HandleMessage(Message, ReceiveTime))
+	{
+		return;
+	}
+
+	// Protocol messages are never dropped, they only count towards the budget
+	if (Memory)
+	{
+		Memory->Add(EAiBridgeMemoryCategory::Messages, Message.Len() * sizeof(TCHAR));
+	}
+
+	FAiBridgeIoEvent Event;
+	Event.Kind = EAiBridgeIoEventKind::Text;
+	Event.Text = Message;
+	Event.ReceiveTime = ReceiveTime;
+	++FramesReceived;
+	PostEvent(MoveTemp(Event));
+}
+
+void FAiBridgeIoThread::HandleBinaryMessage(const void* Data, SIZE_T Size, bool bIsLastFragment)
+{
+	const double ReceiveTime = FPlatformTime::Seconds();
+	Heartbeat.NotifyInbound(ReceiveTime);
+
+	// Audio the game thread has not caught up with goes first when a hitch outlasts the budget
+	if (Memory && !Memory->TryAdd(EAiBridgeMemoryCategory::Messages, Size))
+	{
+		Memory->NoteEvicted(EAiBridgeMemoryCategory::Messages, Size);
+		AIBRIDGE_LOG_SAMPLED(50, Warning, "ws.binary.dropped", FAiBridgeLogField::Int(TEXT("bytes"), (int64)Size), FAiBridgeLogField::Int(TEXT("budget"), Memory->GetBudget(EAiBridgeMemoryCategory::Messages)));
+		return;
+	}
+
+	FAiBridgeIoEvent Event;
+	Event.Kind = EAiBridgeIoEventKind::Binary;
+	Event.Bytes.Append(static_cast<const uint8*>(Data), Size);
+	Event.ReceiveTime = ReceiveTime;
+	++FramesReceived;
+	PostEvent(MoveTemp(Event));
+}
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WebSocket/AiBridgeOutbox.h"
+#include "IWebSocket.h"
+#include "HAL/Event.h"
+
+FAiBridgeOutbox::FAiBridgeOutbox()
+{
+	WorkEvent = FPlatformProcess::GetSynchEventFromPool(false);
+}
+
+FAiBridgeOutbox::~FAiBridgeOutbox()
+{
+	FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+	WorkEvent = nullptr;
+}
+
+bool FAiBridgeOutbox::Send(FAiBridgeOutboundFrame&& Frame)
+{
+	if (!IsLinkUp())
+	{
+		return false;
+	}
+
+	NumQueued.fetch_add(1, std::memory_order_relaxed);
+	Frames.Enqueue(MoveTemp(Frame));
+	WorkEvent->Trigger();
+	return true;
+}
+
+bool FAiBridgeOutbox::SendText(FString&& Text)
+{
+	FAiBridgeOutboundFrame Frame;
+	Frame.Text = MoveTemp(Text);
+	return Send(MoveTemp(Frame));
+}
+
+bool FAiBridgeOutbox::SendUtf8Text(TArray<uint8>&& Utf8)
+{
+	FAiBridgeOutboundFrame Frame;
+	Frame.Bytes = MoveTemp(Utf8);
+	return Send(MoveTemp(Frame));
+}
+
+bool FAiBridgeOutbox::SendBinary(TArray<uint8>&& Bytes)
+{
+	FAiBridgeOutboundFrame Frame;
+	Frame.bIsBinary = true;
+	Frame.Bytes = MoveTemp(Bytes);
+	return Send(MoveTemp(Frame));
+}
+
+void FAiBridgeOutbox::Wake()
+{
+	WorkEvent->Trigger();
+}
+
+bool FAiBridgeOutbox::WaitForWork(double Seconds)
+{
+	return WorkEvent->Wait(FTimespan::FromSeconds(Seconds));
+}
+
+int32 FAiBridgeOutbox::Flush(IWebSocket* Socket)
+{
+	const bool bConnected = Socket != nullptr && Socket->IsConnected();
+
+	int32 NumWritten = 0;
+	FAiBridgeOutboundFrame Frame;
+	while (Frames.Dequeue(Frame))
+	{
+		NumQueued.fetch_sub(1, std::memory_order_relaxed);
+		if (!bConnected)
+		{
+			continue;
+		}
+
+		if (Frame.bIsBinary || Frame.Bytes.Num() > 0)
+		{
+			Socket->Send(Frame.Bytes.GetData(), Frame.Bytes.Num(), Frame.bIsBinary);
+			BytesSent.fetch_add(Frame.Bytes.Num(), std::memory_order_relaxed);
+		}
+		else
+		{
+			Socket->Send(Frame.Text);
+			BytesSent.fetch_add(Frame.Text.Len(), std::memory_order_relaxed);
+		}
+
+		FramesSent.fetch_add(1, std::memory_order_relaxed);
+		++NumWritten;
+	}
+	return NumWritten;
+}
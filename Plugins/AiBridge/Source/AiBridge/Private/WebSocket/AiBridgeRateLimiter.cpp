@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WebSocket/AiBridgeRateLimiter.h"
+#include "Logging/AiBridgeLog.h"
+
+void FAiBridgeRateLimiter::Configure(const TArray<FAiBridgeRateLimit>& Limits)
+{
+	Buckets.Reset();
+	for (const FAiBridgeRateLimit& Limit : Limits)
+	{
+		// A bucket starts full, the first burst after startup is never held back
+		FBucket& Bucket = Buckets.Add(Limit.Bucket);
+		Bucket.Limit = Limit;
+		Bucket.Tokens = Limit.Burst;
+	}
+}
+
+bool FAiBridgeRateLimiter::Submit(FName Bucket, TUniqueFunction<bool()>&& Send, double Now)
+{
+	FBucket* Found = Buckets.Find(Bucket);
+	if (Found == nullptr)
+	{
+		if (Send())
+		{
+			++Stats.Admitted;
+		}
+		return true;
+	}
+
+	Refill(*Found, Now);
+
+	// Requests already waiting go first, a newcomer never overtakes them
+	if (Found->Queue.Num() == 0 && Found->Tokens >= 1.0)
+	{
+		if (Send())
+		{
+			Found->Tokens -= 1.0;
+			++Stats.Admitted;
+		}
+		return true;
+	}
+
+	if (Found->Queue.Num() >= Found->Limit.MaxQueued)
+	{
+		++Stats.Rejected;
+		AIBRIDGE_LOG_EVENT(Warning, "ratelimit.rejected", FAiBridgeLogField::Text(TEXT("bucket"), Bucket.ToString()), FAiBridgeLogField::Int(TEXT("queued"), Found->Queue.Num()));
+		return false;
+	}
+
+	++Stats.Throttled;
+	Found->Queue.Add({ MoveTemp(Send), Now });
+	return true;
+}
+
+void FAiBridgeRateLimiter::Tick(double Now)
+{
+	for (TPair<FName, FBucket>& Pair : Buckets)
+	{
+		FBucket& Bucket = Pair.Value;
+		if (Bucket.Queue.Num() == 0)
+		{
+			continue;
+		}
+
+		Refill(Bucket, Now);
+
+		int32 NumReleased = 0;
+		while (NumReleased < Bucket.Queue.Num() && Bucket.Tokens >= 1.0)
+		{
+			FPending& Pending = Bucket.Queue[NumReleased++];
+
+			// Sends only hand the request to the outbox, they cannot come back into the limiter. One whose
+			// caller gave up while it waited sends nothing and leaves its token to the next
+			if (!Pending.Send())
+			{
+				continue;
+			}
+
+			Bucket.Tokens -= 1.0;
+			Stats.MaxWaitMs = FMath::Max(Stats.MaxWaitMs, (float)((Now - Pending.SubmitTime) * 1000.0));
+			++Stats.Admitted;
+		}
+
+		if (NumReleased > 0)
+		{
+			Bucket.Queue.RemoveAt(0, NumReleased, EAllowShrinking::No);
+		}
+	}
+}
+
+void FAiBridgeRateLimiter::Reset()
+{
+	for (TPair<FName, FBucket>& Pair : Buckets)
+	{
+		Pair.Value.Queue.Reset();
+	}
+}
+
+FAiBridgeRateLimiterStats FAiBridgeRateLimiter::GetStats() const
+{
+	FAiBridgeRateLimiterStats Snapshot = Stats;
+	Snapshot.Queued = 0;
+	for (const TPair<FName, FBucket>& Pair : Buckets)
+	{
+		Snapshot.Queued += Pair.Value.Queue.Num();
+	}
+	return Snapshot;
+}
+
+void FAiBridgeRateLimiter::Refill(FBucket& Bucket, double Now)
+{
+	if (Bucket.RefillTime > 0.0)
+	{
+		const double TokensPerSecond = Bucket.Limit.RequestsPerMinute / 60.0;
+		Bucket.Tokens = FMath::Min<double>(Bucket.Tokens + (Now - Bucket.RefillTime) * TokensPerSecond, Bucket.Limit.Burst);
+	}
+	Bucket.RefillTime = Now;
+}
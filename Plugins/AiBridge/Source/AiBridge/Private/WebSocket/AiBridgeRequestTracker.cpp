@@ -0,0 +1,363 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WebSocket/AiBridgeRequestTracker.h"
+#include "Logging/AiBridgeLog.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace AiBridgeRequestTracker
+{
+	// Reply types of the orchestrator protocol
+	const TCHAR* const EchoType = TEXT("textinput");
+	const TCHAR* const ErrorType = TEXT("error");
+	const TCHAR* const TextCompleteTypes[] = { TEXT("llm_complete"), TEXT("response_complete"), TEXT("turn_complete") };
+	const TCHAR* const AudioCompleteTypes[] = { TEXT("tts_complete"), TEXT("audio_complete"), TEXT("audio_end") };
+
+	/** Fields carrying only the reply text added since the last message */
+	const TCHAR* const DeltaFields[] = { TEXT("token"), TEXT("delta") };
+
+	/** Field carrying the whole reply text so far, as cumulative streams and final messages send it */
+	const TCHAR* const SnapshotField = TEXT("text");
+
+	/** Quiet time after which a reply whose text is done no longer waits for audio */
+	constexpr double AudioGraceSeconds = 5.0;
+
+	template <int32 N>
+	bool IsOneOf(const FString& Type, const TCHAR* const (&Types)[N])
+	{
+		for (const TCHAR* Candidate : Types)
+		{
+			if (Type == Candidate)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+void FAiBridgeRequestTracker::Begin(const FString& RequestId, FAiBridgeReplyHandlers&& Handlers, bool bExpectAudio, double Now, double TimeoutSeconds)
+{
+	FRequest& Request = Requests.AddDefaulted_GetRef();
+	Request.RequestId = RequestId;
+	Request.Handlers.Add(MoveTemp(Handlers));
+	Request.bExpectAudio = bExpectAudio;
+	Request.Timeout = TimeoutSeconds;
+	Request.LastActivityTime = Now;
+}
+
+void FAiBridgeRequestTracker::MarkSent(const FString& RequestId, double Now)
+{
+	const int32 Index = Find(RequestId);
+	if (Index != INDEX_NONE)
+	{
+		Requests[Index].bSent = true;
+		Requests[Index].LastActivityTime = Now;
+	}
+}
+
+bool FAiBridgeRequestTracker::Join(const FString& RequestId, FAiBridgeReplyHandlers&& Handlers)
+{
+	const int32 Index = Find(RequestId);
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// Copied first, the replayed handlers may start or cancel requests
+	const FAiBridgeReplyHandlers Joined = Handlers;
+	FRequest& Request = Requests[Index];
+	const FString Text = Request.Text;
+	const bool bHasToken = Request.bHasToken;
+	const bool bAudioStarted = Request.bAudioStarted;
+	Request.Handlers.Add(MoveTemp(Handlers));
+
+	if (bHasToken && Joined.OnFirstToken)
+	{
+		Joined.OnFirstToken(Text);
+	}
+	if (!Text.IsEmpty() && Joined.OnDelta)
+	{
+		Joined.OnDelta(Text);
+	}
+	if (bAudioStarted && Joined.OnAudioStart)
+	{
+		Joined.OnAudioStart();
+	}
+	return true;
+}
+
+bool FAiBridgeRequestTracker::HandleText(const FString& Message, double Now)
+{
+	using namespace AiBridgeRequestTracker;
+
+	// Nothing to correlate, leave the message alone without parsing it
+	if (Requests.Num() == 0)
+	{
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> Json;
+	const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Message);
+	if (!FJsonSerializer::Deserialize(Reader, Json) || !Json.IsValid())
+	{
+		return false;
+	}
+
+	FString Type;
+	Json->TryGetStringField(TEXT("type"), Type);
+
+	FString RequestId;
+	int32 Index = INDEX_NONE;
+	if (Json->TryGetStringField(TEXT("requestId"), RequestId))
+	{
+		Index = Find(RequestId);
+	}
+	else if (IsOneOf(Type, AudioCompleteTypes))
+	{
+		Index = Requests.IndexOfByPredicate([](const FRequest& Request) { return Request.bAudioStarted && !Request.bAudioComplete; });
+	}
+
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	FRequest& Request = Requests[Index];
+	Request.LastActivityTime = Now;
+
+	// The loopback transport and some proxies echo the request back
+	if (Type == EchoType)
+	{
+		return true;
+	}
+
+	if (Type == ErrorType)
+	{
+		FString Error;
+		if (!Json->TryGetStringField(TEXT("message"), Error) && !Json->TryGetStringField(TEXT("error"), Error))
+		{
+			Error = Message;
+		}
+		Fail(Index, Error);
+		return true;
+	}
+
+	if (IsOneOf(Type, AudioCompleteTypes))
+	{
+		Request.bAudioComplete = true;
+		TryComplete(Index, Now);
+		return true;
+	}
+
+	// The field says how to read the text: a delta whose words happen to repeat the reply so far is still appended
+	FString Delta;
+	bool bHasDelta = false;
+	for (const TCHAR* Field : DeltaFields)
+	{
+		if (Json->TryGetStringField(Field, Delta))
+		{
+			bHasDelta = true;
+			break;
+		}
+	}
+
+	FString Snapshot;
+	if (bHasDelta)
+	{
+		Request.Text += Delta;
+	}
+	else if (Json->TryGetStringField(SnapshotField, Snapshot))
+	{
+		// Only what extends the text so far is new; a snapshot that rewrites it cannot be told as a delta
+		if (Snapshot.StartsWith(Request.Text, ESearchCase::CaseSensitive))
+		{
+			Delta = Snapshot.RightChop(Request.Text.Len());
+		}
+		else
+		{
+			AIBRIDGE_LOG_EVENT(Verbose, "request.text.rewritten", FAiBridgeLogField::Text(TEXT("id"), Request.RequestId));
+		}
+		Request.Text = MoveTemp(Snapshot);
+	}
+
+	bool bFinal = false;
+	Json->TryGetBoolField(TEXT("isFinal"), bFinal);
+	if ((bFinal || IsOneOf(Type, TextCompleteTypes)) && !Request.bTextComplete)
+	{
+		Request.bTextComplete = true;
+		Request.TextCompleteTime = Now;
+	}
+
+	const bool bFirstToken = !Request.bHasToken && !Request.Text.IsEmpty();
+	if (bFirstToken || !Delta.IsEmpty())
+	{
+		Request.bHasToken = true;
+
+		// Handlers may start or cancel requests, so the request is looked up again afterwards
+		const TArray<FAiBridgeReplyHandlers, TInlineAllocator<1>> Handlers = Request.Handlers;
+		const FString FirstText = bFirstToken ? Request.Text : FString();
+		for (const FAiBridgeReplyHandlers& Handler : Handlers)
+		{
+			if (bFirstToken && Handler.OnFirstToken)
+			{
+				Handler.OnFirstToken(FirstText);
+			}
+			if (!Delta.IsEmpty() && Handler.OnDelta)
+			{
+				Handler.OnDelta(Delta);
+			}
+		}
+
+		Index = Find(RequestId);
+		if (Index == INDEX_NONE)
+		{
+			return true;
+		}
+	}
+
+	TryComplete(Index, Now);
+	return true;
+}
+
+void FAiBridgeRequestTracker::HandleBinary(double Now)
+{
+	const int32 Index = Requests.IndexOfByPredicate([](const FRequest& Request) { return Request.bExpectAudio && !Request.bAudioComplete; });
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	FRequest& Request = Requests[Index];
+	Request.LastActivityTime = Now;
+
+	if (!Request.bAudioStarted)
+	{
+		Request.bAudioStarted = true;
+
+		const TArray<FAiBridgeReplyHandlers, TInlineAllocator<1>> Handlers = Request.Handlers;
+		if (OnRequestAudioStart)
+		{
+			OnRequestAudioStart(Request.RequestId);
+		}
+		for (const FAiBridgeReplyHandlers& Handler : Handlers)
+		{
+			if (Handler.OnAudioStart)
+			{
+				Handler.OnAudioStart();
+			}
+		}
+	}
+}
+
+void FAiBridgeRequestTracker::Tick(double Now)
+{
+	// Handlers may change the list, so each finished request restarts the scan
+	bool bChanged = true;
+	while (bChanged)
+	{
+		bChanged = false;
+		for (int32 Index = 0; Index < Requests.Num(); ++Index)
+		{
+			if (TryComplete(Index, Now))
+			{
+				bChanged = true;
+				break;
+			}
+
+			const FRequest& Request = Requests[Index];
+			if (Request.bSent && Request.Timeout > 0.0 && Now - Request.LastActivityTime > Request.Timeout)
+			{
+				Fail(Index, FString::Printf(TEXT("No reply for %.0f seconds"), Request.Timeout));
+				bChanged = true;
+				break;
+			}
+		}
+	}
+}
+
+void FAiBridgeRequestTracker::FailAll(const FString& Error)
+{
+	TArray<FRequest> Failed = MoveTemp(Requests);
+	Requests.Reset();
+
+	for (const FRequest& Request : Failed)
+	{
+		for (const FAiBridgeReplyHandlers& Handler : Request.Handlers)
+		{
+			if (Handler.OnFailed)
+			{
+				Handler.OnFailed(Error);
+			}
+		}
+	}
+}
+
+void FAiBridgeRequestTracker::Fail(const FString& RequestId, const FString& Error)
+{
+	const int32 Index = Find(RequestId);
+	if (Index != INDEX_NONE)
+	{
+		Fail(Index, Error);
+	}
+}
+
+void FAiBridgeRequestTracker::Cancel(const FString& RequestId)
+{
+	Requests.RemoveAll([&RequestId](const FRequest& Request) { return Request.RequestId == RequestId; });
+}
+
+bool FAiBridgeRequestTracker::Contains(const FString& RequestId) const
+{
+	return Find(RequestId) != INDEX_NONE;
+}
+
+int32 FAiBridgeRequestTracker::Find(const FString& RequestId) const
+{
+	return Requests.IndexOfByPredicate([&RequestId](const FRequest& Request) { return Request.RequestId == RequestId; });
+}
+
+bool FAiBridgeRequestTracker::TryComplete(int32 Index, double Now)
+{
+	const FRequest& Request = Requests[Index];
+
+	// Audio that ended, never started or went quiet after the text was done
+	const bool bAudioDone = !Request.bExpectAudio || Request.bAudioComplete
+		|| (Request.bTextComplete && Now - FMath::Max(Request.LastActivityTime, Request.TextCompleteTime) > AiBridgeRequestTracker::AudioGraceSeconds);
+	if (!Request.bTextComplete || !bAudioDone)
+	{
+		return false;
+	}
+
+	FRequest Done = MoveTemp(Requests[Index]);
+	Requests.RemoveAt(Index, 1, EAllowShrinking::No);
+
+	AIBRIDGE_LOG_EVENT(Verbose, "request.complete", FAiBridgeLogField::Text(TEXT("id"), Done.RequestId), FAiBridgeLogField::Int(TEXT("chars"), Done.Text.Len()));
+
+	for (const FAiBridgeReplyHandlers& Handler : Done.Handlers)
+	{
+		if (Handler.OnComplete)
+		{
+			Handler.OnComplete(Done.Text);
+		}
+	}
+	return true;
+}
+
+void FAiBridgeRequestTracker::Fail(int32 Index, const FString& Error)
+{
+	FRequest Failed = MoveTemp(Requests[Index]);
+	Requests.RemoveAt(Index, 1, EAllowShrinking::No);
+
+	AIBRIDGE_LOG_EVENT(Warning, "request.failed", FAiBridgeLogField::Text(TEXT("id"), Failed.RequestId), FAiBridgeLogField::Text(TEXT("error"), Error));
+
+	for (const FAiBridgeReplyHandlers& Handler : Failed.Handlers)
+	{
+		if (Handler.OnFailed)
+		{
+			Handler.OnFailed(Error);
+		}
+	}
+}
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WebSocket/AiBridgeThroughputMeter.h"
+
+namespace AiBridgeThroughputMeter
+{
+	/** Silence that ends a burst */
+	constexpr double IdleGapSeconds = 0.5;
+
+	/** Slowest link the meter expects, a gap as long as the last frame would take at this speed is transfer, not idle */
+	constexpr double MinLinkKbps = 32.0;
+
+	/** A long transfer is sampled every so often instead of once at its end */
+	constexpr double MaxBurstSeconds = 1.0;
+
+	/** Smaller bursts are dominated by latency and scheduling, not by the link */
+	constexpr int64 MinSampleBytes = 16 * 1024;
+
+	/** Weight of a new sample in the estimate. Drops count more than recoveries so audio starts degrading before it stalls */
+	constexpr float RiseSmoothing = 0.3f;
+	constexpr float FallSmoothing = 0.6f;
+
+	double GetIdleGap(int32 LastFrameBytes)
+	{
+		return FMath::Max(IdleGapSeconds, LastFrameBytes * 8 / (MinLinkKbps * 1000.0));
+	}
+}
+
+void FAiBridgeThroughputMeter::AddFrame(int32 Bytes, double ReceiveTime, double Resolution)
+{
+	using namespace AiBridgeThroughputMeter;
+
+	Stats.BytesReceived += Bytes;
+
+	if (bInBurst && (ReceiveTime - LastFrameTime > GetIdleGap(LastFrameBytes)
+		|| (ReceiveTime - BurstStartTime > MaxBurstSeconds && BurstBytes >= MinSampleBytes)))
+	{
+		CloseBurst();
+	}
+
+	if (!bInBurst)
+	{
+		// The first frame only starts the clock
+		bInBurst = true;
+		BurstStartTime = ReceiveTime;
+		BurstBytes = 0;
+		BurstResolution = Resolution;
+	}
+	else
+	{
+		BurstBytes += Bytes;
+		BurstResolution = FMath::Max(BurstResolution, Resolution);
+	}
+	LastFrameTime = ReceiveTime;
+	LastFrameBytes = Bytes;
+}
+
+void FAiBridgeThroughputMeter::Flush(double Now)
+{
+	if (bInBurst && Now - LastFrameTime > AiBridgeThroughputMeter::GetIdleGap(LastFrameBytes))
+	{
+		CloseBurst();
+	}
+}
+
+void FAiBridgeThroughputMeter::Reset()
+{
+	Stats = FAiBridgeThroughputStats();
+	bInBurst = false;
+}
+
+void FAiBridgeThroughputMeter::CloseBurst()
+{
+	bInBurst = false;
+
+	// Either end of the burst may have arrived up to a stamp's resolution earlier than it was seen
+	const double Duration = LastFrameTime - BurstStartTime + BurstResolution;
+	if (BurstBytes < AiBridgeThroughputMeter::MinSampleBytes || Duration <= UE_SMALL_NUMBER)
+	{
+		return;
+	}
+
+	const float Kbps = (float)(BurstBytes * 8 / Duration / 1000.0);
+	Stats.LastSampleKbps = Kbps;
+	const float Smoothing = Kbps < Stats.EstimatedKbps ? AiBridgeThroughputMeter::FallSmoothing : AiBridgeThroughputMeter::RiseSmoothing;
+	Stats.EstimatedKbps = Stats.Samples > 0 ? FMath::Lerp(Stats.EstimatedKbps, Kbps, Smoothing) : Kbps;
+	++Stats.Samples;
+}
@@ -2,114 +2,138 @@
 
 
 #include "WebSocket/WebSocketConnection.h"
+#include "Logging/AiBridgeLog.h"
 #include "IWebSocket.h"
-#include "WebSocketsModule.h"
-
-
+#include "Capture/AiBridgeCapture.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Transport/CaptureWebSocket.h"
+#include "Transport/LoopbackWebSocket.h"
+#include "Transport/NetworkConditionWebSocket.h"
+#include "Transport/ReplayWebSocket.h"
+#include "Transport/TcpWebSocket.h"
+#include "UObject/UObjectIterator.h"
 
 bool UWebSocketConnection::IsConnected() const
 {
-	return WebSocket.IsValid() && WebSocket->IsConnected();
+	return bLinkOpen;
 }
 
 void UWebSocketConnection::Connect(const FString& Url, const FString& ConnectionId, const FString& InToken, TFunction<void(bool)> Callback)
 {
 	if (IsConnected() || bIsConnecting)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Already connected or connecting"));
+		UE_LOG(LogAiBridge, Warning, TEXT("Already connected or connecting"));
 		Callback(false);
 		return;
 	}
 
 	bIsConnecting = true;
+	bIsDisconnecting = false;
+	bAutoReconnect = true;
 	JwtToken = InToken;
 	LastUrl = Url;
+	LastConnectionId = ConnectionId;
+	PendingConnectCallback = MoveTemp(Callback);
 
 	FString SafeUrl = SanitizeUrl(Url);
 
-	UE_LOG(LogTemp, Log, TEXT("🔌 Connecting to %s"), *SafeUrl);
+	UE_LOG(LogAiBridge, Log, TEXT("🔌 Connecting to %s"), *SafeUrl);
 
-	WebSocket = FWebSocketsModule::Get().CreateWebSocket(Url);
+	EnsureIoThread();
 
-	//WebSocket->OnConnected().AddRaw(this, &UWebSocketConnection::HandleConnected);
-	WebSocket->OnConnected().AddLambda([this]()
+	if (!bCheckedCaptureCommandLine)
 	{
-		HandleConnected();
-	});
+		bCheckedCaptureCommandLine = true;
 
-	WebSocket->OnConnectionError().AddLambda(
-		[this, Callback](const FString& Error)
+		FString CaptureDirectory;
+		if (!Capture && (FParse::Value(FCommandLine::Get(), TEXT("-AiBridgeCapture="), CaptureDirectory) || FParse::Param(FCommandLine::Get(), TEXT("AiBridgeCapture"))))
 		{
-			HandleError(Error);
-			bIsConnecting = false;
-			Callback(false);
+			StartCapture(AiBridgeCapture::MakeCapturePath(CaptureDirectory, ConnectionId));
 		}
-	);
+	}
 
-	//WebSocket->OnClosed().AddRaw(this, &UWebSocketConnection::HandleClosed);
-	WebSocket->OnClosed().AddLambda([this](int32 StatusCode, const FString& Reason, bool bWasClean)
+	// Nothing is accepted for the new session until its transport has connected
+	Outbox->SetLinkUp(false);
+	bLinkOpen = false;
+
+	IoThread->GetHeartbeat().Configure(HeartbeatInterval, HeartbeatTimeout);
+
+	// Built, connected and timed out on the I/O thread; its events come back through PumpIo tagged with the session
+	const bool bSimulateNetwork = FNetworkConditions::IsSimulationEnabled();
+	Session = IoThread->Open([Url, CaptureWriter = Capture, bSimulateNetwork](FTSTicker& Ticker)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("OnClosed"));
-		//HandleClosed(StatusCode, Reason, bWasClean);
-	});
-	
-	WebSocket->OnMessage().AddLambda(
-		[this](const FString& Msg)
-		{
-			if (OnTextMessage) OnTextMessage(Msg);
-		}
-	);
+		return CreateTransport(Url, Ticker, CaptureWriter, bSimulateNetwork);
+	}, ConnectTimeout);
+}
 
-	WebSocket->OnBinaryMessage().AddLambda(
-		[this](const void* Data, SIZE_T Size, bool isLast)
-		{
-			TArray<uint8> Bytes;
-			Bytes.Append((uint8*)Data, Size);
+void UWebSocketConnection::Disconnect()
+{
+	bAutoReconnect = false;
+	bIsDisconnecting = true;
 
-			if (OnBinaryMessage) OnBinaryMessage(Bytes);
-		}
-	);
+	// What was queued before the disconnect still goes out ahead of the close
+	Outbox->SetLinkUp(false);
+	if (IoThread)
+	{
+		IoThread->Close();
+	}
 
-	WebSocket->Connect();
+	// Whatever the dropped transport reported meanwhile is stale now
+	Session = 0;
+	bLinkOpen = false;
 
-	// Simulate "await connection with timeout"
-	FTimerHandle Timer;
-	GWorld->GetTimerManager().SetTimer(
-		Timer,
-		[this, Callback]()
-		{
-			bool bSuccess = IsConnected();
-			bIsConnecting = false;
-			Callback(bSuccess);
-		},
-		10.0f,
-		false
-	);
+	// An explicit disconnect is not a failed connect, the caller must not fail over or retry
+	PendingConnectCallback = nullptr;
+	FinishConnect(false);
 }
 
-void UWebSocketConnection::Disconnect()
+void UWebSocketConnection::BeginDestroy()
 {
+	FTSTicker::GetCoreTicker().RemoveTicker(PumpHandle);
+
 	bAutoReconnect = false;
-	bIsDisconnecting = true;
+	PendingConnectCallback = nullptr;
+	Session = 0;
+	bLinkOpen = false;
 
-	if (WebSocket.IsValid())
+	// Producers still holding the outbox see a closed link from now on, the thread closes the transport as it goes
+	Outbox->SetLinkUp(false);
+	IoThread.Reset();
+	Outbox->Flush(nullptr);
+
+	StopCapture();
+
+	Super::BeginDestroy();
+}
+
+void UWebSocketConnection::EnsureIoThread()
+{
+	check(IsInGameThread());
+
+	if (!IoThread)
 	{
-		WebSocket->Close();
-		WebSocket = nullptr;
+		LLM_SCOPE_BYTAG(AiBridge_Network);
+		Memory = AiBridgeMemory::CreateStream(GetFName());
+		IoThread = MakeUnique<FAiBridgeIoThread>(Outbox, Memory);
+		PumpHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UWebSocketConnection::PumpIo));
 	}
 }
 
 void UWebSocketConnection::HandleConnected()
 {
+	bLinkOpen = true;
 	bIsConnecting = false;
 	ReconnectAttempts = 0;
 	CurrentReconnectDelay = ReconnectBaseDelay;
 
 	if (bVerbose)
 	{
-		UE_LOG(LogTemp, Log, TEXT("✅ Connected"));
+		UE_LOG(LogAiBridge, Log, TEXT("✅ Connected"));
 	}
 
+	FinishConnect(true);
+
 	if (OnConnected) OnConnected();
 }
 
@@ -117,20 +141,26 @@ void UWebSocketConnection::HandleClosed(int32 StatusCode, const FString& Reason,
 {
 	if (bVerbose)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("🔌 Disconnected: %d"), StatusCode);
+		UE_LOG(LogAiBridge, Warning, TEXT("🔌 Disconnected: %d"), StatusCode);
 	}
 
+	bLinkOpen = false;
+
+	// A close during the handshake is reported through the connect callback, which owns the retry
+	const bool bWasEstablished = !bIsConnecting;
+	FinishConnect(false);
+
 	if (OnDisconnected) OnDisconnected();
 
-	if (bAutoReconnect)
+	if (bWasEstablished && bReconnectOnDrop && bAutoReconnect && !bIsDisconnecting)
 	{
-		//AttemptReconnect();
+		AttemptReconnect();
 	}
 }
 
 void UWebSocketConnection::HandleError(const FString& Error)
 {
-	UE_LOG(LogTemp, Error, TEXT("WebSocket error: %s"), *Error);
+	UE_LOG(LogAiBridge, Error, TEXT("WebSocket error: %s"), *Error);
 
 	if (OnError) OnError(Error);
 }
@@ -145,41 +175,190 @@ void UWebSocketConnection::AttemptReconnect()
 
 	float Delay = CurrentReconnectDelay;
 
-	UE_LOG(LogTemp, Warning, TEXT("Reconnect attempt %d in %.1fs"), ReconnectAttempts, Delay);
+	UE_LOG(LogAiBridge, Warning, TEXT("Reconnect attempt %d in %.1fs"), ReconnectAttempts, Delay);
 
-	FTimerHandle Timer;
+	IoThread->Schedule(Delay, [this]()
+	{
+		bIsReconnecting = false;
+		CurrentReconnectDelay = FMath::Min(CurrentReconnectDelay * 2.f, ReconnectMaxDelay);
 
-	GWorld->GetTimerManager().SetTimer(
-		Timer,
-		[this]()
-		{
-			bIsReconnecting = false;
-			/*
-			Connect(LastUrl, JwtToken,
-				[](bool bSuccess)
+		if (!bAutoReconnect || IsConnected() || bIsConnecting)
+			return;
+
+		Connect(LastUrl, LastConnectionId, JwtToken,
+			[this](bool bSuccess)
+			{
+				if (!bSuccess && bAutoReconnect)
 				{
-					// handled internally
-				});
-			*/
-			CurrentReconnectDelay = FMath::Min(CurrentReconnectDelay * 2.f, ReconnectMaxDelay);
-		},
-		Delay,
-		false
-	);
+					AttemptReconnect();
+				}
+			});
+	});
+}
+
+void UWebSocketConnection::FinishConnect(bool bSuccess)
+{
+	bIsConnecting = false;
+
+	// Exactly once per Connect, whichever of connected, error, close or timeout comes first
+	if (PendingConnectCallback)
+	{
+		TFunction<void(bool)> Callback = MoveTemp(PendingConnectCallback);
+		PendingConnectCallback = nullptr;
+		Callback(bSuccess);
+	}
+}
+
+bool UWebSocketConnection::PumpIo(float DeltaTime)
+{
+	IoThread->RunDueCallbacks();
+	IoThread->DrainEvents([this](FAiBridgeIoEvent& Event)
+	{
+		const bool bIsFrame = Event.Kind == EAiBridgeIoEventKind::Text || Event.Kind == EAiBridgeIoEventKind::Binary;
+		if (bIsFrame && Memory)
+		{
+			Memory->Remove(EAiBridgeMemoryCategory::Messages, Event.Kind == EAiBridgeIoEventKind::Binary ? Event.Bytes.Num() : Event.Text.Len() * sizeof(TCHAR));
+		}
+
+		// Left over from a transport replaced or dropped since, a handler below may also open a new one
+		if (Event.Session != Session)
+		{
+			return;
+		}
+
+		switch (Event.Kind)
+		{
+		case EAiBridgeIoEventKind::Connected:
+			HandleConnected();
+			break;
+		case EAiBridgeIoEventKind::ConnectionError:
+			HandleError(Event.Text);
+			FinishConnect(false);
+			break;
+		case EAiBridgeIoEventKind::Closed:
+			HandleClosed(Event.StatusCode, Event.Text, Event.bWasClean);
+			break;
+		case EAiBridgeIoEventKind::Text:
+		case EAiBridgeIoEventKind::Binary:
+			DispatchInbound(Event);
+			break;
+		}
+	});
+	Downstream.Flush(FPlatformTime::Seconds());
+
+	return true;
+}
+
+void UWebSocketConnection::DispatchInbound(FAiBridgeIoEvent& Event)
+{
+	const bool bIsBinary = Event.Kind == EAiBridgeIoEventKind::Binary;
+
+	// Bytes as they were on the wire, text frames are UTF-8 there
+	const int32 WireBytes = bIsBinary ? Event.Bytes.Num() : FPlatformString::ConvertedLength<UTF8CHAR>(*Event.Text, Event.Text.Len());
+	Downstream.AddFrame(WireBytes, Event.ReceiveTime, FAiBridgeIoThread::ServiceIntervalSeconds);
+
+	if (bIsBinary)
+	{
+		if (OnBinaryMessage) OnBinaryMessage(Event.Bytes);
+	}
+	else
+	{
+		if (OnTextMessage) OnTextMessage(Event.Text);
+	}
 }
 
 void UWebSocketConnection::SendText(const FString& Message)
 {
-	if (!IsConnected()) return;
+	// Not IsConnected: that is game thread state, the link flag can be read from anywhere
+	if (!Outbox->IsLinkUp()) return;
 
-	WebSocket->Send(Message);
+	Outbox->SendText(CopyTemp(Message));
+}
+
+void UWebSocketConnection::SendUtf8Text(TArray<uint8>&& Utf8)
+{
+	if (!Outbox->IsLinkUp()) return;
+
+	Outbox->SendUtf8Text(MoveTemp(Utf8));
 }
 
 void UWebSocketConnection::SendBinary(const TArray<uint8>& Data)
 {
-	if (!IsConnected()) return;
+	SendBinary(CopyTemp(Data));
+}
+
+void UWebSocketConnection::SendBinary(TArray<uint8>&& Data)
+{
+	if (!Outbox->IsLinkUp()) return;
+
+	Outbox->SendBinary(MoveTemp(Data));
+}
+
+FAiBridgeIoStats UWebSocketConnection::GetIoStats() const
+{
+	if (!IoThread)
+	{
+		return FAiBridgeIoStats();
+	}
+
+	FAiBridgeIoStats Stats = IoThread->GetStats();
+	Stats.FramesSent = Outbox->GetFramesSent();
+	Stats.BytesSent = Outbox->GetBytesSent();
+	Stats.OutboundQueued = Outbox->GetNumQueued();
+	return Stats;
+}
+
+FAiBridgeHeartbeatStats UWebSocketConnection::GetHeartbeatStats() const
+{
+	return IoThread ? IoThread->GetHeartbeat().GetStats(FPlatformTime::Seconds()) : FAiBridgeHeartbeatStats();
+}
+
+bool UWebSocketConnection::StartCapture(const FString& Path)
+{
+	StopCapture();
+
+	Capture = FAiBridgeCaptureWriter::Create(AiBridgeCapture::ResolvePath(Path));
+	if (!Capture)
+	{
+		return false;
+	}
+
+	UE_LOG(LogAiBridge, Log, TEXT("[Capture] Recording AiBridge traffic to %s%s"), *Capture->GetPath(),
+		Session != 0 ? TEXT(" from the next connect") : TEXT(""));
+	return true;
+}
+
+void UWebSocketConnection::StopCapture()
+{
+	// A capture shim still holding the writer drops its frames once it is closed
+	if (Capture)
+	{
+		Capture->Close();
+		Capture = nullptr;
+	}
+}
+
+TSharedRef<IWebSocket> UWebSocketConnection::CreateTransport(const FString& Url, FTSTicker& Ticker, TSharedPtr<FAiBridgeCaptureWriter, ESPMode::ThreadSafe> CaptureWriter, bool bSimulateNetwork)
+{
+	TSharedRef<IWebSocket> Transport = Url.StartsWith(TEXT("loopback://"))
+		? StaticCastSharedRef<IWebSocket>(MakeShared<FLoopbackWebSocket>(Ticker))
+		: Url.StartsWith(TEXT("replay://"))
+		? StaticCastSharedRef<IWebSocket>(MakeShared<FReplayWebSocket>(Url, Ticker))
+		: StaticCastSharedRef<IWebSocket>(MakeShared<FTcpWebSocket>(Url, Ticker));
+
+	if (bSimulateNetwork)
+	{
+		UE_LOG(LogAiBridge, Warning, TEXT("Network condition simulation enabled for this connection"));
+		Transport = MakeShared<FNetworkConditionWebSocket>(Transport, Ticker);
+	}
 
-	WebSocket->Send(Data.GetData(), Data.Num(), true);
+	// Outermost, so frames are recorded with the timing the connection saw them
+	if (CaptureWriter)
+	{
+		Transport = MakeShared<FCaptureWebSocket>(Transport, CaptureWriter.ToSharedRef());
+	}
+
+	return Transport;
 }
 
 FString UWebSocketConnection::SanitizeUrl(const FString& Url)
@@ -207,4 +386,27 @@ FString UWebSocketConnection::SanitizeUrl(const FString& Url)
 		// token is last parameter
 		return Result.Left(ValueStart) + TEXT("[REDACTED]");
 	}
-}
\ No newline at end of file
+}
+
+static FAutoConsoleCommand GAiBridgeCaptureStartCommand(
+	TEXT("AiBridge.Capture.Start"),
+	TEXT("Records the traffic of every AiBridge connection from its next connect. Usage: AiBridge.Capture.Start [Directory=Saved/AiBridgeCaptures]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const FString Directory = Args.Num() > 0 ? Args[0] : FString();
+		for (TObjectIterator<UWebSocketConnection> It(RF_ClassDefaultObject); It; ++It)
+		{
+			It->StartCapture(AiBridgeCapture::MakeCapturePath(Directory, It->GetName()));
+		}
+	}));
+
+static FAutoConsoleCommand GAiBridgeCaptureStopCommand(
+	TEXT("AiBridge.Capture.Stop"),
+	TEXT("Stops recording AiBridge traffic and closes the capture files"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		for (TObjectIterator<UWebSocketConnection> It(RF_ClassDefaultObject); It; ++It)
+		{
+			It->StopCapture();
+		}
+	}));
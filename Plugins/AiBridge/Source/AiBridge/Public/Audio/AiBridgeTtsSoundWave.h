@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Sound/SoundWaveProcedural.h"
+#include "Audio/AudioDecodeStage.h"
+#include "AiBridgeTtsSoundWave.generated.h"
+
+/**
+ * Plays what an FAudioDecodeStage decodes. The audio render thread pulls the stage's PCM as it mixes and
+ * gets silence while the network is behind, so one playing sound voices every utterance of the stage.
+ * The stage has a single reader: only one instance of the sound may play at a time.
+ */
+UCLASS()
+class AIBRIDGE_API UAiBridgeTtsSoundWave : public USoundWaveProcedural
+{
+	GENERATED_BODY()
+
+public:
+	UAiBridgeTtsSoundWave(const FObjectInitializer& ObjectInitializer);
+
+	/** Before the sound first plays. Takes the stage's rate and channels, and keeps it alive as long as the sound */
+	void SetStage(const TSharedPtr<FAudioDecodeStage, ESPMode::ThreadSafe>& InStage);
+
+	// Begin USoundWaveProcedural
+	virtual int32 OnGeneratePCMAudio(TArray<uint8>& OutAudio, int32 NumSamples) override;
+	virtual Audio::EAudioMixerStreamDataFormat::Type GetGeneratedPCMDataFormat() const override { return Audio::EAudioMixerStreamDataFormat::Float; }
+	// End USoundWaveProcedural
+
+private:
+	TSharedPtr<FAudioDecodeStage, ESPMode::ThreadSafe> Stage;
+};
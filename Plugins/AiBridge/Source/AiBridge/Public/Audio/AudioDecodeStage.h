@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "Tasks/Pipe.h"
+#include <atomic>
+#include "Audio/AudioDecoder.h"
+#include "Audio/PolyphaseResampler.h"
+#include "Memory/AiBridgeMemory.h"
+
+/** Fixed-size block of interleaved float PCM at the output rate */
+struct FAudioPcmBlock
+{
+	TArray<float> Samples;
+	int32 NumFrames = 0;
+	uint32 Stream = 0;
+};
+
+/** Sees every run of decoded frames, interleaved at the stage's output rate and channel count */
+using FAudioPcmTap = TFunction<void(TArrayView<const float> Samples)>;
+
+struct FAudioDecodeStats
+{
+	uint64 ChunksDecoded = 0;
+	uint64 InputFrames = 0;
+	uint64 OutputFrames = 0;
+	/** Worker time spent decoding and resampling */
+	double ProcessSeconds = 0.0;
+	/** Blocks allocated because the reader fell behind the preallocated pool */
+	int32 ExtraBlocks = 0;
+	int32 BufferedFrames = 0;
+	/** Chunks and decoded frames dropped because they did not fit the audio memory budget */
+	int32 DroppedChunks = 0;
+	int64 DroppedFrames = 0;
+};
+
+/**
+ * Decodes streamed TTS audio and converts it to the mixer's rate and channel count on the worker pool.
+ *
+ * Encoded chunks are queued on a task pipe, so work runs off the game thread strictly in arrival
+ * order, and the output lands in a pool of preallocated PCM blocks. A single consumer, typically the
+ * audio render thread feeding a procedural sound, pulls frames with Read without locks or allocation.
+ *
+ * With a memory stream the queued chunks and the pool count against its audio budget. Queued blocks
+ * belong to the reader, so a stage that is full drops incoming audio rather than the oldest.
+ */
+class AIBRIDGE_API FAudioDecodeStage
+{
+public:
+	/** OutputSampleRate 0 uses the main audio device's rate. The pool holds NumBlocks blocks of BlockFrames frames */
+	FAudioDecodeStage(int32 OutputSampleRate = 0, int32 InOutputChannels = 1, int32 InBlockFrames = 1024, int32 NumBlocks = 32, TSharedPtr<FAiBridgeMemoryStream, ESPMode::ThreadSafe> InMemory = nullptr);
+	~FAudioDecodeStage();
+
+	/** Starts a stream in an ElevenLabs-style output format such as pcm_22050 or opus_48000_64. Unread audio of the previous stream is dropped */
+	bool BeginStream(const FString& OutputFormat);
+
+	/** Queues one network chunk for decoding. The buffer is moved, not copied */
+	void PushEncoded(TArray<uint8>&& Chunk);
+
+	/**
+	 * Hands the audio of every chunk queued from now on to Tap too, such as a lip sync analyzer that has to
+	 * see the PCM whatever the codec. The tap runs on a worker. Null removes it; once Flush has returned
+	 * after that, the old tap is no longer called.
+	 */
+	void SetPcmTap(FAudioPcmTap&& InTap);
+
+	/** Single consumer thread. Copies up to NumFrames interleaved frames into Out, returns the frames copied */
+	int32 Read(float* Out, int32 NumFrames);
+
+	/** Blocks until all queued chunks are decoded, only meant for shutdown and benchmarks */
+	void Flush();
+
+	int32 GetOutputSampleRate() const { return OutputRate; }
+	int32 GetOutputChannels() const { return OutputChannels; }
+	FAudioDecodeStats GetStats() const;
+
+private:
+	UE::Tasks::FPipe Pipe;
+
+	int32 OutputRate = 48000;
+	int32 OutputChannels = 1;
+	int32 BlockFrames = 1024;
+
+	/** Optional, budget and accounting of everything this stage buffers */
+	const TSharedPtr<FAiBridgeMemoryStream, ESPMode::ThreadSafe> Memory;
+
+	/** Owns every block; only grows, from inside the pipe */
+	TArray<TUniquePtr<FAudioPcmBlock>> Blocks;
+
+	// Producer: pipe, consumer: reader
+	TQueue<FAudioPcmBlock*, EQueueMode::Spsc> Filled;
+	// Producer: reader, consumer: pipe
+	TQueue<FAudioPcmBlock*, EQueueMode::Spsc> Free;
+
+	/** Bumped by each new stream, the reader drops blocks of older ones */
+	std::atomic<uint32> Stream{0};
+
+	// Pipe only
+	uint32 PipeStream = 0;
+	TUniquePtr<IAudioChunkDecoder> Decoder;
+	FAudioPcmTap Tap;
+	FPolyphaseResampler Resampler;
+	TArray<float> Decoded;
+	TArray<float> Converted;
+	FAudioPcmBlock* Writing = nullptr;
+
+	// Reader only
+	FAudioPcmBlock* Reading = nullptr;
+	int32 ReadFrame = 0;
+
+	std::atomic<uint64> ChunksDecoded{0};
+	std::atomic<uint64> InputFrames{0};
+	std::atomic<uint64> OutputFrames{0};
+	std::atomic<uint64> ProcessCycles{0};
+	std::atomic<int32> ExtraBlocks{0};
+	std::atomic<int32> BufferedFrames{0};
+	std::atomic<int32> DroppedChunks{0};
+	std::atomic<int64> DroppedFrames{0};
+
+	int64 GetBlockBytes() const { return (int64)BlockFrames * OutputChannels * sizeof(float); }
+	/** Null when the pool is empty and may not grow past the audio budget */
+	FAudioPcmBlock* AcquireBlock();
+	void WriteFrames(const float* Samples, int32 NumFrames);
+	void SubmitWriting();
+};
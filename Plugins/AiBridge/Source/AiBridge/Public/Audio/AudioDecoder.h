@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Streaming decoder for one TTS output format. Chunks arrive as the network delivers them, so an
+ * encoded frame split over two chunks has to be carried over. Only ever called from one decode task
+ * at a time.
+ */
+class AIBRIDGE_API IAudioChunkDecoder
+{
+public:
+	virtual ~IAudioChunkDecoder() = default;
+
+	virtual int32 GetSampleRate() const = 0;
+	virtual int32 GetNumChannels() const = 0;
+
+	/** Appends the interleaved samples in Chunk to OutSamples as floats in -1..1. False on corrupt data */
+	virtual bool Decode(TArrayView<const uint8> Chunk, TArray<float>& OutSamples) = 0;
+
+	/** Drops carried-over bytes before a new stream */
+	virtual void Reset() = 0;
+};
+
+/**
+ * Re-encodes streamed 16-bit PCM as G.711 mu-law, half the bytes for the same rate. Used where the
+ * bridge forwards raw pcm_* audio over a link narrower than the provider's, such as replication.
+ */
+class AIBRIDGE_API FMuLawEncoder
+{
+public:
+	/** Appends one mu-law byte per sample of Pcm16, carrying a sample split across chunks over to the next */
+	void Encode(TArrayView<const uint8> Pcm16, TArray<uint8>& Out);
+
+	void Reset() { bHasCarry = false; }
+
+private:
+	uint8 Carry = 0;
+	bool bHasCarry = false;
+};
+
+/** Makes a decoder for a codec at the given sample rate, or null if the rate is not supported */
+using FAudioDecoderFactory = TFunction<TUniquePtr<IAudioChunkDecoder>(int32 SampleRate)>;
+
+namespace AiBridgeAudio
+{
+	/** Splits ElevenLabs-style output formats, pcm_22050, ulaw_8000, mp3_44100_128, into codec and sample rate */
+	AIBRIDGE_API bool ParseOutputFormat(const FString& OutputFormat, FString& OutCodec, int32& OutSampleRate);
+
+	/** Bytes per second of mono audio in an output format, from the bitrate suffix of compressed ones. 0 if the name does not tell */
+	AIBRIDGE_API int32 GetBytesPerSecond(const FString& OutputFormat);
+
+	/**
+	 * Adds or replaces the decoder for a codec. pcm and ulaw are built in, and opus (Ogg Opus) wherever the
+	 * engine ships libOpus. Other codecs such as mp3 are registered by the module that links a decoder for
+	 * them, usually at startup.
+	 */
+	AIBRIDGE_API void RegisterDecoder(const FString& Codec, FAudioDecoderFactory Factory);
+
+	/** Null if the format cannot be parsed or nothing is registered for its codec */
+	AIBRIDGE_API TUniquePtr<IAudioChunkDecoder> CreateDecoder(const FString& OutputFormat);
+
+	/** True if CreateDecoder would find a decoder for the format's codec, without making one */
+	AIBRIDGE_API bool HasDecoder(const FString& OutputFormat);
+}
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Cheap per-frame descriptors shared by the viseme analyzer and the voice activity detector */
+struct FAudioFrameFeatures
+{
+	float Rms = 0.0f;
+	/** Energy of the first difference over signal energy, 0..1, a cheap spectral centroid proxy */
+	float Brightness = 0.0f;
+	/** Zero crossings per sample, 0..1 */
+	float ZeroCrossingRate = 0.0f;
+};
+
+namespace AiBridgeAudio
+{
+	/** Analyzes one frame of mono float samples with SIMD loops. PreviousSample is the last sample of the prior frame */
+	AIBRIDGE_API FAudioFrameFeatures AnalyzeFrame(const float* Samples, int32 NumSamples, float PreviousSample);
+}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Streaming sample rate and channel count converter for TTS audio on its way to the mixer.
+ *
+ * The rate ratio is reduced to Up/Down and a Kaiser-windowed sinc low-pass is split into Up phases,
+ * so every output sample is one short dot product over the input history, computed four taps at a
+ * time with SIMD. Channels are converted while deinterleaving: mono is duplicated, anything to mono
+ * is averaged. State carries over between calls, so chunks can be any size.
+ */
+class AIBRIDGE_API FPolyphaseResampler
+{
+public:
+	/** TapsPerPhase is rounded up to a multiple of four, more taps give a steeper filter */
+	void Configure(int32 InInputRate, int32 InOutputRate, int32 InInputChannels, int32 InOutputChannels, int32 InTapsPerPhase = 32);
+
+	/** Forgets buffered input, the next sample starts a new stream */
+	void Reset();
+
+	/** Converts NumFrames interleaved input frames and appends the output frames to Out. Returns frames appended */
+	int32 Process(const float* Interleaved, int32 NumFrames, TArray<float>& Out);
+
+	/** Upper bound of frames Process can append for NumFrames input frames */
+	int32 GetMaxOutputFrames(int32 NumFrames) const;
+
+	int32 GetInputRate() const { return InputRate; }
+	int32 GetOutputRate() const { return OutputRate; }
+	int32 GetOutputChannels() const { return OutputChannels; }
+	bool IsPassthrough() const { return InputRate == OutputRate; }
+
+private:
+	int32 InputRate = 0;
+	int32 OutputRate = 0;
+	int32 InputChannels = 1;
+	int32 OutputChannels = 1;
+	int32 Taps = 0;
+	uint32 Up = 1;
+	uint32 Down = 1;
+
+	/** Up phases of Taps coefficients each, stored reversed so they line up with the input history */
+	TArray<float> Bank;
+
+	/** Per output channel input, the first Taps - 1 samples are history */
+	TArray<TArray<float>> Channels;
+
+	/** Position of the newest input sample the next output depends on */
+	int32 Index = 0;
+	uint32 Phase = 0;
+
+	void Deinterleave(const float* Interleaved, int32 NumFrames);
+};
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Settings/AiBridgeSettings.h"
+
+/**
+ * Walks a ladder of TTS formats, best first, as the measured link speed changes. Going down is immediate
+ * once the link falls below a format's MinKbps; going up takes UpgradeHeadroom times the better format's
+ * MinKbps. The choice only changes between turns, an utterance keeps the format it was asked for.
+ */
+class AIBRIDGE_API FTtsFormatSelector
+{
+public:
+	/** The ladder is ordered by MinKbps, highest first; formats with equal MinKbps keep their listed order */
+	void Configure(const TArray<FAiBridgeTtsFormat>& InFormats, float InUpgradeHeadroom);
+
+	/**
+	 * Picks the format for the next turn among those IsUsable accepts. Without a measurement, MeasuredKbps
+	 * 0, the current format is kept, the best usable one at first. True when the format changed.
+	 */
+	bool Update(float MeasuredKbps, TFunctionRef<bool(const FAiBridgeTtsFormat&)> IsUsable);
+
+	/** Null before the first Update or when no format is usable */
+	const FAiBridgeTtsFormat* GetCurrent() const { return Formats.IsValidIndex(Current) ? &Formats[Current] : nullptr; }
+
+private:
+	TArray<FAiBridgeTtsFormat> Formats;
+	float UpgradeHeadroom = 1.5f;
+	int32 Current = INDEX_NONE;
+};
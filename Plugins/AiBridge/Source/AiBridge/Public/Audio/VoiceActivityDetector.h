@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include "VoiceActivityDetector.generated.h"
+
+/** Tunables for the client-side voice activity detector */
+USTRUCT(BlueprintType)
+struct AIBRIDGE_API FAiBridgeVadSettings
+{
+	GENERATED_BODY()
+
+	/** Analysis frame length */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voice", meta = (ClampMin = "5", ClampMax = "50"))
+	int32 FrameMs = 20;
+
+	/** How far above the tracked noise floor a frame must be to count as speech */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voice", meta = (ClampMin = "0"))
+	float SpeechThresholdDb = 9.0f;
+
+	/** Frames above this zero-crossing rate need twice the threshold, rejects hiss and fan noise */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voice", meta = (ClampMin = "0", ClampMax = "1"))
+	float NoiseZeroCrossingRate = 0.35f;
+
+	/** Absolute level that is never considered speech, regardless of the noise floor */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voice")
+	float MinSpeechDb = -55.0f;
+
+	/** How fast the noise floor follows non-speech frames, per frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voice", meta = (ClampMin = "0", ClampMax = "1"))
+	float NoiseFloorAdaptRate = 0.05f;
+
+	/** Consecutive speech needed before the gate opens */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voice", meta = (ClampMin = "0"))
+	int32 OnsetMs = 60;
+
+	/** Audio kept from before the onset so the first syllable is not clipped */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voice", meta = (ClampMin = "0"))
+	int32 PreRollMs = 200;
+
+	/** Non-speech still uploaded after speech stops, covers short pauses between words */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voice", meta = (ClampMin = "0"))
+	int32 HangoverMs = 250;
+
+	/** Silence after which the utterance is considered finished and the request can be triggered */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voice", meta = (ClampMin = "0"))
+	int32 EndOfUtteranceMs = 600;
+};
+
+/** Snapshot of detector activity, readable from any thread */
+USTRUCT(BlueprintType)
+struct AIBRIDGE_API FAiBridgeVadStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Voice")
+	int64 FramesProcessed = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Voice")
+	int64 FramesUploaded = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Voice")
+	int64 BytesSuppressed = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Voice")
+	int32 Utterances = 0;
+
+	/** Exponential average of the analysis cost of one frame */
+	UPROPERTY(BlueprintReadOnly, Category = "Voice")
+	float AverageFrameCostMicroseconds = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Voice")
+	float PeakFrameCostMicroseconds = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Voice")
+	float NoiseFloorDb = 0.0f;
+};
+
+/**
+ * Energy + zero-crossing voice activity detector meant to run directly on the audio capture thread.
+ *
+ * Capture buffers of any size are cut into fixed frames and analyzed with the shared SIMD frame
+ * features. While the gate is closed nothing is forwarded; once speech is confirmed the pre-roll and
+ * all following frames are handed to OnVoicedAudio as 16-bit PCM, and OnEndOfUtterance fires as soon as
+ * the trailing silence is long enough, without waiting for the server-side endpointer.
+ */
+class AIBRIDGE_API FVoiceActivityDetector
+{
+public:
+	explicit FVoiceActivityDetector(const FAiBridgeVadSettings& InSettings = FAiBridgeVadSettings());
+
+	/** Called on the capture thread with frames that should be uploaded */
+	TFunction<void(TArrayView<const int16> Pcm, int32 SampleRate)> OnVoicedAudio;
+	TFunction<void()> OnSpeechStart;
+	TFunction<void()> OnEndOfUtterance;
+
+	/** Same shape as Audio::FOnAudioCaptureFunction so it can be bound to a capture stream directly */
+	void ProcessCaptureBuffer(const float* Interleaved, int32 NumFrames, int32 NumChannels, int32 SampleRate);
+
+	/** Capture thread only; takes effect at the next frame boundary */
+	void SetSettings(const FAiBridgeVadSettings& InSettings);
+
+	bool IsSpeaking() const { return bSpeaking.load(std::memory_order_relaxed); }
+
+	FAiBridgeVadStats GetStats() const;
+
+private:
+	FAiBridgeVadSettings Settings;
+
+	int32 SampleRate = 0;
+	int32 FrameSamples = 0;
+
+	TArray<float> FrameBuffer;
+	TArray<int16> PcmFrame;
+
+	/** Circular pre-roll of recent non-uploaded frames */
+	TArray<int16> PreRoll;
+	int32 PreRollWrite = 0;
+	int32 PreRollFilled = 0;
+
+	float NoiseFloorDb = -60.0f;
+	float PreviousSample = 0.0f;
+	int32 SpeechRunMs = 0;
+	int32 SilenceRunMs = 0;
+	bool bInUtterance = false;
+	std::atomic<bool> bSpeaking{false};
+
+	// Stats, written by the capture thread, read anywhere
+	std::atomic<int64> FramesProcessed{0};
+	std::atomic<int64> FramesUploaded{0};
+	std::atomic<int64> BytesSuppressed{0};
+	std::atomic<int32> Utterances{0};
+	std::atomic<float> AverageFrameCostUs{0.0f};
+	std::atomic<float> PeakFrameCostUs{0.0f};
+	std::atomic<float> PublishedNoiseFloorDb{0.0f};
+
+	void Configure(int32 InSampleRate);
+	void ProcessFrame();
+	void PushPreRoll();
+	void FlushPreRoll();
+	void Upload(TArrayView<const int16> Pcm);
+};
@@ -10,6 +10,7 @@ class AIBRIDGE_API UJwtAuthenticationService : public UObject
 	GENERATED_BODY()
 
 public:
+	/** Points the service at an endpoint, a token cached for another endpoint is dropped */
 	void Initialize(const FString& InBaseUrl);
 
 	// Async-style callback instead of Task<string>
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "AiBridgeConnectAction.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FAiBridgeConnectPin);
+
+class UAiBridgeWebSocketSubsystem;
+
+/** Latent Connect node, fires once the bridge is connected instead of having graphs poll IsConnected */
+UCLASS()
+class AIBRIDGE_API UAiBridgeConnectAction : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	/** Connects the bridge unless it already is, trying every healthy endpoint before giving up */
+	UFUNCTION(BlueprintCallable, Category = "AiBridge", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject", DisplayName = "Connect AiBridge"))
+	static UAiBridgeConnectAction* ConnectAiBridge(UObject* WorldContextObject);
+
+	UPROPERTY(BlueprintAssignable)
+	FAiBridgeConnectPin OnConnected;
+
+	/** No endpoint could be reached, or this instance does not own the bridge */
+	UPROPERTY(BlueprintAssignable)
+	FAiBridgeConnectPin OnFailed;
+
+	virtual void Activate() override;
+
+private:
+	TWeakObjectPtr<UAiBridgeWebSocketSubsystem> Subsystem;
+
+	void Finish(bool bConnected);
+};
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "AiBridgeConversationTurnAction.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FAiBridgeConversationTurnPin, const FString&, RequestId, const FString&, Text);
+
+class UAiBridgePromptTemplate;
+class UAiBridgeWebSocketSubsystem;
+
+/**
+ * Latent node for one conversation turn. It connects if needed, sends the utterance and fires for this
+ * turn's reply only, so graphs no longer filter OnTextMessage by requestId.
+ */
+UCLASS()
+class AIBRIDGE_API UAiBridgeConversationTurnAction : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Says Text to Npc. Its kept conversation is sent as history and, once the reply completes, extended by
+	 * the utterance and the reply; None sends no history and keeps none. Persona and Variables are as for
+	 * SendTextInput. With bWaitForAudio, OnComplete waits for the reply's TTS audio to end as well.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "AiBridge", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject", AutoCreateRefTerm = "Variables"))
+	static UAiBridgeConversationTurnAction* SendConversationTurn(UObject* WorldContextObject, const FString& Text, FName Npc, UAiBridgePromptTemplate* Persona, const TMap<FString, FString>& Variables, bool bWaitForAudio = true, float TimeoutSeconds = 30.0f);
+
+	/** The first text of the reply */
+	UPROPERTY(BlueprintAssignable)
+	FAiBridgeConversationTurnPin OnFirstToken;
+
+	/** Each piece of reply text as it streams in, Text is only what was added, e.g. for a transcript widget */
+	UPROPERTY(BlueprintAssignable)
+	FAiBridgeConversationTurnPin OnTextDelta;
+
+	/** The first audio of the reply, Text is empty */
+	UPROPERTY(BlueprintAssignable)
+	FAiBridgeConversationTurnPin OnAudioStart;
+
+	/** The whole reply */
+	UPROPERTY(BlueprintAssignable)
+	FAiBridgeConversationTurnPin OnComplete;
+
+	/** Text is the error: no connection, an error reply or a timeout */
+	UPROPERTY(BlueprintAssignable)
+	FAiBridgeConversationTurnPin OnFailed;
+
+	virtual void Activate() override;
+
+private:
+	TWeakObjectPtr<UAiBridgeWebSocketSubsystem> Subsystem;
+
+	UPROPERTY()
+	UAiBridgePromptTemplate* Persona;
+
+	FString Text;
+	FName Npc;
+	TMap<FString, FString> Variables;
+	bool bWaitForAudio = true;
+	float TimeoutSeconds = 30.0f;
+	FString RequestId;
+
+	void Send();
+	void Fail(const FString& Error);
+};
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+class IFileHandle;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * AiBridge capture files (.aibcap) hold every frame a connection sent and received, in the order
+ * they crossed the transport. Little endian, append only:
+ *
+ *   Header  uint32 Magic, uint32 Version, int64 start time in UTC ticks
+ *   Record  uint64 microseconds since the capture started, uint8 flags, uint32 payload size, payload
+ *
+ * Text payloads are stored as UTF-8.
+ */
+namespace AiBridgeCapture
+{
+	constexpr uint32 Magic = 0x50434241; // "ABCP"
+	constexpr uint32 Version = 1;
+	constexpr int32 HeaderSize = 16;
+	constexpr int32 RecordHeaderSize = 13;
+
+	constexpr uint8 FlagOutbound = 1 << 0;
+	constexpr uint8 FlagBinary = 1 << 1;
+
+	/** Relative paths land in Saved/AiBridgeCaptures, an extension is added when missing */
+	AIBRIDGE_API FString ResolvePath(const FString& Path);
+
+	/** Unique file name for a new capture of ConnectionId inside Directory */
+	AIBRIDGE_API FString MakeCapturePath(const FString& Directory, const FString& ConnectionId);
+}
+
+/** One frame read back from a capture, Payload is only valid until the next read */
+struct FAiBridgeCaptureRecord
+{
+	uint64 TimeMicros = 0;
+	uint8 Flags = 0;
+	TArrayView<const uint8> Payload;
+
+	bool IsOutbound() const { return (Flags & AiBridgeCapture::FlagOutbound) != 0; }
+	bool IsBinary() const { return (Flags & AiBridgeCapture::FlagBinary) != 0; }
+	FString GetText() const;
+};
+
+/**
+ * Appends frames to a capture file. Frames in both directions are written from the AiBridge I/O
+ * thread that owns the transport, while the connection stops the capture from the game thread, so
+ * every call takes the lock. Records are buffered and written in large blocks so capturing stays off
+ * the frame time.
+ */
+class AIBRIDGE_API FAiBridgeCaptureWriter
+{
+public:
+	/** Creates or truncates the file at Path, null if it cannot be opened */
+	static TSharedPtr<FAiBridgeCaptureWriter, ESPMode::ThreadSafe> Create(const FString& Path);
+
+	~FAiBridgeCaptureWriter();
+
+	void WriteText(bool bOutbound, const FString& Text);
+	void WriteText(bool bOutbound, const void* Utf8, SIZE_T Size);
+	void WriteBinary(bool bOutbound, const void* Data, SIZE_T Size);
+
+	/** Writes the buffered records out. The file stays open */
+	void Flush();
+
+	/** Flushes and closes the file, later writes are dropped */
+	void Close();
+
+	bool IsOpen() const;
+	const FString& GetPath() const { return Path; }
+	uint64 GetNumRecords() const;
+	uint64 GetNumBytes() const;
+
+private:
+	FAiBridgeCaptureWriter(TUniquePtr<IFileHandle>&& InFile, const FString& InPath);
+
+	mutable FCriticalSection Lock;
+	TUniquePtr<IFileHandle> File;
+	TArray<uint8> Buffer;
+	FString Path;
+	double StartSeconds = 0.0;
+	uint64 NumRecords = 0;
+	uint64 NumBytes = 0;
+
+	void Append(uint8 Flags, const void* Data, uint32 Size);
+	void FlushLocked();
+};
+
+/**
+ * Reads a capture front to back. Captures above MapThreshold are memory-mapped so an hour-long
+ * session replays without loading it; smaller ones are read into memory, and platforms without
+ * mapping fall back to reading one record at a time.
+ */
+class AIBRIDGE_API FAiBridgeCaptureReader
+{
+public:
+	static constexpr int64 MapThreshold = 4 * 1024 * 1024;
+
+	/** Null if the file is missing or not a capture. bAllowMapping false forces streamed reads */
+	static TUniquePtr<FAiBridgeCaptureReader> Open(const FString& Path, bool bAllowMapping = true);
+
+	~FAiBridgeCaptureReader();
+
+	/** False at the end of the capture or on a truncated record */
+	bool Next(FAiBridgeCaptureRecord& OutRecord);
+
+	/** Back to the first record */
+	void Rewind();
+
+	bool IsMapped() const { return MappedRegion.IsValid(); }
+	int64 GetSize() const { return Size; }
+
+private:
+	FAiBridgeCaptureReader() = default;
+
+	// Mapped
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	// Streamed, or the whole file when small
+	TUniquePtr<IFileHandle> File;
+	TArray<uint8> Contents;
+	TArray<uint8> Scratch;
+
+	/** Whole capture in memory, mapped or loaded, null when streaming */
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+	int64 Offset = AiBridgeCapture::HeaderSize;
+};
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/** One snippet returned by a knowledge search */
+struct FKnowledgeHit
+{
+	int32 Snippet = INDEX_NONE;
+	/** Cosine similarity to the query, -1..1 */
+	float Score = 0.0f;
+};
+
+namespace AiBridgeKnowledge
+{
+	/** Vector width, a power of two and a multiple of the 16-byte SIMD stride */
+	constexpr int32 Dimensions = 1024;
+
+	/**
+	 * Hashed bag-of-features embedding: words, word pairs and character trigrams are hashed into
+	 * Dimensions signed buckets, so no model has to ship with the client. Weights is the per-bucket
+	 * inverse document frequency of the index, null for unweighted.
+	 */
+	AIBRIDGE_API void Embed(FStringView Text, const float* Weights, float* OutVector);
+
+	/** Quantizes to int8 with the largest component at 127, returns the norm of the quantized vector */
+	AIBRIDGE_API float Quantize(const float* Vector, int8* OutVector);
+
+	/** Dot product of two int8 vectors of Dimensions components, 16 at a time with SIMD */
+	AIBRIDGE_API int32 DotInt8(const int8* A, const int8* B);
+}
+
+/**
+ * Read-only knowledge base for prompt retrieval: snippets with int8 quantized embeddings in a single
+ * memory-mapped file, searched by brute-force cosine similarity. A few thousand snippets search in
+ * well under a millisecond and the pages are shared with the OS file cache instead of the heap.
+ *
+ * File layout, little endian: a 32-byte header, inverse document frequency per dimension, vector
+ * norms, the 16-byte aligned int8 vectors, snippet offsets and the UTF-8 snippet text.
+ */
+class AIBRIDGE_API FKnowledgeIndex
+{
+public:
+	/** Embeds Snippets and writes an index to Path, false if it cannot be written */
+	static bool Build(const TArray<FString>& Snippets, const FString& Path);
+
+	/** Splits a text file into snippets at blank lines */
+	static TArray<FString> SplitSnippets(const FString& Text);
+
+	/** Null if the file is missing or not a knowledge index */
+	static TUniquePtr<FKnowledgeIndex> Open(const FString& Path);
+
+	~FKnowledgeIndex();
+
+	/** Best MaxHits snippets scoring at least MinScore, best first */
+	void Search(FStringView Query, int32 MaxHits, float MinScore, TArray<FKnowledgeHit>& OutHits) const;
+
+	FString GetSnippet(int32 Index) const;
+	int32 Num() const { return Count; }
+	bool IsMapped() const { return MappedRegion.IsValid(); }
+
+private:
+	FKnowledgeIndex() = default;
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray<uint8> Contents;
+
+	int32 Count = 0;
+	const float* Weights = nullptr;
+	const float* Norms = nullptr;
+	const int8* Vectors = nullptr;
+	const uint32* TextOffsets = nullptr;
+	const UTF8CHAR* Text = nullptr;
+
+	bool Bind(const uint8* Data, int64 Size);
+};
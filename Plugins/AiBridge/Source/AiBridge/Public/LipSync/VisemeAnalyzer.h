@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Pipe.h"
+#include "Audio/AudioFeatures.h"
+#include "LipSync/VisemeTrack.h"
+
+/**
+ * Turns streamed TTS audio into a viseme curve track off the game thread.
+ *
+ * Incoming chunks are queued on a task pipe, so analysis runs on the worker pool strictly in arrival
+ * order. Each 10 ms hop is reduced to energy, brightness and zero-crossing features with SIMD loops and
+ * mapped to mouth shapes. When the server sends character alignment instead, keys are generated from
+ * the text timings and the audio path is skipped for that utterance.
+ */
+class AIBRIDGE_API FVisemeAnalyzer
+{
+public:
+	FVisemeAnalyzer();
+	~FVisemeAnalyzer();
+
+	/** Starts a new utterance, subsequent keys are timed from zero */
+	void BeginUtterance(int32 InSampleRate, int32 InNumChannels = 1);
+
+	/** Queues little-endian 16-bit PCM for analysis. The buffer is moved, not copied */
+	void PushPcm16(TArray<uint8>&& Chunk);
+
+	/** Queues interleaved float PCM in -1..1, e.g. the output of an FAudioDecodeStage. The buffer is moved, not copied */
+	void PushPcmFloat(TArray<float>&& Samples);
+
+	/** Queues server-provided character timings (e.g. ElevenLabs alignment) for the current utterance */
+	void PushCharacterAlignment(const FString& Characters, TArray<float>&& StartTimesSeconds);
+
+	/** Blocks until all queued work is done, only meant for shutdown and benchmarks */
+	void Flush();
+
+	const FVisemeTrack& GetTrack() const { return *Track; }
+
+	/** Maps hop features to a quantized key */
+	static FVisemeKey MapFeatures(const FAudioFrameFeatures& Features, float PeakRms, int32 SampleRate, uint32 TimeMs);
+
+private:
+	UE::Tasks::FPipe Pipe;
+	TUniquePtr<FVisemeTrack> Track;
+
+	// Everything below is only touched from inside the pipe
+	int32 SampleRate = 22050;
+	int32 NumChannels = 1;
+	uint64 SamplesConsumed = 0;
+	float PeakRms = 0.0f;
+	float LastSample = 0.0f;
+	bool bUsingAlignment = false;
+	TArray<float> Pending;
+
+	void AnalyzePending();
+};
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include "VisemeTrack.generated.h"
+
+/** Mouth shapes produced by the analyzer, silence is implied when all weights are zero */
+enum class EVisemeChannel : uint8
+{
+	AA,		// open vowels (a, ah)
+	EE,		// spread vowels (e, i)
+	OO,		// rounded vowels (o, u, w)
+	FF,		// fricatives (f, v, s, z, sh)
+	MBP,	// closed lips (m, b, p)
+	Count
+};
+
+/** Sampled mouth pose handed to animation */
+USTRUCT(BlueprintType)
+struct AIBRIDGE_API FAiBridgeVisemeFrame
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "LipSync")
+	float Amplitude = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "LipSync")
+	float AA = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "LipSync")
+	float EE = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "LipSync")
+	float OO = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "LipSync")
+	float FF = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "LipSync")
+	float MBP = 0.0f;
+};
+
+/** One quantized key on the curve track, 12 bytes */
+struct FVisemeKey
+{
+	uint32 TimeMs = 0;
+	uint8 Amplitude = 0;
+	uint8 Weights[(int32)EVisemeChannel::Count] = {};
+};
+
+/**
+ * Append-only ring of time-stamped viseme keys.
+ *
+ * Exactly one writer (the analysis pipe) appends keys in time order and publishes them with a release
+ * store, any number of readers (game thread, animation worker threads) sample without taking a lock.
+ * Readers only look at the newer half of the ring so the writer can never overwrite a key under them.
+ */
+class AIBRIDGE_API FVisemeTrack
+{
+public:
+	static constexpr uint32 Capacity = 8192;	// ~80 s of audio at a 10 ms hop
+
+	/** Writer only */
+	void Append(const FVisemeKey& Key);
+
+	/** Writer only, starts a new utterance at time zero */
+	void Reset();
+
+	/** Any thread. Interpolates the pose at TimeSeconds since the start of the current utterance */
+	FAiBridgeVisemeFrame Sample(double TimeSeconds) const;
+
+	/** Any thread. Time of the newest published key */
+	double GetDuration() const;
+
+	/** Any thread. Number of keys published since the last reset */
+	uint32 GetNumKeys() const { return Published.load(std::memory_order_acquire) - Base.load(std::memory_order_acquire); }
+
+private:
+	FVisemeKey Keys[Capacity];
+
+	/** Monotonic index of the next key to write, keys are stored at Index % Capacity */
+	std::atomic<uint32> Published{0};
+
+	/** Index of the first key of the current utterance */
+	std::atomic<uint32> Base{0};
+};
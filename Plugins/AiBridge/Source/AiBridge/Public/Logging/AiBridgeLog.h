@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+// Shipping keeps warnings and errors only, Log and Verbose statements compile out entirely
+#if UE_BUILD_SHIPPING
+AIBRIDGE_API DECLARE_LOG_CATEGORY_EXTERN(LogAiBridge, Log, Warning);
+#else
+AIBRIDGE_API DECLARE_LOG_CATEGORY_EXTERN(LogAiBridge, Log, All);
+#endif
+
+/** One key/value of a structured event. Keys must be string literals, they are kept by pointer */
+struct FAiBridgeLogField
+{
+	enum class EKind : uint8
+	{
+		Int,
+		Float,
+		Text,
+		/** Message bodies: only a short preview and the full length are logged */
+		Payload,
+		/** Tokens and keys: only the length and a fingerprint are logged, the text never leaves the call */
+		Secret,
+	};
+
+	static FAiBridgeLogField Int(const TCHAR* Key, int64 Value) { FAiBridgeLogField Field(Key, EKind::Int); Field.IntValue = Value; return Field; }
+	static FAiBridgeLogField Float(const TCHAR* Key, double Value) { FAiBridgeLogField Field(Key, EKind::Float); Field.FloatValue = Value; return Field; }
+	static FAiBridgeLogField Text(const TCHAR* Key, FStringView Value) { FAiBridgeLogField Field(Key, EKind::Text); Field.TextValue = Value; return Field; }
+	static FAiBridgeLogField Payload(const TCHAR* Key, FStringView Value) { FAiBridgeLogField Field(Key, EKind::Payload); Field.TextValue = Value; return Field; }
+	static FAiBridgeLogField Secret(const TCHAR* Key, FStringView Value) { FAiBridgeLogField Field(Key, EKind::Secret); Field.TextValue = Value; return Field; }
+
+	const TCHAR* Key;
+	EKind Kind;
+	int64 IntValue = 0;
+	double FloatValue = 0.0;
+	FStringView TextValue;
+
+private:
+	FAiBridgeLogField(const TCHAR* InKey, EKind InKind) : Key(InKey), Kind(InKind) {}
+};
+
+/** Lets one in EveryN events of a call site through, AiBridge.Log.SampleAll lets all of them through */
+struct AIBRIDGE_API FAiBridgeLogSampler
+{
+	explicit FAiBridgeLogSampler(uint32 InEveryN) : EveryN(FMath::Max(1u, InEveryN)) {}
+
+	bool Sample();
+	uint32 GetRate() const;
+
+private:
+	const uint32 EveryN;
+	std::atomic<uint32> Count{0};
+};
+
+/** Counters of the event ring, snapshot */
+struct FAiBridgeLogStats
+{
+	uint64 Emitted = 0;
+	uint64 Written = 0;
+	uint64 Dropped = 0;
+	int32 Capacity = 0;
+};
+
+/**
+ * Structured AiBridge events. Emit copies the fields into a slot of a fixed-size lock-free ring and
+ * returns; a background writer formats them and hands them to the log. Hot paths such as inbound
+ * frames therefore never format or write on the calling thread, and a full ring drops events rather
+ * than blocking. Use the AIBRIDGE_LOG_* macros so inactive verbosities cost nothing.
+ */
+namespace AiBridgeLog
+{
+	/** Any thread. SampleRate is recorded with the event so readers can scale counts back up */
+	AIBRIDGE_API void Emit(ELogVerbosity::Type Verbosity, const TCHAR* Event, TConstArrayView<FAiBridgeLogField> Fields, uint32 SampleRate = 1);
+
+	/** Any thread. Blocks until everything emitted so far has been written */
+	AIBRIDGE_API void Flush();
+
+	/** Stops the writer, later events are written on the calling thread. Called on module shutdown */
+	AIBRIDGE_API void Shutdown();
+
+	AIBRIDGE_API FAiBridgeLogStats GetStats();
+}
+
+#define AIBRIDGE_LOG_EVENT(Verbosity, Event, ...) \
+	do \
+	{ \
+		if (UE_LOG_ACTIVE(LogAiBridge, Verbosity)) \
+		{ \
+			AiBridgeLog::Emit(ELogVerbosity::Verbosity, TEXT(Event), { __VA_ARGS__ }); \
+		} \
+	} while (false)
+
+/** Like AIBRIDGE_LOG_EVENT for one in EveryN passes through this statement */
+#define AIBRIDGE_LOG_SAMPLED(EveryN, Verbosity, Event, ...) \
+	do \
+	{ \
+		if (UE_LOG_ACTIVE(LogAiBridge, Verbosity)) \
+		{ \
+			static FAiBridgeLogSampler AiBridgeLogSampler(EveryN); \
+			if (AiBridgeLogSampler.Sample()) \
+			{ \
+				AiBridgeLog::Emit(ELogVerbosity::Verbosity, TEXT(Event), { __VA_ARGS__ }, AiBridgeLogSampler.GetRate()); \
+			} \
+		} \
+	} while (false)
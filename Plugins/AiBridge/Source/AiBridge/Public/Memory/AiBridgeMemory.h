@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+#include <atomic>
+
+// Low-level memory tracker tags, shown under AiBridge/ when the game runs with -llm
+LLM_DECLARE_TAG_API(AiBridge, AIBRIDGE_API);
+LLM_DECLARE_TAG_API(AiBridge_Audio, AIBRIDGE_API);
+LLM_DECLARE_TAG_API(AiBridge_Network, AIBRIDGE_API);
+LLM_DECLARE_TAG_API(AiBridge_Prompt, AIBRIDGE_API);
+LLM_DECLARE_TAG_API(AiBridge_Knowledge, AIBRIDGE_API);
+LLM_DECLARE_TAG_API(AiBridge_Tokenizer, AIBRIDGE_API);
+LLM_DECLARE_TAG_API(AiBridge_Log, AIBRIDGE_API);
+
+/** What a stream's buffered bytes are spent on, each with its own budget */
+enum class EAiBridgeMemoryCategory : uint8
+{
+	/** Conversation history kept for the next prompt */
+	History,
+	/** Encoded TTS chunks waiting for the decoder and decoded PCM waiting for playback */
+	Audio,
+	/** Inbound frames received but not yet handled on the game thread */
+	Messages,
+
+	Num
+};
+
+AIBRIDGE_API const TCHAR* LexToString(EAiBridgeMemoryCategory Category);
+
+/** Usage of one category, snapshot */
+struct FAiBridgeMemoryUsage
+{
+	int64 Current = 0;
+	int64 Peak = 0;
+	/** 0 is unlimited */
+	int64 Budget = 0;
+	int64 EvictedBytes = 0;
+	uint64 Evictions = 0;
+};
+
+/**
+ * Byte accounting for one stream of buffered data, such as an NPC's conversation or the TTS audio of
+ * a connection. Owners count what they keep with Add or TryAdd and take it off with Remove when it is
+ * freed; past the budget they drop their oldest data, or refuse new data where the oldest belongs to
+ * another thread, and report what they dropped with NoteEvicted. Safe to use from any thread.
+ */
+class AIBRIDGE_API FAiBridgeMemoryStream
+{
+public:
+	explicit FAiBridgeMemoryStream(FName InName);
+	~FAiBridgeMemoryStream();
+
+	FName GetName() const { return Name; }
+
+	/** Counts Bytes, over the budget or not. For data that must be kept, the owner then evicts down to the budget */
+	void Add(EAiBridgeMemoryCategory Category, int64 Bytes);
+
+	/** Counts Bytes only if they fit the budget, false and nothing counted otherwise */
+	bool TryAdd(EAiBridgeMemoryCategory Category, int64 Bytes);
+
+	void Remove(EAiBridgeMemoryCategory Category, int64 Bytes);
+
+	/** Records data dropped to stay within the budget, after it was taken off with Remove or refused by TryAdd */
+	void NoteEvicted(EAiBridgeMemoryCategory Category, int64 Bytes);
+
+	/** Bytes above the category's budget, 0 when within it or unlimited */
+	int64 GetOverBudget(EAiBridgeMemoryCategory Category) const;
+
+	/** Bytes <= 0 is unlimited. Streams start with the project's budgets from AiBridge settings */
+	void SetBudget(EAiBridgeMemoryCategory Category, int64 Bytes);
+	int64 GetBudget(EAiBridgeMemoryCategory Category) const;
+
+	FAiBridgeMemoryUsage GetUsage(EAiBridgeMemoryCategory Category) const;
+
+private:
+	struct FCounters
+	{
+		std::atomic<int64> Current{0};
+		std::atomic<int64> Peak{0};
+		std::atomic<int64> Budget{0};
+		std::atomic<int64> EvictedBytes{0};
+		std::atomic<uint64> Evictions{0};
+	};
+
+	const FName Name;
+	FCounters Counters[(int32)EAiBridgeMemoryCategory::Num];
+};
+
+namespace AiBridgeMemory
+{
+	/** A new accounting stream listed by AiBridge.Memory.Report for as long as it is alive. Game thread */
+	AIBRIDGE_API TSharedRef<FAiBridgeMemoryStream, ESPMode::ThreadSafe> CreateStream(FName Name);
+
+	/** Totals over every stream, including streams already gone */
+	AIBRIDGE_API FAiBridgeMemoryUsage GetTotalUsage(EAiBridgeMemoryCategory Category);
+
+	/** Writes current and peak usage by category and by stream to the log */
+	AIBRIDGE_API void LogReport();
+}
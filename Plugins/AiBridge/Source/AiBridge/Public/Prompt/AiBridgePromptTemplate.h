@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Prompt/PromptTemplate.h"
+#include "AiBridgePromptTemplate.generated.h"
+
+/**
+ * An NPC persona: the system prompt text with ${name} variables filled in per turn.
+ *
+ * The text is compiled once when the asset loads or is edited, so a turn only copies literals and
+ * the variable values into a reused UTF-8 buffer. Values come from the request, then Defaults, then
+ * the project's PromptVariables; a variable none of them sets is sent as written.
+ */
+UCLASS(BlueprintType)
+class AIBRIDGE_API UAiBridgePromptTemplate : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Plain text. ${name} inserts a variable, $${ writes a literal ${ */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Prompt", meta = (MultiLine = true))
+	FString Template;
+
+	/** Values for variables the request does not set, e.g. customerContext */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Prompt")
+	TMap<FString, FString> Defaults;
+
+	/** Replaces the text and compiles it, for personas assembled at runtime */
+	UFUNCTION(BlueprintCallable, Category = "Prompt")
+	void SetTemplate(const FString& InTemplate);
+
+	/** Appends the prompt to Out as UTF-8, feeding the bytes to Hash when one is given. Game thread */
+	void Render(const TMap<FString, FString>& Variables, TArray<uint8>& Out, FXxHash64Builder* Hash = nullptr) const;
+
+	/** The prompt as it would be sent with Variables, for previews and debugging */
+	UFUNCTION(BlueprintCallable, Category = "Prompt")
+	FString RenderToString(const TMap<FString, FString>& Variables) const;
+
+	const FPromptTemplate& GetCompiled() const;
+
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+	mutable FPromptTemplate Compiled;
+
+	/** Reused between renders */
+	mutable TArray<FPromptTemplateValue> Values;
+};
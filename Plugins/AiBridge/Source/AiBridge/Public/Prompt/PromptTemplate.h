@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FXxHash64Builder;
+
+enum class EPromptEscaping : uint8
+{
+	/** Written as is */
+	None,
+	/** Escaped for the inside of a JSON string */
+	Json,
+};
+
+/** Value for one template variable; a default-constructed value leaves the placeholder as written */
+struct FPromptTemplateValue
+{
+	FPromptTemplateValue() = default;
+	FPromptTemplateValue(FStringView InText) : Text(InText), bSet(true) {}
+	FPromptTemplateValue(TConstArrayView<uint8> InUtf8) : Utf8(InUtf8), bUtf8(true), bSet(true) {}
+
+	FStringView Text;
+	TConstArrayView<uint8> Utf8;
+	bool bUtf8 = false;
+	bool bSet = false;
+};
+
+namespace AiBridgePrompt
+{
+	/** Appends Text as UTF-8, escaped as Escaping asks */
+	AIBRIDGE_API void AppendUtf8(FStringView Text, EPromptEscaping Escaping, TArray<uint8>& Out);
+	AIBRIDGE_API void AppendUtf8(TConstArrayView<uint8> Utf8, EPromptEscaping Escaping, TArray<uint8>& Out);
+}
+
+/**
+ * Text template compiled once into a list of literal and variable segments.
+ *
+ * ${name} inserts a variable and $${ writes a literal ${. A variable may pick its own escaping with
+ * ${name|json} or ${name|raw}, otherwise it is escaped like the literal text around it. Literals are
+ * stored already converted to UTF-8 and escaped, so rendering is a run of memcpys and value
+ * conversions into a caller-owned buffer that keeps its capacity from turn to turn.
+ */
+class AIBRIDGE_API FPromptTemplate
+{
+public:
+	/** Escaping applies to the literal text and to variables that do not choose their own */
+	void Compile(FStringView Source, EPromptEscaping Escaping = EPromptEscaping::None);
+
+	bool IsCompiled() const { return bCompiled; }
+
+	int32 NumVariables() const { return VariableNames.Num(); }
+	const FString& GetVariableName(int32 Index) const { return VariableNames[Index]; }
+	int32 FindVariable(FStringView Name) const;
+
+	/** Sizes Values for this template and sets variable Name, ignored if the template does not use it */
+	void SetValue(TArray<FPromptTemplateValue>& Values, FStringView Name, const FPromptTemplateValue& Value) const;
+
+	/**
+	 * Appends the template to Out with Values[Index] for variable Index; missing values keep their
+	 * placeholder. The bytes appended are fed to Hash as they are written when one is given.
+	 */
+	void Render(TConstArrayView<FPromptTemplateValue> Values, TArray<uint8>& Out, FXxHash64Builder* Hash = nullptr) const;
+
+private:
+	struct FSegment
+	{
+		/** Literal bytes, or the placeholder text for a variable */
+		int32 Offset = 0;
+		int32 Length = 0;
+		int32 Variable = INDEX_NONE;
+		EPromptEscaping Escaping = EPromptEscaping::None;
+	};
+
+	TArray<FSegment> Segments;
+	TArray<uint8> Literals;
+	TArray<FString> VariableNames;
+	bool bCompiled = false;
+};
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Audio/AudioDecodeStage.h"
+#include "AiBridgeDialogueReceiver.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnAiBridgeDialogueText, AActor*, Speaker, const FString&, Text);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnAiBridgeDialogueStarted, AActor*, Speaker, const FString&, AudioFormat);
+
+/** Counters of one client's dialogue channel, snapshot */
+struct FAiBridgeDialogueChannelStats
+{
+	// Server side
+	uint64 TextBytesSent = 0;
+	uint64 AudioBytesSent = 0;
+	uint64 AudioChunksSent = 0;
+	/** Chunks that had to wait for the client's bandwidth budget */
+	uint64 AudioChunksPaced = 0;
+	/** Chunks dropped because the backlog waiting for the budget was full */
+	uint64 AudioChunksOverBudget = 0;
+
+	// Client side
+	uint64 AudioChunksReceived = 0;
+	/** Gaps in the sequence: lost packets and chunks the server left out for budget */
+	uint64 AudioChunksMissing = 0;
+};
+
+/**
+ * A player's end of the replicated dialogue channel, added to each PlayerController by
+ * UAiBridgeReplicationSubsystem when the bridge runs server-authoritative.
+ *
+ * The server sends NPC dialogue to the owning client only: text reliably, audio as unreliable chunks
+ * numbered per turn so a late or lost chunk costs a gap rather than stalling the stream. Audio beyond
+ * the client's bandwidth budget waits on the server and is paced out from the component tick. On the
+ * client, audio of each speaker is decoded into its own stage for playback.
+ */
+UCLASS(ClassGroup = (AiBridge), meta = (BlueprintSpawnableComponent))
+class AIBRIDGE_API UAiBridgeDialogueReceiver : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UAiBridgeDialogueReceiver();
+
+	/** Decode received audio, read it back through GetSpeakerAudio */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replication")
+	bool bDecodeAudio = true;
+
+	/** A message of the orchestrator, as the server's bridge received it */
+	UPROPERTY(BlueprintAssignable, Category = "Replication")
+	FOnAiBridgeDialogueText OnDialogueText;
+
+	/** A speaker began a new utterance, its earlier audio is dropped */
+	UPROPERTY(BlueprintAssignable, Category = "Replication")
+	FOnAiBridgeDialogueStarted OnDialogueStarted;
+
+	/** Mono PCM at the mixer rate of what Speaker says, null before it first spoke to this client */
+	FAudioDecodeStage* GetSpeakerAudio(const AActor* Speaker) const;
+
+	FAiBridgeDialogueChannelStats GetStats() const { return Stats; }
+
+	// Server
+	/** Turn of Speaker this client was last told about, 0 for none */
+	uint32 GetStartedTurn(const AActor* Speaker) const;
+
+	void SendBeginDialogue(AActor* Speaker, uint32 TurnId, const FString& AudioFormat);
+	void SendText(AActor* Speaker, const FString& Text);
+
+	/** Sends the chunk now or once the client's audio budget covers it. False when the backlog is full and it is dropped */
+	bool SendAudio(AActor* Speaker, uint32 TurnId, uint16 Sequence, const TArray<uint8>& Chunk);
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	struct FSpeakerStream
+	{
+		uint32 TurnId = 0;
+		uint16 NextSequence = 0;
+		TUniquePtr<FAudioDecodeStage> Audio;
+	};
+
+	/** Client side */
+	TMap<TWeakObjectPtr<const AActor>, FSpeakerStream> Speakers;
+
+	struct FStartedTurn
+	{
+		uint32 TurnId = 0;
+		/** What the turn's format needs to play in real time, 0 if unknown */
+		int32 BytesPerSecond = 0;
+	};
+
+	struct FQueuedAudio
+	{
+		TWeakObjectPtr<AActor> Speaker;
+		uint32 TurnId = 0;
+		uint16 Sequence = 0;
+		TArray<uint8> Chunk;
+	};
+
+	/** Server side */
+	TMap<TWeakObjectPtr<const AActor>, FStartedTurn> StartedTurns;
+	double AudioAllowance = 0.0;
+	double AllowanceTime = 0.0;
+
+	/** Chunks waiting for the budget in sequence order, sent from the tick */
+	TArray<FQueuedAudio> QueuedAudio;
+	int32 QueuedAudioBytes = 0;
+
+	FAiBridgeDialogueChannelStats Stats;
+
+	/** The configured budget, raised to what the fastest started format needs. 0 is unlimited */
+	int32 GetAudioBytesPerSecond() const;
+
+	/** Takes Bytes from the client's audio allowance, false and nothing taken when it does not cover them */
+	bool TrySpendAudioBudget(int32 Bytes);
+
+	/** Sends queued chunks while the allowance covers them, oldest first */
+	void SendQueuedAudio();
+
+	UFUNCTION(Client, Reliable)
+	void ClientBeginDialogue(AActor* Speaker, uint32 TurnId, const FString& AudioFormat);
+
+	UFUNCTION(Client, Reliable)
+	void ClientDialogueText(AActor* Speaker, const FString& Text);
+
+	UFUNCTION(Client, Unreliable)
+	void ClientDialogueAudio(AActor* Speaker, uint32 TurnId, uint16 Sequence, const TArray<uint8>& Chunk);
+};
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Audio/AudioDecoder.h"
+#include "AiBridgeReplicationSubsystem.generated.h"
+
+class AGameModeBase;
+class APlayerController;
+class UAiBridgeDialogueReceiver;
+
+/**
+ * Server side of the replicated dialogue channel, created when AiBridge settings select the
+ * ServerAuthoritative net mode. Only the server or listen host talks to the orchestrator; what its
+ * bridge receives for an NPC is forwarded here and sent to each client whose player is within
+ * ReplicationAudibleDistance of the NPC and to whom the NPC is net relevant.
+ *
+ * Every PlayerController gets a UAiBridgeDialogueReceiver on login. Audio is split into chunks that
+ * fit a packet, raw pcm_* audio is re-encoded as mu-law first, and each client has its own byte
+ * budget so a crowd around one NPC cannot starve gameplay replication.
+ */
+UCLASS()
+class AIBRIDGE_API UAiBridgeReplicationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Begin USubsystem
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End USubsystem
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Starts a new utterance of Speaker in a TTS output format such as pcm_22050. Server only */
+	UFUNCTION(BlueprintCallable, Category = "Replication")
+	void BeginDialogue(AActor* Speaker, const FString& AudioFormat);
+
+	/** Sends an orchestrator message for Speaker to the clients that can hear it. Server only */
+	UFUNCTION(BlueprintCallable, Category = "Replication")
+	void PublishText(AActor* Speaker, const FString& Text);
+
+	/** Sends a chunk of Speaker's current utterance in the format BeginDialogue was given. Server only */
+	void PublishAudio(AActor* Speaker, TConstArrayView<uint8> Chunk);
+
+	/** False on clients, which only receive */
+	bool IsServer() const;
+
+	void LogStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/** Largest audio payload per RPC, split bunches of unreliable RPCs are lost as a whole */
+	static constexpr int32 MaxAudioChunkBytes = 1000;
+
+	struct FTurn
+	{
+		uint32 TurnId = 0;
+		/** What clients decode, ulaw_* when pcm_* is re-encoded */
+		FString ReplicatedFormat;
+		uint16 NextSequence = 0;
+		bool bReencode = false;
+		FMuLawEncoder Encoder;
+	};
+
+	TMap<TWeakObjectPtr<AActor>, FTurn> Turns;
+	TArray<TWeakObjectPtr<UAiBridgeDialogueReceiver>> Receivers;
+	uint32 NextTurnId = 1;
+
+	/** Reused between chunks */
+	TArray<uint8> Encoded;
+	TArray<uint8> Piece;
+
+	FDelegateHandle PostLoginHandle;
+
+	void HandlePostLogin(AGameModeBase* GameMode, APlayerController* PlayerController);
+	UAiBridgeDialogueReceiver* AddReceiver(APlayerController* PlayerController);
+
+	/** Receivers that should hear Speaker now, each told about the current turn before its first chunk */
+	void GatherAudience(AActor* Speaker, const FTurn& Turn, TArray<UAiBridgeDialogueReceiver*>& OutAudience);
+};
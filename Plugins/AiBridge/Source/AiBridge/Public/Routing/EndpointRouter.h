@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "Http.h"
+#include "Settings/AiBridgeSettings.h"
+#include "EndpointRouter.generated.h"
+
+/** Live health of one configured endpoint */
+struct FEndpointHealth
+{
+	FAiBridgeEndpoint Endpoint;
+
+	/** Exponentially smoothed /health round trip, negative until the first successful probe */
+	double SmoothedRttMs = -1.0;
+	double LastRttMs = -1.0;
+	int32 ConsecutiveFailures = 0;
+	bool bProbeInFlight = false;
+};
+
+/**
+ * Picks which orchestrator deployment to talk to.
+ *
+ * Every endpoint is probed with the same /health GET the bridge already used as a Cloud Run wake-up
+ * call, so probing also keeps the instances warm. Connects go to the healthy endpoint with the lowest
+ * smoothed round trip; a failed connect or a link that drops marks the endpoint and fails over to the
+ * next best one. Only a 2xx answer counts as healthy.
+ */
+UCLASS()
+class AIBRIDGE_API UAiBridgeEndpointRouter : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	void Initialize(const TArray<FAiBridgeEndpoint>& InEndpoints, int32 InFailuresBeforeUnhealthy, float InProbeTimeout);
+
+	/** Probes every endpoint now and then every Interval seconds (0 = no periodic probing) */
+	void StartProbing(float Interval);
+	void StopProbing();
+	bool IsProbing() const { return bProbing; }
+
+	/** Fires one /health request per endpoint that is not already being probed */
+	void ProbeAll();
+
+	/** Selects the endpoint to connect to and makes it active */
+	const FAiBridgeEndpoint& SelectEndpoint();
+
+	/** The endpoint chosen by the last SelectEndpoint/Failover */
+	const FAiBridgeEndpoint& GetActiveEndpoint() const;
+
+	/** Records a failed connect or lost link on the active endpoint; returns true if another healthy endpoint was selected */
+	bool Failover();
+
+	/** Records a successful connect on the active endpoint */
+	void ReportSuccess();
+
+	int32 GetNumHealthyEndpoints() const;
+
+	const TArray<FEndpointHealth>& GetEndpoints() const { return Endpoints; }
+
+	/** Multi-line status for console output */
+	FString Describe() const;
+
+	virtual void BeginDestroy() override;
+
+private:
+	TArray<FEndpointHealth> Endpoints;
+	int32 ActiveIndex = 0;
+	int32 FailuresBeforeUnhealthy = 2;
+	float ProbeTimeout = 10.0f;
+
+	FTSTicker::FDelegateHandle ProbeTicker;
+	bool bProbing = false;
+
+	bool IsHealthy(const FEndpointHealth& Health) const { return Health.ConsecutiveFailures < FailuresBeforeUnhealthy; }
+	int32 FindBestIndex(int32 ExcludeIndex) const;
+
+	void Probe(int32 Index);
+	void HandleProbeResult(int32 Index, double StartTime, bool bHealthy);
+	bool TickProbes(float DeltaTime);
+};
@@ -0,0 +1,205 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "AiBridgeSettings.generated.h"
+
+class UAiBridgePromptTemplate;
+
+/** Which game instances talk to the orchestrator in a networked session */
+UENUM(BlueprintType)
+enum class EAiBridgeNetMode : uint8
+{
+	/** Every instance, clients included, runs its own bridge */
+	EveryInstance,
+	/** Only the server or listen host runs the bridge and replicates NPC dialogue to the clients that can hear it */
+	ServerAuthoritative,
+};
+
+/** One orchestrator deployment the bridge may connect to */
+USTRUCT(BlueprintType)
+struct AIBRIDGE_API FAiBridgeEndpoint
+{
+	GENERATED_BODY()
+
+	/** Base http(s) url, the websocket and /health urls are derived from it */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Endpoint")
+	FString Url;
+
+	/** Region sent as `location` in conversation payloads, e.g. europe-west4 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Endpoint")
+	FString Location;
+
+	/** Added to every probe of this endpoint outside Shipping, for exercising selection against local mocks */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Endpoint", AdvancedDisplay, meta = (ClampMin = "0"))
+	float SimulatedLatencyMs = 0.0f;
+};
+
+/** One rung of the TTS quality ladder, what the provider is asked for while the link sustains MinKbps */
+USTRUCT(BlueprintType)
+struct AIBRIDGE_API FAiBridgeTtsFormat
+{
+	GENERATED_BODY()
+
+	/** ElevenLabs output format, e.g. pcm_22050, opus_48000_96 or ulaw_8000 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Tts")
+	FString OutputFormat;
+
+	/** batch sends the utterance once it is synthesized, streaming sends it as it is */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Tts")
+	FString StreamingMode = TEXT("batch");
+
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Tts")
+	FString Model = TEXT("eleven_turbo_v2_5");
+
+	/** Measured downstream throughput this format needs, well above its bitrate so playback never waits */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Tts", meta = (ClampMin = "0"))
+	float MinKbps = 0.0f;
+};
+
+/** Client-side share of an orchestrator quota, requests beyond it wait instead of being refused by the server */
+USTRUCT(BlueprintType)
+struct AIBRIDGE_API FAiBridgeRateLimit
+{
+	GENERATED_BODY()
+
+	/** Requests sent under this name share the limit, conversation turns use Turns */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "RateLimit")
+	FName Bucket = TEXT("Turns");
+
+	/** Sustained rate, keep it at or below the server's quota for the API key */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "RateLimit", meta = (ClampMin = "0.1"))
+	float RequestsPerMinute = 30.0f;
+
+	/** Requests that may go out back to back after a quiet spell */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "RateLimit", meta = (ClampMin = "1"))
+	int32 Burst = 5;
+
+	/** Requests waiting for their turn, further ones fail straight away rather than queue up stale */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "RateLimit", meta = (ClampMin = "0"))
+	int32 MaxQueued = 8;
+};
+
+/**
+ * Project-wide AiBridge configuration, edited under Project Settings > Plugins > AiBridge and stored in DefaultGame.ini.
+ */
+UCLASS(config = Game, defaultconfig, meta = (DisplayName = "AiBridge"))
+class AIBRIDGE_API UAiBridgeSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UAiBridgeSettings();
+
+	/** Candidate deployments, the healthy one with the lowest measured round trip is used */
+	UPROPERTY(Config, EditAnywhere, Category = "Endpoints")
+	TArray<FAiBridgeEndpoint> Endpoints;
+
+	/** Seconds between background /health probes, 0 probes only on startup and failover */
+	UPROPERTY(Config, EditAnywhere, Category = "Endpoints", meta = (ClampMin = "0"))
+	float ProbeInterval = 30.0f;
+
+	/** A probe slower than this counts as a failure */
+	UPROPERTY(Config, EditAnywhere, Category = "Endpoints", meta = (ClampMin = "0.1"))
+	float ProbeTimeout = 10.0f;
+
+	/** Consecutive failed probes or connects before an endpoint is skipped */
+	UPROPERTY(Config, EditAnywhere, Category = "Endpoints", meta = (ClampMin = "1"))
+	int32 FailuresBeforeUnhealthy = 2;
+
+	/** Seconds between heartbeat pings on the open socket, 0 disables the heartbeat */
+	UPROPERTY(Config, EditAnywhere, Category = "Connection", meta = (ClampMin = "0"))
+	float HeartbeatInterval = 2.0f;
+
+	/** Inbound silence after which the link is treated as dead and reconnected, counted from the connect */
+	UPROPERTY(Config, EditAnywhere, Category = "Connection", meta = (ClampMin = "0.5"))
+	float HeartbeatTimeout = 6.0f;
+
+	/** Index built with AiBridge.Knowledge.Build, relative paths are under the project directory. Empty sends the inline prompt knowledge */
+	UPROPERTY(Config, EditAnywhere, Category = "Knowledge")
+	FString KnowledgeIndexPath;
+
+	/** Most snippets added to one request's system prompt */
+	UPROPERTY(Config, EditAnywhere, Category = "Knowledge", meta = (ClampMin = "1"))
+	int32 KnowledgeTopK = 4;
+
+	/** Snippets less similar to the utterance than this are left out, even when fewer than KnowledgeTopK match */
+	UPROPERTY(Config, EditAnywhere, Category = "Knowledge", meta = (ClampMin = "0", ClampMax = "1"))
+	float KnowledgeMinScore = 0.15f;
+
+	/** Compiled tiktoken rank tables named <encoding>.abtok, relative paths are under the project directory. Stage it as a non-UFS directory */
+	UPROPERTY(Config, EditAnywhere, Category = "Tokenizer")
+	FString TokenizerDirectory = TEXT("Content/AiBridge/Tokenizers");
+
+	/** Tokens the system prompt, history and utterance may use together, the oldest history is dropped beyond it. 0 sends everything */
+	UPROPERTY(Config, EditAnywhere, Category = "Tokenizer", meta = (ClampMin = "0"))
+	int32 PromptTokenBudget = 3000;
+
+	/** Persona for requests that do not pass one, the built-in customer service persona when unset */
+	UPROPERTY(Config, EditAnywhere, Category = "Prompt")
+	TSoftObjectPtr<UAiBridgePromptTemplate> DefaultPersona;
+
+	/** Values for persona variables that neither the request nor the persona sets, e.g. serviceConfig.escalationThreshold */
+	UPROPERTY(Config, EditAnywhere, Category = "Prompt")
+	TMap<FString, FString> PromptVariables;
+
+	/** Picks each turn's TTS format from TtsFormats by the measured downstream throughput, otherwise the bridge's TtsOutputFormat is always asked for */
+	UPROPERTY(Config, EditAnywhere, Category = "Tts")
+	bool bAdaptiveTtsFormat = true;
+
+	/**
+	 * Ordered by MinKbps, highest first, whatever order they are listed in. The first format the link sustains
+	 * is used, the last one however slow the link. Only formats the client can play are considered: raw pcm,
+	 * and any format with a registered decoder while the bridge decodes TTS audio.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Tts", meta = (EditCondition = "bAdaptiveTtsFormat"))
+	TArray<FAiBridgeTtsFormat> TtsFormats;
+
+	/** Moving up to a better format takes this many times its MinKbps, so a link near a threshold does not flap */
+	UPROPERTY(Config, EditAnywhere, Category = "Tts", meta = (EditCondition = "bAdaptiveTtsFormat", ClampMin = "1"))
+	float TtsUpgradeHeadroom = 1.5f;
+
+	/** Buckets without an entry are not limited */
+	UPROPERTY(Config, EditAnywhere, Category = "RateLimit")
+	TArray<FAiBridgeRateLimit> RateLimits;
+
+	/** A turn identical to one still waiting for its reply joins that reply instead of being sent again */
+	UPROPERTY(Config, EditAnywhere, Category = "RateLimit")
+	bool bCoalesceDuplicateTurns = true;
+
+	/** Conversation history kept per NPC, the oldest messages are evicted beyond it. 0 is unlimited */
+	UPROPERTY(Config, EditAnywhere, Category = "Memory", meta = (ClampMin = "0", Units = "Kilobytes"))
+	int32 HistoryBudgetKB = 256;
+
+	/** Encoded and decoded TTS audio waiting for playback per stream, later audio is dropped beyond it. 0 is unlimited */
+	UPROPERTY(Config, EditAnywhere, Category = "Memory", meta = (ClampMin = "0", Units = "Kilobytes"))
+	int32 AudioBudgetKB = 8192;
+
+	/** Inbound frames waiting for the game thread per connection, binary frames are dropped beyond it. 0 is unlimited */
+	UPROPERTY(Config, EditAnywhere, Category = "Memory", meta = (ClampMin = "0", Units = "Kilobytes"))
+	int32 MessagesBudgetKB = 4096;
+
+	/** Who talks to the orchestrator in a multiplayer session */
+	UPROPERTY(Config, EditAnywhere, Category = "Replication")
+	EAiBridgeNetMode BridgeNetMode = EAiBridgeNetMode::EveryInstance;
+
+	/** Clients further than this from the speaking NPC do not receive its dialogue */
+	UPROPERTY(Config, EditAnywhere, Category = "Replication", meta = (ClampMin = "0", Units = "Centimeters"))
+	float ReplicationAudibleDistance = 3000.0f;
+
+	/**
+	 * Replicated dialogue audio per client. Audio arriving faster, such as a batch TTS reply, is queued and
+	 * paced out at this rate; it is raised to what the replicated format needs to play in real time when
+	 * set lower. 0 is unlimited
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Replication", meta = (ClampMin = "0"))
+	int32 ReplicatedAudioBytesPerSecond = 32000;
+
+	/** Re-encodes pcm_* TTS audio as mu-law before replicating it, halving its bandwidth */
+	UPROPERTY(Config, EditAnywhere, Category = "Replication")
+	bool bCompressReplicatedPcm = true;
+
+	virtual FName GetCategoryName() const override { return TEXT("Plugins"); }
+};
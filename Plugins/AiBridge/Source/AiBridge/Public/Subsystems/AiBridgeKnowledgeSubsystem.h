@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Knowledge/KnowledgeIndex.h"
+#include "AiBridgeKnowledgeSubsystem.generated.h"
+
+/**
+ * Picks the knowledge snippets relevant to the current utterance, so requests carry a few paragraphs
+ * instead of the whole knowledge base in every system prompt.
+ */
+UCLASS()
+class AIBRIDGE_API UAiBridgeKnowledgeSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Begin USubsystem
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End USubsystem
+
+	/** Replaces the loaded index, false keeps none loaded */
+	UFUNCTION(BlueprintCallable, Category = "Knowledge")
+	bool LoadIndex(const FString& Path);
+
+	UFUNCTION(BlueprintPure, Category = "Knowledge")
+	bool HasIndex() const { return Index.IsValid(); }
+
+	/** Best matching snippets for Utterance separated by blank lines, empty if none is similar enough */
+	UFUNCTION(BlueprintCallable, Category = "Knowledge")
+	FString SelectKnowledge(const FString& Utterance) const;
+
+	/** Splits a text file into snippets at blank lines and writes an index for them */
+	static bool BuildIndex(const FString& SourcePath, const FString& IndexPath);
+
+	/** Relative paths resolve against the project directory */
+	static FString ResolvePath(const FString& Path);
+
+	const FKnowledgeIndex* GetIndex() const { return Index.Get(); }
+
+private:
+	TUniquePtr<FKnowledgeIndex> Index;
+
+	int32 TopK = 4;
+	float MinScore = 0.15f;
+
+	/** Reused between searches, retrieval runs once per utterance on the game thread */
+	mutable TArray<FKnowledgeHit> Hits;
+};
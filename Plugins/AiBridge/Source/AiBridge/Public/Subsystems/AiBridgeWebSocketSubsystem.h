@@ -6,6 +6,17 @@
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "IWebSocket.h"
 #include "Authentication/JwtAuthenticationService.h"
+#include "LipSync/VisemeAnalyzer.h"
+#include "Audio/AudioDecodeStage.h"
+#include "Audio/TtsFormatSelector.h"
+#include "Audio/VoiceActivityDetector.h"
+#include "Memory/AiBridgeMemory.h"
+#include "Prompt/PromptTemplate.h"
+#include "Tokenizer/PromptBudget.h"
+#include "WebSocket/AiBridgeHeartbeat.h"
+#include "WebSocket/AiBridgeOutbox.h"
+#include "WebSocket/AiBridgeRateLimiter.h"
+#include "WebSocket/AiBridgeRequestTracker.h"
 #include "AiBridgeWebSocketSubsystem.generated.h"
 
 
@@ -15,6 +26,11 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnWebSocketTextMessage, const FStri
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnWebSocketBinaryMessage, const TArray<uint8>&, Data);
 
 class UWebSocketConnection;
+class UAiBridgeEndpointRouter;
+class UAiBridgePromptTemplate;
+class UAiBridgeReplicationSubsystem;
+class UAiBridgeTtsSoundWave;
+class USoundWave;
 /**
  * 
  */
@@ -24,8 +40,41 @@ class AIBRIDGE_API UAiBridgeWebSocketSubsystem : public UGameInstanceSubsystem
 	GENERATED_BODY()
 public:
 	
+	/** Kept for Blueprints: the /health probes that pick the endpoint also wake it up, they always run */
 	UPROPERTY(BlueprintReadWrite, Category = "WebSocket")
 	bool sendWakeUpCall = true;
+
+	/** Feed incoming audio into the viseme analyzer, as decoded PCM when bDecodeTtsAudio is set, else as raw pcm_* bytes */
+	UPROPERTY(BlueprintReadWrite, Category = "LipSync")
+	bool bAnalyzeLipSync = false;
+
+	/** Sample rate of the 16-bit PCM the server streams (matches the requested ElevenLabs pcm_* format), unused while decoding */
+	UPROPERTY(BlueprintReadWrite, Category = "LipSync")
+	int32 LipSyncSampleRate = 22050;
+
+	/** Decode incoming binary audio to the mixer rate on worker threads, play it with GetTtsSound or read it back through GetTtsAudioStage */
+	UPROPERTY(BlueprintReadWrite, Category = "Audio")
+	bool bDecodeTtsAudio = false;
+
+	/**
+	 * Output format the TTS provider is asked for, e.g. pcm_22050, ulaw_8000 or opus_48000_64. With adaptive TTS
+	 * formats enabled in AiBridge settings it is picked before every turn from the measured downstream throughput.
+	 * Decoding moves to a new format once the audio of the first turn that asked for it arrives. Every turn names it: the server would otherwise answer in mp3, which this client has no built-in decoder
+	 * for, and OnBinaryMessage listeners without decoding can only use raw pcm.
+	 */
+	UPROPERTY(BlueprintReadWrite, Category = "Audio")
+	FString TtsOutputFormat = TEXT("pcm_22050");
+
+	/** Tunables applied to detectors created by CreateVoiceUploadGate */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voice")
+	FAiBridgeVadSettings VadSettings;
+
+	/**
+	 * Text frame upload gates send when the local endpointer ends an utterance, for servers that take one.
+	 * Empty by default: the orchestrator's protocol defines no such message and endpoints audio itself.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voice")
+	FString EndOfUtteranceMessage;
 	
 	// Begin USubsystem
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
@@ -46,9 +95,24 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "WebSocket")
 	void SendBinary(const TArray<uint8>& Data);
 
+	/** Callable from any thread, the buffer is moved to the I/O thread without copies. False if the link is down */
+	bool SendTextAnyThread(FString&& Message);
+	bool SendBinaryAnyThread(TArray<uint8>&& Data);
+
+	/** Keep this rather than the subsystem on worker threads, it stays safe to use after the subsystem is gone */
+	TSharedPtr<FAiBridgeOutbox, ESPMode::ThreadSafe> GetOutbox() const { return Outbox; }
+
 	UFUNCTION(BlueprintPure, Category = "WebSocket")
 	bool IsConnected() const;
 
+	/** Round trip and liveness of the current socket as measured by the heartbeat */
+	UFUNCTION(BlueprintPure, Category = "WebSocket")
+	FAiBridgeHeartbeatStats GetConnectionStats() const;
+
+	/** Throughput the server has been able to deliver, what adaptive TTS formats are picked by */
+	UFUNCTION(BlueprintPure, Category = "WebSocket")
+	FAiBridgeThroughputStats GetDownstreamStats() const;
+
 	// Events
 	UPROPERTY(BlueprintAssignable, Category = "WebSocket")
 	FOnWebSocketConnected OnConnected;
@@ -63,6 +127,7 @@ public:
 	FOnWebSocketBinaryMessage OnBinaryMessage;
 	
 
+	/** Calls Callback once connected or once connecting failed; callers during an attempt share its outcome */
 	void EnsureConnection(TFunction<void(bool)> Callback);
 	
 	UFUNCTION(BlueprintCallable, Category = "WebSocket")
@@ -70,24 +135,205 @@ public:
 	
 	UFUNCTION(BlueprintCallable, Category = "WebSocket")
 	void SendSomethingCrazy();
+
+	/**
+	 * Sends a text turn, dropping the oldest History messages that do not fit the prompt token budget.
+	 * Persona is the NPC's system prompt, the configured default when null; Variables fill its ${name}s.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "WebSocket", meta = (AutoCreateRefTerm = "Variables"))
+	void SendTextInput(const FString& Text, const TArray<FAiBridgeChatMessage>& History, UAiBridgePromptTemplate* Persona, const TMap<FString, FString>& Variables);
+
+	/**
+	 * Sends a text turn like SendTextInput and follows its reply through Handlers, matched by the returned
+	 * requestId. With bExpectAudio the turn completes once its TTS audio has ended too. A turn that hears
+	 * nothing for TimeoutSeconds after it went out, is sent while disconnected or finds the rate limiter's
+	 * queue full fails; one that fails or is cancelled while the limiter holds it back is never sent.
+	 * A turn identical to one still waiting for its reply, audio expectation included, shares that reply
+	 * and its requestId.
+	 */
+	FString SendConversationTurn(const FString& Text, const TArray<FAiBridgeChatMessage>& History, UAiBridgePromptTemplate* Persona, const TMap<FString, FString>& Variables, FAiBridgeReplyHandlers&& Handlers, bool bExpectAudio, float TimeoutSeconds);
+
+	/** Stops following RequestId, its handlers are not called again */
+	void CancelConversationTurn(const FString& RequestId);
+
+	/** Turns held back or coalesced to stay within the orchestrator's quotas */
+	UFUNCTION(BlueprintPure, Category = "WebSocket")
+	FAiBridgeRateLimiterStats GetRateLimiterStats() const { return RateLimiter.GetStats(); }
+
+	// Conversation history
+	/** Appends Message to the conversation kept for Npc, its oldest messages are evicted beyond the history memory budget */
+	UFUNCTION(BlueprintCallable, Category = "Conversation")
+	void AddHistoryMessage(FName Npc, const FAiBridgeChatMessage& Message);
+
+	/** The conversation kept for Npc, oldest first, ready to pass to SendTextInput */
+	UFUNCTION(BlueprintPure, Category = "Conversation")
+	TArray<FAiBridgeChatMessage> GetHistory(FName Npc) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Conversation")
+	void ClearHistory(FName Npc);
+
+	// Lip sync
+	UFUNCTION(BlueprintCallable, Category = "LipSync")
+	void BeginLipSyncUtterance();
+
+	/** Lock-free, safe to call from animation worker threads */
+	UFUNCTION(BlueprintPure, Category = "LipSync", meta = (BlueprintThreadSafe))
+	FAiBridgeVisemeFrame GetVisemeFrame(float PlaybackTime) const;
+
+	UAiBridgeEndpointRouter* GetEndpointRouter() const { return Router; }
+
+	FVisemeAnalyzer* GetVisemeAnalyzer() const { return VisemeAnalyzer.Get(); }
+
+	// TTS audio
+	/** Starts a new TTS utterance in TtsOutputFormat, audio still queued from the previous one is dropped */
+	UFUNCTION(BlueprintCallable, Category = "Audio")
+	void BeginTtsAudioStream();
+
+	/** Mono PCM at the mixer rate, pull it from the audio render thread with Read */
+	FAudioDecodeStage* GetTtsAudioStage() const { return TtsAudioStage.Get(); }
+
+	/**
+	 * Sound playing the decoded TTS audio, made on first use and turning bDecodeTtsAudio on. Play it on an
+	 * audio component at the speaker; it stays silent between replies. Only one instance may play at a time.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Audio")
+	USoundWave* GetTtsSound();
+
+	// Voice upload
+	/**
+	 * Creates a voice activity detector whose voiced frames are uploaded through this bridge.
+	 * Bind ProcessCaptureBuffer to the microphone capture callback; silence never leaves the client and,
+	 * when EndOfUtteranceMessage is set, it is sent as soon as the local endpointer fires.
+	 */
+	TSharedRef<FVoiceActivityDetector, ESPMode::ThreadSafe> CreateVoiceUploadGate();
+
+	/** Stats of the most recently created upload gate */
+	UFUNCTION(BlueprintPure, Category = "Voice")
+	FAiBridgeVadStats GetVadStats() const;
+
+	// Replication
+	/**
+	 * False on clients when AiBridge settings make the bridge server-authoritative; they then never
+	 * connect and get NPC dialogue through their UAiBridgeDialogueReceiver instead.
+	 */
+	UFUNCTION(BlueprintPure, Category = "Replication")
+	bool OwnsBridge() const;
+
+	/**
+	 * Replicates what the bridge receives from now on as Speaker's dialogue, starting a new utterance.
+	 * Does nothing unless the bridge is server-authoritative. Null stops replicating.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Replication")
+	void SetReplicatedSpeaker(AActor* Speaker);
 	
 private:
 	
-	FString ApiBaseUrl = "https://api-orchestrator-service-936031000571.europe-west4.run.app";
+	UPROPERTY()
+	UAiBridgeEndpointRouter* Router;
 	
 	bool bIsConnecting = false;
+
+	/** Everyone waiting on the connection attempt in progress, answered together when it ends */
+	TArray<TFunction<void(bool)>> ConnectCallbacks;
+
+	/** Fetches a token for the best endpoint and opens the socket, failing over until one works or none is left */
+	void ConnectToBestEndpoint();
+	void FinishConnecting(bool bSuccess);
+
+	/** Reconnects through the router after an established link dropped, backing off between failed attempts */
+	void RecoverLink(int32 Attempt);
+	FTSTicker::FDelegateHandle RecoveryTicker;
+
+	UPROPERTY()
 	UWebSocketConnection* WebSocket;
+
+	TSharedPtr<FAiBridgeOutbox, ESPMode::ThreadSafe> Outbox;
 	
 	UPROPERTY()
 	UJwtAuthenticationService* AuthService;
 	bool bJwtReady;
 	FString CachedToken;
+
+	TUniquePtr<FVisemeAnalyzer> VisemeAnalyzer;
+
+	/** Shared with the TTS sound, whose render thread reads it and may outlive the subsystem */
+	TSharedPtr<FAudioDecodeStage, ESPMode::ThreadSafe> TtsAudioStage;
+
+	UPROPERTY()
+	UAiBridgeTtsSoundWave* TtsSound;
+
+	/** Whether the decode stage currently hands its PCM to the viseme analyzer */
+	bool bLipSyncTapped = false;
+
+	/** Adds or removes the lip sync tap on the decode stage as bAnalyzeLipSync changes, in order with the chunks */
+	void UpdateLipSyncTap();
+
+	FTtsFormatSelector TtsFormats;
+	FString TtsStreamingMode;
+	FString TtsModel;
+
+	/** Picks the TTS format the link sustains now for the turn being built, playback moves to it with that turn's audio */
+	void UpdateTtsFormat();
+
+	/** Format of the audio arriving now, what the decode stage and replication were started with */
+	FString PlayingTtsFormat;
+
+	/** Format each tracked turn asked for, by request id, until its audio starts */
+	TMap<FString, FString> TurnTtsFormats;
+
+	/** Restarts the decode stage, lip sync and replication for audio in Format, dropping what is still queued */
+	void StartTtsAudioStream(const FString& Format);
+
+	TSharedPtr<FVoiceActivityDetector, ESPMode::ThreadSafe> VoiceUploadGate;
+
+	TWeakObjectPtr<AActor> ReplicatedSpeaker;
+
+	/** Conversation turns waiting for their reply */
+	FAiBridgeRequestTracker RequestTracker;
+	FTSTicker::FDelegateHandle RequestTicker;
+
+	/** Paces turns to the configured quotas */
+	FAiBridgeRateLimiter RateLimiter;
+
+	/** Turns waiting for their reply by a hash of what they asked, for coalescing duplicates */
+	TMap<uint64, FString> PendingTurns;
+
+	bool TickRequests(float DeltaTime);
+
+	/** Where inbound dialogue is replicated, null when nothing is */
+	UAiBridgeReplicationSubsystem* GetReplication() const;
 	
 	void InitializeConnectionSequence();
 	
-	void SendWakeUpCallAsync() const;
+	/** Starts the /health probes endpoint selection runs on, unless they already run */
+	void StartEndpointProbing() const;
 	
 	void PreFetchJwtToken();
+
+	/** Knowledge section of the system prompt for Utterance */
+	FString SelectKnowledgeText(const FString& Utterance) const;
+
+	/** The request as UTF-8 JSON, valid until the next call */
+	const TArray<uint8>& BuildTextInputRequest(const FString& Text, const FString& RequestId, TArray<FAiBridgeChatMessage> History, const UAiBridgePromptTemplate* Persona, const TMap<FString, FString>& Variables);
+
+	UPROPERTY()
+	UAiBridgePromptTemplate* DefaultPersona;
+
+	/** Reused from turn to turn so building a request settles into no allocations */
+	TMap<FString, FString> PromptVariables;
+	TArray<uint8> PromptBuffer;
+	TArray<uint8> MessagesBuffer;
+	TArray<uint8> RequestBuffer;
+	TArray<FPromptTemplateValue> MessageValues;
+	TArray<FPromptTemplateValue> RequestValues;
+
+	/** History kept per NPC, each counted against its own history budget */
+	struct FNpcConversation
+	{
+		TArray<FAiBridgeChatMessage> Messages;
+		TSharedPtr<FAiBridgeMemoryStream, ESPMode::ThreadSafe> Memory;
+	};
+	TMap<FName, FNpcConversation> Conversations;
 	
 	
 };
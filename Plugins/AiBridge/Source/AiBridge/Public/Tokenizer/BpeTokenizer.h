@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/** How text is split into pieces before byte pair merging, each matches one tiktoken encoding's regex */
+enum class EBpePreTokenizer : uint8
+{
+	/** cl100k_base: gpt-4, gpt-3.5-turbo and the text-embedding-3 models */
+	Cl100k,
+	/** o200k_base: gpt-4o, gpt-4.1 and the o-series */
+	O200k,
+};
+
+namespace AiBridgeTokenizer
+{
+	/** tiktoken encoding name for an llmModel, o200k_base unless the model is known to use cl100k_base */
+	AIBRIDGE_API FString GetEncodingForModel(const FString& Model);
+
+	/** Pre-tokenizer of an encoding name */
+	AIBRIDGE_API EBpePreTokenizer GetPreTokenizer(const FString& Encoding);
+}
+
+/**
+ * Byte-level BPE tokenizer compatible with OpenAI's tiktoken encodings, used to budget prompts before
+ * they are sent.
+ *
+ * The rank table is compiled once from the published .tiktoken file into an open-addressed hash table
+ * that is memory mapped at load, so nothing is parsed or allocated per token. Count converts and merges
+ * each piece in stack buffers and does not allocate for pieces of up to 256 bytes. Without a compiled
+ * table the tokenizer still splits text the same way and estimates the count from piece lengths.
+ */
+class AIBRIDGE_API FBpeTokenizer
+{
+public:
+	/** Writes a rank table, Tokens[Rank] holding the bytes of each token. False if it cannot be written */
+	static bool Compile(const TArray<TArray<uint8>>& Tokens, EBpePreTokenizer PreTokenizer, const FString& Path);
+
+	/** Compiles a tiktoken rank file, lines of base64 token bytes and rank, for Encoding */
+	static bool CompileTiktoken(const FString& SourcePath, const FString& Encoding, const FString& Path);
+
+	/** Null if the file is missing or not a compiled rank table */
+	static TUniquePtr<FBpeTokenizer> Open(const FString& Path);
+
+	/** Shared tokenizer for the model's encoding from the configured tokenizer directory, estimating if it has no table */
+	static TSharedRef<FBpeTokenizer, ESPMode::ThreadSafe> ForModel(const FString& Model);
+
+	~FBpeTokenizer();
+
+	/** Number of tokens Text encodes to */
+	int32 Count(FStringView Text) const;
+
+	/** Appends the token ranks of Text, nothing without a table */
+	void Encode(FStringView Text, TArray<uint32>& OutTokens) const;
+
+	/** Appends the UTF-8 bytes of Tokens */
+	void Decode(TConstArrayView<uint32> Tokens, TArray<uint8>& OutBytes) const;
+
+	/** False when counts are estimates because no rank table was found */
+	bool IsExact() const { return NumRanks > 0; }
+	bool IsMapped() const { return MappedRegion.IsValid(); }
+	int32 GetVocabularySize() const { return NumRanks; }
+	EBpePreTokenizer GetPreTokenizer() const { return PreTokenizer; }
+
+private:
+	explicit FBpeTokenizer(EBpePreTokenizer InPreTokenizer) : PreTokenizer(InPreTokenizer) {}
+
+	struct FEntry
+	{
+		uint32 Hash;
+		uint32 Rank;
+	};
+
+	EBpePreTokenizer PreTokenizer;
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray<uint8> Contents;
+
+	int32 NumRanks = 0;
+	uint32 TableMask = 0;
+	const FEntry* Table = nullptr;
+	const uint32* RankOffsets = nullptr;
+	const uint8* TokenBytes = nullptr;
+
+	bool Bind(const uint8* Data, int64 Size);
+
+	/** Rank of a byte sequence, MAX_uint32 if it is not a token */
+	uint32 Lookup(const uint8* Bytes, int32 Length) const;
+
+	/** Merges one piece, calls Emit(Start, End) for each resulting token and returns the token count */
+	template <typename EmitType>
+	int32 MergePiece(const uint8* Bytes, int32 Length, EmitType&& Emit) const;
+};
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PromptBudget.generated.h"
+
+class FBpeTokenizer;
+
+/** One turn of conversation history as sent in context.messages */
+USTRUCT(BlueprintType)
+struct AIBRIDGE_API FAiBridgeChatMessage
+{
+	GENERATED_BODY()
+
+	FAiBridgeChatMessage() = default;
+	FAiBridgeChatMessage(const FString& InRole, const FString& InContent) : Role(InRole), Content(InContent) {}
+
+	/** user or assistant */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation")
+	FString Role;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Conversation")
+	FString Content;
+};
+
+namespace AiBridgeTokenizer
+{
+	/** Tokens one chat message costs: its content plus the role and the framing the chat format wraps it in */
+	AIBRIDGE_API int32 CountMessage(const FBpeTokenizer& Tokenizer, FStringView Role, FStringView Content);
+
+	/**
+	 * Drops the oldest History messages until the system prompt, the remaining history and the new
+	 * utterance fit in Budget tokens. Returns the tokens the request uses, which is still above Budget
+	 * if the system prompt and utterance alone exceed it.
+	 */
+	AIBRIDGE_API int32 TrimHistoryToBudget(const FBpeTokenizer& Tokenizer, FStringView SystemPrompt, FStringView Utterance, int32 Budget, TArray<FAiBridgeChatMessage>& History);
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** A word and the whitespace after it, the unit the transcript is laid out in */
+struct FAiBridgeTranscriptRun
+{
+	int32 Chunk = 0;
+	int32 Start = 0;
+	int32 Len = 0;
+
+	/** First run of a paragraph, the newline before it is not part of any run */
+	bool bNewParagraph = false;
+};
+
+/**
+ * Streaming reply text as a rope of fixed-size chunks, appended to delta by delta without ever moving
+ * what is already there. The text is kept split into word runs so a view can lay out each run once:
+ * only the last run, the word still being typed, changes when a delta arrives and every other run is
+ * final. Appending costs the length of the delta however long the reply has grown.
+ *
+ * Game thread only, views poll GetVersion to see whether anything changed.
+ */
+class AIBRIDGE_API FAiBridgeTranscript
+{
+public:
+	void Append(FStringView Delta);
+
+	/** Forgets all text. Views see a new generation and start over */
+	void Reset();
+
+	int32 NumRuns() const { return Runs.Num(); }
+	const FAiBridgeTranscriptRun& GetRun(int32 Index) const { return Runs[Index]; }
+
+	/** Valid until the run changes, i.e. for any run but an open last one, until Reset */
+	FStringView GetRunText(int32 Index) const;
+
+	/** True while the last run may still grow, until a new word or paragraph starts after it */
+	bool IsLastRunOpen() const { return bRunOpen && Runs.Num() > 0; }
+
+	/** Changes with every append */
+	uint32 GetVersion() const { return Version; }
+
+	/** Changes with every reset */
+	uint32 GetGeneration() const { return Generation; }
+
+	int32 Len() const { return NumChars; }
+
+	/** The whole text, for when it is needed as one string, e.g. once the reply completes */
+	FString ToString() const;
+
+private:
+	/** Characters per chunk, a run is moved to a fresh chunk rather than split across two */
+	static constexpr int32 ChunkChars = 1024;
+
+	TArray<TArray<TCHAR>> Chunks;
+	TArray<FAiBridgeTranscriptRun> Runs;
+
+	int32 NumChars = 0;
+	uint32 Version = 0;
+	uint32 Generation = 0;
+
+	bool bRunOpen = false;
+	bool bAfterWhitespace = false;
+	bool bNewParagraph = false;
+
+	void StartRun();
+
+	/** Room for one more character in the last run, moving the run to a new chunk if its own is full */
+	void MakeRoom();
+};
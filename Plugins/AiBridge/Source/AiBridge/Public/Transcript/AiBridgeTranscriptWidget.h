@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/Widget.h"
+#include "AiBridgeTranscriptWidget.generated.h"
+
+class FAiBridgeTranscript;
+class SAiBridgeTranscript;
+
+/**
+ * Subtitles for streamed replies. Feed it the OnTextDelta pin of a conversation turn: each delta is
+ * appended to the transcript and only the words it touched are laid out, however long the reply is.
+ */
+UCLASS()
+class AIBRIDGE_API UAiBridgeTranscriptWidget : public UWidget
+{
+	GENERATED_BODY()
+
+public:
+	UAiBridgeTranscriptWidget();
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Appearance")
+	FSlateFontInfo Font;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Appearance")
+	FSlateColor ColorAndOpacity;
+
+	/** Keeps the newest text in view while the transcript grows */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Behavior")
+	bool bAutoScroll = true;
+
+	/** Adds streamed reply text, a newline starts a new paragraph */
+	UFUNCTION(BlueprintCallable, Category = "Transcript")
+	void AppendText(const FString& Delta);
+
+	UFUNCTION(BlueprintCallable, Category = "Transcript")
+	void Clear();
+
+	/** The whole text as one string, it is rebuilt on every call */
+	UFUNCTION(BlueprintPure, Category = "Transcript")
+	FString GetText() const;
+
+	const FAiBridgeTranscript& GetTranscript() const { return *Transcript; }
+
+	virtual void SynchronizeProperties() override;
+	virtual void ReleaseSlateResources(bool bReleaseChildren) override;
+
+#if WITH_EDITOR
+	virtual const FText GetPaletteCategory() override;
+#endif
+
+protected:
+	virtual TSharedRef<SWidget> RebuildWidget() override;
+
+private:
+	/** Outlives the Slate widget, which is rebuilt e.g. when the widget is shown again */
+	TSharedRef<FAiBridgeTranscript> Transcript;
+
+	TSharedPtr<SAiBridgeTranscript> MyTranscript;
+};
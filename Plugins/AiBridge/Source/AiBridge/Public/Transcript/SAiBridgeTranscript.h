@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Styling/CoreStyle.h"
+#include "Widgets/SCompoundWidget.h"
+
+class FAiBridgeTranscript;
+class SScrollBox;
+class STextBlock;
+class SWrapBox;
+
+/**
+ * Shows an FAiBridgeTranscript as subtitles. Every word run gets its own text block, laid out once when
+ * it first appears; when the transcript grows only the new runs and the open last run are shaped, so a
+ * delta costs the same at the end of a long reply as at its start. Paragraphs wrap at the allotted width.
+ */
+class AIBRIDGE_API SAiBridgeTranscript : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SAiBridgeTranscript)
+		: _Font(FCoreStyle::GetDefaultFontStyle("Regular", 18))
+		, _ColorAndOpacity(FLinearColor::White)
+		, _AutoScroll(true)
+	{}
+		SLATE_ARGUMENT(TSharedPtr<const FAiBridgeTranscript>, Transcript)
+		SLATE_ARGUMENT(FSlateFontInfo, Font)
+		SLATE_ARGUMENT(FSlateColor, ColorAndOpacity)
+		/** Keeps the newest text in view while the transcript grows */
+		SLATE_ARGUMENT(bool, AutoScroll)
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs);
+
+	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
+
+	void SetTranscript(const TSharedPtr<const FAiBridgeTranscript>& InTranscript);
+
+	/** Font and color apply to every run, changing them lays the transcript out again */
+	void SetFont(const FSlateFontInfo& InFont);
+	void SetTextColor(const FSlateColor& InColor);
+
+	void SetAutoScroll(bool bInAutoScroll) { bAutoScroll = bInAutoScroll; }
+
+private:
+	TSharedPtr<const FAiBridgeTranscript> Transcript;
+	FSlateFontInfo Font;
+	FSlateColor TextColor;
+	bool bAutoScroll = true;
+
+	TSharedPtr<SScrollBox> ScrollBox;
+
+	/** The paragraph new runs are added to and the block of the last run laid out */
+	TSharedPtr<SWrapBox> Paragraph;
+	TSharedPtr<STextBlock> LastBlock;
+
+	int32 NumBuilt = 0;
+	bool bLastBuiltOpen = false;
+	uint32 BuiltVersion = 0;
+	uint32 BuiltGeneration = 0;
+
+	/** Lays out what was appended since the last call */
+	void Update();
+
+	/** Drops every block, the next update lays out the whole transcript */
+	void Clear();
+};
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Transport/TransportWebSocketBase.h"
+
+class FAiBridgeCaptureWriter;
+
+/**
+ * IWebSocket shim that records every frame crossing the transport into an AiBridge capture.
+ *
+ * Installed outermost by UWebSocketConnection while capture is on, so it sees frames with the timing
+ * the connection saw them, network simulation included. Like the transport it wraps it belongs to the
+ * AiBridge I/O thread, which sends through it and on which its events are recorded and relayed.
+ */
+class AIBRIDGE_API FCaptureWebSocket : public FTransportWebSocketBase
+{
+public:
+	FCaptureWebSocket(TSharedRef<IWebSocket> InInner, TSharedRef<FAiBridgeCaptureWriter, ESPMode::ThreadSafe> InWriter);
+	virtual ~FCaptureWebSocket() override;
+
+	// IWebSocket
+	virtual void Connect() override { Inner->Connect(); }
+	virtual void Close(int32 Code = 1000, const FString& Reason = FString()) override { Inner->Close(Code, Reason); }
+	virtual bool IsConnected() override { return Inner->IsConnected(); }
+	virtual void Send(const FString& Data) override;
+	virtual void Send(const void* Data, SIZE_T Size, bool bIsBinary = false) override;
+	virtual void SetTextMessageMemoryLimit(uint64 TextMessageMemoryLimit) override { Inner->SetTextMessageMemoryLimit(TextMessageMemoryLimit); }
+
+private:
+	TSharedRef<IWebSocket> Inner;
+	TSharedRef<FAiBridgeCaptureWriter, ESPMode::ThreadSafe> Writer;
+
+	void HandleInnerConnected();
+	void HandleInnerConnectionError(const FString& Error);
+	void HandleInnerClosed(int32 StatusCode, const FString& Reason, bool bWasClean);
+	void HandleInnerMessage(const FString& Message);
+	void HandleInnerBinaryMessage(const void* Data, SIZE_T Size, bool bIsLastFragment);
+	void HandleInnerMessageSent(const FString& Message);
+};
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include <atomic>
+#include "Transport/TransportWebSocketBase.h"
+
+/**
+ * In-process echo server reached through loopback:// urls.
+ *
+ * Lets the connection, the network simulator and everything above them run in automation on a
+ * machine without network access: the handshake completes on the next tick of the given ticker and
+ * every frame sent is delivered back unchanged one tick later, heartbeat pings come back as pongs.
+ * Send is safe from any thread, everything else belongs to the thread that ticks the ticker.
+ */
+class AIBRIDGE_API FLoopbackWebSocket : public FTransportWebSocketBase
+{
+public:
+	explicit FLoopbackWebSocket(FTSTicker& Ticker);
+	virtual ~FLoopbackWebSocket() override;
+
+	// IWebSocket
+	virtual void Connect() override;
+	virtual void Close(int32 Code = 1000, const FString& Reason = FString()) override;
+	virtual bool IsConnected() override { return bConnected; }
+	virtual void Send(const FString& Data) override;
+	virtual void Send(const void* Data, SIZE_T Size, bool bIsBinary = false) override;
+
+private:
+	struct FEcho
+	{
+		FString Text;
+		TArray<uint8> Bytes;
+		bool bIsText = true;
+	};
+
+	/** Filled by Send from any thread, drained by Tick */
+	TQueue<FEcho, EQueueMode::Mpsc> Pending;
+	bool bConnecting = false;
+	std::atomic<bool> bConnected{false};
+
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	bool Tick(float DeltaTime);
+};
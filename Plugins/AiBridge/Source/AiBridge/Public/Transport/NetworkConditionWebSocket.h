@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include "Math/RandomStream.h"
+#include <atomic>
+#include "Transport/TransportWebSocketBase.h"
+
+/** Impairments applied by FNetworkConditionWebSocket, normally read from the AiBridge.NetSim.* console variables */
+struct AIBRIDGE_API FNetworkConditions
+{
+	/** One-way delay added in each direction */
+	float LatencyMs = 0.0f;
+
+	/** Uniform random extra delay on top of LatencyMs, frames are never reordered */
+	float JitterMs = 0.0f;
+
+	/** Link capacity in each direction, 0 = unlimited */
+	float BandwidthKbps = 0.0f;
+
+	/** Inbound frames are held and released together on this period, mimicking Wi-Fi power save bursts */
+	float BurstPeriodMs = 0.0f;
+
+	/** Mean time between random connection drops, 0 = never */
+	float DisconnectMeanSeconds = 0.0f;
+
+	static FNetworkConditions FromConsoleVariables();
+
+	/** AiBridge.NetSim.Enable, checked when a connection creates its transport */
+	static bool IsSimulationEnabled();
+};
+
+/**
+ * IWebSocket shim that sits between UWebSocketConnection and the real transport and impairs traffic.
+ *
+ * Every frame in either direction is queued with a due time derived from latency, jitter and the
+ * bandwidth cap, then delivered in order from the ticker it is given, the one that ticks the inner
+ * socket. Connection drops, random or forced from the console, close the inner socket and report an
+ * unclean close so the reconnect path runs exactly as it would on a lost venue link.
+ */
+class AIBRIDGE_API FNetworkConditionWebSocket : public FTransportWebSocketBase
+{
+public:
+	FNetworkConditionWebSocket(TSharedRef<IWebSocket> InInner, FTSTicker& Ticker);
+	virtual ~FNetworkConditionWebSocket() override;
+
+	// IWebSocket
+	virtual void Connect() override;
+	virtual void Close(int32 Code = 1000, const FString& Reason = FString()) override;
+	virtual bool IsConnected() override;
+	virtual void Send(const FString& Data) override;
+	virtual void Send(const void* Data, SIZE_T Size, bool bIsBinary = false) override;
+	virtual void SetTextMessageMemoryLimit(uint64 TextMessageMemoryLimit) override;
+
+	/** Drops the link as if the access point disappeared. Reports one close, however often it is called, until the next Connect */
+	void SimulateDisconnect();
+
+	/** Any thread. Has the next tick drop the link, for callers that do not own the socket */
+	void RequestDisconnect() { bDisconnectRequested = true; }
+
+	/** Overrides the console variables for this socket, mainly for automation */
+	void SetConditionsOverride(const FNetworkConditions& InConditions);
+
+	int32 GetNumInFlight() const { return NumInFlight; }
+
+	/**
+	 * Any thread. Runs Callback for every live shim with the registry locked, used by the console commands.
+	 * The shims belong to the threads that tick them, Callback may only use what is safe from any thread.
+	 */
+	static void ForEachActive(TFunctionRef<void(FNetworkConditionWebSocket&)> Callback);
+
+private:
+	enum class EFrameKind : uint8
+	{
+		Text,
+		Binary,
+		Connected,
+		ConnectionError,
+		Closed
+	};
+
+	struct FFrame
+	{
+		double DueTime = 0.0;
+		EFrameKind Kind = EFrameKind::Text;
+		FString Text;
+		TArray<uint8> Bytes;
+		int32 StatusCode = 0;
+		bool bWasClean = true;
+		bool bIsBinary = true;
+		bool bIsLastFragment = true;
+	};
+
+	/** Per-direction link state */
+	struct FLink
+	{
+		TQueue<FFrame> Frames;
+		double FreeTime = 0.0;
+		double LastDueTime = 0.0;
+	};
+
+	TSharedRef<IWebSocket> Inner;
+	FLink Inbound;
+	FLink Outbound;
+
+	/** Frames handed to Send, possibly from another thread, not yet timed onto the outbound link */
+	TQueue<FFrame, EQueueMode::Mpsc> Submitted;
+
+	FNetworkConditions Conditions;
+	bool bHasOverride = false;
+	std::atomic<bool> bSimulatedDown{false};
+	std::atomic<bool> bDisconnectRequested{false};
+	int32 NumInFlight = 0;
+
+	FRandomStream Random;
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	void Enqueue(FLink& Link, FFrame&& Frame, int32 NumBytes, bool bInbound);
+	bool Tick(float DeltaTime);
+	void Deliver(FFrame& Frame, bool bInbound);
+
+	void HandleInnerConnected();
+	void HandleInnerConnectionError(const FString& Error);
+	void HandleInnerClosed(int32 StatusCode, const FString& Reason, bool bWasClean);
+	void HandleInnerMessage(const FString& Message);
+	void HandleInnerBinaryMessage(const void* Data, SIZE_T Size, bool bIsLastFragment);
+};
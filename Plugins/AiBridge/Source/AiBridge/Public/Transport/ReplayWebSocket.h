@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include <atomic>
+#include "Capture/AiBridgeCapture.h"
+#include "Transport/TransportWebSocketBase.h"
+
+/**
+ * Plays an AiBridge capture back as if the orchestrator were sending it, reached through
+ * replay://<capture>[?speed=N][&loop=1] urls.
+ *
+ * The handshake completes on the next tick, then the captured inbound frames are delivered from the
+ * given ticker at their recorded offsets divided by speed; speed=0 delivers a bounded batch every
+ * tick. Frames the game sends are counted and dropped, except heartbeat pings which are
+ * answered so the link stays up, and the pongs of the recorded session are skipped. At the end the
+ * socket closes cleanly and refuses reconnects, or starts over with loop=1. Relative capture paths
+ * resolve under Saved/AiBridgeCaptures. Send is safe from any thread, everything else belongs to the
+ * thread that ticks the ticker.
+ */
+class AIBRIDGE_API FReplayWebSocket : public FTransportWebSocketBase
+{
+public:
+	FReplayWebSocket(const FString& Url, FTSTicker& Ticker);
+	virtual ~FReplayWebSocket() override;
+
+	// IWebSocket
+	virtual void Connect() override;
+	virtual void Close(int32 Code = 1000, const FString& Reason = FString()) override;
+	virtual bool IsConnected() override { return bConnected; }
+	virtual void Send(const FString& Data) override;
+	virtual void Send(const void* Data, SIZE_T Size, bool bIsBinary = false) override;
+
+	/** Inbound frames delivered so far, over all loops */
+	uint64 GetNumDelivered() const { return NumDelivered; }
+
+	/** Frames the game sent, which a replay drops */
+	uint64 GetNumDropped() const { return NumDropped; }
+
+private:
+	TUniquePtr<FAiBridgeCaptureReader> Reader;
+	FString Path;
+	float Speed = 1.0f;
+	bool bLoop = false;
+
+	bool bConnecting = false;
+	std::atomic<bool> bConnected{false};
+
+	/** Played to the end without loop, reconnects are refused so the session does not start over */
+	bool bFinished = false;
+
+	/** Record read ahead but not yet due, its payload stays valid until the next read */
+	FAiBridgeCaptureRecord Pending;
+	bool bHasPending = false;
+
+	/** Capture time of the first record of the pass and the wall time it was played at */
+	bool bPassStarted = false;
+	uint64 PassStartMicros = 0;
+	double PassStartSeconds = 0.0;
+	int32 NumDeliveredThisPass = 0;
+
+	/** Pings from the heartbeat, answered on the next tick */
+	TQueue<FString, EQueueMode::Mpsc> Pings;
+
+	uint64 NumDelivered = 0;
+	std::atomic<uint64> NumDropped{0};
+
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	bool Tick(float DeltaTime);
+
+	/** Reads ahead to the next frame the orchestrator sent, false at the end of the capture */
+	bool ReadNext();
+};
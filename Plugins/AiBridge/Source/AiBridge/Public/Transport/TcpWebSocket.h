@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include "Math/RandomStream.h"
+#include "Transport/TransportWebSocketBase.h"
+
+class FSocket;
+class FInternetAddr;
+struct ssl_st;
+struct ssl_ctx_st;
+struct bio_st;
+
+/**
+ * RFC 6455 client for ws:// and wss:// urls on a plain platform socket, with TLS done in memory.
+ *
+ * The engine WebSockets module reads and writes on a thread of its own but raises every event from the
+ * game thread tick, so a hitch stalls receive along with the game. This transport does all of its work
+ * from the ticker it is given: the AiBridge I/O thread ticks it, and the handshake, sends, receives,
+ * pings and closes run on that thread whatever the game thread is doing. Events are raised there too.
+ *
+ * Not thread-safe: every call must come from the thread that ticks it. Messages are delivered whole,
+ * fragments are reassembled, and protocol pings are answered here without reaching the owner.
+ */
+class AIBRIDGE_API FTcpWebSocket : public FTransportWebSocketBase
+{
+public:
+	FTcpWebSocket(const FString& InUrl, FTSTicker& Ticker);
+	virtual ~FTcpWebSocket() override;
+
+	// IWebSocket
+	virtual void Connect() override;
+	virtual void Close(int32 Code = 1000, const FString& Reason = FString()) override;
+	virtual bool IsConnected() override { return State == EState::Open; }
+	virtual void Send(const FString& Data) override;
+	virtual void Send(const void* Data, SIZE_T Size, bool bIsBinary = false) override;
+	virtual void SetTextMessageMemoryLimit(uint64 TextMessageMemoryLimit) override;
+
+private:
+	enum class EState : uint8
+	{
+		Idle,
+		Resolving,
+		Connecting,
+		TlsHandshake,
+		Upgrading,
+		Open,
+		Closing,
+		Closed
+	};
+
+	/** Resolved address, or null when the lookup failed */
+	using FResolveQueue = TQueue<TSharedPtr<FInternetAddr>, EQueueMode::Spsc>;
+
+	FString Url;
+	FString Host;
+	FString HostHeader;
+	FString Resource;
+	int32 Port = 0;
+	bool bSecure = false;
+	bool bValidUrl = false;
+
+	EState State = EState::Idle;
+
+	/** Filled by the resolver's worker thread, shared so a socket destroyed meanwhile does not matter */
+	TSharedPtr<FResolveQueue, ESPMode::ThreadSafe> Resolved;
+
+	FSocket* Socket = nullptr;
+
+	// TLS, wss:// only. The library reads and writes memory buffers, this class moves the bytes
+	ssl_ctx_st* SslContext = nullptr;
+	ssl_st* Ssl = nullptr;
+	bio_st* TlsIn = nullptr;
+	bio_st* TlsOut = nullptr;
+
+	/** Bytes waiting for the socket, already encrypted on wss:// */
+	TArray<uint8> Outgoing;
+	int32 OutgoingOffset = 0;
+
+	/** Plain bytes received and not parsed yet */
+	TArray<uint8> Incoming;
+
+	/** Message being reassembled from fragments, MessageOpcode 0 when none */
+	TArray<uint8> Message;
+	uint8 MessageOpcode = 0;
+	int64 MaxMessageBytes = 0;
+
+	FString HandshakeKey;
+
+	/** Close we started, reported once the server answers or CloseDeadline passes */
+	int32 CloseCode = 1000;
+	FString CloseReason;
+	double CloseDeadline = 0.0;
+
+	/** Masks the frames we send, as RFC 6455 requires of clients */
+	FRandomStream MaskRandom;
+	TArray<uint8> FrameScratch;
+
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	bool Tick(float DeltaTime);
+
+	void ParseUrl();
+	void BeginConnect(const TSharedPtr<FInternetAddr>& Address);
+	bool BeginTls();
+	void SendHandshake();
+	bool ReadHandshake();
+	bool ReadFrames();
+
+	/** Moves bytes between the socket and the buffers, false once the socket failed or the peer went away */
+	bool ReadSocket();
+	bool WriteSocket();
+	bool ContinueTls();
+
+	void WritePlain(const uint8* Data, int32 Size);
+	void SendFrame(uint8 Opcode, const uint8* Payload, int32 Size);
+
+	/** Raises a connection error before the upgrade completed, a close after */
+	void Fail(const FString& Error, int32 Code = 1006);
+
+	/** Tells the server why and drops the link without waiting for its answer */
+	void Abort(int32 Code, const FString& Reason);
+	void Finish(int32 Code, const FString& Reason, bool bWasClean);
+	void DestroySocket();
+};
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IWebSocket.h"
+
+/**
+ * Owns the IWebSocket event storage so in-process transports (network shims, loopback, replay) only
+ * implement the behaviour they change.
+ */
+class AIBRIDGE_API FTransportWebSocketBase : public IWebSocket
+{
+public:
+	virtual void SetTextMessageMemoryLimit(uint64 TextMessageMemoryLimit) override {}
+
+	virtual FWebSocketConnectedEvent& OnConnected() override { return ConnectedEvent; }
+	virtual FWebSocketConnectionErrorEvent& OnConnectionError() override { return ConnectionErrorEvent; }
+	virtual FWebSocketClosedEvent& OnClosed() override { return ClosedEvent; }
+	virtual FWebSocketMessageEvent& OnMessage() override { return MessageEvent; }
+	virtual FWebSocketBinaryMessageEvent& OnBinaryMessage() override { return BinaryMessageEvent; }
+	virtual FWebSocketRawMessageEvent& OnRawMessage() override { return RawMessageEvent; }
+	virtual FWebSocketMessageSentEvent& OnMessageSent() override { return MessageSentEvent; }
+
+protected:
+	FWebSocketConnectedEvent ConnectedEvent;
+	FWebSocketConnectionErrorEvent ConnectionErrorEvent;
+	FWebSocketClosedEvent ClosedEvent;
+	FWebSocketMessageEvent MessageEvent;
+	FWebSocketBinaryMessageEvent BinaryMessageEvent;
+	FWebSocketRawMessageEvent RawMessageEvent;
+	FWebSocketMessageSentEvent MessageSentEvent;
+};
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AiBridgeHeartbeat.generated.h"
+
+/** Link quality measured by the heartbeat, readable from any thread */
+USTRUCT(BlueprintType)
+struct AIBRIDGE_API FAiBridgeHeartbeatStats
+{
+	GENERATED_BODY()
+
+	/** Smoothed round trip, RFC 6298 style */
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	float SmoothedRttMs = 0.0f;
+
+	/** Round trip variation, the jitter a jitter buffer has to absorb */
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	float RttJitterMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	float LastRttMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	float MinRttMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	int32 PingsSent = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	int32 PongsReceived = 0;
+
+	/** Pings that were not answered within the dead-link timeout */
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	int32 PongsMissed = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	float SecondsSinceLastInbound = 0.0f;
+};
+
+/**
+ * Application-level ping/pong on the AiBridge socket.
+ *
+ * The connection's I/O thread asks for a ping every Interval while the link is up, feeds every inbound
+ * frame in as the transport delivers it and checks for silence on every wake, so a game thread hitch is
+ * never mistaken for a dead link. Detection arms as the link opens and judges inbound silence alone:
+ * any frame proves the link is alive. Pongs are optional, a server that answers them keeps an otherwise
+ * quiet link alive and gives a round trip sample with each one.
+ */
+class AIBRIDGE_API FAiBridgeHeartbeat
+{
+public:
+	/** Seconds between pings, 0 disables the heartbeat */
+	void Configure(float InInterval, float InTimeout);
+
+	/** Starts a new session as its link opens, forgets outstanding pings and arms dead-link detection */
+	void Reset(double Now);
+
+	/** I/O thread, which sends it. Returns true and fills OutPing when a ping is due */
+	bool TickPing(double Now, FString& OutPing);
+
+	/** Any thread. Every inbound frame, including pongs */
+	void NotifyInbound(double ReceiveTime);
+
+	/** Any thread. Returns true if Message was a heartbeat reply, which the caller should not forward. Counts as inbound traffic */
+	bool HandleMessage(const FString& Message, double ReceiveTime);
+
+	/** True once nothing has arrived for Timeout seconds */
+	bool IsDead(double Now) const;
+
+	FAiBridgeHeartbeatStats GetStats(double Now) const;
+
+private:
+	struct FOutstandingPing
+	{
+		uint32 Seq = 0;
+		double SendTime = 0.0;
+	};
+
+	mutable FCriticalSection Lock;
+
+	float Interval = 0.0f;
+	float Timeout = 0.0f;
+
+	uint32 NextSeq = 1;
+	double NextPingTime = 0.0;
+	double LastInboundTime = 0.0;
+	bool bHasRtt = false;
+
+	TArray<FOutstandingPing> Outstanding;
+	FAiBridgeHeartbeatStats Stats;
+};
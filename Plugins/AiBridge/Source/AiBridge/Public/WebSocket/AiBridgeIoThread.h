@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include "WebSocket/AiBridgeHeartbeat.h"
+#include <atomic>
+
+class FRunnableThread;
+class IWebSocket;
+class FAiBridgeOutbox;
+class FAiBridgeMemoryStream;
+
+enum class EAiBridgeIoEventKind : uint8
+{
+	Connected,
+	ConnectionError,
+	Closed,
+	Text,
+	Binary
+};
+
+/** Something the transport reported, handed to the game thread and stamped on arrival so consumers can see real network timing */
+struct FAiBridgeIoEvent
+{
+	EAiBridgeIoEventKind Kind = EAiBridgeIoEventKind::Text;
+
+	/** Session returned by the Open the event belongs to, events of an earlier session are stale */
+	uint32 Session = 0;
+
+	/** Message, connection error or close reason */
+	FString Text;
+	TArray<uint8> Bytes;
+
+	int32 StatusCode = 0;
+	bool bWasClean = false;
+
+	/** FPlatformTime::Seconds() when the transport delivered the event */
+	double ReceiveTime = 0.0;
+};
+
+/** Snapshot of the I/O counters of a connection */
+struct FAiBridgeIoStats
+{
+	uint64 LoopIterations = 0;
+	/** Written to the socket from the outbox, see FAiBridgeOutbox::Flush */
+	uint64 FramesSent = 0;
+	uint64 BytesSent = 0;
+	uint64 FramesReceived = 0;
+	int32 OutboundQueued = 0;
+	int32 InboundQueued = 0;
+
+	/** Worst delay between when the thread planned to wake and when it actually ran */
+	float MaxWakeLatenessMs = 0.0f;
+};
+
+/**
+ * I/O thread owned by a UWebSocketConnection, and owner of its transport.
+ *
+ * The transport is created, connected, ticked and closed here and raises its events here, so the
+ * handshake, sends, receives, heartbeat pings, dead-link detection and the connect timeout all keep
+ * going while the game thread hitches, loads or travels. IWebSocket is not thread-safe: nothing else
+ * may touch the transport. The game thread asks for a new transport with Open and drops it with
+ * Close, producers on any thread queue frames in the outbox, which this thread flushes as soon as it
+ * is woken.
+ *
+ * What the transport reports is queued for the game thread, tagged with its session, and picked up
+ * there with DrainEvents. Reconnect backoff runs on wall-clock timers kept here as well, their
+ * callbacks run on the game thread from RunDueCallbacks.
+ */
+class AIBRIDGE_API FAiBridgeIoThread : public FRunnable
+{
+public:
+	/** Runs on the I/O thread and builds the transport around the ticker it must tick from */
+	using FTransportFactory = TUniqueFunction<TSharedRef<IWebSocket>(FTSTicker&)>;
+
+	/** How often the transport is ticked while there is one, the resolution of inbound timestamps */
+	static constexpr double ServiceIntervalSeconds = 0.002;
+
+	FAiBridgeIoThread(TSharedRef<FAiBridgeOutbox, ESPMode::ThreadSafe> InOutbox, TSharedPtr<FAiBridgeMemoryStream, ESPMode::ThreadSafe> InMemory);
+	virtual ~FAiBridgeIoThread() override;
+
+	/**
+	 * Game thread. Drops the current transport and frames still queued for it, then builds a new one
+	 * with MakeTransport and connects it, failing with a connection error after ConnectTimeout seconds.
+	 * Returns the session its events carry.
+	 */
+	uint32 Open(FTransportFactory&& MakeTransport, double ConnectTimeout);
+
+	/** Game thread. Writes what is already queued, then closes the transport without reporting it */
+	void Close(int32 Code = 1000, const FString& Reason = FString());
+
+	/** Game thread. Runs Callback on the game thread once DelaySeconds of wall time have passed */
+	uint64 Schedule(double DelaySeconds, TUniqueFunction<void()>&& Callback);
+
+	/** Game thread. A cancelled timer never runs, even if it is already due */
+	void Cancel(uint64 TimerId);
+
+	/** Game thread. Runs timer callbacks whose delay has elapsed */
+	void RunDueCallbacks();
+
+	/** Game thread. Hands queued transport events to Handler in arrival order */
+	void DrainEvents(TFunctionRef<void(FAiBridgeIoEvent&)> Handler);
+
+	FAiBridgeIoStats GetStats() const;
+
+	/** Configured by the connection before Open, fed and judged on this thread */
+	FAiBridgeHeartbeat& GetHeartbeat() { return Heartbeat; }
+
+	// FRunnable
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	struct FTimer
+	{
+		double DueTime = 0.0;
+		uint64 Id = 0;
+		TUniqueFunction<void()> Callback;
+	};
+
+	struct FDueCallback
+	{
+		uint64 Id = 0;
+		TUniqueFunction<void()> Callback;
+	};
+
+	FRunnableThread* Thread = nullptr;
+	std::atomic<bool> bStopping{false};
+
+	/** Frames to write, its event also wakes this thread for commands */
+	TSharedRef<FAiBridgeOutbox, ESPMode::ThreadSafe> Outbox;
+
+	/** Inbound frames waiting for the game thread, counted against the messages budget */
+	TSharedPtr<FAiBridgeMemoryStream, ESPMode::ThreadSafe> Memory;
+
+	// Producers: game thread, consumer: I/O thread
+	TQueue<TUniqueFunction<void()>, EQueueMode::Mpsc> Commands;
+
+	// Producer: I/O thread, consumer: game thread
+	TQueue<FAiBridgeIoEvent, EQueueMode::Spsc> Events;
+	TQueue<FDueCallback, EQueueMode::Mpsc> DueCallbacks;
+
+	// I/O thread only
+	FTSTicker Ticker;
+	TSharedPtr<IWebSocket> Socket;
+	uint32 Session = 0;
+	double ConnectTimeoutSeconds = 0.0;
+	double ConnectDeadline = 0.0;
+	bool bLinkOpen = false;
+	/** The transport reported an error or a close from inside its tick, it is dropped once the tick is over */
+	bool bTransportDone = false;
+	TArray<FTimer> Timers;
+
+	FAiBridgeHeartbeat Heartbeat;
+
+	// Game thread only
+	TSet<uint64> LiveTimers;
+	uint64 NextTimerId = 1;
+	uint32 NextSession = 1;
+
+	std::atomic<uint64> LoopIterations{0};
+	std::atomic<uint64> FramesReceived{0};
+	std::atomic<int32> InboundQueued{0};
+	std::atomic<float> MaxWakeLatenessMs{0.0f};
+
+	/** Pings, dead-link and connect timeout checks and the outbox flush, once per wake */
+	void ServiceLink(double Now);
+
+	/** Unbinds and closes the transport, it reports nothing more */
+	void DropTransport(int32 Code = 1000, const FString& Reason = FString());
+
+	void PostEvent(FAiBridgeIoEvent&& Event);
+	void FireDueTimers(double Now);
+
+	void HandleConnected();
+	void HandleConnectionError(const FString& Error);
+	void HandleClosed(int32 StatusCode, const FString& Reason, bool bWasClean);
+	void HandleMessage(const FString& Message);
+	void HandleBinaryMessage(const void* Data, SIZE_T Size, bool bIsLastFragment);
+};
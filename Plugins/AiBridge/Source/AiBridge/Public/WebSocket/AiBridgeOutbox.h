@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include <atomic>
+
+class IWebSocket;
+class FEvent;
+
+/** A frame waiting to be written to the socket, the payload is moved in and never copied again */
+struct FAiBridgeOutboundFrame
+{
+	FString Text;
+	/** Binary payload, or the UTF-8 of a text frame that was built as UTF-8 */
+	TArray<uint8> Bytes;
+	bool bIsBinary = false;
+};
+
+/**
+ * Thread-safe send entry point of an AiBridge connection.
+ *
+ * Producers on any thread move their buffers in without copies or locks and wake the connection's I/O
+ * thread, the single consumer, which writes them to the socket with Flush straight away, whatever the
+ * game thread is doing. Frames go out in the order they were queued, so a stream keeps its order as
+ * long as its frames are queued in sequence, which holds for a stream fed from one thread or handed
+ * between threads with proper synchronization.
+ *
+ * Worker threads should keep the shared reference from UWebSocketConnection::GetOutbox rather than the
+ * connection itself; the outbox stays valid after the connection is gone and simply refuses frames.
+ */
+class AIBRIDGE_API FAiBridgeOutbox
+{
+public:
+	FAiBridgeOutbox();
+	~FAiBridgeOutbox();
+
+	UE_NONCOPYABLE(FAiBridgeOutbox);
+
+	/** Any thread. Returns false and drops the frame when the link is down */
+	bool Send(FAiBridgeOutboundFrame&& Frame);
+	bool SendText(FString&& Text);
+	/** Text frame already encoded as UTF-8, it goes out without another conversion */
+	bool SendUtf8Text(TArray<uint8>&& Utf8);
+	bool SendBinary(TArray<uint8>&& Bytes);
+
+	/** Any thread. Set by the connection as the link opens and closes */
+	bool IsLinkUp() const { return bLinkUp.load(std::memory_order_acquire); }
+	void SetLinkUp(bool bInLinkUp) { bLinkUp.store(bInLinkUp, std::memory_order_release); }
+
+	/**
+	 * Consumer only, the thread that owns Socket. Writes every queued frame to Socket in order and returns
+	 * how many were written. Frames are dropped instead when Socket is null or not connected, they belong
+	 * to a session that is gone.
+	 */
+	int32 Flush(IWebSocket* Socket);
+
+	/** Any thread. Wakes the consumer from WaitForWork, as a queued frame does */
+	void Wake();
+
+	/** Consumer only. Sleeps until a frame is queued, Wake is called or Seconds pass, true if woken early */
+	bool WaitForWork(double Seconds);
+
+	int32 GetNumQueued() const { return NumQueued.load(std::memory_order_relaxed); }
+	uint64 GetFramesSent() const { return FramesSent.load(std::memory_order_relaxed); }
+	uint64 GetBytesSent() const { return BytesSent.load(std::memory_order_relaxed); }
+
+private:
+	TQueue<FAiBridgeOutboundFrame, EQueueMode::Mpsc> Frames;
+
+	std::atomic<int32> NumQueued{0};
+	std::atomic<bool> bLinkUp{false};
+
+	FEvent* WorkEvent = nullptr;
+
+	std::atomic<uint64> FramesSent{0};
+	std::atomic<uint64> BytesSent{0};
+};
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Settings/AiBridgeSettings.h"
+#include "AiBridgeRateLimiter.generated.h"
+
+/** What the rate limiter has done since it was configured */
+USTRUCT(BlueprintType)
+struct AIBRIDGE_API FAiBridgeRateLimiterStats
+{
+	GENERATED_BODY()
+
+	/** Requests sent, straight away or after waiting */
+	UPROPERTY(BlueprintReadOnly, Category = "RateLimit")
+	int64 Admitted = 0;
+
+	/** Requests that had to wait for their bucket to refill */
+	UPROPERTY(BlueprintReadOnly, Category = "RateLimit")
+	int64 Throttled = 0;
+
+	/** Requests refused because their bucket's queue was full */
+	UPROPERTY(BlueprintReadOnly, Category = "RateLimit")
+	int64 Rejected = 0;
+
+	/** Duplicates answered by a request already waiting or in flight, never sent */
+	UPROPERTY(BlueprintReadOnly, Category = "RateLimit")
+	int64 Coalesced = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "RateLimit")
+	int32 Queued = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "RateLimit")
+	float MaxWaitMs = 0.0f;
+};
+
+/**
+ * Token buckets in front of the orchestrator, one per quota. A request whose bucket is empty waits in
+ * order behind the others of its bucket until a token refills, so a burst of NPC turns is spread out
+ * on the client instead of being refused by the server and retried. Game thread only.
+ */
+class AIBRIDGE_API FAiBridgeRateLimiter
+{
+public:
+	/** Replaces the limits and drops queued requests, buckets not in Limits are unlimited */
+	void Configure(const TArray<FAiBridgeRateLimit>& Limits);
+
+	/**
+	 * Runs Send now if Bucket has a token, otherwise queues it. False, without running it, if the queue is full.
+	 * Send returns false if the request is no longer wanted by the time it runs, its token then stays in the bucket.
+	 */
+	bool Submit(FName Bucket, TUniqueFunction<bool()>&& Send, double Now);
+
+	/** Runs queued requests whose bucket has refilled */
+	void Tick(double Now);
+
+	/** Drops queued requests without running them, e.g. when the connection they were for is gone */
+	void Reset();
+
+	void NoteCoalesced() { ++Stats.Coalesced; }
+
+	FAiBridgeRateLimiterStats GetStats() const;
+
+private:
+	struct FPending
+	{
+		TUniqueFunction<bool()> Send;
+		double SubmitTime = 0.0;
+	};
+
+	struct FBucket
+	{
+		FAiBridgeRateLimit Limit;
+		double Tokens = 0.0;
+		double RefillTime = 0.0;
+		TArray<FPending> Queue;
+	};
+
+	TMap<FName, FBucket> Buckets;
+	FAiBridgeRateLimiterStats Stats;
+
+	/** Adds the tokens earned since the last refill, up to the burst */
+	static void Refill(FBucket& Bucket, double Now);
+};
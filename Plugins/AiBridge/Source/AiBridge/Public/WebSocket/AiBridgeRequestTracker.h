@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** What a caller hears about one request. Every handler is optional and runs on the game thread */
+struct FAiBridgeReplyHandlers
+{
+	/** The first reply text of the request */
+	TFunction<void(const FString& Text)> OnFirstToken;
+	/** Reply text as it streams in, only what was added since the last call */
+	TFunction<void(const FString& Delta)> OnDelta;
+	/** The first audio frame of the reply */
+	TFunction<void()> OnAudioStart;
+	/** The whole reply text, once its text and, when audio is expected, its audio have ended */
+	TFunction<void(const FString& Text)> OnComplete;
+	/** An error reply, a timeout or a lost connection. Nothing else is called afterwards */
+	TFunction<void(const FString& Error)> OnFailed;
+};
+
+/**
+ * Matches replies to the requests they answer by the requestId each request carries, so callers get
+ * events for their own turn instead of filtering every message.
+ *
+ * Text replies name their request. Audio frames do not; they are credited to the oldest request still
+ * waiting for audio, since the orchestrator speaks one turn at a time. Game thread only.
+ */
+class AIBRIDGE_API FAiBridgeRequestTracker
+{
+public:
+	/**
+	 * Tracks RequestId until it completes, fails or hears nothing for TimeoutSeconds. The timeout only runs
+	 * once MarkSent is called, a request still held back by the rate limiter waits without it.
+	 */
+	void Begin(const FString& RequestId, FAiBridgeReplyHandlers&& Handlers, bool bExpectAudio, double Now, double TimeoutSeconds);
+
+	/** The request went out at Now, its timeout counts from here */
+	void MarkSent(const FString& RequestId, double Now);
+
+	/**
+	 * Adds another caller to a tracked request, for a duplicate that is answered by the same reply. Events
+	 * the request already had are replayed to the new caller. False if RequestId is not tracked.
+	 */
+	bool Join(const FString& RequestId, FAiBridgeReplyHandlers&& Handlers);
+
+	/** True if Message was a reply to a tracked request */
+	bool HandleText(const FString& Message, double Now);
+
+	void HandleBinary(double Now);
+
+	/** Completes requests whose audio never came and fails the ones that timed out */
+	void Tick(double Now);
+
+	/** Fails every tracked request, e.g. when the connection drops */
+	void FailAll(const FString& Error);
+
+	/** Fails one request, e.g. one that was never sent */
+	void Fail(const FString& RequestId, const FString& Error);
+
+	/** Forgets RequestId without calling anything, for callers that went away */
+	void Cancel(const FString& RequestId);
+
+	bool Contains(const FString& RequestId) const;
+
+	int32 Num() const { return Requests.Num(); }
+
+	/** Runs when the first audio frame of a request arrives, before that request's own handlers */
+	TFunction<void(const FString& RequestId)> OnRequestAudioStart;
+
+private:
+	struct FRequest
+	{
+		FString RequestId;
+		/** The caller that sent the request first, then any that joined it */
+		TArray<FAiBridgeReplyHandlers, TInlineAllocator<1>> Handlers;
+		FString Text;
+		double Timeout = 0.0;
+		double LastActivityTime = 0.0;
+		double TextCompleteTime = 0.0;
+		bool bExpectAudio = false;
+		bool bSent = false;
+		bool bHasToken = false;
+		bool bTextComplete = false;
+		bool bAudioStarted = false;
+		bool bAudioComplete = false;
+	};
+
+	/** Oldest first */
+	TArray<FRequest> Requests;
+
+	int32 Find(const FString& RequestId) const;
+
+	/** Calls OnComplete and forgets the request if it has everything it waits for */
+	bool TryComplete(int32 Index, double Now);
+	void Fail(int32 Index, const FString& Error);
+};
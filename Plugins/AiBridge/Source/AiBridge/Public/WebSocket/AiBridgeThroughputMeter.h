@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AiBridgeThroughputMeter.generated.h"
+
+/** Downstream throughput of the AiBridge socket as measured from inbound frame arrival times */
+USTRUCT(BlueprintType)
+struct AIBRIDGE_API FAiBridgeThroughputStats
+{
+	GENERATED_BODY()
+
+	/** Smoothed over recent bursts, 0 until the first burst large enough to measure */
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	float EstimatedKbps = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	float LastSampleKbps = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	int32 Samples = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "WebSocket")
+	int64 BytesReceived = 0;
+};
+
+/**
+ * Estimates how fast the link delivers, not how much the server happens to send. Frames are grouped into
+ * bursts split by idle gaps and each burst large enough to matter gives one sample: its bytes over the
+ * time between its first and last frame. A gap counts as idle only if it is longer than the last frame
+ * would take on a very slow link, so a slow link delivering large fragments still forms bursts. The
+ * bytes of the first frame are left out, they were on the wire before the burst's clock started. Idle
+ * time between replies never dilutes the estimate.
+ *
+ * Frames are stamped when the I/O thread services the socket, not when they came off the wire, so a
+ * burst's span is widened by the stamp resolution. A burst delivered within a wake or two then yields a
+ * conservative sample instead of bytes over a fraction of a millisecond.
+ *
+ * A server that paces its sends, such as streaming TTS, can only show its own rate, so samples are a
+ * lower bound of the link. Game thread only.
+ */
+class AIBRIDGE_API FAiBridgeThroughputMeter
+{
+public:
+	/** A frame of Bytes handed over by the transport at ReceiveTime, having arrived up to Resolution seconds before */
+	void AddFrame(int32 Bytes, double ReceiveTime, double Resolution = 0.0);
+
+	/** Closes the current burst once the link has been idle long enough, call it now and then */
+	void Flush(double Now);
+
+	void Reset();
+
+	FAiBridgeThroughputStats GetStats() const { return Stats; }
+
+private:
+	FAiBridgeThroughputStats Stats;
+
+	double BurstStartTime = 0.0;
+	double LastFrameTime = 0.0;
+	int64 BurstBytes = 0;
+	/** Coarsest stamp resolution of the burst's frames */
+	double BurstResolution = 0.0;
+	int32 LastFrameBytes = 0;
+	bool bInBurst = false;
+
+	void CloseBurst();
+};
@@ -5,8 +5,15 @@
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
 #include "IWebSocket.h"
+#include "Containers/Ticker.h"
+#include "WebSocket/AiBridgeIoThread.h"
+#include "WebSocket/AiBridgeOutbox.h"
+#include "WebSocket/AiBridgeThroughputMeter.h"
+#include "Memory/AiBridgeMemory.h"
 #include "WebSocketConnection.generated.h"
 
+class FAiBridgeCaptureWriter;
+
 /**
  * 
  */
@@ -16,15 +23,41 @@ class AIBRIDGE_API UWebSocketConnection : public UObject
 	GENERATED_BODY()
 public:
 	
-	// State
+	// State, game thread
 	bool IsConnected() const;
 	bool IsConnecting() const { return bIsConnecting; }
 
 	// Core API
 	void Connect(const FString& Url, const FString& ConnectionId, const FString& InToken, TFunction<void(bool)> Callback);
 	void Disconnect();
+
+	/** Any thread. Dropped while the link is down, otherwise written by the I/O thread as soon as it wakes */
 	void SendText(const FString& Message);
+	void SendUtf8Text(TArray<uint8>&& Utf8);
 	void SendBinary(const TArray<uint8>& Data);
+	void SendBinary(TArray<uint8>&& Data);
+
+	/**
+	 * Thread-safe sender for this connection, for producers on worker threads (audio capture, perception).
+	 * The outbox can be used from anywhere and outlives the connection.
+	 */
+	TSharedRef<FAiBridgeOutbox, ESPMode::ThreadSafe> GetOutbox() const { return Outbox; }
+
+	FAiBridgeIoStats GetIoStats() const;
+	FAiBridgeHeartbeatStats GetHeartbeatStats() const;
+
+	/** How fast this connection has been delivering, carried over reconnects as the network rarely changes with them */
+	FAiBridgeThroughputStats GetDownstreamStats() const { return Downstream.GetStats(); }
+
+	/**
+	 * Records every frame sent and received to an AiBridge capture at Path (see AiBridgeCapture.h), for
+	 * playing back later through a replay:// url. Recording starts with the next connect and carries
+	 * over reconnects until StopCapture. Starting the game with -AiBridgeCapture[=Directory] captures
+	 * every connection from its first connect.
+	 */
+	bool StartCapture(const FString& Path);
+	void StopCapture();
+	bool IsCapturing() const { return Capture.IsValid(); }
 
 	// Events
 	TFunction<void()> OnConnected;
@@ -33,33 +66,86 @@ public:
 	TFunction<void(const FString&)> OnTextMessage;
 	TFunction<void(const TArray<uint8>&)> OnBinaryMessage;
 	
+	/** Seconds to wait for the handshake before the connect callback reports failure */
+	float ConnectTimeout = 10.0f;
+
+	/** Seconds between heartbeat pings, 0 disables the heartbeat */
+	float HeartbeatInterval = 2.0f;
+
+	/** Inbound silence after which the link is considered dead and reconnected, pings keep an answering server audible */
+	float HeartbeatTimeout = 6.0f;
+
+	/** Reconnect to the same url after an established link drops, off when the owner picks where to reconnect */
+	bool bReconnectOnDrop = true;
+
+	virtual void BeginDestroy() override;
+
 private:
-	TSharedPtr<IWebSocket> WebSocket;
+	/**
+	 * Owns the transport: the socket is connected, read, written, pinged and timed out there, so it keeps
+	 * going through game thread hitches. Reconnect backoff runs on its wall-clock timers too.
+	 */
+	TUniquePtr<FAiBridgeIoThread> IoThread;
+
+	/**
+	 * Sends from any thread, written to the socket by the I/O thread. Created with the connection and never
+	 * replaced, so other threads can read it; its link flag, set by the I/O thread as the transport opens
+	 * and closes, gates every send.
+	 */
+	TSharedRef<FAiBridgeOutbox, ESPMode::ThreadSafe> Outbox = MakeShared<FAiBridgeOutbox, ESPMode::ThreadSafe>();
+
+	/** Inbound frames waiting for the game thread, counted against the messages budget */
+	TSharedPtr<FAiBridgeMemoryStream, ESPMode::ThreadSafe> Memory;
+	FTSTicker::FDelegateHandle PumpHandle;
+
+	/** Fed with frames as the game thread dispatches them, timed by when the transport delivered them */
+	FAiBridgeThroughputMeter Downstream;
+
+	TFunction<void(bool)> PendingConnectCallback;
+
+	/** Transport the game thread listens to, events of any other session are left over from a dropped one */
+	uint32 Session = 0;
 
 	// State
+	bool bLinkOpen = false;
 	bool bIsConnecting = false;
 	bool bIsDisconnecting = false;
 
 	// Reconnect
-	float ReconnectBaseDelay;
-	float ReconnectMaxDelay;
-	float CurrentReconnectDelay;
-	int32 MaxReconnectAttempts;
+	float ReconnectBaseDelay = 1.0f;
+	float ReconnectMaxDelay = 30.0f;
+	float CurrentReconnectDelay = 1.0f;
+	int32 MaxReconnectAttempts = 5;
 	int32 ReconnectAttempts = 0;
 	bool bIsReconnecting = false;
 	bool bAutoReconnect = true;
 
 	// Session
 	FString LastUrl;
+	FString LastConnectionId;
 	FString JwtToken;
 
 	bool bVerbose = true;
 
+	// Capture
+	TSharedPtr<FAiBridgeCaptureWriter, ESPMode::ThreadSafe> Capture;
+	bool bCheckedCaptureCommandLine = false;
+
 	// Internal
 	void HandleConnected();
 	void HandleClosed(int32 StatusCode, const FString& Reason, bool bWasClean);
 	void HandleError(const FString& Error);
 	void AttemptReconnect();
+	void FinishConnect(bool bSuccess);
+	bool PumpIo(float DeltaTime);
+	void DispatchInbound(FAiBridgeIoEvent& Event);
+	void EnsureIoThread();
+
+	/**
+	 * I/O thread. Socket, loopback:// echo or replay:// capture transport ticked by Ticker, optionally
+	 * wrapped in the network condition simulator and then in the capture recorder
+	 */
+	static TSharedRef<IWebSocket> CreateTransport(const FString& Url, FTSTicker& Ticker, TSharedPtr<FAiBridgeCaptureWriter, ESPMode::ThreadSafe> CaptureWriter, bool bSimulateNetwork);
 
 	FString SanitizeUrl(const FString& Url);
 };
@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NpcConversationBudgetSubsystem.h"
+#include "NpcConversationComponent.h"
+#include "TheSimulationCrewCharacter.h"
+#include "Camera/CameraComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+void UNpcConversationBudgetSubsystem::RegisterNpc(UNpcConversationComponent* Npc)
+{
+	if (Npc == nullptr || Npc->BudgetIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	Npc->BudgetIndex = Npcs.Add(Npc);
+	Npc->SetConversationMode(ENpcConversationMode::Baked);
+}
+
+void UNpcConversationBudgetSubsystem::UnregisterNpc(UNpcConversationComponent* Npc)
+{
+	if (Npc == nullptr || !Npcs.IsValidIndex(Npc->BudgetIndex) || Npcs[Npc->BudgetIndex] != Npc)
+	{
+		return;
+	}
+
+	if (Npc->CanUseLiveConversation())
+	{
+		NumLive--;
+	}
+
+	// Swap the last entry into the freed slot and fix up its index
+	const int32 Index = Npc->BudgetIndex;
+	Npcs.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	if (Npcs.IsValidIndex(Index))
+	{
+		Npcs[Index]->BudgetIndex = Index;
+	}
+
+	Npc->BudgetIndex = INDEX_NONE;
+}
+
+void UNpcConversationBudgetSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Npcs.Num() == 0)
+	{
+		return;
+	}
+
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	const APawn* PlayerPawn = PlayerController != nullptr ? PlayerController->GetPawn() : nullptr;
+	if (PlayerPawn == nullptr)
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	FVector ViewDirection;
+	if (const ATheSimulationCrewCharacter* Character = Cast<ATheSimulationCrewCharacter>(PlayerPawn))
+	{
+		const UCameraComponent* Camera = Character->GetFirstPersonCameraComponent();
+		ViewLocation = Camera->GetComponentLocation();
+		ViewDirection = Camera->GetForwardVector();
+	}
+	else
+	{
+		FRotator ViewRotation;
+		PlayerPawn->GetActorEyesViewPoint(ViewLocation, ViewRotation);
+		ViewDirection = ViewRotation.Vector();
+	}
+
+	Rebalance(ViewLocation, ViewDirection);
+}
+
+void UNpcConversationBudgetSubsystem::Rebalance(const FVector& ViewLocation, const FVector& ViewDirection)
+{
+	constexpr uint8 Ineligible = 0xFF;
+
+	const int32 Num = Npcs.Num();
+	Buckets.SetNumUninitialized(Num, EAllowShrinking::No);
+	Scores.SetNumUninitialized(Num, EAllowShrinking::No);
+	SortedIndices.SetNumUninitialized(Num, EAllowShrinking::No);
+
+	const float MaxDistanceSq = FMath::Square(MaxConversationDistance);
+	const float CosViewCone = FMath::Cos(FMath::DegreesToRadians(ViewConeHalfAngle));
+	const float InvBucketSize = 1.0f / BucketSize;
+
+	// Score every NPC and count how many land in each distance ring
+	int32 BucketCounts[NumBuckets] = {};
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const UNpcConversationComponent* Npc = Npcs[Index];
+		const AActor* Owner = Npc->GetOwner();
+
+		const FVector ToNpc = Owner->GetActorLocation() - ViewLocation;
+		const float DistanceSq = ToNpc.SizeSquared();
+
+		// NPCs mid-turn keep their slot regardless of where the player is looking
+		if (Npc->IsConversationActive() && Npc->CanUseLiveConversation())
+		{
+			Scores[Index] = -1.0f;
+			Buckets[Index] = 0;
+			BucketCounts[0]++;
+			continue;
+		}
+
+		if (DistanceSq > MaxDistanceSq)
+		{
+			Buckets[Index] = Ineligible;
+			continue;
+		}
+
+		float Distance = FMath::Sqrt(DistanceSq);
+		const bool bInViewCone = Distance <= KINDA_SMALL_NUMBER || FVector::DotProduct(ToNpc, ViewDirection) >= CosViewCone * Distance;
+		if (!bInViewCone || !Owner->WasRecentlyRendered(0.25f))
+		{
+			Distance *= HiddenDistanceScale;
+		}
+		if (Npc->CanUseLiveConversation())
+		{
+			Distance *= 1.0f - Hysteresis;
+		}
+		Distance /= Npc->PriorityWeight;
+
+		const int32 Bucket = FMath::Min(FMath::FloorToInt32(Distance * InvBucketSize), NumBuckets - 1);
+		Scores[Index] = Distance;
+		Buckets[Index] = static_cast<uint8>(Bucket);
+		BucketCounts[Bucket]++;
+	}
+
+	// Counting sort by ring, then only order the single ring that straddles the budget boundary
+	int32 BucketStart[NumBuckets];
+	int32 Running = 0;
+	int32 BoundaryBucket = INDEX_NONE;
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		BucketStart[Bucket] = Running;
+		Running += BucketCounts[Bucket];
+		if (BoundaryBucket == INDEX_NONE && Running >= MaxLiveConversations)
+		{
+			BoundaryBucket = Bucket;
+		}
+	}
+
+	const int32 NumEligible = Running;
+	int32 BucketWrite[NumBuckets];
+	FMemory::Memcpy(BucketWrite, BucketStart, sizeof(BucketStart));
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		if (Buckets[Index] != Ineligible)
+		{
+			SortedIndices[BucketWrite[Buckets[Index]]++] = Index;
+		}
+	}
+
+	if (BoundaryBucket != INDEX_NONE && BucketCounts[BoundaryBucket] > 1)
+	{
+		TArrayView<int32> Slice(SortedIndices.GetData() + BucketStart[BoundaryBucket], BucketCounts[BoundaryBucket]);
+		Slice.Sort([this](int32 A, int32 B) { return Scores[A] < Scores[B]; });
+	}
+
+	// Everyone in the first MaxLiveConversations sorted entries is admitted, the rest degrade
+	const int32 NumAdmitted = FMath::Min(MaxLiveConversations, NumEligible);
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		Buckets[Index] = 0;
+	}
+	for (int32 Rank = 0; Rank < NumAdmitted; ++Rank)
+	{
+		Buckets[SortedIndices[Rank]] = 1;
+	}
+
+	NumLive = 0;
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const bool bAdmitted = Buckets[Index] != 0;
+		NumLive += bAdmitted ? 1 : 0;
+		Npcs[Index]->SetConversationMode(bAdmitted ? ENpcConversationMode::Live : ENpcConversationMode::Baked);
+	}
+}
+
+TStatId UNpcConversationBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UNpcConversationBudgetSubsystem, STATGROUP_Tickables);
+}
+
+bool UNpcConversationBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NpcConversationBudgetSubsystem.generated.h"
+
+class UNpcConversationComponent;
+
+/**
+ * Limits how many NPCs may hold a live LLM conversation at the same time.
+ *
+ * Every tick each registered NPC is scored by its distance to the player pawn, penalised when it is
+ * outside the view cone or not rendered, and dropped into a distance ring. Rings are then walked from
+ * the inside out until MaxLiveConversations slots are filled, so a rebalance is O(N + buckets).
+ * Everyone else is degraded to cached/baked lines.
+ */
+UCLASS(config=Game)
+class THESIMULATIONCREW_API UNpcConversationBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Number of NPCs allowed to talk to the LLM backend simultaneously */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Budget, meta=(ClampMin="0"))
+	int32 MaxLiveConversations = 3;
+
+	/** NPCs further than this from the player are never admitted */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Budget, meta=(ClampMin="0"))
+	float MaxConversationDistance = 2500.0f;
+
+	/** Width of one distance ring used to bucket NPCs */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Budget, meta=(ClampMin="1"))
+	float BucketSize = 200.0f;
+
+	/** Distance multiplier applied to NPCs the player cannot currently see */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Budget, meta=(ClampMin="1"))
+	float HiddenDistanceScale = 2.5f;
+
+	/** Half angle of the player's view cone used for the visibility test */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Budget, meta=(ClampMin="0", ClampMax="180"))
+	float ViewConeHalfAngle = 60.0f;
+
+	/** Fractional distance bonus given to NPCs already holding a slot, avoids flapping at the boundary */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Budget, meta=(ClampMin="0", ClampMax="1"))
+	float Hysteresis = 0.15f;
+
+	void RegisterNpc(UNpcConversationComponent* Npc);
+	void UnregisterNpc(UNpcConversationComponent* Npc);
+
+	UFUNCTION(BlueprintPure, Category=Budget)
+	int32 GetNumLiveConversations() const { return NumLive; }
+
+	UFUNCTION(BlueprintPure, Category=Budget)
+	int32 GetNumRegisteredNpcs() const { return Npcs.Num(); }
+
+	// Begin FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	static constexpr int32 NumBuckets = 32;
+
+	/** Dense list of registered NPCs, each component remembers its own index for O(1) removal */
+	UPROPERTY()
+	TArray<TObjectPtr<UNpcConversationComponent>> Npcs;
+
+	/** Scratch buffers reused between rebalances to avoid per-tick allocations */
+	TArray<uint8> Buckets;
+	TArray<float> Scores;
+	TArray<int32> SortedIndices;
+
+	int32 NumLive = 0;
+
+	void Rebalance(const FVector& ViewLocation, const FVector& ViewDirection);
+};
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NpcConversationComponent.h"
+#include "NpcConversationBudgetSubsystem.h"
+#include "Engine/World.h"
+
+UNpcConversationComponent::UNpcConversationComponent()
+{
+	// The budget manager drives this component, it never needs its own tick
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UNpcConversationComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UNpcConversationBudgetSubsystem* Budget = UWorld::GetSubsystem<UNpcConversationBudgetSubsystem>(GetWorld()))
+	{
+		Budget->RegisterNpc(this);
+	}
+}
+
+void UNpcConversationComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UNpcConversationBudgetSubsystem* Budget = UWorld::GetSubsystem<UNpcConversationBudgetSubsystem>(GetWorld()))
+	{
+		Budget->UnregisterNpc(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UNpcConversationComponent::SetConversationMode(ENpcConversationMode NewMode)
+{
+	if (Mode == NewMode)
+	{
+		return;
+	}
+
+	Mode = NewMode;
+	OnConversationModeChanged.Broadcast(NewMode);
+}
+
+void UNpcConversationComponent::CacheLiveLine(const FText& Line)
+{
+	if (MaxCachedLines <= 0 || Line.IsEmpty())
+	{
+		return;
+	}
+
+	// Keep the newest lines, dropping the oldest once we are full
+	if (CachedLines.Num() >= MaxCachedLines)
+	{
+		CachedLines.RemoveAt(0, CachedLines.Num() - MaxCachedLines + 1, EAllowShrinking::No);
+	}
+	CachedLines.Add(Line);
+}
+
+FText UNpcConversationComponent::GetNextFallbackLine()
+{
+	if (CachedLines.Num() > 0)
+	{
+		NextCachedLine = NextCachedLine % CachedLines.Num();
+		return CachedLines[NextCachedLine++];
+	}
+
+	if (BakedLines.Num() > 0)
+	{
+		NextBakedLine = NextBakedLine % BakedLines.Num();
+		return BakedLines[NextBakedLine++];
+	}
+
+	return FText::GetEmpty();
+}
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "NpcConversationComponent.generated.h"
+
+UENUM(BlueprintType)
+enum class ENpcConversationMode : uint8
+{
+	/** The NPC holds one of the live LLM conversation slots */
+	Live,
+	/** The NPC is outside the budget and should speak cached or baked lines */
+	Baked
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnNpcConversationModeChanged, ENpcConversationMode, NewMode);
+
+/**
+ * Marks an actor as a conversational NPC. The owning world's UNpcConversationBudgetSubsystem decides
+ * whether it may talk to the LLM backend or has to fall back to cached/baked lines.
+ */
+UCLASS(Blueprintable, BlueprintType, ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class THESIMULATIONCREW_API UNpcConversationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UNpcConversationComponent();
+
+	/** Authored lines used when this NPC is not admitted into a live conversation */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Conversation)
+	TArray<FText> BakedLines;
+
+	/** Relative importance of this NPC; larger values make it win slots from further away */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Conversation, meta=(ClampMin="0.01"))
+	float PriorityWeight = 1.0f;
+
+	/** How many recent live responses are remembered for reuse while degraded */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Conversation, meta=(ClampMin="0"))
+	int32 MaxCachedLines = 4;
+
+	/** Fired whenever the budget manager admits or evicts this NPC */
+	UPROPERTY(BlueprintAssignable, Category=Conversation)
+	FOnNpcConversationModeChanged OnConversationModeChanged;
+
+	UFUNCTION(BlueprintPure, Category=Conversation)
+	ENpcConversationMode GetConversationMode() const { return Mode; }
+
+	UFUNCTION(BlueprintPure, Category=Conversation)
+	bool CanUseLiveConversation() const { return Mode == ENpcConversationMode::Live; }
+
+	/** Pins the NPC to its live slot while a turn is in flight so it is not cut off mid-sentence */
+	UFUNCTION(BlueprintCallable, Category=Conversation)
+	void SetConversationActive(bool bActive) { bConversationActive = bActive; }
+
+	UFUNCTION(BlueprintPure, Category=Conversation)
+	bool IsConversationActive() const { return bConversationActive; }
+
+	/** Remembers a live response so it can be replayed once the NPC is degraded */
+	UFUNCTION(BlueprintCallable, Category=Conversation)
+	void CacheLiveLine(const FText& Line);
+
+	/** Returns the next fallback line, preferring cached live responses over baked ones */
+	UFUNCTION(BlueprintCallable, Category=Conversation)
+	FText GetNextFallbackLine();
+
+	/** Called by the budget manager only */
+	void SetConversationMode(ENpcConversationMode NewMode);
+
+	/** Slot in the budget manager's dense arrays, INDEX_NONE while unregistered */
+	int32 BudgetIndex = INDEX_NONE;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	ENpcConversationMode Mode = ENpcConversationMode::Baked;
+	bool bConversationActive = false;
+
+	TArray<FText> CachedLines;
+	int32 NextCachedLine = 0;
+	int32 NextBakedLine = 0;
+};
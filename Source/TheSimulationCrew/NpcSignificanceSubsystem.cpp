@@ -0,0 +1,247 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NpcSignificanceSubsystem.h"
+#include "NpcConversationComponent.h"
+#include "TheSimulationCrewCharacter.h"
+#include "Camera/CameraComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+
+DECLARE_STATS_GROUP(TEXT("NpcSignificance"), STATGROUP_NpcSignificance, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Critical"), STAT_NpcSignificanceCritical, STATGROUP_NpcSignificance);
+DECLARE_DWORD_COUNTER_STAT(TEXT("High"), STAT_NpcSignificanceHigh, STATGROUP_NpcSignificance);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Medium"), STAT_NpcSignificanceMedium, STATGROUP_NpcSignificance);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Low"), STAT_NpcSignificanceLow, STATGROUP_NpcSignificance);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Ticks Saved Per Frame"), STAT_NpcSignificanceTicksSaved, STATGROUP_NpcSignificance);
+DECLARE_CYCLE_STAT(TEXT("Rebalance"), STAT_NpcSignificanceRebalance, STATGROUP_NpcSignificance);
+
+namespace NpcSignificance
+{
+	/** Expected ticks per frame of something ticking every Interval seconds */
+	float TicksPerFrame(float Interval, float DeltaTime)
+	{
+		return Interval > DeltaTime ? DeltaTime / Interval : 1.0f;
+	}
+
+	/** LOD levels covered by the frame skip map, more than any character mesh here has */
+	constexpr int32 MaxLodCount = 8;
+}
+
+UNpcSignificanceSubsystem::UNpcSignificanceSubsystem()
+{
+	MediumBudget.TickInterval = 0.1f;
+	MediumBudget.MovementTickInterval = 0.05f;
+	MediumBudget.AnimFrameSkip = 1;
+
+	LowBudget.TickInterval = 0.25f;
+	LowBudget.MovementTickInterval = 0.15f;
+	LowBudget.AnimFrameSkip = 3;
+}
+
+void UNpcSignificanceSubsystem::RegisterCharacter(ATheSimulationCrewCharacter* Character)
+{
+	if (Character == nullptr || Character->SignificanceIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	Character->SignificanceIndex = Characters.Add(Character);
+	Conversations.Add(Character->FindComponentByClass<UNpcConversationComponent>());
+	Significances.Add(ENpcSignificance::Critical);
+	ApplyBudget(Character, GetBudget(ENpcSignificance::Critical));
+
+	// Rebucket promptly so a new NPC does not run at full rate for a whole interval
+	TimeUntilRebalance = 0.0f;
+}
+
+void UNpcSignificanceSubsystem::UnregisterCharacter(ATheSimulationCrewCharacter* Character)
+{
+	if (Character == nullptr || !Characters.IsValidIndex(Character->SignificanceIndex) || Characters[Character->SignificanceIndex] != Character)
+	{
+		return;
+	}
+
+	ApplyBudget(Character, GetBudget(ENpcSignificance::Critical));
+
+	// Swap the last entry into the freed slot and fix up its index
+	const int32 Index = Character->SignificanceIndex;
+	Characters.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Conversations.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Significances.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	if (Characters.IsValidIndex(Index))
+	{
+		Characters[Index]->SignificanceIndex = Index;
+	}
+
+	Character->SignificanceIndex = INDEX_NONE;
+}
+
+ENpcSignificance UNpcSignificanceSubsystem::GetSignificance(const ATheSimulationCrewCharacter* Character) const
+{
+	if (Character == nullptr || !Characters.IsValidIndex(Character->SignificanceIndex))
+	{
+		return ENpcSignificance::Critical;
+	}
+
+	return Significances[Character->SignificanceIndex];
+}
+
+void UNpcSignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Characters.Num() == 0)
+	{
+		return;
+	}
+
+	UpdateStats(DeltaTime);
+
+	TimeUntilRebalance -= DeltaTime;
+	if (TimeUntilRebalance > 0.0f)
+	{
+		return;
+	}
+	TimeUntilRebalance = RebalanceInterval;
+
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	const APawn* PlayerPawn = PlayerController != nullptr ? PlayerController->GetPawn() : nullptr;
+	if (PlayerPawn == nullptr)
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	if (const ATheSimulationCrewCharacter* Character = Cast<ATheSimulationCrewCharacter>(PlayerPawn))
+	{
+		ViewLocation = Character->GetFirstPersonCameraComponent()->GetComponentLocation();
+	}
+	else
+	{
+		FRotator ViewRotation;
+		PlayerPawn->GetActorEyesViewPoint(ViewLocation, ViewRotation);
+	}
+
+	Rebalance(ViewLocation);
+}
+
+TStatId UNpcSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UNpcSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+bool UNpcSignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UNpcSignificanceSubsystem::Rebalance(const FVector& ViewLocation)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NpcSignificanceRebalance);
+
+	const float HighDistanceSq = FMath::Square(HighDistance);
+	const float MediumDistanceSq = FMath::Square(MediumDistance);
+
+	for (int32 Index = 0; Index < Characters.Num(); ++Index)
+	{
+		ATheSimulationCrewCharacter* Character = Characters[Index];
+		const UNpcConversationComponent* Conversation = Conversations[Index];
+
+		ENpcSignificance Significance;
+		if (Character->IsPlayerControlled() || (Conversation != nullptr && Conversation->IsConversationActive()))
+		{
+			// Speaking NPCs drive lip-sync and gestures, never throttle them mid-turn
+			Significance = ENpcSignificance::Critical;
+		}
+		else
+		{
+			const float DistanceSq = FVector::DistSquared(Character->GetActorLocation(), ViewLocation);
+			Significance = DistanceSq <= HighDistanceSq ? ENpcSignificance::High
+				: DistanceSq <= MediumDistanceSq ? ENpcSignificance::Medium
+				: ENpcSignificance::Low;
+
+			// Holding a live slot means the player may start talking to it any moment
+			const bool bLive = Conversation != nullptr && Conversation->CanUseLiveConversation();
+			if (bDemoteHidden && !bLive && Significance != ENpcSignificance::Low && !Character->WasRecentlyRendered(0.25f))
+			{
+				Significance = static_cast<ENpcSignificance>(static_cast<uint8>(Significance) + 1);
+			}
+			if (bLive && Significance > ENpcSignificance::High)
+			{
+				Significance = ENpcSignificance::High;
+			}
+		}
+
+		if (Significance != Significances[Index])
+		{
+			Significances[Index] = Significance;
+			ApplyBudget(Character, GetBudget(Significance));
+		}
+	}
+}
+
+const FNpcSignificanceBudget& UNpcSignificanceSubsystem::GetBudget(ENpcSignificance Significance) const
+{
+	static const FNpcSignificanceBudget FullRate;
+
+	switch (Significance)
+	{
+	case ENpcSignificance::High:
+		return HighBudget;
+	case ENpcSignificance::Medium:
+		return MediumBudget;
+	case ENpcSignificance::Low:
+		return LowBudget;
+	default:
+		return FullRate;
+	}
+}
+
+void UNpcSignificanceSubsystem::ApplyBudget(ATheSimulationCrewCharacter* Character, const FNpcSignificanceBudget& Budget) const
+{
+	Character->SetActorTickInterval(Budget.TickInterval);
+
+	if (UCharacterMovementComponent* Movement = Character->GetCharacterMovement())
+	{
+		Movement->SetComponentTickInterval(Budget.MovementTickInterval);
+	}
+
+	// Same skip at every LOD, URO still slows down further on its own while the mesh is not rendered
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	if (Mesh != nullptr && Mesh->AnimUpdateRateParams != nullptr)
+	{
+		FAnimUpdateRateParameters* Params = Mesh->AnimUpdateRateParams;
+		Params->bShouldUseLodMap = true;
+		for (int32 Lod = 0; Lod < NpcSignificance::MaxLodCount; ++Lod)
+		{
+			Params->LODToFrameSkipMap.Add(Lod, Budget.AnimFrameSkip);
+		}
+	}
+}
+
+void UNpcSignificanceSubsystem::UpdateStats(float DeltaTime) const
+{
+#if STATS
+	int32 Counts[4] = {};
+	float TicksSaved = 0.0f;
+	for (const ENpcSignificance Significance : Significances)
+	{
+		Counts[static_cast<uint8>(Significance)]++;
+
+		// Actor, movement and animation would each run once per frame at full rate
+		const FNpcSignificanceBudget& Budget = GetBudget(Significance);
+		TicksSaved += 3.0f
+			- NpcSignificance::TicksPerFrame(Budget.TickInterval, DeltaTime)
+			- NpcSignificance::TicksPerFrame(Budget.MovementTickInterval, DeltaTime)
+			- 1.0f / (Budget.AnimFrameSkip + 1);
+	}
+
+	SET_DWORD_STAT(STAT_NpcSignificanceCritical, Counts[0]);
+	SET_DWORD_STAT(STAT_NpcSignificanceHigh, Counts[1]);
+	SET_DWORD_STAT(STAT_NpcSignificanceMedium, Counts[2]);
+	SET_DWORD_STAT(STAT_NpcSignificanceLow, Counts[3]);
+	SET_FLOAT_STAT(STAT_NpcSignificanceTicksSaved, TicksSaved);
+#endif
+}
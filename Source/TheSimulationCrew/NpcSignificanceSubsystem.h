@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NpcSignificanceSubsystem.generated.h"
+
+class ATheSimulationCrewCharacter;
+class UNpcConversationComponent;
+
+UENUM(BlueprintType)
+enum class ENpcSignificance : uint8
+{
+	/** Speaking, or controlled by a player: always full rate */
+	Critical,
+	High,
+	Medium,
+	Low
+};
+
+/** How much work a character in one significance bucket is allowed per second */
+USTRUCT(BlueprintType)
+struct FNpcSignificanceBudget
+{
+	GENERATED_BODY()
+
+	/** Seconds between actor ticks, 0 ticks every frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Significance, meta=(ClampMin="0"))
+	float TickInterval = 0.0f;
+
+	/** Seconds between character movement updates, 0 updates every frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Significance, meta=(ClampMin="0"))
+	float MovementTickInterval = 0.0f;
+
+	/** Frames skipped between animation evaluations through update rate optimization, 0 evaluates every frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Significance, meta=(ClampMin="0", ClampMax="30"))
+	int32 AnimFrameSkip = 0;
+};
+
+/**
+ * Throttles NPC characters by how much the player would notice them.
+ *
+ * Every RebalanceInterval each registered ATheSimulationCrewCharacter is bucketed by its distance to
+ * the player's view and whether it was recently rendered. NPCs holding an active conversation are
+ * Critical, and so are player-controlled characters. Each bucket's budget is then applied to the
+ * actor tick interval, the character movement tick interval and the skeletal mesh's update rate
+ * optimization frame skip. 'stat NpcSignificance' shows the bucket sizes and the ticks saved per frame.
+ */
+UCLASS(config=Game)
+class THESIMULATIONCREW_API UNpcSignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Seconds between re-bucketing, budgets stay applied in between */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Significance, meta=(ClampMin="0"))
+	float RebalanceInterval = 0.2f;
+
+	/** NPCs closer than this to the view are High */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Significance, meta=(ClampMin="0"))
+	float HighDistance = 1500.0f;
+
+	/** NPCs closer than this to the view are Medium, further ones Low */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Significance, meta=(ClampMin="0"))
+	float MediumDistance = 4000.0f;
+
+	/** NPCs not rendered recently drop one bucket */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Significance)
+	bool bDemoteHidden = true;
+
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Significance)
+	FNpcSignificanceBudget HighBudget;
+
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Significance)
+	FNpcSignificanceBudget MediumBudget;
+
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Significance)
+	FNpcSignificanceBudget LowBudget;
+
+	UNpcSignificanceSubsystem();
+
+	void RegisterCharacter(ATheSimulationCrewCharacter* Character);
+	void UnregisterCharacter(ATheSimulationCrewCharacter* Character);
+
+	UFUNCTION(BlueprintPure, Category=Significance)
+	ENpcSignificance GetSignificance(const ATheSimulationCrewCharacter* Character) const;
+
+	UFUNCTION(BlueprintPure, Category=Significance)
+	int32 GetNumRegisteredCharacters() const { return Characters.Num(); }
+
+	// Begin FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/** Dense list of registered characters, each character remembers its own index for O(1) removal */
+	UPROPERTY()
+	TArray<TObjectPtr<ATheSimulationCrewCharacter>> Characters;
+
+	/** Parallel to Characters, the conversation component is looked up once at registration */
+	UPROPERTY()
+	TArray<TObjectPtr<UNpcConversationComponent>> Conversations;
+
+	TArray<ENpcSignificance> Significances;
+
+	float TimeUntilRebalance = 0.0f;
+
+	void Rebalance(const FVector& ViewLocation);
+	const FNpcSignificanceBudget& GetBudget(ENpcSignificance Significance) const;
+	void ApplyBudget(ATheSimulationCrewCharacter* Character, const FNpcSignificanceBudget& Budget) const;
+	void UpdateStats(float DeltaTime) const;
+};
@@ -0,0 +1,463 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PerfBenchmarkSubsystem.h"
+#include "TheSimulationCrewCharacter.h"
+#include "TheSimulationCrewProjectile.h"
+#include "TP_PickUpComponent.h"
+#include "TP_WeaponComponent.h"
+#include "ProjectilePoolSubsystem.h"
+#include "ProjectileSimulationSubsystem.h"
+#include "WebSocket/WebSocketConnection.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+
+namespace PerfBench
+{
+	/** Nearest-rank percentile of an already sorted array */
+	float Percentile(const TArray<float>& Sorted, float Fraction)
+	{
+		if (Sorted.Num() == 0)
+		{
+			return 0.0f;
+		}
+		return Sorted[FMath::Clamp(FMath::CeilToInt(Fraction * Sorted.Num()) - 1, 0, Sorted.Num() - 1)];
+	}
+
+	float Average(const TArray<float>& Values)
+	{
+		double Sum = 0.0;
+		for (const float Value : Values)
+		{
+			Sum += Value;
+		}
+		return Values.Num() > 0 ? static_cast<float>(Sum / Values.Num()) : 0.0f;
+	}
+}
+
+void UPerfBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bActive || bFinished)
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (!bStarted)
+	{
+		// The player is spawned by the game mode, wait for it to anchor the scenario
+		bStarted = Start();
+		LastFrameSeconds = Now;
+		return;
+	}
+
+	// Wall-clock frame time, DeltaTime is clamped by the engine exactly when frames get slow
+	const float FrameSeconds = static_cast<float>(Now - LastFrameSeconds);
+	LastFrameSeconds = Now;
+	Elapsed += FrameSeconds;
+
+	DriveScenario(DeltaTime);
+
+	if (Elapsed >= WarmupSeconds)
+	{
+		Capture(FrameSeconds);
+	}
+	if (Elapsed >= WarmupSeconds + DurationSeconds)
+	{
+		Finish();
+	}
+}
+
+TStatId UPerfBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPerfBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+bool UPerfBenchmarkSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return Super::ShouldCreateSubsystem(Outer) && FParse::Param(FCommandLine::Get(), TEXT("PerfBench"));
+}
+
+bool UPerfBenchmarkSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPerfBenchmarkSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	ApplyCommandLine();
+
+	// Started on another map, travel to the benchmark map and let its own subsystem run
+	const FString MapName = UWorld::RemovePIEPrefix(InWorld.GetPackage()->GetName());
+	if (!BenchmarkMap.IsNull() && MapName != BenchmarkMap.GetLongPackageName())
+	{
+		UE_LOG(LogTemp, Log, TEXT("[PerfBench] Loading %s"), *BenchmarkMap.GetLongPackageName());
+		UGameplayStatics::OpenLevel(&InWorld, FName(*BenchmarkMap.GetLongPackageName()));
+		return;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("[PerfBench] %s on %s: %d NPCs (%d shooters at %.1f shots/s), %d pickups, %.0fs + %.0fs warmup, AiBridge %s"),
+		*Label, *MapName, NumNpcs, FMath::Min(NumShooters, NumNpcs), ShotsPerSecond, NumPickups, DurationSeconds, WarmupSeconds,
+		AiBridgeUrl.IsEmpty() ? TEXT("off") : *AiBridgeUrl);
+	bActive = true;
+}
+
+void UPerfBenchmarkSubsystem::Deinitialize()
+{
+	if (Connection != nullptr)
+	{
+		Connection->OnTextMessage = nullptr;
+		Connection->OnBinaryMessage = nullptr;
+		Connection->Disconnect();
+		Connection = nullptr;
+	}
+
+	Super::Deinitialize();
+}
+
+void UPerfBenchmarkSubsystem::ApplyCommandLine()
+{
+	const TCHAR* CommandLine = FCommandLine::Get();
+
+	FString Map;
+	if (FParse::Value(CommandLine, TEXT("PerfBench.Map="), Map))
+	{
+		BenchmarkMap = FSoftObjectPath(Map);
+	}
+
+	FParse::Value(CommandLine, TEXT("PerfBench.Npcs="), NumNpcs);
+	FParse::Value(CommandLine, TEXT("PerfBench.Shooters="), NumShooters);
+	FParse::Value(CommandLine, TEXT("PerfBench.ShotsPerSecond="), ShotsPerSecond);
+	FParse::Value(CommandLine, TEXT("PerfBench.Pickups="), NumPickups);
+	FParse::Value(CommandLine, TEXT("PerfBench.Duration="), DurationSeconds);
+	FParse::Value(CommandLine, TEXT("PerfBench.Warmup="), WarmupSeconds);
+	FParse::Value(CommandLine, TEXT("PerfBench.AiBridgeUrl="), AiBridgeUrl);
+	FParse::Value(CommandLine, TEXT("PerfBench.MessagesPerSecond="), AiBridgeMessagesPerSecond);
+	FParse::Value(CommandLine, TEXT("PerfBench.Output="), OutputDirectory);
+	bExitWhenDone = !FParse::Param(CommandLine, TEXT("PerfBench.NoExit"));
+
+	if (!FParse::Value(CommandLine, TEXT("PerfBench.Label="), Label))
+	{
+		Label = FString::Printf(TEXT("%s-%s"), FApp::GetBuildVersion(), LexToString(FApp::GetBuildConfiguration()));
+	}
+
+	NumNpcs = FMath::Max(0, NumNpcs);
+	NumShooters = FMath::Clamp(NumShooters, 0, NumNpcs);
+	DurationSeconds = FMath::Max(1.0f, DurationSeconds);
+}
+
+bool UPerfBenchmarkSubsystem::Start()
+{
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	APawn* PlayerPawn = PlayerController != nullptr ? PlayerController->GetPawn() : nullptr;
+	if (PlayerPawn == nullptr)
+	{
+		return false;
+	}
+
+	Center = PlayerPawn->GetActorLocation();
+
+	// The camera path places the player every frame, walking and falling would only fight it
+	if (ACharacter* PlayerCharacter = Cast<ACharacter>(PlayerPawn))
+	{
+		PlayerCharacter->GetCharacterMovement()->DisableMovement();
+	}
+
+	SpawnScenario();
+	ConnectAiBridge();
+	return true;
+}
+
+void UPerfBenchmarkSubsystem::SpawnScenario()
+{
+	UWorld* World = GetWorld();
+
+	UClass* NpcType = NpcClass.LoadSynchronous();
+	if (NpcType == nullptr)
+	{
+		NpcType = ATheSimulationCrewCharacter::StaticClass();
+	}
+
+	TSubclassOf<ATheSimulationCrewProjectile> ProjectileType = ProjectileClass.LoadSynchronous();
+	if (ProjectileType == nullptr)
+	{
+		ProjectileType = ATheSimulationCrewProjectile::StaticClass();
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (int32 NpcIndex = 0; NpcIndex < NumNpcs; ++NpcIndex)
+	{
+		const float Angle = Random.FRandRange(0.0f, UE_TWO_PI);
+		const FVector Location = FindGround(Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f) * SpawnRadius * FMath::Sqrt(Random.FRand()));
+		const float Yaw = Random.FRandRange(0.0f, 360.0f);
+
+		ATheSimulationCrewCharacter* Npc = World->SpawnActor<ATheSimulationCrewCharacter>(NpcType, Location, FRotator(0.0f, Yaw, 0.0f), SpawnParams);
+		if (Npc == nullptr)
+		{
+			continue;
+		}
+
+		Npc->SpawnDefaultController();
+		Npcs.Add(Npc);
+		Headings.Add(Yaw);
+
+		// The first NumShooters NPCs get a weapon, fired through the same path as the player's
+		if (Weapons.Num() < NumShooters && Npc->GetController() != nullptr)
+		{
+			UTP_WeaponComponent* Weapon = NewObject<UTP_WeaponComponent>(Npc);
+			Weapon->ProjectileClass = ProjectileType;
+			Weapon->RegisterComponent();
+			if (Weapon->AttachWeapon(Npc))
+			{
+				Weapons.Add(Weapon);
+			}
+			else
+			{
+				Weapon->DestroyComponent();
+			}
+		}
+	}
+
+	UClass* PickupType = PickupClass.LoadSynchronous();
+	for (int32 PickupIndex = 0; PickupIndex < NumPickups; ++PickupIndex)
+	{
+		const float Angle = Random.FRandRange(0.0f, UE_TWO_PI);
+		const FVector Location = FindGround(Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f) * SpawnRadius * FMath::Sqrt(Random.FRand())) + FVector(0.0f, 0.0f, 50.0f);
+
+		AActor* Pickup = World->SpawnActor<AActor>(PickupType != nullptr ? PickupType : AActor::StaticClass(), FTransform(Location), SpawnParams);
+		if (Pickup != nullptr && PickupType == nullptr)
+		{
+			// No pickup Blueprint configured, a bare pickup component still costs what the detection costs
+			UTP_PickUpComponent* PickUpComponent = NewObject<UTP_PickUpComponent>(Pickup);
+			PickUpComponent->SetCollisionProfileName(TEXT("OverlapAllDynamic"));
+			Pickup->SetRootComponent(PickUpComponent);
+			PickUpComponent->SetWorldLocation(Location);
+			PickUpComponent->RegisterComponent();
+		}
+		if (Pickup != nullptr)
+		{
+			Pickups.Add(Pickup);
+		}
+	}
+}
+
+void UPerfBenchmarkSubsystem::ConnectAiBridge()
+{
+	if (AiBridgeUrl.IsEmpty())
+	{
+		return;
+	}
+
+	Connection = NewObject<UWebSocketConnection>(this);
+	Connection->OnTextMessage = [this](const FString& Message)
+	{
+		FramesReceived++;
+		BytesReceived += FTCHARToUTF8(*Message).Length();
+	};
+	Connection->OnBinaryMessage = [this](const TArray<uint8>& Data)
+	{
+		FramesReceived++;
+		BytesReceived += Data.Num();
+	};
+
+	const FString Url = AiBridgeUrl;
+	Connection->Connect(Url, TEXT("perfbench"), FString(), [Url](bool bConnected)
+	{
+		UE_LOG(LogTemp, Log, TEXT("[PerfBench] AiBridge mock %s %s"), *Url, bConnected ? TEXT("connected") : TEXT("failed to connect"));
+	});
+}
+
+void UPerfBenchmarkSubsystem::DriveScenario(float DeltaTime)
+{
+	// Camera path: one lap around the start over the whole run, looking at the middle of the crowd
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	APawn* PlayerPawn = PlayerController != nullptr ? PlayerController->GetPawn() : nullptr;
+	if (PlayerPawn != nullptr)
+	{
+		const float Angle = UE_TWO_PI * Elapsed / (WarmupSeconds + DurationSeconds);
+		const FVector Location = Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f) * CameraPathRadius;
+		PlayerPawn->SetActorLocation(Location, false, nullptr, ETeleportType::TeleportPhysics);
+		PlayerController->SetControlRotation((Center - Location).Rotation());
+	}
+
+	// NPCs wander and turn back once they leave the spawn disc
+	for (int32 NpcIndex = 0; NpcIndex < Npcs.Num(); ++NpcIndex)
+	{
+		ATheSimulationCrewCharacter* Npc = Npcs[NpcIndex];
+		if (!IsValid(Npc))
+		{
+			continue;
+		}
+
+		const FVector ToCenter = Center - Npc->GetActorLocation();
+		Headings[NpcIndex] = ToCenter.SizeSquared2D() > FMath::Square(SpawnRadius)
+			? ToCenter.Rotation().Yaw
+			: Headings[NpcIndex] + Random.FRandRange(-90.0f, 90.0f) * DeltaTime;
+		Npc->AddMovementInput(FRotator(0.0f, Headings[NpcIndex], 0.0f).Vector(), 0.5f);
+	}
+
+	// Shots are spread round-robin over the shooters rather than fired in volleys
+	if (Weapons.Num() > 0)
+	{
+		ShotBudget = FMath::Min(ShotBudget + DeltaTime * ShotsPerSecond * Weapons.Num(), 2.0f * Weapons.Num());
+		while (ShotBudget >= 1.0f)
+		{
+			ShotBudget -= 1.0f;
+
+			UTP_WeaponComponent* Weapon = Weapons[NextShooter++ % Weapons.Num()];
+			const APawn* Shooter = Weapon != nullptr ? Cast<APawn>(Weapon->GetOwner()) : nullptr;
+			if (Shooter != nullptr && Shooter->GetController() != nullptr)
+			{
+				Shooter->GetController()->SetControlRotation(FRotator(Random.FRandRange(-5.0f, 20.0f), Random.FRandRange(0.0f, 360.0f), 0.0f));
+				Weapon->Fire();
+			}
+		}
+	}
+
+	// Orchestrator-sized turns, echoed back by the loopback mock
+	if (Connection != nullptr && Connection->IsConnected())
+	{
+		static const FString Payload = FString::ChrN(240, TEXT('a'));
+
+		MessageBudget = FMath::Min(MessageBudget + DeltaTime * AiBridgeMessagesPerSecond, 2.0f * AiBridgeMessagesPerSecond);
+		while (MessageBudget >= 1.0f)
+		{
+			MessageBudget -= 1.0f;
+			Connection->SendText(FString::Printf(TEXT("{\"type\":\"bench\",\"seq\":%d,\"npc\":%d,\"text\":\"%s\"}"),
+				MessageSequence, Npcs.Num() > 0 ? MessageSequence % Npcs.Num() : 0, *Payload));
+			MessageSequence++;
+		}
+	}
+}
+
+void UPerfBenchmarkSubsystem::Capture(float FrameSeconds)
+{
+	UWorld* World = GetWorld();
+	const FPlatformMemoryStats Memory = FPlatformMemory::GetStats();
+
+	FPerfBenchSample& Sample = Samples.AddDefaulted_GetRef();
+	Sample.TimeSeconds = Elapsed - WarmupSeconds;
+	Sample.FrameMs = FrameSeconds * 1000.0f;
+	Sample.GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	Sample.UsedPhysicalMb = Memory.UsedPhysical / (1024.0f * 1024.0f);
+	Sample.UsedVirtualMb = Memory.UsedVirtual / (1024.0f * 1024.0f);
+	Sample.Npcs = Npcs.Num();
+
+	if (const UProjectileSimulationSubsystem* ProjectileSimulation = World->GetSubsystem<UProjectileSimulationSubsystem>())
+	{
+		Sample.Projectiles += ProjectileSimulation->GetNumProjectiles();
+	}
+	if (const UProjectilePoolSubsystem* ProjectilePool = World->GetSubsystem<UProjectilePoolSubsystem>())
+	{
+		Sample.Projectiles += ProjectilePool->GetNumActive();
+	}
+
+	for (const AActor* Pickup : Pickups)
+	{
+		Sample.Pickups += IsValid(Pickup) ? 1 : 0;
+	}
+
+	if (Connection != nullptr)
+	{
+		const FAiBridgeIoStats IoStats = Connection->GetIoStats();
+		Sample.FramesSent = IoStats.FramesSent;
+		Sample.BytesSent = IoStats.BytesSent;
+		Sample.FramesReceived = FramesReceived;
+		Sample.BytesReceived = BytesReceived;
+		Sample.RttMs = Connection->GetHeartbeatStats().SmoothedRttMs;
+	}
+}
+
+void UPerfBenchmarkSubsystem::Finish()
+{
+	bFinished = true;
+
+	const FString Directory = OutputDirectory.IsEmpty() ? FPaths::ProfilingDir() / TEXT("PerfBench") : OutputDirectory;
+	const FString MapName = FPackageName::GetShortName(UWorld::RemovePIEPrefix(GetWorld()->GetPackage()->GetName()));
+	const FString Timestamp = FDateTime::Now().ToString();
+
+	// Every captured frame, for plotting one run
+	FString Frames = TEXT("Time,FrameMs,GameThreadMs,UsedPhysicalMb,UsedVirtualMb,Npcs,Projectiles,Pickups,FramesSent,BytesSent,FramesReceived,BytesReceived,RttMs\n");
+	Frames.Reserve(Samples.Num() * 96);
+	TArray<float> FrameTimes;
+	TArray<float> GameThreadTimes;
+	TArray<float> Rtts;
+	float PeakPhysicalMb = 0.0f;
+	for (const FPerfBenchSample& Sample : Samples)
+	{
+		Frames.Appendf(TEXT("%.4f,%.3f,%.3f,%.1f,%.1f,%d,%d,%d,%llu,%llu,%llu,%llu,%.2f\n"),
+			Sample.TimeSeconds, Sample.FrameMs, Sample.GameThreadMs, Sample.UsedPhysicalMb, Sample.UsedVirtualMb,
+			Sample.Npcs, Sample.Projectiles, Sample.Pickups,
+			Sample.FramesSent, Sample.BytesSent, Sample.FramesReceived, Sample.BytesReceived, Sample.RttMs);
+
+		FrameTimes.Add(Sample.FrameMs);
+		GameThreadTimes.Add(Sample.GameThreadMs);
+		if (Sample.RttMs > 0.0f)
+		{
+			Rtts.Add(Sample.RttMs);
+		}
+		PeakPhysicalMb = FMath::Max(PeakPhysicalMb, Sample.UsedPhysicalMb);
+	}
+
+	const FString FramesPath = Directory / FString::Printf(TEXT("%s_%s_%s.csv"), *MapName, *FPaths::MakeValidFileName(Label, TEXT('_')), *Timestamp);
+	FFileHelper::SaveStringToFile(Frames, *FramesPath);
+
+	FrameTimes.Sort();
+	GameThreadTimes.Sort();
+	const FPerfBenchSample Last = Samples.Num() > 0 ? Samples.Last() : FPerfBenchSample();
+
+	// One row per run in a shared file, the regression comparison across builds
+	const FString HistoryPath = Directory / TEXT("PerfBenchHistory.csv");
+	FString History;
+	if (!IFileManager::Get().FileExists(*HistoryPath))
+	{
+		History = TEXT("Timestamp,Label,Map,Npcs,Shooters,ShotsPerSecond,Pickups,MessagesPerSecond,Frames,AvgFrameMs,P50FrameMs,P95FrameMs,P99FrameMs,MaxFrameMs,AvgGameThreadMs,P95GameThreadMs,PeakPhysicalMb,BytesSent,BytesReceived,AvgRttMs\n");
+	}
+	History.Appendf(TEXT("%s,%s,%s,%d,%d,%.1f,%d,%.1f,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%llu,%llu,%.2f\n"),
+		*Timestamp, *Label, *MapName, Npcs.Num(), Weapons.Num(), ShotsPerSecond, Pickups.Num(), AiBridgeMessagesPerSecond, Samples.Num(),
+		PerfBench::Average(FrameTimes), PerfBench::Percentile(FrameTimes, 0.5f), PerfBench::Percentile(FrameTimes, 0.95f),
+		PerfBench::Percentile(FrameTimes, 0.99f), FrameTimes.Num() > 0 ? FrameTimes.Last() : 0.0f,
+		PerfBench::Average(GameThreadTimes), PerfBench::Percentile(GameThreadTimes, 0.95f),
+		PeakPhysicalMb, Last.BytesSent, Last.BytesReceived, PerfBench::Average(Rtts));
+	FFileHelper::SaveStringToFile(History, *HistoryPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+
+	UE_LOG(LogTemp, Log, TEXT("[PerfBench] %d frames: avg %.2f ms, p95 %.2f ms, p99 %.2f ms, game thread avg %.2f ms, peak %.0f MB. Wrote %s"),
+		Samples.Num(), PerfBench::Average(FrameTimes), PerfBench::Percentile(FrameTimes, 0.95f), PerfBench::Percentile(FrameTimes, 0.99f),
+		PerfBench::Average(GameThreadTimes), PeakPhysicalMb, *FramesPath);
+
+	if (Connection != nullptr)
+	{
+		Connection->Disconnect();
+	}
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false, TEXT("PerfBench"));
+	}
+}
+
+FVector UPerfBenchmarkSubsystem::FindGround(const FVector& Location) const
+{
+	// Drop onto whatever is below, a capsule half height up so characters do not spawn in the floor
+	FHitResult Hit;
+	const FVector Start = Location + FVector(0.0f, 0.0f, 1000.0f);
+	const FVector End = Location - FVector(0.0f, 0.0f, 5000.0f);
+	if (GetWorld()->LineTraceSingleByChannel(Hit, Start, End, ECC_Visibility))
+	{
+		return Hit.Location + FVector(0.0f, 0.0f, 100.0f);
+	}
+	return Location;
+}
@@ -0,0 +1,163 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PerfBenchmarkSubsystem.generated.h"
+
+class ATheSimulationCrewCharacter;
+class ATheSimulationCrewProjectile;
+class UTP_WeaponComponent;
+class UWebSocketConnection;
+
+/** One captured frame of a benchmark run */
+struct FPerfBenchSample
+{
+	float TimeSeconds = 0.0f;
+	float FrameMs = 0.0f;
+	float GameThreadMs = 0.0f;
+	float UsedPhysicalMb = 0.0f;
+	float UsedVirtualMb = 0.0f;
+	int32 Npcs = 0;
+	int32 Projectiles = 0;
+	int32 Pickups = 0;
+	uint64 FramesSent = 0;
+	uint64 BytesSent = 0;
+	uint64 FramesReceived = 0;
+	uint64 BytesReceived = 0;
+	float RttMs = 0.0f;
+};
+
+/**
+ * Repeatable performance run, only created when the game is started with -PerfBench.
+ *
+ * Loads BenchmarkMap, spawns wandering NPCs, NPC shooters firing UTP_WeaponComponent weapons and
+ * pickups, flies the player along a circular camera path and streams orchestrator-sized messages
+ * over an AiBridge connection to a local mock (the in-process loopback:// echo by default, or any
+ * local server through -PerfBench.AiBridgeUrl=). After the warmup every frame is captured, at the end
+ * the frames are written to a CSV, a summary row is appended to PerfBenchHistory.csv for comparing
+ * builds, and the game exits. Runs headless:
+ *
+ *   TheSimulationCrew -game -PerfBench -nullrhi -unattended -nosound
+ *     [-PerfBench.Npcs=50] [-PerfBench.Shooters=10] [-PerfBench.ShotsPerSecond=4] [-PerfBench.Pickups=100]
+ *     [-PerfBench.Duration=60] [-PerfBench.Warmup=5] [-PerfBench.AiBridgeUrl=ws://127.0.0.1:8080/ws]
+ *     [-PerfBench.MessagesPerSecond=20] [-PerfBench.Output=<dir>] [-PerfBench.Label=<build>] [-PerfBench.NoExit]
+ */
+UCLASS(config=Game)
+class THESIMULATIONCREW_API UPerfBenchmarkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark, meta=(AllowedClasses="/Script/Engine.World"))
+	FSoftObjectPath BenchmarkMap;
+
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark)
+	TSoftClassPtr<ATheSimulationCrewCharacter> NpcClass;
+
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark)
+	TSoftClassPtr<ATheSimulationCrewProjectile> ProjectileClass;
+
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark)
+	TSoftClassPtr<AActor> PickupClass;
+
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark, meta=(ClampMin="0"))
+	int32 NumNpcs = 50;
+
+	/** NPCs, out of NumNpcs, that carry a weapon and fire */
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark, meta=(ClampMin="0"))
+	int32 NumShooters = 10;
+
+	/** Shots per second for each shooter */
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark, meta=(ClampMin="0"))
+	float ShotsPerSecond = 4.0f;
+
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark, meta=(ClampMin="0"))
+	int32 NumPickups = 100;
+
+	/** Seconds run before frames are captured, lets streaming and pools settle */
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark, meta=(ClampMin="0"))
+	float WarmupSeconds = 5.0f;
+
+	/** Seconds captured after the warmup */
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark, meta=(ClampMin="1"))
+	float DurationSeconds = 60.0f;
+
+	/** NPCs and pickups are spread over a disc of this radius around the player start */
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark, meta=(ClampMin="0"))
+	float SpawnRadius = 2000.0f;
+
+	/** Radius of the circle the camera flies around the player start, once per run */
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark, meta=(ClampMin="0"))
+	float CameraPathRadius = 2500.0f;
+
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark)
+	FString AiBridgeUrl = TEXT("loopback://perfbench");
+
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark, meta=(ClampMin="0"))
+	float AiBridgeMessagesPerSecond = 20.0f;
+
+	/** Directory for the CSVs, defaults to Saved/Profiling/PerfBench */
+	UPROPERTY(Config, EditAnywhere, Category=Benchmark)
+	FString OutputDirectory;
+
+	// Begin FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject
+
+protected:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+private:
+	UPROPERTY()
+	TArray<TObjectPtr<ATheSimulationCrewCharacter>> Npcs;
+
+	UPROPERTY()
+	TArray<TObjectPtr<UTP_WeaponComponent>> Weapons;
+
+	UPROPERTY()
+	TArray<TObjectPtr<AActor>> Pickups;
+
+	UPROPERTY()
+	TObjectPtr<UWebSocketConnection> Connection;
+
+	/** Wander heading per NPC, in degrees */
+	TArray<float> Headings;
+
+	/** Fixed seed so placement, wandering and aim are the same in every run */
+	FRandomStream Random{0x5EED};
+
+	TArray<FPerfBenchSample> Samples;
+
+	FVector Center = FVector::ZeroVector;
+	FString Label;
+
+	bool bActive = false;
+	bool bStarted = false;
+	bool bFinished = false;
+	bool bExitWhenDone = true;
+
+	double LastFrameSeconds = 0.0;
+	float Elapsed = 0.0f;
+	float ShotBudget = 0.0f;
+	float MessageBudget = 0.0f;
+	int32 NextShooter = 0;
+	int32 MessageSequence = 0;
+	uint64 BytesReceived = 0;
+	uint64 FramesReceived = 0;
+
+	void ApplyCommandLine();
+	bool Start();
+	void SpawnScenario();
+	void ConnectAiBridge();
+	void DriveScenario(float DeltaTime);
+	void Capture(float FrameSeconds);
+	void Finish();
+
+	FVector FindGround(const FVector& Location) const;
+};
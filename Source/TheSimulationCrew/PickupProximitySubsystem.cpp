@@ -0,0 +1,303 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PickupProximitySubsystem.h"
+#include "TP_PickUpComponent.h"
+#include "TheSimulationCrewCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pickup Proximity"), STAT_PickupProximity, STATGROUP_Game);
+
+void UPickupProximitySubsystem::RegisterPickup(UTP_PickUpComponent* Pickup)
+{
+	if (Pickup == nullptr || Pickup->ProximityIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	const FVector Location = Pickup->GetComponentLocation();
+	const int32 Index = Pickups.Add(Pickup);
+	Locations.Add(Location);
+	Radii.Add(Pickup->GetScaledSphereRadius());
+	PickupCells.Add(GetCell(Location));
+	Pickup->ProximityIndex = Index;
+	AddToCell(Index);
+
+	MaxRadius = FMath::Max(MaxRadius, Radii[Index]);
+
+	// Pickups rarely move, but a carried or animated one has to follow into its new cell
+	Pickup->TransformUpdated.AddUObject(this, &UPickupProximitySubsystem::HandlePickupMoved);
+}
+
+void UPickupProximitySubsystem::UnregisterPickup(UTP_PickUpComponent* Pickup)
+{
+	if (Pickup == nullptr || !Pickups.IsValidIndex(Pickup->ProximityIndex) || Pickups[Pickup->ProximityIndex] != Pickup)
+	{
+		return;
+	}
+
+	const int32 Index = Pickup->ProximityIndex;
+	RemoveFromCell(Index);
+	Pickup->TransformUpdated.RemoveAll(this);
+	Pickup->ProximityIndex = INDEX_NONE;
+
+	// Swap the last entry into the freed slot and fix up its index and cell entry
+	const int32 Last = Pickups.Num() - 1;
+	if (Index != Last)
+	{
+		RemoveFromCell(Last);
+		Pickups[Index] = Pickups[Last];
+		Locations[Index] = Locations[Last];
+		Radii[Index] = Radii[Last];
+		PickupCells[Index] = PickupCells[Last];
+		Pickups[Index]->ProximityIndex = Index;
+		AddToCell(Index);
+	}
+
+	Pickups.Pop(EAllowShrinking::No);
+	Locations.Pop(EAllowShrinking::No);
+	Radii.Pop(EAllowShrinking::No);
+	PickupCells.Pop(EAllowShrinking::No);
+}
+
+void UPickupProximitySubsystem::UpdateProximity()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PickupProximity);
+
+	if (Pickups.Num() == 0)
+	{
+		return;
+	}
+
+	Entered.Reset();
+	for (TActorIterator<ATheSimulationCrewCharacter> It(GetWorld()); It; ++It)
+	{
+		const UCapsuleComponent* Capsule = It->GetCapsuleComponent();
+		if (Capsule == nullptr || !Capsule->IsCollisionEnabled())
+		{
+			continue;
+		}
+
+		// Sphere against capsule: distance to the capsule's inner segment within both radii
+		const FVector Center = Capsule->GetComponentLocation();
+		const FVector Axis = Capsule->GetUpVector() * Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+		const float CapsuleRadius = Capsule->GetScaledCapsuleRadius();
+		const FVector Extent(CapsuleRadius + Capsule->GetScaledCapsuleHalfHeight() + MaxRadius);
+
+		const FIntVector MinCell = GetCell(Center - Extent);
+		const FIntVector MaxCell = GetCell(Center + Extent);
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+			{
+				for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+				{
+					const TArray<int32>* Cell = Cells.Find(FIntVector(X, Y, Z));
+					if (Cell == nullptr)
+					{
+						continue;
+					}
+
+					for (const int32 Index : *Cell)
+					{
+						const float Reach = Radii[Index] + CapsuleRadius;
+						if (FMath::PointDistToSegmentSquared(Locations[Index], Center - Axis, Center + Axis) <= FMath::Square(Reach))
+						{
+							Entered.Emplace(Pickups[Index], *It);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Broadcast after the search, handlers attach weapons and destroy pickups which unregisters them
+	for (const TPair<UTP_PickUpComponent*, ATheSimulationCrewCharacter*>& Pair : Entered)
+	{
+		UTP_PickUpComponent* Pickup = Pair.Key;
+		if (IsValid(Pickup) && Pickup->ProximityIndex != INDEX_NONE)
+		{
+			// First character in wins and the pickup stops listening, as with the overlap binding
+			UnregisterPickup(Pickup);
+			Pickup->OnPickUp.Broadcast(Pair.Value);
+		}
+	}
+	Entered.Reset();
+}
+
+void UPickupProximitySubsystem::RunBenchmark(const TArray<int32>& Counts, int32 Steps)
+{
+	UWorld* World = GetWorld();
+	TActorIterator<ATheSimulationCrewCharacter> CharacterIt(World);
+	if (!CharacterIt)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("[PickupProximity] No character in the world to move through the pickups"));
+		return;
+	}
+
+	ATheSimulationCrewCharacter* Character = *CharacterIt;
+	const FVector Origin = Character->GetActorLocation();
+	const bool bWasEnabled = bEnabled;
+	const float Spacing = 150.0f;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	for (const int32 Count : Counts)
+	{
+		// Square field of pickups in front of the character, walked through from one edge to the other
+		const int32 Side = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(Count)));
+		const float FieldSize = Side * Spacing;
+		const FVector Corner = Origin + FVector(Spacing, -0.5f * FieldSize, 0.0f);
+
+		double Seconds[2] = { 0.0, 0.0 };
+		for (int32 Mode = 0; Mode < 2; ++Mode)
+		{
+			// Mode 0 is the overlap body per pickup, mode 1 the spatial hash
+			bEnabled = Mode == 1;
+
+			TArray<AActor*> Spawned;
+			for (int32 PickupIndex = 0; PickupIndex < Count; ++PickupIndex)
+			{
+				const FVector Location = Corner + FVector((PickupIndex / Side) * Spacing, (PickupIndex % Side) * Spacing, 0.0f);
+				AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform(Location), SpawnParams);
+				UTP_PickUpComponent* Pickup = NewObject<UTP_PickUpComponent>(Actor);
+				Pickup->SetCollisionProfileName(TEXT("OverlapAllDynamic"));
+				Actor->SetRootComponent(Pickup);
+				Pickup->SetWorldLocation(Location);
+				Pickup->RegisterComponent();
+				Spawned.Add(Actor);
+			}
+
+			const double Start = FPlatformTime::Seconds();
+			for (int32 Step = 0; Step < Steps; ++Step)
+			{
+				Character->SetActorLocation(Origin + FVector((FieldSize + 2.0f * Spacing) * Step / Steps, 0.0f, 0.0f));
+				if (bEnabled)
+				{
+					UpdateProximity();
+				}
+			}
+			Seconds[Mode] = FPlatformTime::Seconds() - Start;
+
+			Character->SetActorLocation(Origin);
+			for (AActor* Actor : Spawned)
+			{
+				Actor->Destroy();
+			}
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("[PickupProximity] %d pickups, %d steps: overlap bodies %.2f us/step (%d bodies), spatial hash %.2f us/step (0 bodies)"),
+			Count, Steps, Seconds[0] * 1e6 / Steps, Count, Seconds[1] * 1e6 / Steps);
+	}
+
+	bEnabled = bWasEnabled;
+}
+
+void UPickupProximitySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	UpdateProximity();
+}
+
+TStatId UPickupProximitySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPickupProximitySubsystem, STATGROUP_Tickables);
+}
+
+bool UPickupProximitySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPickupProximitySubsystem::Deinitialize()
+{
+	for (UTP_PickUpComponent* Pickup : Pickups)
+	{
+		if (Pickup != nullptr)
+		{
+			Pickup->TransformUpdated.RemoveAll(this);
+			Pickup->ProximityIndex = INDEX_NONE;
+		}
+	}
+
+	Pickups.Reset();
+	Locations.Reset();
+	Radii.Reset();
+	PickupCells.Reset();
+	Cells.Reset();
+
+	Super::Deinitialize();
+}
+
+FIntVector UPickupProximitySubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void UPickupProximitySubsystem::AddToCell(int32 Index)
+{
+	Cells.FindOrAdd(PickupCells[Index]).Add(Index);
+}
+
+void UPickupProximitySubsystem::RemoveFromCell(int32 Index)
+{
+	TArray<int32>* Cell = Cells.Find(PickupCells[Index]);
+	if (Cell == nullptr)
+	{
+		return;
+	}
+
+	Cell->RemoveSingleSwap(Index, EAllowShrinking::No);
+	if (Cell->Num() == 0)
+	{
+		Cells.Remove(PickupCells[Index]);
+	}
+}
+
+void UPickupProximitySubsystem::HandlePickupMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	UTP_PickUpComponent* Pickup = Cast<UTP_PickUpComponent>(UpdatedComponent);
+	if (Pickup == nullptr || !Pickups.IsValidIndex(Pickup->ProximityIndex))
+	{
+		return;
+	}
+
+	const int32 Index = Pickup->ProximityIndex;
+	Locations[Index] = Pickup->GetComponentLocation();
+	Radii[Index] = Pickup->GetScaledSphereRadius();
+	MaxRadius = FMath::Max(MaxRadius, Radii[Index]);
+
+	const FIntVector NewCell = GetCell(Locations[Index]);
+	if (NewCell != PickupCells[Index])
+	{
+		RemoveFromCell(Index);
+		PickupCells[Index] = NewCell;
+		AddToCell(Index);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GPickupProximityBenchCommand(
+	TEXT("TheSimulationCrew.Pickups.Bench"),
+	TEXT("Walks the player through 10, 100 and 1000 pickups using overlap bodies and then the spatial hash. Usage: TheSimulationCrew.Pickups.Bench [Steps=200] [Counts...]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UPickupProximitySubsystem* Proximity = World->GetSubsystem<UPickupProximitySubsystem>())
+		{
+			const int32 Steps = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 200;
+
+			TArray<int32> Counts;
+			for (int32 ArgIndex = 1; ArgIndex < Args.Num(); ++ArgIndex)
+			{
+				Counts.Add(FMath::Max(1, FCString::Atoi(*Args[ArgIndex])));
+			}
+			if (Counts.Num() == 0)
+			{
+				Counts = { 10, 100, 1000 };
+			}
+
+			Proximity->RunBenchmark(Counts, Steps);
+		}
+	}));
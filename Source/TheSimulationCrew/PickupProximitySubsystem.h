@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Components/SceneComponent.h"
+#include "PickupProximitySubsystem.generated.h"
+
+class UTP_PickUpComponent;
+class ATheSimulationCrewCharacter;
+
+/**
+ * Detects characters entering pickups without a physics overlap body per pickup.
+ *
+ * Registered pickups are bucketed by position in a uniform spatial hash. Once per tick each
+ * ATheSimulationCrewCharacter's capsule is tested against the pickups in the cells it touches, so
+ * the cost follows the number of characters rather than the number of pickups. A pickup fires
+ * OnPickUp for the first character inside its radius and is then unregistered, which matches the
+ * one-shot overlap binding it replaces.
+ */
+UCLASS(config=Game)
+class THESIMULATIONCREW_API UPickupProximitySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Pickups register here instead of generating overlap events, takes effect for pickups beginning play */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Pickups)
+	bool bEnabled = true;
+
+	/** Edge length of one hash cell, a few times the typical pickup radius works well */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Pickups, meta=(ClampMin="1"))
+	float CellSize = 400.0f;
+
+	void RegisterPickup(UTP_PickUpComponent* Pickup);
+	void UnregisterPickup(UTP_PickUpComponent* Pickup);
+
+	/** Tests every character against nearby pickups and fires OnPickUp for those entered */
+	void UpdateProximity();
+
+	UFUNCTION(BlueprintPure, Category=Pickups)
+	int32 GetNumPickups() const { return Pickups.Num(); }
+
+	/** Times character movement through Count pickups with overlap bodies against the spatial hash, for each count */
+	void RunBenchmark(const TArray<int32>& Counts, int32 Steps);
+
+	// Begin FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+
+private:
+	/** Dense list of registered pickups, each component remembers its own index for O(1) removal */
+	UPROPERTY()
+	TArray<TObjectPtr<UTP_PickUpComponent>> Pickups;
+
+	/** Parallel to Pickups */
+	TArray<FVector> Locations;
+	TArray<float> Radii;
+	TArray<FIntVector> PickupCells;
+
+	/** Indices into Pickups per occupied cell */
+	TMap<FIntVector, TArray<int32>> Cells;
+
+	/** Largest registered radius, widens the cell range searched around a character */
+	float MaxRadius = 0.0f;
+
+	/** Scratch list of pickups entered this update, broadcast after the search */
+	TArray<TPair<UTP_PickUpComponent*, ATheSimulationCrewCharacter*>> Entered;
+
+	FIntVector GetCell(const FVector& Location) const;
+	void AddToCell(int32 Index);
+	void RemoveFromCell(int32 Index);
+
+	void HandlePickupMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+};
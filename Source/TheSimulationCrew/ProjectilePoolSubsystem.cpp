@@ -0,0 +1,251 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ProjectilePoolSubsystem.h"
+#include "TheSimulationCrewProjectile.h"
+#include "TP_WeaponComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+void UProjectilePoolSubsystem::Prewarm(TSubclassOf<ATheSimulationCrewProjectile> Class, int32 Count)
+{
+	if (Class == nullptr)
+	{
+		return;
+	}
+
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(Class);
+	Count = FMath::Min(Count, MaxPooledPerClass);
+	while (Bucket.Free.Num() < Count)
+	{
+		ATheSimulationCrewProjectile* Projectile = SpawnParked(Class);
+		if (Projectile == nullptr)
+		{
+			break;
+		}
+		Bucket.Free.Add(Projectile);
+	}
+}
+
+ATheSimulationCrewProjectile* UProjectilePoolSubsystem::Acquire(TSubclassOf<ATheSimulationCrewProjectile> Class, const FVector& Location, const FRotator& Rotation)
+{
+	UWorld* World = GetWorld();
+	if (Class == nullptr || World == nullptr)
+	{
+		return nullptr;
+	}
+
+	const double Start = FPlatformTime::Seconds();
+
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(Class);
+	ATheSimulationCrewProjectile* Projectile = nullptr;
+	while (Projectile == nullptr && Bucket.Free.Num() > 0)
+	{
+		// Parked projectiles can still be destroyed by the world, e.g. on level unload
+		Projectile = Bucket.Free.Pop(EAllowShrinking::No);
+		if (!IsValid(Projectile))
+		{
+			Projectile = nullptr;
+		}
+	}
+
+	if (Projectile == nullptr)
+	{
+		// Pool ran dry, grow it by spawning exactly as the weapon used to
+		FActorSpawnParameters ActorSpawnParams;
+		ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
+
+		Projectile = World->SpawnActor<ATheSimulationCrewProjectile>(Class, Location, Rotation, ActorSpawnParams);
+		if (Projectile == nullptr)
+		{
+			return nullptr;
+		}
+
+		Projectile->bPooled = true;
+		NumSpawned++;
+		NumActive++;
+		TotalSpawnSeconds += FPlatformTime::Seconds() - Start;
+		return Projectile;
+	}
+
+	// Same rule SpawnActor applies: nudge out of blocking geometry, or do not fire at all
+	FVector FireLocation = Location;
+	Projectile->SetActorEnableCollision(true);
+	if (World->EncroachingBlockingGeometry(Projectile, FireLocation, Rotation) && !World->FindTeleportSpot(Projectile, FireLocation, Rotation))
+	{
+		Projectile->SetActorEnableCollision(false);
+		Bucket.Free.Push(Projectile);
+		return nullptr;
+	}
+
+	Projectile->ActivateFromPool(FireLocation, Rotation);
+	NumReused++;
+	NumActive++;
+	TotalReuseSeconds += FPlatformTime::Seconds() - Start;
+	return Projectile;
+}
+
+void UProjectilePoolSubsystem::Release(ATheSimulationCrewProjectile* Projectile)
+{
+	if (!IsValid(Projectile) || Projectile->bParked)
+	{
+		return;
+	}
+
+	if (!Projectile->bPooled)
+	{
+		Projectile->Destroy();
+		return;
+	}
+
+	NumActive--;
+
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(Projectile->GetClass());
+	if (Bucket.Free.Num() >= MaxPooledPerClass)
+	{
+		Projectile->bPooled = false;
+		Projectile->Destroy();
+		return;
+	}
+
+	Projectile->DeactivateToPool();
+	Bucket.Free.Push(Projectile);
+}
+
+int32 UProjectilePoolSubsystem::GetNumFree() const
+{
+	int32 NumFree = 0;
+	for (const TPair<TObjectPtr<UClass>, FProjectilePoolBucket>& Pair : Buckets)
+	{
+		NumFree += Pair.Value.Free.Num();
+	}
+	return NumFree;
+}
+
+void UProjectilePoolSubsystem::DumpStats() const
+{
+	const double SpawnUs = NumSpawned > 0 ? TotalSpawnSeconds * 1e6 / NumSpawned : 0.0;
+	const double ReuseUs = NumReused > 0 ? TotalReuseSeconds * 1e6 / NumReused : 0.0;
+
+	UE_LOG(LogTemp, Log, TEXT("[ProjectilePool] %d active, %d free, %d spawned, %d reused; spawn %.1f us, reuse %.1f us, saved %.2f ms so far"),
+		NumActive, GetNumFree(), NumSpawned, NumReused, SpawnUs, ReuseUs,
+		NumSpawned > 0 ? NumReused * (SpawnUs - ReuseUs) / 1000.0 : 0.0);
+}
+
+void UProjectilePoolSubsystem::RunBenchmark(TSubclassOf<ATheSimulationCrewProjectile> Class, int32 ShotCount)
+{
+	UWorld* World = GetWorld();
+	if (Class == nullptr || World == nullptr)
+	{
+		return;
+	}
+
+	// High above the level so nothing is hit while the benchmark runs within one frame
+	const FVector Location(0.0f, 0.0f, 100000.0f);
+	const FRotator Rotation = FRotator::ZeroRotator;
+
+	FActorSpawnParameters ActorSpawnParams;
+	ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// Baseline: one spawn and one destroy per shot, plus the collection of the dead actors
+	double Start = FPlatformTime::Seconds();
+	for (int32 Shot = 0; Shot < ShotCount; ++Shot)
+	{
+		if (AActor* Projectile = World->SpawnActor<ATheSimulationCrewProjectile>(Class, Location, Rotation, ActorSpawnParams))
+		{
+			Projectile->Destroy();
+		}
+	}
+	const double SpawnSeconds = FPlatformTime::Seconds() - Start;
+
+	Start = FPlatformTime::Seconds();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	const double SpawnGcSeconds = FPlatformTime::Seconds() - Start;
+
+	// Pooled: same shots through Acquire and Release
+	Prewarm(Class, 1);
+	Start = FPlatformTime::Seconds();
+	for (int32 Shot = 0; Shot < ShotCount; ++Shot)
+	{
+		Release(Acquire(Class, Location, Rotation));
+	}
+	const double PoolSeconds = FPlatformTime::Seconds() - Start;
+
+	Start = FPlatformTime::Seconds();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	const double PoolGcSeconds = FPlatformTime::Seconds() - Start;
+
+	UE_LOG(LogTemp, Log, TEXT("[ProjectilePool] %d shots of %s: spawn/destroy %.1f us/shot + GC %.2f ms, pooled %.1f us/shot + GC %.2f ms (%.1fx)"),
+		ShotCount, *Class->GetName(),
+		SpawnSeconds * 1e6 / ShotCount, SpawnGcSeconds * 1000.0,
+		PoolSeconds * 1e6 / ShotCount, PoolGcSeconds * 1000.0,
+		(SpawnSeconds + SpawnGcSeconds) / FMath::Max(PoolSeconds + PoolGcSeconds, 1e-9));
+}
+
+bool UProjectilePoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UProjectilePoolSubsystem::Deinitialize()
+{
+	Buckets.Reset();
+	Super::Deinitialize();
+}
+
+ATheSimulationCrewProjectile* UProjectilePoolSubsystem::SpawnParked(UClass* Class)
+{
+	const double Start = FPlatformTime::Seconds();
+
+	FActorSpawnParameters ActorSpawnParams;
+	ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	ATheSimulationCrewProjectile* Projectile = GetWorld()->SpawnActor<ATheSimulationCrewProjectile>(Class, FVector::ZeroVector, FRotator::ZeroRotator, ActorSpawnParams);
+	if (Projectile != nullptr)
+	{
+		Projectile->bPooled = true;
+		Projectile->DeactivateToPool();
+		NumSpawned++;
+		TotalSpawnSeconds += FPlatformTime::Seconds() - Start;
+	}
+	return Projectile;
+}
+
+namespace ProjectilePool
+{
+	/** The projectile the player's weapon fires, or the native class when no weapon is around */
+	TSubclassOf<ATheSimulationCrewProjectile> FindWeaponProjectileClass(UWorld* World)
+	{
+		for (TObjectIterator<UTP_WeaponComponent> It; It; ++It)
+		{
+			if (It->GetWorld() == World && It->ProjectileClass != nullptr)
+			{
+				return It->ProjectileClass;
+			}
+		}
+		return ATheSimulationCrewProjectile::StaticClass();
+	}
+}
+
+static FAutoConsoleCommandWithWorld GProjectilePoolStatsCommand(
+	TEXT("TheSimulationCrew.ProjectilePool.Stats"),
+	TEXT("Logs projectile pool reuse counts and the measured spawn versus reuse cost."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UProjectilePoolSubsystem* Pool = World->GetSubsystem<UProjectilePoolSubsystem>())
+		{
+			Pool->DumpStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GProjectilePoolBenchCommand(
+	TEXT("TheSimulationCrew.ProjectilePool.Bench"),
+	TEXT("Compares spawn/destroy against pooled fire for the weapon's projectile. Usage: TheSimulationCrew.ProjectilePool.Bench [Shots=500]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UProjectilePoolSubsystem* Pool = World->GetSubsystem<UProjectilePoolSubsystem>())
+		{
+			const int32 Shots = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 500;
+			Pool->RunBenchmark(ProjectilePool::FindWeaponProjectileClass(World), Shots);
+		}
+	}));
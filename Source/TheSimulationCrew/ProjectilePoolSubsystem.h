@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectilePoolSubsystem.generated.h"
+
+class ATheSimulationCrewProjectile;
+
+/** Inactive projectiles of one class waiting to be fired again */
+USTRUCT()
+struct FProjectilePoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<ATheSimulationCrewProjectile>> Free;
+};
+
+/**
+ * Recycles ATheSimulationCrewProjectile actors instead of spawning and destroying one per shot.
+ *
+ * Weapons pre-warm the pool when they are picked up. Firing takes a parked projectile, teleports it to
+ * the muzzle and restarts its movement; hits and lifespan expiry park it again. The pool only spawns
+ * when it runs dry, so sustained fire stops paying for actor construction, component registration
+ * and the garbage collection of dead projectiles.
+ *
+ * With the batched projectile simulation enabled, the default, weapons fire into that instead and the
+ * pool only takes the shots the simulation has no room for; it is not pre-warmed then and grows on demand.
+ */
+UCLASS(config=Game)
+class THESIMULATIONCREW_API UProjectilePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Projectiles spawned up front for each class when a weapon using it is equipped */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Pool, meta=(ClampMin="0"))
+	int32 PrewarmCount = 32;
+
+	/** Parked projectiles kept per class, extra ones returned beyond this are destroyed */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Pool, meta=(ClampMin="1"))
+	int32 MaxPooledPerClass = 256;
+
+	/** Spawns parked projectiles of Class until Count are free */
+	void Prewarm(TSubclassOf<ATheSimulationCrewProjectile> Class, int32 Count);
+
+	/**
+	 * Fires a projectile of Class from Location, reusing a parked one when possible.
+	 * Follows the weapon's spawn rule: nudged out of blocking geometry if possible, otherwise not fired.
+	 */
+	ATheSimulationCrewProjectile* Acquire(TSubclassOf<ATheSimulationCrewProjectile> Class, const FVector& Location, const FRotator& Rotation);
+
+	/** Parks Projectile for reuse, projectiles the pool does not own are destroyed */
+	void Release(ATheSimulationCrewProjectile* Projectile);
+
+	UFUNCTION(BlueprintPure, Category=Pool)
+	int32 GetNumFree() const;
+
+	UFUNCTION(BlueprintPure, Category=Pool)
+	int32 GetNumActive() const { return NumActive; }
+
+	/** Logs reuse counts and the measured cost of a spawn against a reuse */
+	void DumpStats() const;
+
+	/** Times ShotCount spawn + destroy cycles against the same number of pooled fires in the current world */
+	void RunBenchmark(TSubclassOf<ATheSimulationCrewProjectile> Class, int32 ShotCount);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+
+private:
+	UPROPERTY()
+	TMap<TObjectPtr<UClass>, FProjectilePoolBucket> Buckets;
+
+	int32 NumActive = 0;
+	int32 NumSpawned = 0;
+	int32 NumReused = 0;
+
+	double TotalSpawnSeconds = 0.0;
+	double TotalReuseSeconds = 0.0;
+
+	ATheSimulationCrewProjectile* SpawnParked(UClass* Class);
+};
@@ -0,0 +1,486 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ProjectileSimulationSubsystem.h"
+#include "TheSimulationCrewProjectile.h"
+#include "TP_WeaponComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SphereComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Engine/SCS_Node.h"
+#include "Engine/SimpleConstructionScript.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/VectorRegister.h"
+#include "UObject/UObjectIterator.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectiles Resolve Sweeps"), STAT_ProjectilesResolveSweeps, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Projectiles Integrate"), STAT_ProjectilesIntegrate, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Projectiles Issue Sweeps"), STAT_ProjectilesIssueSweeps, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Projectiles Update Visuals"), STAT_ProjectilesUpdateVisuals, STATGROUP_Game);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles In Flight"), STAT_ProjectilesInFlight, STATGROUP_Game);
+
+namespace ProjectileSimulation
+{
+	/** The mesh a Blueprint projectile adds in its construction script, searched from the most derived class up */
+	const UStaticMeshComponent* FindMeshTemplate(UClass* Class)
+	{
+		for (UBlueprintGeneratedClass* BlueprintClass = Cast<UBlueprintGeneratedClass>(Class); BlueprintClass != nullptr; BlueprintClass = Cast<UBlueprintGeneratedClass>(BlueprintClass->GetSuperClass()))
+		{
+			if (BlueprintClass->SimpleConstructionScript == nullptr)
+			{
+				continue;
+			}
+
+			for (USCS_Node* Node : BlueprintClass->SimpleConstructionScript->GetAllNodes())
+			{
+				if (const UStaticMeshComponent* Mesh = Cast<UStaticMeshComponent>(Node->ComponentTemplate))
+				{
+					return Mesh;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	/** Padding lanes stay zero so they integrate to nothing */
+	int32 PaddedCount(int32 Count)
+	{
+		return Align(Count, 4);
+	}
+}
+
+bool UProjectileSimulationSubsystem::Fire(TSubclassOf<ATheSimulationCrewProjectile> Class, const FVector& Location, const FRotator& Rotation)
+{
+	UWorld* World = GetWorld();
+	if (Class == nullptr || World == nullptr || Num >= MaxProjectiles)
+	{
+		return false;
+	}
+
+	const int32 Archetype = FindOrAddArchetype(Class);
+	const FSimulatedProjectileArchetype& Params = Archetypes[Archetype];
+
+	// The actor spawn would try to nudge out of geometry first; a shot from inside a wall is simply not fired
+	static const FName FireOverlapName(TEXT("ProjectileFire"));
+	if (World->OverlapBlockingTestByChannel(Location, FQuat::Identity, Params.Channel, FCollisionShape::MakeSphere(Params.Radius), FCollisionQueryParams(FireOverlapName), FCollisionResponseParams(Params.Responses)))
+	{
+		return false;
+	}
+
+	const int32 Index = AddProjectile();
+	const FVector Velocity = Rotation.Vector() * Params.InitialSpeed;
+
+	PosX[Index] = PrevX[Index] = Location.X;
+	PosY[Index] = PrevY[Index] = Location.Y;
+	PosZ[Index] = PrevZ[Index] = Location.Z;
+	VelX[Index] = Velocity.X;
+	VelY[Index] = Velocity.Y;
+	VelZ[Index] = Velocity.Z;
+	Gravity[Index] = Params.GravityZ;
+	MaxSpeed[Index] = Params.MaxSpeed;
+	Age[Index] = 0.0f;
+	LifeSpan[Index] = Params.LifeSpan;
+	ArchetypeIndex[Index] = Archetype;
+	return true;
+}
+
+void UProjectileSimulationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SET_DWORD_STAT(STAT_ProjectilesInFlight, Num);
+
+	// Last frame's sweeps first, so bounces feed this frame's integration
+	ResolveSweeps();
+	Integrate(DeltaTime);
+	RetireExpired();
+	IssueSweeps();
+	UpdateVisuals();
+}
+
+TStatId UProjectileSimulationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileSimulationSubsystem, STATGROUP_Tickables);
+}
+
+bool UProjectileSimulationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UProjectileSimulationSubsystem::Deinitialize()
+{
+	for (TArray<float>* Lane : GetFloatLanes())
+	{
+		Lane->Reset();
+	}
+	ArchetypeIndex.Reset();
+	Sweeps.Reset();
+	Num = 0;
+
+	Archetypes.Reset();
+	InstanceTransforms.Reset();
+	VisualHost = nullptr;
+
+	Super::Deinitialize();
+}
+
+int32 UProjectileSimulationSubsystem::FindOrAddArchetype(UClass* Class)
+{
+	const int32 Existing = Archetypes.IndexOfByPredicate([Class](const FSimulatedProjectileArchetype& Archetype) { return Archetype.Class == Class; });
+	if (Existing != INDEX_NONE)
+	{
+		return Existing;
+	}
+
+	// Everything the actor would have simulated with comes from its defaults
+	const ATheSimulationCrewProjectile* Defaults = Class->GetDefaultObject<ATheSimulationCrewProjectile>();
+	const UProjectileMovementComponent* Movement = Defaults->GetProjectileMovement();
+	const USphereComponent* Collision = Defaults->GetCollisionComp();
+
+	FSimulatedProjectileArchetype& Archetype = Archetypes.AddDefaulted_GetRef();
+	Archetype.Class = Class;
+	Archetype.Radius = Collision->GetUnscaledSphereRadius();
+	Archetype.Channel = Collision->GetCollisionObjectType();
+	Archetype.Responses = Collision->GetCollisionResponseToChannels();
+	Archetype.InitialSpeed = Movement->InitialSpeed;
+	Archetype.MaxSpeed = Movement->MaxSpeed > 0.0f ? Movement->MaxSpeed : UE_BIG_NUMBER;
+	Archetype.GravityZ = GetWorld()->GetGravityZ() * Movement->ProjectileGravityScale;
+	Archetype.Bounciness = Movement->Bounciness;
+	Archetype.Friction = Movement->Friction;
+	Archetype.StopSpeed = Movement->BounceVelocityStopSimulatingThreshold;
+	Archetype.bShouldBounce = Movement->bShouldBounce;
+	Archetype.bRotationFollowsVelocity = Movement->bRotationFollowsVelocity;
+	Archetype.LifeSpan = Defaults->InitialLifeSpan > 0.0f ? Defaults->InitialLifeSpan : UE_BIG_NUMBER;
+
+	if (VisualHost == nullptr)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		VisualHost = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+	}
+
+	UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(VisualHost, NAME_None, RF_Transient);
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetCanEverAffectNavigation(false);
+	if (const UStaticMeshComponent* Template = ProjectileSimulation::FindMeshTemplate(Class))
+	{
+		Instances->SetStaticMesh(Template->GetStaticMesh());
+		for (int32 MaterialIndex = 0; MaterialIndex < Template->OverrideMaterials.Num(); ++MaterialIndex)
+		{
+			Instances->SetMaterial(MaterialIndex, Template->OverrideMaterials[MaterialIndex]);
+		}
+		Archetype.MeshScale = Template->GetRelativeScale3D();
+	}
+
+	if (VisualHost->GetRootComponent() == nullptr)
+	{
+		VisualHost->SetRootComponent(Instances);
+	}
+	else
+	{
+		Instances->SetupAttachment(VisualHost->GetRootComponent());
+	}
+	Instances->RegisterComponent();
+	VisualHost->AddInstanceComponent(Instances);
+	Archetype.Instances = Instances;
+
+	InstanceTransforms.AddDefaulted();
+	return Archetypes.Num() - 1;
+}
+
+int32 UProjectileSimulationSubsystem::AddProjectile()
+{
+	const int32 Index = Num++;
+	const int32 Padded = ProjectileSimulation::PaddedCount(Num);
+	if (Padded > PosX.Num())
+	{
+		for (TArray<float>* Lane : GetFloatLanes())
+		{
+			Lane->AddZeroed(Padded - Lane->Num());
+		}
+	}
+	ArchetypeIndex.SetNum(Padded);
+	Sweeps.SetNum(Padded);
+	Sweeps[Index] = FTraceHandle();
+	return Index;
+}
+
+void UProjectileSimulationSubsystem::RemoveAtSwap(int32 Index)
+{
+	const int32 Last = --Num;
+	for (TArray<float>* Lane : GetFloatLanes())
+	{
+		(*Lane)[Index] = (*Lane)[Last];
+		(*Lane)[Last] = 0.0f;
+	}
+	ArchetypeIndex[Index] = ArchetypeIndex[Last];
+	Sweeps[Index] = Sweeps[Last];
+	Sweeps[Last] = FTraceHandle();
+}
+
+void UProjectileSimulationSubsystem::SetResting(int32 Index)
+{
+	VelX[Index] = VelY[Index] = VelZ[Index] = 0.0f;
+	Gravity[Index] = 0.0f;
+}
+
+void UProjectileSimulationSubsystem::ResolveSweeps()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectilesResolveSweeps);
+
+	UWorld* World = GetWorld();
+	FTraceDatum Datum;
+
+	// Backwards so a projectile removed on impact is replaced by one already resolved
+	for (int32 Index = Num - 1; Index >= 0; --Index)
+	{
+		if (!Sweeps[Index].IsValid())
+		{
+			continue;
+		}
+
+		const bool bReady = World->QueryTraceData(Sweeps[Index], Datum);
+		Sweeps[Index] = FTraceHandle();
+		if (bReady && Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit)
+		{
+			HandleHit(Index, Datum.OutHits[0]);
+		}
+	}
+}
+
+void UProjectileSimulationSubsystem::HandleHit(int32 Index, const FHitResult& Hit)
+{
+	const FSimulatedProjectileArchetype& Params = Archetypes[ArchetypeIndex[Index]];
+	const FVector Velocity(VelX[Index], VelY[Index], VelZ[Index]);
+
+	OnImpact.Broadcast(Hit, Velocity);
+
+	// Only add impulse and remove the projectile if we hit a physics body, as ATheSimulationCrewProjectile::OnHit does
+	UPrimitiveComponent* OtherComp = Hit.GetComponent();
+	if (Hit.GetActor() != nullptr && OtherComp != nullptr && OtherComp->IsSimulatingPhysics())
+	{
+		OtherComp->AddImpulseAtLocation(Velocity * 100.0f, Hit.Location);
+		RemoveAtSwap(Index);
+		return;
+	}
+
+	// Back to where the sphere touched, this frame's integration continues from there
+	PosX[Index] = Hit.Location.X;
+	PosY[Index] = Hit.Location.Y;
+	PosZ[Index] = Hit.Location.Z;
+
+	if (!Params.bShouldBounce)
+	{
+		SetResting(Index);
+		return;
+	}
+
+	// UProjectileMovementComponent::ComputeBounceDelta: friction on the tangential part, bounciness on the reflected normal
+	const FVector ProjectedNormal = Hit.Normal * -FMath::Min(FVector::DotProduct(Velocity, Hit.Normal), 0.0);
+	FVector Bounced = (Velocity + ProjectedNormal) * FMath::Clamp(1.0f - Params.Friction, 0.0f, 1.0f);
+	Bounced += ProjectedNormal * FMath::Max(Params.Bounciness, 0.0f);
+
+	if (Bounced.SizeSquared() < FMath::Square(Params.StopSpeed))
+	{
+		SetResting(Index);
+		return;
+	}
+
+	VelX[Index] = Bounced.X;
+	VelY[Index] = Bounced.Y;
+	VelZ[Index] = Bounced.Z;
+}
+
+void UProjectileSimulationSubsystem::Integrate(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectilesIntegrate);
+
+	const VectorRegister4Float Dt = VectorSetFloat1(DeltaTime);
+	const VectorRegister4Float HalfDtSquared = VectorSetFloat1(0.5f * DeltaTime * DeltaTime);
+	const VectorRegister4Float One = VectorOneFloat();
+
+	const int32 Padded = ProjectileSimulation::PaddedCount(Num);
+	for (int32 Index = 0; Index < Padded; Index += 4)
+	{
+		VectorRegister4Float PX = VectorLoad(&PosX[Index]);
+		VectorRegister4Float PY = VectorLoad(&PosY[Index]);
+		VectorRegister4Float PZ = VectorLoad(&PosZ[Index]);
+		VectorRegister4Float VX = VectorLoad(&VelX[Index]);
+		VectorRegister4Float VY = VectorLoad(&VelY[Index]);
+		VectorRegister4Float VZ = VectorLoad(&VelZ[Index]);
+		const VectorRegister4Float G = VectorLoad(&Gravity[Index]);
+
+		VectorStore(PX, &PrevX[Index]);
+		VectorStore(PY, &PrevY[Index]);
+		VectorStore(PZ, &PrevZ[Index]);
+
+		// Same move delta as the movement component: v * dt + g * dt^2 / 2, then v += g * dt
+		PX = VectorMultiplyAdd(VX, Dt, PX);
+		PY = VectorMultiplyAdd(VY, Dt, PY);
+		PZ = VectorMultiplyAdd(VZ, Dt, VectorMultiplyAdd(G, HalfDtSquared, PZ));
+		VZ = VectorMultiplyAdd(G, Dt, VZ);
+
+		// Clamp to MaxSpeed; lanes at or under it, resting ones included, select a scale of one
+		const VectorRegister4Float Max = VectorLoad(&MaxSpeed[Index]);
+		const VectorRegister4Float SpeedSquared = VectorMultiplyAdd(VX, VX, VectorMultiplyAdd(VY, VY, VectorMultiply(VZ, VZ)));
+		const VectorRegister4Float Scale = VectorSelect(VectorCompareGT(SpeedSquared, VectorMultiply(Max, Max)), VectorMultiply(Max, VectorReciprocalSqrt(SpeedSquared)), One);
+		VX = VectorMultiply(VX, Scale);
+		VY = VectorMultiply(VY, Scale);
+		VZ = VectorMultiply(VZ, Scale);
+
+		VectorStore(PX, &PosX[Index]);
+		VectorStore(PY, &PosY[Index]);
+		VectorStore(PZ, &PosZ[Index]);
+		VectorStore(VX, &VelX[Index]);
+		VectorStore(VY, &VelY[Index]);
+		VectorStore(VZ, &VelZ[Index]);
+		VectorStore(VectorAdd(VectorLoad(&Age[Index]), Dt), &Age[Index]);
+	}
+}
+
+void UProjectileSimulationSubsystem::RetireExpired()
+{
+	const float KillZ = GetWorld()->GetWorldSettings()->KillZ;
+	for (int32 Index = Num - 1; Index >= 0; --Index)
+	{
+		if (Age[Index] >= LifeSpan[Index] || PosZ[Index] < KillZ)
+		{
+			RemoveAtSwap(Index);
+		}
+	}
+}
+
+void UProjectileSimulationSubsystem::IssueSweeps()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectilesIssueSweeps);
+
+	UWorld* World = GetWorld();
+	static const FName SweepName(TEXT("ProjectileSweep"));
+	const FCollisionQueryParams QueryParams(SweepName);
+
+	// The async trace manager batches these and runs them while the rest of the frame goes on
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const FVector Start(PrevX[Index], PrevY[Index], PrevZ[Index]);
+		const FVector End(PosX[Index], PosY[Index], PosZ[Index]);
+		if (Start.Equals(End))
+		{
+			continue;
+		}
+
+		const FSimulatedProjectileArchetype& Params = Archetypes[ArchetypeIndex[Index]];
+		Sweeps[Index] = World->AsyncSweepByChannel(EAsyncTraceType::Single, Start, End, FQuat::Identity, Params.Channel,
+			FCollisionShape::MakeSphere(Params.Radius), QueryParams, FCollisionResponseParams(Params.Responses));
+	}
+}
+
+void UProjectileSimulationSubsystem::UpdateVisuals()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectilesUpdateVisuals);
+
+	for (TArray<FTransform>& Transforms : InstanceTransforms)
+	{
+		Transforms.Reset();
+	}
+
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const FSimulatedProjectileArchetype& Params = Archetypes[ArchetypeIndex[Index]];
+		const FVector Velocity(VelX[Index], VelY[Index], VelZ[Index]);
+		const FQuat Rotation = Params.bRotationFollowsVelocity && !Velocity.IsNearlyZero() ? Velocity.ToOrientationQuat() : FQuat::Identity;
+		InstanceTransforms[ArchetypeIndex[Index]].Emplace(Rotation, FVector(PosX[Index], PosY[Index], PosZ[Index]), Params.MeshScale);
+	}
+
+	for (int32 ArchetypeIdx = 0; ArchetypeIdx < Archetypes.Num(); ++ArchetypeIdx)
+	{
+		UInstancedStaticMeshComponent* Instances = Archetypes[ArchetypeIdx].Instances;
+		if (!IsValid(Instances))
+		{
+			continue;
+		}
+
+		// Instances are anonymous, only their count has to follow the projectiles
+		const TArray<FTransform>& Transforms = InstanceTransforms[ArchetypeIdx];
+		const int32 Current = Instances->GetInstanceCount();
+		if (Current > Transforms.Num())
+		{
+			TArray<int32> Surplus;
+			for (int32 InstanceIndex = Transforms.Num(); InstanceIndex < Current; ++InstanceIndex)
+			{
+				Surplus.Add(InstanceIndex);
+			}
+			Instances->RemoveInstances(Surplus);
+		}
+		else if (Current < Transforms.Num())
+		{
+			Instances->AddInstances(TArray<FTransform>(Transforms.GetData() + Current, Transforms.Num() - Current), false, true);
+		}
+
+		const int32 NumToUpdate = FMath::Min(Current, Transforms.Num());
+		if (NumToUpdate > 0)
+		{
+			Instances->BatchUpdateInstancesTransforms(0, TArray<FTransform>(Transforms.GetData(), NumToUpdate), true, true, true);
+		}
+	}
+}
+
+TArray<TArray<float>*, TInlineAllocator<16>> UProjectileSimulationSubsystem::GetFloatLanes()
+{
+	return { &PosX, &PosY, &PosZ, &PrevX, &PrevY, &PrevZ, &VelX, &VelY, &VelZ, &Gravity, &MaxSpeed, &Age, &LifeSpan };
+}
+
+static FAutoConsoleCommandWithWorld GProjectileSimulationStatsCommand(
+	TEXT("TheSimulationCrew.ProjectileSim.Stats"),
+	TEXT("Logs how many projectiles the batched simulation has in flight. 'stat game' shows its per-stage cost."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UProjectileSimulationSubsystem* Simulation = World->GetSubsystem<UProjectileSimulationSubsystem>())
+		{
+			UE_LOG(LogTemp, Log, TEXT("[ProjectileSim] %d in flight (max %d), %s"),
+				Simulation->GetNumProjectiles(), Simulation->MaxProjectiles, Simulation->bEnabled ? TEXT("enabled") : TEXT("disabled"));
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GProjectileSimulationBurstCommand(
+	TEXT("TheSimulationCrew.ProjectileSim.Burst"),
+	TEXT("Fires a cone of the weapon's projectiles from the player's view to load the simulation. Usage: TheSimulationCrew.ProjectileSim.Burst [Count=1000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UProjectileSimulationSubsystem* Simulation = World->GetSubsystem<UProjectileSimulationSubsystem>();
+		APlayerController* PlayerController = World->GetFirstPlayerController();
+		if (Simulation == nullptr || PlayerController == nullptr || PlayerController->PlayerCameraManager == nullptr)
+		{
+			return;
+		}
+
+		TSubclassOf<ATheSimulationCrewProjectile> Class = ATheSimulationCrewProjectile::StaticClass();
+		for (TObjectIterator<UTP_WeaponComponent> It; It; ++It)
+		{
+			if (It->GetWorld() == World && It->ProjectileClass != nullptr)
+			{
+				Class = It->ProjectileClass;
+				break;
+			}
+		}
+
+		const int32 Count = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1000;
+		const FVector Origin = PlayerController->PlayerCameraManager->GetCameraLocation();
+		const FVector Forward = PlayerController->PlayerCameraManager->GetCameraRotation().Vector();
+
+		const double Start = FPlatformTime::Seconds();
+		int32 Fired = 0;
+		for (int32 Shot = 0; Shot < Count; ++Shot)
+		{
+			const FVector Direction = FMath::VRandCone(Forward, FMath::DegreesToRadians(15.0f));
+			Fired += Simulation->Fire(Class, Origin + Direction * 100.0f, Direction.Rotation()) ? 1 : 0;
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("[ProjectileSim] fired %d of %d %s in %.2f ms, %d in flight"),
+			Fired, Count, *Class->GetName(), (FPlatformTime::Seconds() - Start) * 1000.0, Simulation->GetNumProjectiles());
+	}));
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+#include "ProjectileSimulationSubsystem.generated.h"
+
+class ATheSimulationCrewProjectile;
+class UInstancedStaticMeshComponent;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnSimulatedProjectileImpact, const FHitResult&, Hit, FVector, Velocity);
+
+/** Flight parameters and visuals shared by all simulated projectiles of one class, taken from its defaults */
+USTRUCT()
+struct FSimulatedProjectileArchetype
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<UClass> Class;
+
+	/** One instance per projectile in flight, rebuilt every tick */
+	UPROPERTY()
+	TObjectPtr<UInstancedStaticMeshComponent> Instances;
+
+	float Radius = 5.0f;
+	float InitialSpeed = 3000.0f;
+	float MaxSpeed = 3000.0f;
+	float GravityZ = 0.0f;
+	float Bounciness = 0.6f;
+	float Friction = 0.2f;
+	float StopSpeed = 5.0f;
+	float LifeSpan = 3.0f;
+	bool bShouldBounce = true;
+	bool bRotationFollowsVelocity = true;
+
+	FVector MeshScale = FVector::OneVector;
+	TEnumAsByte<ECollisionChannel> Channel = ECC_WorldDynamic;
+	FCollisionResponseContainer Responses;
+};
+
+/**
+ * Simulates every in-flight projectile in one batch instead of one actor with its own movement and
+ * sphere component per shot.
+ *
+ * State lives in structure-of-arrays lanes padded to four so integration runs four projectiles per
+ * SIMD instruction. Each projectile's segment for the frame is swept with an async sphere trace and
+ * the results are resolved at the start of the next tick, where hits bounce with the class's
+ * movement settings. Hits on simulating bodies keep ATheSimulationCrewProjectile::OnHit's behaviour,
+ * an impulse of velocity * 100, and end the projectile. Visuals are one instanced mesh per class;
+ * no actor exists per projectile, impacts are reported through OnImpact for effects.
+ */
+UCLASS(config=Game)
+class THESIMULATIONCREW_API UProjectileSimulationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Weapons fire into this simulation instead of the projectile actor pool */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Projectiles)
+	bool bEnabled = true;
+
+	/** Shots beyond this many projectiles in flight are fired as pooled projectile actors instead */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Projectiles, meta=(ClampMin="1"))
+	int32 MaxProjectiles = 4096;
+
+	/** Fired for every blocking hit, before the bounce is applied */
+	UPROPERTY(BlueprintAssignable, Category=Projectiles)
+	FOnSimulatedProjectileImpact OnImpact;
+
+	/**
+	 * Launches a projectile of Class from Location along Rotation. Like the weapon's spawn rule the
+	 * shot is skipped when the muzzle is inside blocking geometry.
+	 */
+	bool Fire(TSubclassOf<ATheSimulationCrewProjectile> Class, const FVector& Location, const FRotator& Rotation);
+
+	UFUNCTION(BlueprintPure, Category=Projectiles)
+	int32 GetNumProjectiles() const { return Num; }
+
+	/** No room for another projectile, Fire would drop the shot */
+	bool IsFull() const { return Num >= MaxProjectiles; }
+
+	// Begin FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	// End FTickableGameObject
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+
+private:
+	UPROPERTY()
+	TArray<FSimulatedProjectileArchetype> Archetypes;
+
+	/** Owns the instanced mesh components, the only actor this simulation spawns */
+	UPROPERTY()
+	TObjectPtr<AActor> VisualHost;
+
+	// Per-projectile lanes, all sized to Num rounded up to a multiple of 4 with zeroed padding
+	TArray<float> PosX, PosY, PosZ;
+	TArray<float> PrevX, PrevY, PrevZ;
+	TArray<float> VelX, VelY, VelZ;
+	TArray<float> Gravity;
+	TArray<float> MaxSpeed;
+	TArray<float> Age;
+	TArray<float> LifeSpan;
+	TArray<uint16> ArchetypeIndex;
+	TArray<FTraceHandle> Sweeps;
+
+	int32 Num = 0;
+
+	/** Scratch transforms per archetype, reused between ticks */
+	TArray<TArray<FTransform>> InstanceTransforms;
+
+	int32 FindOrAddArchetype(UClass* Class);
+	int32 AddProjectile();
+	void RemoveAtSwap(int32 Index);
+	void SetResting(int32 Index);
+
+	void ResolveSweeps();
+	void HandleHit(int32 Index, const FHitResult& Hit);
+	void Integrate(float DeltaTime);
+	void RetireExpired();
+	void IssueSweeps();
+	void UpdateVisuals();
+
+	/** The float lanes, for resizing and moving projectiles as a unit */
+	TArray<TArray<float>*, TInlineAllocator<16>> GetFloatLanes();
+};
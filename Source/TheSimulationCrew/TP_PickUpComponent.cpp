@@ -1,6 +1,8 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "TP_PickUpComponent.h"
+#include "PickupProximitySubsystem.h"
+#include "Engine/World.h"
 
 UTP_PickUpComponent::UTP_PickUpComponent()
 {
@@ -12,10 +14,30 @@ void UTP_PickUpComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// Let the proximity manager test characters against our radius, no physics body needed
+	UPickupProximitySubsystem* Proximity = UWorld::GetSubsystem<UPickupProximitySubsystem>(GetWorld());
+	if (Proximity != nullptr && Proximity->bEnabled)
+	{
+		SetGenerateOverlapEvents(false);
+		SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Proximity->RegisterPickup(this);
+		return;
+	}
+
 	// Register our Overlap Event
 	OnComponentBeginOverlap.AddDynamic(this, &UTP_PickUpComponent::OnSphereBeginOverlap);
 }
 
+void UTP_PickUpComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UPickupProximitySubsystem* Proximity = UWorld::GetSubsystem<UPickupProximitySubsystem>(GetWorld()))
+	{
+		Proximity->UnregisterPickup(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void UTP_PickUpComponent::OnSphereBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
 	// Checking if it is a First Person Character overlapping
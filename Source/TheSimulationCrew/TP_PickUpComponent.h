@@ -23,11 +23,17 @@ public:
 	FOnPickUp OnPickUp;
 
 	UTP_PickUpComponent();
+
+	/** Slot in the proximity manager's dense arrays, INDEX_NONE while unregistered */
+	int32 ProximityIndex = INDEX_NONE;
 protected:
 
 	/** Called when the game starts */
 	virtual void BeginPlay() override;
 
+	/** Called when the game ends or the pickup is destroyed */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	/** Code for when something overlaps this component */
 	UFUNCTION()
 	void OnSphereBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
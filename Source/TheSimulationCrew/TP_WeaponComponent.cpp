@@ -4,6 +4,8 @@
 #include "TP_WeaponComponent.h"
 #include "TheSimulationCrewCharacter.h"
 #include "TheSimulationCrewProjectile.h"
+#include "ProjectilePoolSubsystem.h"
+#include "ProjectileSimulationSubsystem.h"
 #include "GameFramework/PlayerController.h"
 #include "Camera/PlayerCameraManager.h"
 #include "Kismet/GameplayStatics.h"
@@ -34,17 +36,24 @@ void UTP_WeaponComponent::Fire()
 		UWorld* const World = GetWorld();
 		if (World != nullptr)
 		{
-			APlayerController* PlayerController = Cast<APlayerController>(Character->GetController());
-			const FRotator SpawnRotation = PlayerController->PlayerCameraManager->GetCameraRotation();
+			// AI shooters have no camera manager and aim along their control rotation
+			const APlayerController* PlayerController = Cast<APlayerController>(Character->GetController());
+			const FRotator SpawnRotation = PlayerController != nullptr && PlayerController->PlayerCameraManager != nullptr
+				? PlayerController->PlayerCameraManager->GetCameraRotation()
+				: Character->GetController()->GetControlRotation();
 			// MuzzleOffset is in camera space, so transform it to world space before offsetting from the character location to find the final muzzle position
 			const FVector SpawnLocation = GetOwner()->GetActorLocation() + SpawnRotation.RotateVector(MuzzleOffset);
 	
-			//Set Spawn Collision Handling Override
-			FActorSpawnParameters ActorSpawnParams;
-			ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
-	
-			// Spawn the projectile at the muzzle
-			World->SpawnActor<ATheSimulationCrewProjectile>(ProjectileClass, SpawnLocation, SpawnRotation, ActorSpawnParams);
+			// Fire into the batched simulation, or a pooled projectile actor when it is turned off or full
+			UProjectileSimulationSubsystem* ProjectileSimulation = World->GetSubsystem<UProjectileSimulationSubsystem>();
+			if (ProjectileSimulation != nullptr && ProjectileSimulation->bEnabled && !ProjectileSimulation->IsFull())
+			{
+				ProjectileSimulation->Fire(ProjectileClass, SpawnLocation, SpawnRotation);
+			}
+			else if (UProjectilePoolSubsystem* ProjectilePool = World->GetSubsystem<UProjectilePoolSubsystem>())
+			{
+				ProjectilePool->Acquire(ProjectileClass, SpawnLocation, SpawnRotation);
+			}
 		}
 	}
 	
@@ -83,6 +92,14 @@ bool UTP_WeaponComponent::AttachWeapon(ATheSimulationCrewCharacter* TargetCharac
 	// add the weapon as an instance component to the character
 	Character->AddInstanceComponent(this);
 
+	// Have projectiles ready before the first shot, the batched simulation needs actors only once it is full
+	const UProjectileSimulationSubsystem* ProjectileSimulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>();
+	UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>();
+	if (ProjectilePool != nullptr && (ProjectileSimulation == nullptr || !ProjectileSimulation->bEnabled))
+	{
+		ProjectilePool->Prewarm(ProjectileClass, ProjectilePool->PrewarmCount);
+	}
+
 	// Set up action bindings
 	if (APlayerController* PlayerController = Cast<APlayerController>(Character->GetController()))
 	{
@@ -9,5 +9,7 @@ public class TheSimulationCrew : ModuleRules
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput", "WebSockets" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "AiBridge" });
 	}
 }
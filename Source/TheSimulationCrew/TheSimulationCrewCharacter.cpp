@@ -2,6 +2,7 @@
 
 #include "TheSimulationCrewCharacter.h"
 #include "TheSimulationCrewProjectile.h"
+#include "NpcSignificanceSubsystem.h"
 #include "Animation/AnimInstance.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
@@ -36,12 +37,31 @@ ATheSimulationCrewCharacter::ATheSimulationCrewCharacter()
 	//Mesh1P->SetRelativeRotation(FRotator(0.9f, -19.19f, 5.2f));
 	Mesh1P->SetRelativeLocation(FVector(-30.f, 0.f, -150.f));
 
+	// Let the significance manager set animation frame skips on the body mesh NPCs are seen with
+	GetMesh()->bEnableUpdateRateOptimizations = true;
+
 }
 
 void ATheSimulationCrewCharacter::BeginPlay()
 {
 	// Call the base class  
 	Super::BeginPlay();
+
+	// Throttle tick, movement and animation by how much the player would notice
+	if (UNpcSignificanceSubsystem* Significance = UWorld::GetSubsystem<UNpcSignificanceSubsystem>(GetWorld()))
+	{
+		Significance->RegisterCharacter(this);
+	}
+}
+
+void ATheSimulationCrewCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UNpcSignificanceSubsystem* Significance = UWorld::GetSubsystem<UNpcSignificanceSubsystem>(GetWorld()))
+	{
+		Significance->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 //////////////////////////////////////////////////////////////////////////// Input
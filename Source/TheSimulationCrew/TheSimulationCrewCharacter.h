@@ -42,6 +42,7 @@ public:
 
 protected:
 	virtual void BeginPlay();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 		
@@ -67,5 +68,8 @@ public:
 	/** Returns FirstPersonCameraComponent subobject **/
 	UCameraComponent* GetFirstPersonCameraComponent() const { return FirstPersonCameraComponent; }
 
+	/** Slot in the significance manager's dense arrays, INDEX_NONE while unregistered */
+	int32 SignificanceIndex = INDEX_NONE;
+
 };
 
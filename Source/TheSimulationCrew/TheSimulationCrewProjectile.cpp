@@ -3,6 +3,8 @@
 #include "TheSimulationCrewProjectile.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Components/SphereComponent.h"
+#include "ProjectilePoolSubsystem.h"
+#include "Engine/World.h"
 
 ATheSimulationCrewProjectile::ATheSimulationCrewProjectile() 
 {
@@ -38,6 +40,74 @@ void ATheSimulationCrewProjectile::OnHit(UPrimitiveComponent* HitComp, AActor* O
 	{
 		OtherComp->AddImpulseAtLocation(GetVelocity() * 100.0f, GetActorLocation());
 
+		Retire();
+	}
+}
+
+void ATheSimulationCrewProjectile::ActivateFromPool(const FVector& Location, const FRotator& Rotation)
+{
+	bParked = false;
+
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	// Same launch the movement component does on spawn: initial speed along the facing
+	ProjectileMovement->SetUpdatedComponent(CollisionComp);
+	ProjectileMovement->Velocity = Rotation.Vector() * ProjectileMovement->InitialSpeed;
+	ProjectileMovement->UpdateComponentVelocity();
+	ProjectileMovement->SetComponentTickEnabled(true);
+
+	// SetLifeSpan overwrites InitialLifeSpan, so read it from the class defaults
+	SetLifeSpan(GetClass()->GetDefaultObject<ATheSimulationCrewProjectile>()->InitialLifeSpan);
+}
+
+void ATheSimulationCrewProjectile::DeactivateToPool()
+{
+	bParked = true;
+
+	SetLifeSpan(0.0f);
+
+	// Clearing the updated component is how the movement component stops itself, safe from inside a hit
+	ProjectileMovement->Velocity = FVector::ZeroVector;
+	ProjectileMovement->SetUpdatedComponent(nullptr);
+	ProjectileMovement->SetComponentTickEnabled(false);
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+void ATheSimulationCrewProjectile::LifeSpanExpired()
+{
+	if (bPooled)
+	{
+		Retire();
+		return;
+	}
+
+	Super::LifeSpanExpired();
+}
+
+void ATheSimulationCrewProjectile::FellOutOfWorld(const UDamageType& DmgType)
+{
+	if (bPooled)
+	{
+		Retire();
+		return;
+	}
+
+	Super::FellOutOfWorld(DmgType);
+}
+
+void ATheSimulationCrewProjectile::Retire()
+{
+	UProjectilePoolSubsystem* Pool = bPooled ? GetWorld()->GetSubsystem<UProjectilePoolSubsystem>() : nullptr;
+	if (Pool != nullptr)
+	{
+		Pool->Release(this);
+	}
+	else
+	{
 		Destroy();
 	}
 }
\ No newline at end of file
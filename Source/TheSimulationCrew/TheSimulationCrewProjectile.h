@@ -29,9 +29,30 @@ public:
 	UFUNCTION()
 	void OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
 
+	/** Puts a parked projectile back in flight from Location, resetting movement, collision and lifespan */
+	void ActivateFromPool(const FVector& Location, const FRotator& Rotation);
+
+	/** Stops, hides and disables the projectile so UProjectilePoolSubsystem can fire it again */
+	void DeactivateToPool();
+
+	virtual void LifeSpanExpired() override;
+	virtual void FellOutOfWorld(const UDamageType& DmgType) override;
+
 	/** Returns CollisionComp subobject **/
 	USphereComponent* GetCollisionComp() const { return CollisionComp; }
 	/** Returns ProjectileMovement subobject **/
 	UProjectileMovementComponent* GetProjectileMovement() const { return ProjectileMovement; }
+
+private:
+	friend class UProjectilePoolSubsystem;
+
+	/** Owned by the pool: hits and lifespan expiry hand it back instead of destroying it */
+	bool bPooled = false;
+
+	/** Sitting in the pool, hidden and without collision */
+	bool bParked = false;
+
+	/** Back to the pool when pooled, destroyed otherwise */
+	void Retire();
 };
 